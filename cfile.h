@@ -91,6 +91,7 @@ typedef struct _capture_file {
   dfilter_t   *rfcode;          /* Compiled read filter program */
   dfilter_t   *dfcode;          /* Compiled display filter program */
   gchar       *dfilter;         /* Display filter string */
+  struct _filter_cache *filter_cache; /* Results of the last display filters */
   gboolean     redissecting;    /* TRUE if currently redissecting (cf_redissect_packets) */
   /* search */
   gchar       *sfilter;         /* Filter, hex value, or string being searched */
@@ -58,6 +58,12 @@ static GSList *color_filter_list = NULL;
 static GSList *color_filter_deleted_list = NULL;
 static GSList *color_filter_valid_list   = NULL;
 
+/* The enabled, compiled filters of color_filter_list, applied as one
+ * dfilter_set_t so that rules share field loads and common tests;
+ * rebuilt on demand after color_filter_list changes */
+static dfilter_set_t *color_filter_set = NULL;
+static GPtrArray     *color_filter_set_members = NULL;
+
 /* Color Filters can en-/disabled. */
 static gboolean filters_enabled = TRUE;
 
@@ -85,6 +91,37 @@ color_filter_new(const gchar *name,          /* The name of the filter to create
     return colorf;
 }
 
+/* Forget the filter set; must be done before any filter of
+ * color_filter_list is changed or freed */
+static void
+color_filters_invalidate_set(void)
+{
+    if (color_filter_set != NULL) {
+        dfilter_set_free(color_filter_set);
+        color_filter_set = NULL;
+        g_ptr_array_free(color_filter_set_members, TRUE);
+        color_filter_set_members = NULL;
+    }
+}
+
+static void
+color_filters_build_set(void)
+{
+    GSList         *curr;
+    color_filter_t *colorf;
+
+    color_filter_set = dfilter_set_new();
+    color_filter_set_members = g_ptr_array_new();
+
+    for (curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
+        colorf = (color_filter_t *)curr->data;
+        if ( (!colorf->disabled) && (colorf->c_colorfilter != NULL) ) {
+            dfilter_set_add(color_filter_set, colorf->c_colorfilter);
+            g_ptr_array_add(color_filter_set_members, colorf);
+        }
+    }
+}
+
 /* Add ten empty (temporary) colorfilters for easy coloring */
 static void
 color_filters_add_tmp(GSList **cfl)
@@ -149,6 +186,8 @@ color_filters_set_tmp(guint8 filt_nr, gchar *filter, gboolean disabled)
     gchar          *err_msg;
     guint8         i;
 
+    color_filters_invalidate_set();
+
     /* Go through the tomporary filters and look for the same filter string.
      * If found, clear it so that a filter can be "moved" up and down the list
      */
@@ -283,6 +322,8 @@ color_filter_list_clone(GSList *cfl)
 void
 color_filters_init(void)
 {
+    color_filters_invalidate_set();
+
     /* delete all currently existing filters */
     color_filter_list_delete(&color_filter_list);
 
@@ -298,6 +339,8 @@ color_filters_init(void)
 void
 color_filters_reload(void)
 {
+    color_filters_invalidate_set();
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -340,7 +383,7 @@ color_filter_compile_cb(gpointer filter_arg, gpointer unused _U_)
     gchar *err_msg;
 
     g_assert(colorf->c_colorfilter == NULL);
-    if (!dfilter_compile(colorf->filter_text, &colorf->c_colorfilter, &err_msg)) {
+    if (!dfilter_compile_cached(colorf->filter_text, &colorf->c_colorfilter, &err_msg)) {
         simple_dialog(ESD_TYPE_ERROR, ESD_BTN_OK,
                       "Could not compile color filter name: \"%s\" text: \"%s\".\n%s",
                       colorf->filter_name, colorf->filter_text, err_msg);
@@ -358,7 +401,7 @@ color_filter_validate_cb(gpointer filter_arg, gpointer unused _U_)
     gchar *err_msg;
 
     g_assert(colorf->c_colorfilter == NULL);
-    if (!dfilter_compile(colorf->filter_text, &colorf->c_colorfilter, &err_msg)) {
+    if (!dfilter_compile_cached(colorf->filter_text, &colorf->c_colorfilter, &err_msg)) {
         simple_dialog(ESD_TYPE_ERROR, ESD_BTN_OK,
                       "Removing color filter name: \"%s\" text: \"%s\".\n%s",
                       colorf->filter_name, colorf->filter_text, err_msg);
@@ -373,6 +416,8 @@ color_filter_validate_cb(gpointer filter_arg, gpointer unused _U_)
 void
 color_filters_apply(GSList *tmp_cfl, GSList *edit_cfl)
 {
+    color_filters_invalidate_set();
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -437,22 +482,16 @@ color_filters_prime_edt(epan_dissect_t *edt)
 const color_filter_t *
 color_filters_colorize_packet(epan_dissect_t *edt)
 {
-    GSList         *curr;
-    color_filter_t *colorf;
+    int match;
 
     /* If we have color filters, "search" for the matching one. */
     if (color_filters_used()) {
-        curr = color_filter_list;
-
-        while(curr != NULL) {
-            colorf = (color_filter_t *)curr->data;
-            if ( (!colorf->disabled) &&
-                 (colorf->c_colorfilter != NULL) &&
-                 dfilter_apply_edt(colorf->c_colorfilter, edt)) {
-                return colorf;
-            }
-            curr = g_slist_next(curr);
-        }
+        if (color_filter_set == NULL)
+            color_filters_build_set();
+
+        match = dfilter_set_first_match_edt(color_filter_set, edt);
+        if (match >= 0)
+            return (const color_filter_t *)g_ptr_array_index(color_filter_set_members, match);
     }
 
     return NULL;
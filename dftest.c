@@ -30,11 +30,15 @@
 
 #include <glib.h>
 
+#include <epan/epan-int.h>
 #include <epan/epan.h>
+#include <epan/epan_dissect.h>
 #include <epan/timestamp.h>
 #include <epan/prefs.h>
 #include <epan/dfilter/dfilter.h>
 
+#include <wiretap/wtap.h>
+
 #ifdef HAVE_PLUGINS
 #include <wsutil/plugins.h>
 #endif
@@ -44,6 +48,10 @@
 
 #include "ui/util.h"
 #include "register.h"
+#include "frame_tvbuff.h"
+
+/* Number of times each filter is applied to every frame with "-b" */
+#define BENCH_ITERATIONS	100
 
 static void failure_message(const char *msg_format, va_list ap);
 static void open_failure_message(const char *filename, int err,
@@ -51,11 +59,201 @@ static void open_failure_message(const char *filename, int err,
 static void read_failure_message(const char *filename, int err);
 static void write_failure_message(const char *filename, int err);
 
+static const frame_data *ref;
+static const frame_data *prev_dis;
+
+static const nstime_t *
+bench_get_frame_ts(void *data _U_, guint32 frame_num)
+{
+	if (ref && ref->num == frame_num)
+		return &ref->abs_ts;
+
+	if (prev_dis && prev_dis->num == frame_num)
+		return &prev_dis->abs_ts;
+
+	return NULL;
+}
+
+/*
+ * Dissect every frame of a capture file once and time applying the
+ * filter to the resulting tree, both with the bytecode interpreter
+ * and with threaded code.  Returns the exit status.
+ */
+static int
+benchmark(const char *cf_name, const char *text)
+{
+	dfilter_t	*df_interp, *df_threaded, *df_adaptive;
+	gchar		*err_msg;
+	wtap		*wth;
+	int		err;
+	gchar		*err_info;
+	gint64		data_offset;
+	epan_t		*session;
+	epan_dissect_t	*edt;
+	frame_data	fdata, ref_frame, prev_dis_frame;
+	nstime_t	elapsed_time;
+	guint32		framenum = 0, cum_bytes = 0;
+	guint32		passed = 0, mismatches = 0;
+	gboolean	result_interp = FALSE, result_threaded = FALSE;
+	gboolean	result_adaptive = FALSE;
+	GTimer		*timer_interp, *timer_threaded, *timer_adaptive;
+	gdouble		secs_interp, secs_threaded, secs_adaptive;
+	int		i, status = 0;
+
+	dfilter_set_threaded_code(FALSE);
+	if (!dfilter_compile(text, &df_interp, &err_msg)) {
+		fprintf(stderr, "dftest: %s\n", err_msg);
+		g_free(err_msg);
+		return 2;
+	}
+	dfilter_set_threaded_code(TRUE);
+	if (!dfilter_compile(text, &df_threaded, &err_msg)) {
+		fprintf(stderr, "dftest: %s\n", err_msg);
+		g_free(err_msg);
+		dfilter_free(df_interp);
+		return 2;
+	}
+	dfilter_set_adaptive_order(TRUE);
+	if (!dfilter_compile(text, &df_adaptive, &err_msg)) {
+		fprintf(stderr, "dftest: %s\n", err_msg);
+		g_free(err_msg);
+		dfilter_free(df_interp);
+		dfilter_free(df_threaded);
+		return 2;
+	}
+	dfilter_set_adaptive_order(FALSE);
+	if (df_interp == NULL) {
+		fprintf(stderr, "dftest: Filter is empty\n");
+		return 2;
+	}
+
+	wth = wtap_open_offline(cf_name, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+	if (wth == NULL) {
+		fprintf(stderr, "dftest: Can't open %s: %s\n", cf_name,
+			wtap_strerror(err));
+		if (err_info != NULL) {
+			fprintf(stderr, "(%s)\n", err_info);
+			g_free(err_info);
+		}
+		dfilter_free(df_interp);
+		dfilter_free(df_threaded);
+		dfilter_free(df_adaptive);
+		return 2;
+	}
+
+	session = epan_new();
+	session->data = NULL;
+	session->get_frame_ts = bench_get_frame_ts;
+	session->get_interface_name = NULL;
+	session->get_user_comment = NULL;
+
+	edt = epan_dissect_new(session, TRUE, FALSE);
+	nstime_set_zero(&elapsed_time);
+
+	timer_interp = g_timer_new();
+	g_timer_stop(timer_interp);
+	timer_threaded = g_timer_new();
+	g_timer_stop(timer_threaded);
+	timer_adaptive = g_timer_new();
+	g_timer_stop(timer_adaptive);
+
+	while (wtap_read(wth, &err, &err_info, &data_offset)) {
+		framenum++;
+		frame_data_init(&fdata, framenum, wtap_phdr(wth), data_offset, cum_bytes);
+		frame_data_set_before_dissect(&fdata, &elapsed_time, &ref, prev_dis);
+		if (ref == &fdata) {
+			ref_frame = fdata;
+			ref = &ref_frame;
+		}
+
+		/* Both filters need the same fields. */
+		epan_dissect_prime_dfilter(edt, df_interp);
+		epan_dissect_run(edt, wtap_file_type_subtype(wth), wtap_phdr(wth),
+			frame_tvbuff_new(&fdata, wtap_buf_ptr(wth)), &fdata, NULL);
+
+		g_timer_continue(timer_interp);
+		for (i = 0; i < BENCH_ITERATIONS; i++)
+			result_interp = dfilter_apply_edt(df_interp, edt);
+		g_timer_stop(timer_interp);
+
+		g_timer_continue(timer_threaded);
+		for (i = 0; i < BENCH_ITERATIONS; i++)
+			result_threaded = dfilter_apply_edt(df_threaded, edt);
+		g_timer_stop(timer_threaded);
+
+		g_timer_continue(timer_adaptive);
+		for (i = 0; i < BENCH_ITERATIONS; i++)
+			result_adaptive = dfilter_apply_edt(df_adaptive, edt);
+		g_timer_stop(timer_adaptive);
+
+		if (result_interp)
+			passed++;
+		if (result_interp != result_threaded || result_interp != result_adaptive)
+			mismatches++;
+
+		frame_data_set_after_dissect(&fdata, &cum_bytes);
+		prev_dis_frame = fdata;
+		prev_dis = &prev_dis_frame;
+
+		epan_dissect_reset(edt);
+		frame_data_destroy(&fdata);
+	}
+	if (err != 0) {
+		fprintf(stderr, "dftest: Error reading %s: %s\n", cf_name,
+			wtap_strerror(err));
+		if (err_info != NULL) {
+			fprintf(stderr, "(%s)\n", err_info);
+			g_free(err_info);
+		}
+		status = 2;
+	}
+
+	secs_interp = g_timer_elapsed(timer_interp, NULL);
+	secs_threaded = g_timer_elapsed(timer_threaded, NULL);
+	secs_adaptive = g_timer_elapsed(timer_adaptive, NULL);
+
+	printf("Frames: %u, passed: %u, iterations per frame: %d\n",
+		framenum, passed, BENCH_ITERATIONS);
+	if (framenum > 0) {
+		printf("Interpreter:   %10.3f ns/frame\n",
+			secs_interp * 1e9 / ((gdouble)framenum * BENCH_ITERATIONS));
+		printf("Threaded code: %10.3f ns/frame",
+			secs_threaded * 1e9 / ((gdouble)framenum * BENCH_ITERATIONS));
+		if (secs_threaded > 0)
+			printf(" (%.2fx)", secs_interp / secs_threaded);
+		printf("\n");
+		printf("Adaptive order:%10.3f ns/frame",
+			secs_adaptive * 1e9 / ((gdouble)framenum * BENCH_ITERATIONS));
+		if (secs_adaptive > 0)
+			printf(" (%.2fx)", secs_interp / secs_adaptive);
+		printf("\n");
+	}
+	if (mismatches > 0) {
+		fprintf(stderr, "dftest: %u frames gave different results with threaded code or adaptive order\n",
+			mismatches);
+		status = 1;
+	}
+
+	g_timer_destroy(timer_interp);
+	g_timer_destroy(timer_threaded);
+	g_timer_destroy(timer_adaptive);
+	epan_dissect_free(edt);
+	epan_free(session);
+	wtap_close(wth);
+	dfilter_free(df_interp);
+	dfilter_free(df_threaded);
+	dfilter_free(df_adaptive);
+	return status;
+}
+
 int
 main(int argc, char **argv)
 {
 	char		*init_progfile_dir_error;
 	char		*text;
+	const char	*bench_file = NULL;
+	int		filter_index = 1;
+	int		status;
 	char		*gpf_path, *pf_path;
 	int		gpf_open_errno, gpf_read_errno;
 	int		pf_open_errno, pf_read_errno;
@@ -133,17 +331,29 @@ main(int argc, char **argv)
 	line that its preferences have changed. */
 	prefs_apply_all();
 
+	/* Check for a capture file to benchmark against */
+	if (argc > 2 && strcmp(argv[1], "-b") == 0) {
+		bench_file = argv[2];
+		filter_index = 3;
+	}
+
 	/* Check for filter on command line */
-	if (argc <= 1) {
-		fprintf(stderr, "Usage: dftest <filter>\n");
+	if (argc <= filter_index) {
+		fprintf(stderr, "Usage: dftest [-b <capture file>] <filter>\n");
 		exit(1);
 	}
 
 	/* Get filter text */
-	text = get_args_as_string(argc, argv, 1);
+	text = get_args_as_string(argc, argv, filter_index);
 
 	printf("Filter: \"%s\"\n", text);
 
+	if (bench_file) {
+		status = benchmark(bench_file, text);
+		epan_cleanup();
+		exit(status);
+	}
+
 	/* Compile it */
 	if (!dfilter_compile(text, &df, &err_msg)) {
 		fprintf(stderr, "dftest: %s\n", err_msg);
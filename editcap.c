@@ -85,7 +85,8 @@
 #include <wsutil/filesystem.h>
 #include <wsutil/report_err.h>
 #include <wsutil/strnatcmp.h>
-#include <wsutil/md5.h>
+#include <wsutil/mmh3.h>
+#include <wsutil/pint.h>
 #include <wsutil/plugins.h>
 #include <wsutil/crash_info.h>
 #include <wsutil/ws_version_info.h>
@@ -103,9 +104,16 @@ struct select_item {
 
 /*
  * Duplicate frame detection
+ *
+ * The digests of the frames in the window are kept in fd_hash[], as a
+ * ring, the oldest being replaced by the newest.  To find a frame's
+ * digest without looking at all of them, fd_hash_index[] is an open
+ * addressing hash table, with linear probing, of the entries in the
+ * ring, stored there +1 so that 0 means an empty slot; it's kept at
+ * most half full.
  */
 typedef struct _fd_hash_t {
-    md5_byte_t digest[16];
+    guint8     digest[MMH3_DIGEST_LEN];
     guint32    len;
     nstime_t   time;
 } fd_hash_t;
@@ -113,9 +121,12 @@ typedef struct _fd_hash_t {
 #define DEFAULT_DUP_DEPTH       5   /* Used with -d */
 #define MAX_DUP_DEPTH     1000000   /* the maximum window (and actual size of fd_hash[]) for de-duplication */
 
-static fd_hash_t fd_hash[MAX_DUP_DEPTH];
-static int       dup_window    = DEFAULT_DUP_DEPTH;
-static int       cur_dup_entry = 0;
+static fd_hash_t *fd_hash       = NULL;
+static int        dup_window    = DEFAULT_DUP_DEPTH;
+static int        cur_dup_entry = 0;
+static int        fd_hash_used  = 0;    /* entries of fd_hash[] filled in */
+static guint32   *fd_hash_index = NULL;
+static guint32    fd_hash_index_mask;
 
 static int       ignored_bytes  = 0;  /* Used with -I */
 
@@ -532,113 +543,151 @@ set_rel_time(char *optarg_str_p)
     relative_time_window.nsecs = (int)val;
 }
 
-static gboolean
-is_duplicate(guint8* fd, guint32 len) {
-    int i;
-    md5_state_t ms;
+static void
+fd_hash_init(void)
+{
+    guint32 size = 2;
+
+    /* Even a window of 0 has the current frame in it */
+    fd_hash = g_new0(fd_hash_t, MAX(dup_window, 1));
+    while (size < 2 * (guint32)dup_window)
+        size *= 2;
+    fd_hash_index = g_new0(guint32, size);
+    fd_hash_index_mask = size - 1;
+}
 
-    /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
-    guint32 new_len;
-    guint8 *new_fd;
+static void
+fd_hash_cleanup(void)
+{
+    g_free(fd_hash);
+    g_free(fd_hash_index);
+    fd_hash = NULL;
+    fd_hash_index = NULL;
+}
 
-    new_fd  = &fd[ignored_bytes];
-    new_len = len - (ignored_bytes);
+/* Where in fd_hash_index[] an entry with this digest belongs */
+#define FD_HASH_HOME(digest) (pletoh32(digest) & fd_hash_index_mask)
 
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
+static void
+fd_hash_index_add(guint32 entry)
+{
+    guint32 pos = FD_HASH_HOME(fd_hash[entry].digest);
 
-    /* Calculate our digest */
-    md5_init(&ms);
-    md5_append(&ms, new_fd, new_len);
-    md5_finish(&ms, fd_hash[cur_dup_entry].digest);
+    while (fd_hash_index[pos] != 0)
+        pos = (pos + 1) & fd_hash_index_mask;
+    fd_hash_index[pos] = entry + 1;
+}
 
-    fd_hash[cur_dup_entry].len = len;
+static void
+fd_hash_index_remove(guint32 entry)
+{
+    guint32 pos = FD_HASH_HOME(fd_hash[entry].digest);
+    guint32 next, home;
 
-    /* Look for duplicates */
-    for (i = 0; i < dup_window; i++) {
-        if (i == cur_dup_entry)
-            continue;
+    while (fd_hash_index[pos] != entry + 1)
+        pos = (pos + 1) & fd_hash_index_mask;
 
-        if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-            && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
+    /*
+     * Rather than leaving a marker behind, move back any entry further
+     * along that can't be found any more with this slot empty, and then
+     * do the same for the slot it was in.
+     */
+    for (;;) {
+        fd_hash_index[pos] = 0;
+        next = pos;
+        for (;;) {
+            next = (next + 1) & fd_hash_index_mask;
+            if (fd_hash_index[next] == 0)
+                return;
+            home = FD_HASH_HOME(fd_hash[fd_hash_index[next] - 1].digest);
+            /* Is home cyclically outside (pos, next]? */
+            if (pos <= next ? (home <= pos || home > next)
+                            : (home <= pos && home > next))
+                break;
         }
+        fd_hash_index[pos] = fd_hash_index[next];
+        pos = next;
     }
-
-    return FALSE;
 }
 
-static gboolean
-is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
-    int i;
-    md5_state_t ms;
-
+/*
+ * Put the digest of a frame in the next entry of the ring, in place of
+ * the oldest one.
+ */
+static void
+fd_hash_add(const guint8* fd, guint32 len, const nstime_t *current)
+{
     /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
-    guint32 new_len;
-    guint8 *new_fd;
-
-    new_fd  = &fd[ignored_bytes];
-    new_len = len - (ignored_bytes);
+    guint32 skip = MIN((guint32)ignored_bytes, len);
 
     cur_dup_entry++;
     if (cur_dup_entry >= dup_window)
         cur_dup_entry = 0;
 
-    /* Calculate our digest */
-    md5_init(&ms);
-    md5_append(&ms, new_fd, new_len);
-    md5_finish(&ms, fd_hash[cur_dup_entry].digest);
+    if (fd_hash_used < dup_window)
+        fd_hash_used++;
+    else if (dup_window > 0)
+        fd_hash_index_remove(cur_dup_entry);
 
+    mmh3_hash128(&fd[skip], len - skip, 0, fd_hash[cur_dup_entry].digest);
     fd_hash[cur_dup_entry].len = len;
-    fd_hash[cur_dup_entry].time.secs = current->secs;
-    fd_hash[cur_dup_entry].time.nsecs = current->nsecs;
-
-    /*
-     * Look for relative time related duplicates.
-     * This is hopefully a reasonably efficient mechanism for
-     * finding duplicates by rel time in the fd_hash[] cache.
-     * We check starting from the most recently added hash
-     * entries and work backwards towards older packets.
-     * This approach allows the dup test to be terminated
-     * when the relative time of a cached entry is found to
-     * be beyond the dup time window.
-     *
-     * Of course this assumes that the input trace file is
-     * "well-formed" in the sense that the packet timestamps are
-     * in strict chronologically increasing order (which is NOT
-     * always the case!!).
-     *
-     * The fd_hash[] table was deliberately created large (1,000,000).
-     * Looking for time related duplicates in large trace files with
-     * non-fractional dup time window values can potentially take
-     * a long time to complete.
-     */
+    if (current != NULL)
+        fd_hash[cur_dup_entry].time = *current;
+}
 
-    for (i = cur_dup_entry - 1;; i--) {
-        nstime_t delta;
-        int cmp;
+static gboolean
+is_duplicate(guint8* fd, guint32 len) {
+    fd_hash_t *cur;
+    guint32    pos, entry;
+    gboolean   found = FALSE;
 
-        if (i < 0)
-            i = dup_window - 1;
+    fd_hash_add(fd, len, NULL);
+    cur = &fd_hash[cur_dup_entry];
 
-        if (i == cur_dup_entry) {
-            /*
-             * We've decremented back to where we started.
-             * Check no more!
-             */
+    /* Look for duplicates */
+    for (pos = FD_HASH_HOME(cur->digest); fd_hash_index[pos] != 0;
+         pos = (pos + 1) & fd_hash_index_mask) {
+        entry = fd_hash_index[pos] - 1;
+        if (fd_hash[entry].len == cur->len
+            && memcmp(fd_hash[entry].digest, cur->digest, MMH3_DIGEST_LEN) == 0) {
+            found = TRUE;
             break;
         }
+    }
 
-        if (nstime_is_unset(&(fd_hash[i].time))) {
-            /*
-             * We've decremented to an unused fd_hash[] entry.
-             * Check no more!
-             */
-            break;
-        }
+    if (dup_window > 0)
+        fd_hash_index_add(cur_dup_entry);
+    return found;
+}
 
-        nstime_delta(&delta, current, &fd_hash[i].time);
+static gboolean
+is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
+    fd_hash_t *cur;
+    guint32    pos, entry;
+    gboolean   found = FALSE;
+
+    fd_hash_add(fd, len, current);
+    cur = &fd_hash[cur_dup_entry];
+
+    /*
+     * Look for relative time related duplicates, among the cached
+     * frames with the same digest.
+     *
+     * This assumes that the input trace file is "well-formed" in the
+     * sense that the packet timestamps are in strict chronologically
+     * increasing order (which is NOT always the case!!); a cached frame
+     * with a later timestamp than the current one is passed over.
+     */
+    for (pos = FD_HASH_HOME(cur->digest); fd_hash_index[pos] != 0;
+         pos = (pos + 1) & fd_hash_index_mask) {
+        nstime_t delta;
+
+        entry = fd_hash_index[pos] - 1;
+        if (fd_hash[entry].len != cur->len
+            || memcmp(fd_hash[entry].digest, cur->digest, MMH3_DIGEST_LEN) != 0)
+            continue;
+
+        nstime_delta(&delta, current, &fd_hash[entry].time);
 
         if (delta.secs < 0 || delta.nsecs < 0) {
             /*
@@ -647,37 +696,18 @@ is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
              * that it is being compared to.  This is NOT a normal
              * situation since trace files usually have packets in
              * chronological order (oldest to newest).
-             *
-             * There are several possible ways to deal with this:
-             * 1. 'continue' dup checking with the next cached frame.
-             * 2. 'break' from looking for a duplicate of the current frame.
-             * 3. Take the absolute value of the delta and see if that
-             * falls within the specifed dup time window.
-             *
-             * Currently this code does option 1.  But it would pretty
-             * easy to add yet-another-editcap-option to select one of
-             * the other behaviors for dealing with out-of-sequence
-             * packets.
              */
             continue;
         }
 
-        cmp = nstime_cmp(&delta, &relative_time_window);
-
-        if (cmp > 0) {
-            /*
-             * The delta time indicates that we are now looking at
-             * cached packets beyond the specified dup time window.
-             * Check no more!
-             */
+        if (nstime_cmp(&delta, &relative_time_window) <= 0) {
+            found = TRUE;
             break;
-        } else if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-                   && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
         }
     }
 
-    return FALSE;
+    fd_hash_index_add(cur_dup_entry);
+    return found;
 }
 
 static void
@@ -701,14 +731,14 @@ print_usage(FILE *output)
     fprintf(output, "  -D <dup window>        remove packet if duplicate; configurable <dup window>\n");
     fprintf(output, "                         Valid <dup window> values are 0 to %d.\n", MAX_DUP_DEPTH);
     fprintf(output, "                         NOTE: A <dup window> of 0 with -v (verbose option) is\n");
-    fprintf(output, "                         useful to print MD5 hashes.\n");
+    fprintf(output, "                         useful to print hashes.\n");
     fprintf(output, "  -w <dup time window>   remove packet if duplicate packet is found EQUAL TO OR\n");
     fprintf(output, "                         LESS THAN <dup time window> prior to current packet.\n");
     fprintf(output, "                         A <dup time window> is specified in relative seconds\n");
     fprintf(output, "                         (e.g. 0.000001).\n");
     fprintf(output, "\n");
     fprintf(output, "  -I <bytes to ignore>   ignore the specified bytes at the beginning of\n");
-    fprintf(output, "                         the frame during MD5 hash calculation\n");
+    fprintf(output, "                         the frame during hash calculation\n");
     fprintf(output, "                         Useful to remove duplicated packets taken on\n");
     fprintf(output, "                         several routers(differents mac addresses for \n");
     fprintf(output, "                         example)\n");
@@ -763,7 +793,7 @@ print_usage(FILE *output)
     fprintf(output, "  -v                     verbose output.\n");
     fprintf(output, "                         If -v is used with any of the 'Duplicate Packet\n");
     fprintf(output, "                         Removal' options (-d, -D or -w) then Packet lengths\n");
-    fprintf(output, "                         and MD5 hashes are printed to standard-error.\n");
+    fprintf(output, "                         and hashes are printed to standard-error.\n");
     fprintf(output, "\n");
 }
 
@@ -1257,13 +1287,8 @@ main(int argc, char *argv[])
             if (add_selection(argv[i]) == FALSE)
                 break;
 
-        if (dup_detect || dup_detect_by_time) {
-            for (i = 0; i < dup_window; i++) {
-                memset(&fd_hash[i].digest, 0, 16);
-                fd_hash[i].len = 0;
-                nstime_set_unset(&fd_hash[i].time);
-            }
-        }
+        if (dup_detect || dup_detect_by_time)
+            fd_hash_init();
 
         while (wtap_read(wth, &err, &err_info, &data_offset)) {
             read_count++;
@@ -1509,9 +1534,9 @@ main(int argc, char *argv[])
                 if (dup_detect) {
                     if (is_duplicate(buf, phdr->caplen)) {
                         if (verbose) {
-                            fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
+                            fprintf(stderr, "Skipped: %u, Len: %u, Hash: ",
                                     count, phdr->caplen);
-                            for (i = 0; i < 16; i++)
+                            for (i = 0; i < MMH3_DIGEST_LEN; i++)
                                 fprintf(stderr, "%02x",
                                         (unsigned char)fd_hash[cur_dup_entry].digest[i]);
                             fprintf(stderr, "\n");
@@ -1521,9 +1546,9 @@ main(int argc, char *argv[])
                         continue;
                     } else {
                         if (verbose) {
-                            fprintf(stderr, "Packet: %u, Len: %u, MD5 Hash: ",
+                            fprintf(stderr, "Packet: %u, Len: %u, Hash: ",
                                     count, phdr->caplen);
-                            for (i = 0; i < 16; i++)
+                            for (i = 0; i < MMH3_DIGEST_LEN; i++)
                                 fprintf(stderr, "%02x",
                                         (unsigned char)fd_hash[cur_dup_entry].digest[i]);
                             fprintf(stderr, "\n");
@@ -1541,9 +1566,9 @@ main(int argc, char *argv[])
 
                         if (is_duplicate_rel_time(buf, phdr->caplen, &current)) {
                             if (verbose) {
-                                fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
+                                fprintf(stderr, "Skipped: %u, Len: %u, Hash: ",
                                         count, phdr->caplen);
-                                for (i = 0; i < 16; i++)
+                                for (i = 0; i < MMH3_DIGEST_LEN; i++)
                                     fprintf(stderr, "%02x",
                                             (unsigned char)fd_hash[cur_dup_entry].digest[i]);
                                 fprintf(stderr, "\n");
@@ -1553,9 +1578,9 @@ main(int argc, char *argv[])
                             continue;
                         } else {
                             if (verbose) {
-                                fprintf(stderr, "Packet: %u, Len: %u, MD5 Hash: ",
+                                fprintf(stderr, "Packet: %u, Len: %u, Hash: ",
                                         count, phdr->caplen);
-                                for (i = 0; i < 16; i++)
+                                for (i = 0; i < MMH3_DIGEST_LEN; i++)
                                     fprintf(stderr, "%02x",
                                             (unsigned char)fd_hash[cur_dup_entry].digest[i]);
                                 fprintf(stderr, "\n");
@@ -1737,6 +1762,8 @@ main(int argc, char *argv[])
                 (long int)relative_time_window.nsecs);
     }
 
+    fd_hash_cleanup();
+
     return 0;
 }
 
@@ -29,6 +29,7 @@
 
 #include <wsutil/pint.h>
 #include <wsutil/unicode-utils.h>
+#include <wsutil/ws_memsearch.h>
 
 #include "charsets.h"
 
@@ -75,18 +76,22 @@ guint8 *
 get_ascii_string(wmem_allocator_t *scope, const guint8 *ptr, gint length)
 {
     wmem_strbuf_t *str;
+    gint           span;
 
     str = wmem_strbuf_sized_new(scope, length+1, 0);
 
     while (length > 0) {
-        guint8 ch = *ptr;
+        /* Copy runs of ASCII characters in one go */
+        span = (gint)ws_ascii_span(ptr, length);
+        wmem_strbuf_append_len(str, (const gchar *)ptr, span);
+        ptr += span;
+        length -= span;
 
-        if (ch < 0x80)
-            wmem_strbuf_append_c(str, ch);
-        else
+        if (length > 0) {
             wmem_strbuf_append_unichar(str, UNREPL);
-        ptr++;
-        length--;
+            ptr++;
+            length--;
+        }
     }
 
     return (guint8 *) wmem_strbuf_finalize(str);
@@ -101,25 +106,27 @@ guint8 *
 get_8859_1_string(wmem_allocator_t *scope, const guint8 *ptr, gint length)
 {
     wmem_strbuf_t *str;
+    gint           span;
 
     str = wmem_strbuf_sized_new(scope, length+1, 0);
 
     while (length > 0) {
-        guint8 ch = *ptr;
+        span = (gint)ws_ascii_span(ptr, length);
+        wmem_strbuf_append_len(str, (const gchar *)ptr, span);
+        ptr += span;
+        length -= span;
 
-        if (ch < 0x80)
-            wmem_strbuf_append_c(str, ch);
-        else {
+        if (length > 0) {
             /*
              * Note: we assume here that the code points
              * 0x80-0x9F are used for C1 control characters,
              * and thus have the same value as the corresponding
              * Unicode code points.
              */
-            wmem_strbuf_append_unichar(str, ch);
+            wmem_strbuf_append_unichar(str, *ptr);
+            ptr++;
+            length--;
         }
-        ptr++;
-        length--;
     }
 
     return (guint8 *) wmem_strbuf_finalize(str);
@@ -485,18 +492,21 @@ guint8 *
 get_unichar2_string(wmem_allocator_t *scope, const guint8 *ptr, gint length, const gunichar2 table[0x80])
 {
     wmem_strbuf_t *str;
+    gint           span;
 
     str = wmem_strbuf_sized_new(scope, length+1, 0);
 
     while (length > 0) {
-        guint8 ch = *ptr;
-
-        if (ch < 0x80)
-            wmem_strbuf_append_c(str, ch);
-        else
-            wmem_strbuf_append_unichar(str, table[ch-0x80]);
-        ptr++;
-        length--;
+        span = (gint)ws_ascii_span(ptr, length);
+        wmem_strbuf_append_len(str, (const gchar *)ptr, span);
+        ptr += span;
+        length -= span;
+
+        if (length > 0) {
+            wmem_strbuf_append_unichar(str, table[*ptr-0x80]);
+            ptr++;
+            length--;
+        }
     }
 
     return (guint8 *) wmem_strbuf_finalize(str);
@@ -27,8 +27,36 @@
 #include <epan/proto.h>
 #include <stdio.h>
 
+/* Memoized test and filter results in a dfvm_shared_t */
+#define DFVM_RESULT_UNKNOWN	0
+#define DFVM_RESULT_FALSE	1
+#define DFVM_RESULT_TRUE	2
+
+/* Per-frame state shared by the members of a dfilter_set_t: the
+ * fvalues loaded for each field slot and the results of each common
+ * test slot. */
+typedef struct {
+	GList		**field_values;
+	gboolean	*field_loaded;
+	guint8		*test_results;
+} dfvm_shared_t;
+
+/* A term of the "and" or "or" at the root of a filter: the bytecode
+ * evaluating it, the instruction after that (the branch to the next
+ * term, or the final RETURN), and how often it was evaluated and was
+ * true while the filter adapts its order. */
+typedef struct {
+	int		start;
+	int		end;
+	int		cost;
+	guint32		evaluated;
+	guint32		passed;
+} dfvm_term_t;
+
 /* Passed back to user */
 struct epan_dfilter {
+	/* Held by the user and by the cache of compiled filters */
+	volatile gint	ref_count;
 	GPtrArray	*insns;
 	GPtrArray	*consts;
 	guint		num_registers;
@@ -38,6 +66,20 @@ struct epan_dfilter {
 	int		*interesting_fields;
 	int		num_interesting_fields;
 	GPtrArray	*deprecated;
+	struct _dfvm_code_t	*code;
+	int		code_len;
+	/* Set membership; shared is only non-NULL while the set applies us */
+	dfilter_set_t	*set;
+	dfvm_shared_t	*shared;
+	gboolean	*shared_regs;
+	/* Run-time reordering of the root terms; term_end maps the end
+	 * of a term to its index + 1. Lowering into threaded code, if
+	 * wanted, waits until adapt_left applications have been counted. */
+	GArray		*terms;
+	gboolean	terms_and;
+	int		*term_end;
+	guint32		adapt_left;
+	gboolean	adapt_compile;
 };
 
 typedef struct {
@@ -53,6 +95,8 @@ typedef struct {
 	int		next_const_id;
 	int		next_register;
 	int		first_constant; /* first register used as a constant */
+	GArray		*terms;		/* dfvm_term_t of the root, if wanted */
+	gboolean	terms_and;
 } dfwork_t;
 
 /*
@@ -29,6 +29,7 @@
 #include "semcheck.h"
 #include "dfvm.h"
 #include <epan/epan_dissect.h>
+#include <epan/packet.h>
 #include "dfilter.h"
 #include "dfilter-macro.h"
 
@@ -48,6 +49,32 @@ static void*	ParserObj = NULL;
  */
 dfwork_t *global_dfw;
 
+/* Whether dfilter_compile() lowers programs into threaded code */
+static gboolean use_threaded_code = TRUE;
+
+/* Whether filters compiled by dfilter_compile() reorder their root
+ * terms by how often they are true */
+static gboolean use_adaptive_order = FALSE;
+
+/* The scanner and parser aren't reentrant, so compiles are serialized
+ * in case more than one thread compiles filters. That doesn't make it
+ * safe to compile off the main thread, as semantic checks may resolve
+ * host names. Also guards the cache of compiled filters. */
+static GMutex *compile_mtx = NULL;
+
+/* Number of compiled filters kept by dfilter_compile_cached() */
+#define DFILTER_CACHE_SIZE	32
+
+/* Most recently used first; each entry holds a reference to its
+ * filter. cache_table maps the text of an entry to its link. */
+typedef struct {
+	gchar		*text;
+	dfilter_t	*df;
+} dfilter_cache_entry_t;
+
+static GQueue cache_lru = G_QUEUE_INIT;
+static GHashTable *cache_table = NULL;
+
 void
 dfilter_fail(dfwork_t *dfw, const char *format, ...)
 {
@@ -86,6 +113,17 @@ dfilter_init(void)
 	sttype_init();
 
 	dfilter_macro_init();
+
+	if (!compile_mtx) {
+#if GLIB_CHECK_VERSION(2,31,0)
+		compile_mtx = g_new(GMutex, 1);
+		g_mutex_init(compile_mtx);
+#else
+		compile_mtx = g_mutex_new();
+#endif
+	}
+	if (!cache_table)
+		cache_table = g_hash_table_new(g_str_hash, g_str_equal);
 }
 
 /* Clean-up the dfilter module */
@@ -99,6 +137,12 @@ dfilter_cleanup(void)
 
 	/* Clean up the syntax-tree sub-sub-system */
 	sttype_cleanup();
+
+	dfilter_cache_clear();
+	if (cache_table) {
+		g_hash_table_destroy(cache_table);
+		cache_table = NULL;
+	}
 }
 
 static dfilter_t*
@@ -107,6 +151,7 @@ dfilter_new(void)
 	dfilter_t	*df;
 
 	df = g_new0(dfilter_t, 1);
+	df->ref_count = 1;
 	df->insns = NULL;
 	df->deprecated = NULL;
 
@@ -128,6 +173,8 @@ free_insns(GPtrArray *insns)
 	g_ptr_array_free(insns, TRUE);
 }
 
+static void dfilter_set_detach(dfilter_set_t *set, dfilter_t *df);
+
 void
 dfilter_free(dfilter_t *df)
 {
@@ -136,6 +183,12 @@ dfilter_free(dfilter_t *df)
 	if (!df)
 		return;
 
+	if (!g_atomic_int_dec_and_test(&df->ref_count))
+		return;
+
+	if (df->set)
+		dfilter_set_detach(df->set, df);
+
 	if (df->insns) {
 		free_insns(df->insns);
 	}
@@ -144,6 +197,11 @@ dfilter_free(dfilter_t *df)
 	}
 
 	g_free(df->interesting_fields);
+	g_free(df->code);
+	if (df->terms) {
+		g_array_free(df->terms, TRUE);
+	}
+	g_free(df->term_end);
 
 	/* clear registers */
 	for (i = 0; i < df->max_registers; i++) {
@@ -200,6 +258,10 @@ dfwork_free(dfwork_t *dfw)
 		free_insns(dfw->consts);
 	}
 
+	if (dfw->terms) {
+		g_array_free(dfw->terms, TRUE);
+	}
+
 	/*
 	 * We don't free the error message string; our caller will return
 	 * it to its caller.
@@ -207,8 +269,22 @@ dfwork_free(dfwork_t *dfw)
 	g_free(dfw);
 }
 
-gboolean
-dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
+void
+dfilter_set_threaded_code(gboolean enable)
+{
+	use_threaded_code = enable;
+}
+
+void
+dfilter_set_adaptive_order(gboolean enable)
+{
+	use_adaptive_order = enable;
+}
+
+/* Compiles text with its macros already expanded; compile_mtx must
+ * be held. */
+static gboolean
+compile_expanded(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 {
 	int		token;
 	dfilter_t	*dfilter;
@@ -219,20 +295,9 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 	/* XXX, GHashTable */
 	GPtrArray	*deprecated;
 
-	g_assert(dfp);
-
-	if (!text) {
-		*dfp = NULL;
-		if (err_msg != NULL)
-			*err_msg = g_strdup("BUG: NULL text pointer passed to dfilter_compile()");
-		return FALSE;
-	}
-
-	if ( !( text = dfilter_macro_apply(text, err_msg) ) ) {
-		return FALSE;
-	}
-
 	dfw = dfwork_new();
+	if (use_adaptive_order)
+		dfw->terms = g_array_new(FALSE, FALSE, sizeof(dfvm_term_t));
 
 	/*
 	 * XXX - if we're using a version of Flex that supports reentrant lexical
@@ -350,6 +415,19 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 		/* Initialize constants */
 		dfvm_init_const(dfilter);
 
+		/* Lower the bytecode into threaded code; this needs the
+		 * constants to be loaded so they can be inlined. If the
+		 * root terms are to be reordered, that waits until they
+		 * have been. */
+		if (dfw->terms && dfw->terms->len) {
+			dfilter->terms = dfw->terms;
+			dfilter->terms_and = dfw->terms_and;
+			dfw->terms = NULL;
+			dfvm_adapt(dfilter, use_threaded_code);
+		}
+		else if (use_threaded_code)
+			dfvm_compile(dfilter);
+
 		/* Add any deprecated items */
 		dfilter->deprecated = deprecated;
 
@@ -359,7 +437,6 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 	/* SUCCESS */
 	global_dfw = NULL;
 	dfwork_free(dfw);
-	wmem_free(NULL, (char*)text);
 	return TRUE;
 
 FAILURE:
@@ -391,6 +468,134 @@ FAILURE:
 }
 
 
+/* With minimal dissection, the protocols of the fields a filter uses must
+ * be dissected; a filter is compiled before the packets it's applied to
+ * are dissected. */
+static void
+require_fields(const dfilter_t *df)
+{
+	int i;
+
+	if (df == NULL || !minimal_dissection_enabled())
+		return;
+
+	for (i = 0; i < df->num_interesting_fields; i++)
+		minimal_dissection_require_field(df->interesting_fields[i]);
+}
+
+gboolean
+dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
+{
+	const gchar	*expanded;
+	gboolean	ok;
+
+	g_assert(dfp);
+
+	if (!text) {
+		*dfp = NULL;
+		if (err_msg != NULL)
+			*err_msg = g_strdup("BUG: NULL text pointer passed to dfilter_compile()");
+		return FALSE;
+	}
+
+	g_mutex_lock(compile_mtx);
+	if ( !( expanded = dfilter_macro_apply(text, err_msg) ) ) {
+		g_mutex_unlock(compile_mtx);
+		return FALSE;
+	}
+	ok = compile_expanded(expanded, dfp, err_msg);
+	g_mutex_unlock(compile_mtx);
+
+	wmem_free(NULL, (char*)expanded);
+	if (ok)
+		require_fields(*dfp);
+	return ok;
+}
+
+static void
+cache_entry_free(dfilter_cache_entry_t *entry)
+{
+	g_hash_table_remove(cache_table, entry->text);
+	g_free(entry->text);
+	dfilter_free(entry->df);
+	g_free(entry);
+}
+
+gboolean
+dfilter_compile_cached(const gchar *text, dfilter_t **dfp, gchar **err_msg)
+{
+	const gchar		*expanded;
+	GList			*link;
+	dfilter_cache_entry_t	*entry;
+	gboolean		ok;
+
+	g_assert(dfp);
+
+	/* A filter that reorders its terms as it's applied rewrites its
+	 * bytecode; it mustn't be shared. */
+	if (!text || use_adaptive_order) {
+		return dfilter_compile(text, dfp, err_msg);
+	}
+
+	g_mutex_lock(compile_mtx);
+	if ( !( expanded = dfilter_macro_apply(text, err_msg) ) ) {
+		g_mutex_unlock(compile_mtx);
+		return FALSE;
+	}
+
+	link = (GList *)g_hash_table_lookup(cache_table, expanded);
+	if (link) {
+		entry = (dfilter_cache_entry_t *)link->data;
+		g_queue_unlink(&cache_lru, link);
+		g_queue_push_head_link(&cache_lru, link);
+		g_atomic_int_inc(&entry->df->ref_count);
+		*dfp = entry->df;
+		g_mutex_unlock(compile_mtx);
+		wmem_free(NULL, (char*)expanded);
+		require_fields(*dfp);
+		return TRUE;
+	}
+
+	ok = compile_expanded(expanded, dfp, err_msg);
+
+	/* Failures aren't kept, as registering fields may make the
+	 * same text valid. */
+	if (ok && *dfp) {
+		entry = g_new(dfilter_cache_entry_t, 1);
+		entry->text = g_strdup(expanded);
+		entry->df = *dfp;
+		g_atomic_int_inc(&entry->df->ref_count);
+		g_queue_push_head(&cache_lru, entry);
+		g_hash_table_insert(cache_table, entry->text, cache_lru.head);
+
+		if (cache_lru.length > DFILTER_CACHE_SIZE) {
+			cache_entry_free((dfilter_cache_entry_t *)g_queue_pop_tail(&cache_lru));
+		}
+	}
+	g_mutex_unlock(compile_mtx);
+
+	wmem_free(NULL, (char*)expanded);
+	if (ok)
+		require_fields(*dfp);
+	return ok;
+}
+
+void
+dfilter_cache_clear(void)
+{
+	dfilter_cache_entry_t	*entry;
+
+	if (!compile_mtx)
+		return;
+
+	g_mutex_lock(compile_mtx);
+	while ((entry = (dfilter_cache_entry_t *)g_queue_pop_head(&cache_lru)) != NULL) {
+		cache_entry_free(entry);
+	}
+	g_mutex_unlock(compile_mtx);
+}
+
+
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree)
 {
@@ -414,6 +619,13 @@ dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
     }
 }
 
+const int *
+dfilter_interesting_fields(const dfilter_t *df, int *num_fields)
+{
+	*num_fields = df->num_interesting_fields;
+	return df->interesting_fields;
+}
+
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df) {
 	if (df->deprecated && df->deprecated->len > 0) {
@@ -422,6 +634,205 @@ dfilter_deprecated_tokens(dfilter_t *df) {
 	return NULL;
 }
 
+struct epan_dfilter_set {
+	GPtrArray	*filters;	/* dfilter_t *, not owned */
+	GHashTable	*fields;	/* header_field_info * -> field slot + 1 */
+	GHashTable	*tests;		/* test key -> test slot + 1 */
+	dfvm_shared_t	shared;
+	guint		num_fields;
+	guint		num_tests;
+	guint8		*results;	/* DFVM_RESULT_* of each filter */
+	guint32		*matched;	/* returned by dfilter_set_apply_edt() */
+};
+
+/* Stands in for a member freed before its set; never matches */
+static dfilter_t detached_filter;
+
+dfilter_set_t *
+dfilter_set_new(void)
+{
+	dfilter_set_t	*set;
+
+	set = g_new0(dfilter_set_t, 1);
+	set->filters = g_ptr_array_new();
+	set->fields = g_hash_table_new(g_direct_hash, g_direct_equal);
+	set->tests = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	return set;
+}
+
+void
+dfilter_set_free(dfilter_set_t *set)
+{
+	guint		i;
+	dfilter_t	*df;
+
+	if (!set)
+		return;
+
+	dfilter_set_clear_results(set);
+
+	for (i = 0; i < set->filters->len; i++) {
+		df = (dfilter_t *)g_ptr_array_index(set->filters, i);
+		if (df && df != &detached_filter && df->set == set) {
+			dfvm_unshare(df);
+			df->set = NULL;
+		}
+	}
+	g_ptr_array_free(set->filters, TRUE);
+	g_hash_table_destroy(set->fields);
+	g_hash_table_destroy(set->tests);
+	g_free(set->shared.field_values);
+	g_free(set->shared.field_loaded);
+	g_free(set->shared.test_results);
+	g_free(set->results);
+	g_free(set->matched);
+	g_free(set);
+}
+
+static void
+dfilter_set_detach(dfilter_set_t *set, dfilter_t *df)
+{
+	guint	i;
+
+	for (i = 0; i < set->filters->len; i++) {
+		if (g_ptr_array_index(set->filters, i) == df) {
+			g_ptr_array_index(set->filters, i) = &detached_filter;
+		}
+	}
+	dfvm_unshare(df);
+	df->set = NULL;
+}
+
+guint
+dfilter_set_add(dfilter_set_t *set, dfilter_t *df)
+{
+	guint	idx = set->filters->len;
+
+	if (df && df->set == NULL) {
+		dfvm_share(df, set->fields, set->tests);
+		df->set = set;
+	}
+	g_ptr_array_add(set->filters, df);
+
+	/* Resize the per-frame state for the new filter and any new
+	 * slots it brought; nothing of the current frame survives. */
+	dfilter_set_clear_results(set);
+	set->num_fields = g_hash_table_size(set->fields);
+	set->num_tests = g_hash_table_size(set->tests);
+	g_free(set->shared.field_values);
+	g_free(set->shared.field_loaded);
+	g_free(set->shared.test_results);
+	set->shared.field_values = g_new0(GList *, set->num_fields);
+	set->shared.field_loaded = g_new0(gboolean, set->num_fields);
+	set->shared.test_results = g_new0(guint8, set->num_tests);
+	set->results = g_renew(guint8, set->results, set->filters->len);
+	set->results[idx] = DFVM_RESULT_UNKNOWN;
+	set->matched = g_renew(guint32, set->matched, (set->filters->len + 31) / 32);
+
+	return idx;
+}
+
+guint
+dfilter_set_size(const dfilter_set_t *set)
+{
+	return set->filters->len;
+}
+
+void
+dfilter_set_prime_proto_tree(const dfilter_set_t *set, proto_tree *tree)
+{
+	guint		i;
+	dfilter_t	*df;
+
+	for (i = 0; i < set->filters->len; i++) {
+		df = (dfilter_t *)g_ptr_array_index(set->filters, i);
+		if (df && df != &detached_filter)
+			dfilter_prime_proto_tree(df, tree);
+	}
+}
+
+void
+dfilter_set_clear_results(dfilter_set_t *set)
+{
+	guint	i;
+
+	for (i = 0; i < set->num_fields; i++) {
+		if (set->shared.field_loaded[i]) {
+			g_list_free(set->shared.field_values[i]);
+			set->shared.field_values[i] = NULL;
+			set->shared.field_loaded[i] = FALSE;
+		}
+	}
+	if (set->num_tests)
+		memset(set->shared.test_results, DFVM_RESULT_UNKNOWN, set->num_tests);
+	if (set->filters->len)
+		memset(set->results, DFVM_RESULT_UNKNOWN, set->filters->len);
+}
+
+gboolean
+dfilter_set_apply_one_edt(dfilter_set_t *set, guint idx, epan_dissect_t *edt)
+{
+	dfilter_t	*df;
+	gboolean	passed;
+
+	g_assert(idx < set->filters->len);
+
+	if (set->results[idx] != DFVM_RESULT_UNKNOWN)
+		return set->results[idx] == DFVM_RESULT_TRUE;
+
+	df = (dfilter_t *)g_ptr_array_index(set->filters, idx);
+	if (df == NULL) {
+		passed = TRUE;
+	}
+	else if (df == &detached_filter) {
+		passed = FALSE;
+	}
+	else if (df->set == set) {
+		df->shared = &set->shared;
+		passed = dfvm_apply(df, edt->tree);
+		df->shared = NULL;
+	}
+	else {
+		passed = dfvm_apply(df, edt->tree);
+	}
+
+	set->results[idx] = passed ? DFVM_RESULT_TRUE : DFVM_RESULT_FALSE;
+	return passed;
+}
+
+const guint32 *
+dfilter_set_apply_edt(dfilter_set_t *set, epan_dissect_t *edt)
+{
+	guint	i;
+
+	dfilter_set_clear_results(set);
+	if (set->filters->len)
+		memset(set->matched, 0, ((set->filters->len + 31) / 32) * sizeof(guint32));
+
+	for (i = 0; i < set->filters->len; i++) {
+		if (dfilter_set_apply_one_edt(set, i, edt))
+			set->matched[i / 32] |= 1U << (i % 32);
+	}
+
+	return set->matched;
+}
+
+int
+dfilter_set_first_match_edt(dfilter_set_t *set, epan_dissect_t *edt)
+{
+	guint	i;
+
+	dfilter_set_clear_results(set);
+
+	for (i = 0; i < set->filters->len; i++) {
+		if (dfilter_set_apply_one_edt(set, i, edt))
+			return (int)i;
+	}
+
+	return -1;
+}
+
 void
 dfilter_dump(dfilter_t *df)
 {
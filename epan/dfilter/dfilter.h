@@ -27,6 +27,9 @@
 /* Passed back to user */
 typedef struct epan_dfilter dfilter_t;
 
+/* A group of filters applied to the same frames */
+typedef struct epan_dfilter_set dfilter_set_t;
+
 #include <epan/proto.h>
 
 #ifdef __cplusplus
@@ -43,6 +46,21 @@ dfilter_init(void);
 void
 dfilter_cleanup(void);
 
+/* Selects whether filters compiled from now on are lowered into
+ * threaded code (the default) or run by the plain bytecode
+ * interpreter. Both produce the same results. */
+WS_DLL_PUBLIC
+void
+dfilter_set_threaded_code(gboolean enable);
+
+/* Selects whether filters compiled from now on count, for their first
+ * frames, how often each operand of their outermost "and" or "or" is
+ * true, and then reorder those operands so that the ones most likely
+ * to settle the result cheaply come first. Off by default. */
+WS_DLL_PUBLIC
+void
+dfilter_set_adaptive_order(gboolean enable);
+
 /* Compiles a string to a dfilter_t.
  * On success, sets the dfilter* pointed to by dfp
  * to either a NULL pointer (if the filter is a null
@@ -61,8 +79,27 @@ WS_DLL_PUBLIC
 gboolean
 dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg);
 
-/* Frees all memory used by dfilter, and frees
- * the dfilter itself. */
+/* Like dfilter_compile(), but if one of the filters most recently
+ * compiled by it has the same text, once macros are expanded, that
+ * filter is returned instead of compiling a new one. Filters returned
+ * by it are shared, and the cache may drop its reference to one, which
+ * detaches it from the set it is in, whenever it is called: it, the
+ * filters it returns and the sets they are added to must all be used
+ * by the same thread. Filters compiled while
+ * dfilter_set_adaptive_order() is on aren't kept, as they rewrite
+ * themselves as they are applied. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_compile_cached(const gchar *text, dfilter_t **dfp, gchar **err_msg);
+
+/* Forgets the filters kept by dfilter_compile_cached(), e.g. because
+ * fields they use have been unregistered. */
+WS_DLL_PUBLIC
+void
+dfilter_cache_clear(void);
+
+/* Releases a reference to a dfilter; once there are none left, frees
+ * all memory used by the dfilter, and the dfilter itself. */
 WS_DLL_PUBLIC
 void
 dfilter_free(dfilter_t *df);
@@ -80,10 +117,83 @@ dfilter_apply(dfilter_t *df, proto_tree *tree);
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
 
+/* The hfids of the fields/protocols used in a dfilter; the array
+ * belongs to the dfilter. */
+WS_DLL_PUBLIC
+const int *
+dfilter_interesting_fields(const dfilter_t *df, int *num_fields);
+
 WS_DLL_PUBLIC
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df);
 
+/* Filter sets.
+ *
+ * A dfilter_set_t applies a number of compiled filters to the same
+ * frame, loading each field from the proto_tree once and evaluating
+ * each test that appears in several filters (the same field, relation
+ * and constant, or the same existence check) once.
+ *
+ * A filter shares loads and tests with the first set it is added to
+ * only; added again, to that set or another one (as filters returned
+ * by dfilter_compile_cached() may be), it is applied on its own. A
+ * filter must not be freed before the sets it is in are
+ * (dfilter_free() detaches it from the first one if it is; it then
+ * never matches).  A NULL filter always matches. */
+
+/* Creates an empty set. */
+WS_DLL_PUBLIC
+dfilter_set_t *
+dfilter_set_new(void);
+
+/* Frees a set, detaching its filters; does not free the filters. */
+WS_DLL_PUBLIC
+void
+dfilter_set_free(dfilter_set_t *set);
+
+/* Adds a filter to a set and returns its index in the set. */
+WS_DLL_PUBLIC
+guint
+dfilter_set_add(dfilter_set_t *set, dfilter_t *df);
+
+/* Returns the number of filters in a set. */
+WS_DLL_PUBLIC
+guint
+dfilter_set_size(const dfilter_set_t *set);
+
+/* Prime a proto_tree using the fields/protocols used in a set. */
+WS_DLL_PUBLIC
+void
+dfilter_set_prime_proto_tree(const dfilter_set_t *set, proto_tree *tree);
+
+/* Forgets all field loads and results of the previous frame.  Must be
+ * called before dfilter_set_apply_one_edt() is used on a new frame. */
+WS_DLL_PUBLIC
+void
+dfilter_set_clear_results(dfilter_set_t *set);
+
+/* Applies filter number idx of the set, reusing any fields and tests
+ * already evaluated for this frame; the result is remembered until
+ * dfilter_set_clear_results() is called. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_set_apply_one_edt(dfilter_set_t *set, guint idx, struct epan_dissect *edt);
+
+/* Applies every filter of the set to a new frame.  Returns a bitmask
+ * in which filter i matched if DFILTER_SET_MATCHED(mask, i); it
+ * belongs to the set and is overwritten by the next call. */
+WS_DLL_PUBLIC
+const guint32 *
+dfilter_set_apply_edt(dfilter_set_t *set, struct epan_dissect *edt);
+
+#define DFILTER_SET_MATCHED(mask, i)	(((mask)[(i) / 32] >> ((i) % 32)) & 1)
+
+/* Applies the filters of the set to a new frame in order and returns
+ * the index of the first one that matches, or -1 if none does. */
+WS_DLL_PUBLIC
+int
+dfilter_set_first_match_edt(dfilter_set_t *set, struct epan_dissect *edt);
+
 /* Print bytecode of dfilter to stdout */
 WS_DLL_PUBLIC
 void
@@ -23,6 +23,7 @@
 #include "dfvm.h"
 
 #include <ftypes/ftypes-int.h>
+#include <epan/strutil.h>
 
 dfvm_insn_t*
 dfvm_insn_new(dfvm_opcode_t op)
@@ -48,6 +49,12 @@ dfvm_value_free(dfvm_value_t *v)
 		case DRANGE:
 			drange_free(v->value.drange);
 			break;
+		case FVALUE_SET:
+			fvalue_set_free(v->value.fvalue_set);
+			break;
+		case MULTI_SEARCH:
+			multi_search_free(v->value.multi_search);
+			break;
 		default:
 			/* nothing */
 			;
@@ -130,6 +137,8 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_IN:
+			case ANY_CONTAINS_ANY:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -264,6 +273,19 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					id, arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_IN:
+				fprintf(f, "%05d ANY_IN\t\treg#%u in {%u values, %u ranges}\n",
+					id, arg1->value.numeric,
+					fvalue_set_num_values(arg2->value.fvalue_set),
+					fvalue_set_num_ranges(arg2->value.fvalue_set));
+				break;
+
+			case ANY_CONTAINS_ANY:
+				fprintf(f, "%05d ANY_CONTAINS_ANY\treg#%u contains any of %u values\n",
+					id, arg1->value.numeric,
+					multi_search_num_patterns(arg2->value.multi_search));
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -287,30 +309,31 @@ dfvm_dump(FILE *f, dfilter_t *df)
 				break;
 		}
 	}
+
+	if (!df->code) {
+		return;
+	}
+
+	fprintf(f, "\nThreaded code:\n");
+	for (id = 0; id < df->code_len; id++) {
+		const dfvm_code_t *code = &df->code[id];
+
+		fprintf(f, "%05d true->%d false->%d%s%s\n",
+			id, code->next_true, code->next_false,
+			code->cmp_bound ? " [typed cmp]" : "",
+			code->constant ? " [inlined constant]" : "");
+	}
 }
 
-/* Reads a field from the proto_tree and loads the fvalues into a register,
- * if that field has not already been read. */
-static gboolean
-read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
+/* Collects the fvalues of every field named like hfinfo in the tree;
+ * returns NULL if there are none. */
+static GList *
+tree_fvalues(proto_tree *tree, header_field_info *hfinfo)
 {
 	GPtrArray	*finfos;
 	field_info	*finfo;
 	int		i, len;
 	GList		*fvalues = NULL;
-	gboolean	found_something = FALSE;
-
-	/* Already loaded in this run of the dfilter? */
-	if (df->attempted_load[reg]) {
-		if (df->registers[reg]) {
-			return TRUE;
-		}
-		else {
-			return FALSE;
-		}
-	}
-
-	df->attempted_load[reg] = TRUE;
 
 	while (hfinfo) {
 		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
@@ -318,9 +341,6 @@ read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 			hfinfo = hfinfo->same_name_next;
 			continue;
 		}
-		else {
-			found_something = TRUE;
-		}
 
 		len = finfos->len;
 		for (i = 0; i < len; i++) {
@@ -331,12 +351,28 @@ read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 		hfinfo = hfinfo->same_name_next;
 	}
 
-	if (!found_something) {
-		return FALSE;
+	return fvalues;
+}
+
+/* Reads a field from the proto_tree and loads the fvalues into a register,
+ * if that field has not already been read. */
+static gboolean
+read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
+{
+	/* Already loaded in this run of the dfilter? */
+	if (df->attempted_load[reg]) {
+		if (df->registers[reg]) {
+			return TRUE;
+		}
+		else {
+			return FALSE;
+		}
 	}
 
-	df->registers[reg] = fvalues;
-	return TRUE;
+	df->attempted_load[reg] = TRUE;
+
+	df->registers[reg] = tree_fvalues(tree, hfinfo);
+	return df->registers[reg] != NULL;
 }
 
 
@@ -369,6 +405,34 @@ any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
 	return FALSE;
 }
 
+static gboolean
+any_in(dfilter_t *df, int reg, const fvalue_set_t *set)
+{
+	GList	*list;
+
+	for (list = df->registers[reg]; list; list = g_list_next(list)) {
+		if (fvalue_set_contains(set, (fvalue_t *)list->data)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+any_contains_any(dfilter_t *df, int reg, const multi_search_t *ms)
+{
+	GList		*list;
+	const guint8	*data;
+	guint		len;
+
+	for (list = df->registers[reg]; list; list = g_list_next(list)) {
+		if (multi_search_fvalue_bytes((fvalue_t *)list->data, &data, &len) &&
+				multi_search_find(ms, data, len)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
 
 /* Free the list nodes w/o freeing the memory that each
  * list node points to. */
@@ -380,7 +444,11 @@ free_register_overhead(dfilter_t* df)
 	for (i = 0; i < df->num_registers; i++) {
 		df->attempted_load[i] = FALSE;
 		if (df->registers[i]) {
-			g_list_free(df->registers[i]);
+			/* Field values loaded through a filter set belong
+			 * to the set. */
+			if (!df->shared || !df->shared_regs[i]) {
+				g_list_free(df->registers[i]);
+			}
 			df->registers[i] = NULL;
 		}
 	}
@@ -414,6 +482,720 @@ mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 }
 
 
+/* Threaded code.
+ *
+ * Each dfvm_code_t entry carries the handler that executes it; the
+ * handler returns the new accumulator, and the successor is picked
+ * from the entry's next_true/next_false without going back through
+ * the opcode switch or the IF_*_GOTO instructions. */
+
+static gboolean
+code_check_exists(dfilter_t *df _U_, proto_tree *tree,
+		const dfvm_code_t *code, gboolean accum _U_)
+{
+	header_field_info	*hfinfo;
+
+	for (hfinfo = code->hfinfo; hfinfo; hfinfo = hfinfo->same_name_next) {
+		if (proto_check_for_protocol_or_field(tree, hfinfo->id)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+code_read_tree(dfilter_t *df, proto_tree *tree,
+		const dfvm_code_t *code, gboolean accum _U_)
+{
+	return read_tree(df, tree, code->hfinfo, code->reg2);
+}
+
+static gboolean
+code_call_function(dfilter_t *df, proto_tree *tree _U_,
+		const dfvm_code_t *code, gboolean accum _U_)
+{
+	GList	*param1 = NULL;
+	GList	*param2 = NULL;
+
+	if (code->reg3 >= 0) {
+		param1 = df->registers[code->reg3];
+	}
+	if (code->reg4 >= 0) {
+		param2 = df->registers[code->reg4];
+	}
+	return code->funcdef->function(param1, param2,
+			&df->registers[code->reg2]);
+}
+
+static gboolean
+code_mk_range(dfilter_t *df, proto_tree *tree _U_,
+		const dfvm_code_t *code, gboolean accum)
+{
+	mk_range(df, code->reg1, code->reg2, code->drange);
+	return accum;
+}
+
+static gboolean
+code_any_test(dfilter_t *df, proto_tree *tree _U_,
+		const dfvm_code_t *code, gboolean accum _U_)
+{
+	GList	*list_a, *list_b;
+
+	for (list_a = df->registers[code->reg1]; list_a; list_a = g_list_next(list_a)) {
+		for (list_b = df->registers[code->reg2]; list_b; list_b = g_list_next(list_b)) {
+			if (code->cmp((fvalue_t *)list_a->data, (fvalue_t *)list_b->data)) {
+				return TRUE;
+			}
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+code_any_test_constant(dfilter_t *df, proto_tree *tree _U_,
+		const dfvm_code_t *code, gboolean accum _U_)
+{
+	GList	*list_a;
+
+	for (list_a = df->registers[code->reg1]; list_a; list_a = g_list_next(list_a)) {
+		if (code->cmp((fvalue_t *)list_a->data, code->constant)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+code_any_in(dfilter_t *df, proto_tree *tree _U_,
+		const dfvm_code_t *code, gboolean accum _U_)
+{
+	return any_in(df, code->reg1, code->set);
+}
+
+static gboolean
+code_any_contains_any(dfilter_t *df, proto_tree *tree _U_,
+		const dfvm_code_t *code, gboolean accum _U_)
+{
+	return any_contains_any(df, code->reg1, code->search);
+}
+
+/* "matches" against a constant regular expression, skipping the
+ * regular expression for values that lack its literal text. */
+static gboolean
+code_any_matches_literal(dfilter_t *df, proto_tree *tree _U_,
+		const dfvm_code_t *code, gboolean accum _U_)
+{
+	GList		*list_a;
+	const guint8	*data;
+	guint		len;
+
+	for (list_a = df->registers[code->reg1]; list_a; list_a = g_list_next(list_a)) {
+		if (multi_search_fvalue_bytes((fvalue_t *)list_a->data, &data, &len) &&
+				!epan_memmem(data, len, code->literal, code->literal_len)) {
+			continue;
+		}
+		if (code->cmp((fvalue_t *)list_a->data, code->constant)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+code_not(dfilter_t *df _U_, proto_tree *tree _U_,
+		const dfvm_code_t *code _U_, gboolean accum)
+{
+	return !accum;
+}
+
+/* IF_TRUE_GOTO, IF_FALSE_GOTO and RETURN only pick a successor. */
+static gboolean
+code_branch(dfilter_t *df _U_, proto_tree *tree _U_,
+		const dfvm_code_t *code _U_, gboolean accum)
+{
+	return accum;
+}
+
+/* Variants used by members of a dfilter_set_t; when applied on their
+ * own (df->shared is NULL) they behave like the plain handlers. */
+static gboolean
+code_read_tree_shared(dfilter_t *df, proto_tree *tree,
+		const dfvm_code_t *code, gboolean accum)
+{
+	dfvm_shared_t	*shared = df->shared;
+
+	if (!shared) {
+		return code_read_tree(df, tree, code, accum);
+	}
+
+	if (!shared->field_loaded[code->slot]) {
+		shared->field_loaded[code->slot] = TRUE;
+		shared->field_values[code->slot] = tree_fvalues(tree, code->hfinfo);
+	}
+	df->attempted_load[code->reg2] = TRUE;
+	df->registers[code->reg2] = shared->field_values[code->slot];
+	return df->registers[code->reg2] != NULL;
+}
+
+static gboolean
+code_shared_test(dfilter_t *df, proto_tree *tree,
+		const dfvm_code_t *code, gboolean accum)
+{
+	guint8	*result;
+
+	if (!df->shared) {
+		return code->test_func(df, tree, code, accum);
+	}
+
+	result = &df->shared->test_results[code->slot];
+	if (*result == DFVM_RESULT_UNKNOWN) {
+		*result = code->test_func(df, tree, code, accum) ?
+			DFVM_RESULT_TRUE : DFVM_RESULT_FALSE;
+	}
+	return *result == DFVM_RESULT_TRUE;
+}
+
+static gboolean
+dfvm_apply_code(dfilter_t *df, proto_tree *tree)
+{
+	const dfvm_code_t	*code;
+	gboolean		accum = TRUE;
+	int			pc = 0;
+
+	do {
+		code = &df->code[pc];
+		accum = code->func(df, tree, code, accum);
+		pc = accum ? code->next_true : code->next_false;
+	} while (pc >= 0);
+
+	free_register_overhead(df);
+	return accum;
+}
+
+static DFVMCmpFunc
+generic_cmp(dfvm_opcode_t op)
+{
+	switch (op) {
+		case ANY_EQ:		return fvalue_eq;
+		case ANY_NE:		return fvalue_ne;
+		case ANY_GT:		return fvalue_gt;
+		case ANY_GE:		return fvalue_ge;
+		case ANY_LT:		return fvalue_lt;
+		case ANY_LE:		return fvalue_le;
+		case ANY_BITWISE_AND:	return fvalue_bitwise_and;
+		case ANY_CONTAINS:	return fvalue_contains;
+		case ANY_MATCHES:	return fvalue_matches;
+		default:
+			g_assert_not_reached();
+			return NULL;
+	}
+}
+
+static DFVMCmpFunc
+ftype_cmp(const ftype_t *ft, dfvm_opcode_t op)
+{
+	switch (op) {
+		case ANY_EQ:		return ft->cmp_eq;
+		case ANY_NE:		return ft->cmp_ne;
+		case ANY_GT:		return ft->cmp_gt;
+		case ANY_GE:		return ft->cmp_ge;
+		case ANY_LT:		return ft->cmp_lt;
+		case ANY_LE:		return ft->cmp_le;
+		case ANY_BITWISE_AND:	return ft->cmp_bitwise_and;
+		case ANY_CONTAINS:	return ft->cmp_contains;
+		case ANY_MATCHES:	return ft->cmp_matches;
+		default:
+			g_assert_not_reached();
+			return NULL;
+	}
+}
+
+/* Returns the ftype shared by every field with this name, or NULL if
+ * they differ (the comparator must then be looked up per value). */
+static ftype_t *
+field_ftype(header_field_info *hfinfo)
+{
+	ftenum_t	type = hfinfo->type;
+
+	for (hfinfo = hfinfo->same_name_next; hfinfo; hfinfo = hfinfo->same_name_next) {
+		if (hfinfo->type != type) {
+			return NULL;
+		}
+	}
+	return ftype_lookup(type);
+}
+
+/* Finds literal text that every match of a regular expression must
+ * contain: the plain characters it starts with. Stays on the safe
+ * side, giving up on alternatives and stopping at the first escape,
+ * metacharacter or non-ASCII byte. Returns the length of the text,
+ * which is in the pattern itself, or 0. */
+static guint
+regex_literal(const char *pattern, const guint8 **literal)
+{
+	const char	*p;
+	guint		len = 0;
+
+	if (strchr(pattern, '|')) {
+		return 0;
+	}
+
+	p = pattern;
+	if (*p == '^') {
+		p++;
+	}
+	while (p[len] && (guchar)p[len] < 0x80 && !strchr("\\^$.[]()?*+{}", p[len])) {
+		len++;
+	}
+	/* A quantifier that allows no occurrence applies to the last
+	 * character. */
+	if (len > 0 && p[len] && strchr("?*{", p[len])) {
+		len--;
+	}
+
+	*literal = (const guint8 *)p;
+	return len;
+}
+
+static void
+compile_relation(dfilter_t *df, dfvm_code_t *code, ftype_t **reg_ftypes)
+{
+	GList	*constant;
+	ftype_t	*ft;
+
+	/* fvalue_xxx() dispatch on the ftype of the left-hand operand;
+	 * if every value in that register has the same, known ftype,
+	 * call its comparator directly. */
+	ft = reg_ftypes[code->reg1];
+	code->cmp = ft ? ftype_cmp(ft, code->op) : NULL;
+	if (code->cmp) {
+		code->cmp_bound = TRUE;
+	}
+	else {
+		code->cmp = generic_cmp(code->op);
+	}
+
+	/* Constant registers always hold exactly one fvalue, loaded
+	 * once by dfvm_init_const(). */
+	constant = ((guint)code->reg2 >= df->num_registers) ?
+		df->registers[code->reg2] : NULL;
+	if (constant && !constant->next) {
+		code->constant = (const fvalue_t *)constant->data;
+		code->func = code_any_test_constant;
+
+		if (code->op == ANY_MATCHES &&
+				code->constant->ftype->ftype == FT_PCRE &&
+				code->constant->value.re) {
+			code->literal_len = regex_literal(
+					g_regex_get_pattern(code->constant->value.re),
+					&code->literal);
+			if (code->literal_len > 0) {
+				code->func = code_any_matches_literal;
+			}
+		}
+	}
+	else {
+		code->func = code_any_test;
+	}
+}
+
+/* Lower df->insns into threaded code. Must be called after
+ * dfvm_init_const(), since constants are inlined from their
+ * registers. */
+void
+dfvm_compile(dfilter_t *df)
+{
+	int		id, length;
+	dfvm_insn_t	*insn, *next;
+	dfvm_code_t	*code;
+	ftype_t		**reg_ftypes;
+
+	length = df->insns->len;
+	df->code = g_new0(dfvm_code_t, length);
+	df->code_len = length;
+
+	/* The ftype of every value a register will hold, where known. */
+	reg_ftypes = g_new0(ftype_t *, df->max_registers);
+	for (id = 0; id < (int)df->consts->len; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->consts, id);
+		reg_ftypes[insn->arg2->value.numeric] = insn->arg1->value.fvalue->ftype;
+	}
+	for (id = 0; id < length; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+		if (insn->op == READ_TREE) {
+			reg_ftypes[insn->arg2->value.numeric] = field_ftype(insn->arg1->value.hfinfo);
+		}
+		else if (insn->op == MK_RANGE) {
+			/* fvalue_slice() always yields FT_BYTES */
+			reg_ftypes[insn->arg2->value.numeric] = ftype_lookup(FT_BYTES);
+		}
+	}
+
+	for (id = 0; id < length; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+		code = &df->code[id];
+
+		code->op = insn->op;
+		code->reg1 = (insn->arg1 && insn->arg1->type == REGISTER) ? (int)insn->arg1->value.numeric : -1;
+		code->reg2 = (insn->arg2 && insn->arg2->type == REGISTER) ? (int)insn->arg2->value.numeric : -1;
+		code->reg3 = (insn->arg3 && insn->arg3->type == REGISTER) ? (int)insn->arg3->value.numeric : -1;
+		code->reg4 = (insn->arg4 && insn->arg4->type == REGISTER) ? (int)insn->arg4->value.numeric : -1;
+		code->next_true = id + 1;
+		code->next_false = id + 1;
+		code->slot = -1;
+
+		switch (insn->op) {
+			case CHECK_EXISTS:
+				code->hfinfo = insn->arg1->value.hfinfo;
+				code->func = code_check_exists;
+				break;
+
+			case READ_TREE:
+				code->hfinfo = insn->arg1->value.hfinfo;
+				code->func = code_read_tree;
+				break;
+
+			case CALL_FUNCTION:
+				code->funcdef = insn->arg1->value.funcdef;
+				code->func = code_call_function;
+				break;
+
+			case MK_RANGE:
+				code->drange = insn->arg3->value.drange;
+				code->func = code_mk_range;
+				break;
+
+			case ANY_EQ:
+			case ANY_NE:
+			case ANY_GT:
+			case ANY_GE:
+			case ANY_LT:
+			case ANY_LE:
+			case ANY_BITWISE_AND:
+			case ANY_CONTAINS:
+			case ANY_MATCHES:
+				compile_relation(df, code, reg_ftypes);
+				break;
+
+			case ANY_IN:
+				code->set = insn->arg2->value.fvalue_set;
+				code->func = code_any_in;
+				break;
+
+			case ANY_CONTAINS_ANY:
+				code->search = insn->arg2->value.multi_search;
+				code->func = code_any_contains_any;
+				break;
+
+			case NOT:
+				code->func = code_not;
+				break;
+
+			case RETURN:
+				code->func = code_branch;
+				code->next_true = -1;
+				code->next_false = -1;
+				continue;
+
+			case IF_TRUE_GOTO:
+				code->func = code_branch;
+				code->next_true = insn->arg1->value.numeric;
+				continue;
+
+			case IF_FALSE_GOTO:
+				code->func = code_branch;
+				code->next_false = insn->arg1->value.numeric;
+				continue;
+
+			case PUT_FVALUE:
+			default:
+				g_assert_not_reached();
+				break;
+		}
+
+		/* Fold a following conditional branch into this entry; the
+		 * branch itself stays in place for anything that jumps to it. */
+		if (id + 1 < length) {
+			next = (dfvm_insn_t *)g_ptr_array_index(df->insns, id + 1);
+			if (next->op == IF_TRUE_GOTO) {
+				code->next_true = next->arg1->value.numeric;
+				code->next_false = id + 2;
+			}
+			else if (next->op == IF_FALSE_GOTO) {
+				code->next_true = id + 2;
+				code->next_false = next->arg1->value.numeric;
+			}
+		}
+	}
+
+	g_free(reg_ftypes);
+}
+
+/* Returns the slot for key in table, adding it if it is new. The
+ * table holds slot + 1, so that a missing key can be told apart. */
+static int
+share_slot(GHashTable *table, gpointer key, gboolean *added)
+{
+	int	slot;
+
+	slot = GPOINTER_TO_INT(g_hash_table_lookup(table, key));
+	if (slot) {
+		*added = FALSE;
+		return slot - 1;
+	}
+	slot = g_hash_table_size(table);
+	g_hash_table_insert(table, key, GINT_TO_POINTER(slot + 1));
+	*added = TRUE;
+	return slot;
+}
+
+/* Key identifying a test against a constant, so that the same test in
+ * different filters shares one result; NULL if it cannot be shared. */
+static gchar *
+share_test_key(const dfvm_code_t *code, header_field_info **reg_fields)
+{
+	gchar	*repr, *key;
+
+	if (code->op == CHECK_EXISTS) {
+		return g_strdup_printf("%d:%d", code->op, code->hfinfo->id);
+	}
+
+	/* Only a field compared against a constant. */
+	if (!code->constant || !reg_fields[code->reg1]) {
+		return NULL;
+	}
+	repr = fvalue_to_string_repr((fvalue_t *)code->constant,
+			FTREPR_DFILTER, BASE_NONE, NULL);
+	if (!repr) {
+		return NULL;
+	}
+	key = g_strdup_printf("%d:%d:%s:%s", code->op,
+			reg_fields[code->reg1]->id,
+			code->constant->ftype->name, repr);
+	g_free(repr);
+	return key;
+}
+
+/* Make a filter use the field and test slots of a dfilter_set_t.
+ * fields maps a header_field_info to its slot and tests maps a test
+ * key (a g_malloc()ed string) to its slot; new slots are added to
+ * both. */
+void
+dfvm_share(dfilter_t *df, GHashTable *fields, GHashTable *tests)
+{
+	int			id;
+	dfvm_code_t		*code;
+	header_field_info	**reg_fields;
+	gchar			*key;
+	gboolean		added;
+
+	if (!df->code) {
+		/* Too late to reorder the terms. */
+		df->adapt_left = 0;
+		dfvm_compile(df);
+	}
+
+	df->shared_regs = g_new0(gboolean, df->max_registers);
+	reg_fields = g_new0(header_field_info *, df->max_registers);
+
+	for (id = 0; id < df->code_len; id++) {
+		code = &df->code[id];
+
+		switch (code->op) {
+			case READ_TREE:
+				code->slot = share_slot(fields, code->hfinfo, &added);
+				code->func = code_read_tree_shared;
+				df->shared_regs[code->reg2] = TRUE;
+				reg_fields[code->reg2] = code->hfinfo;
+				break;
+
+			case CHECK_EXISTS:
+			case ANY_EQ:
+			case ANY_NE:
+			case ANY_GT:
+			case ANY_GE:
+			case ANY_LT:
+			case ANY_LE:
+			case ANY_BITWISE_AND:
+			case ANY_CONTAINS:
+			case ANY_MATCHES:
+				key = share_test_key(code, reg_fields);
+				if (!key) {
+					break;
+				}
+				code->slot = share_slot(tests, key, &added);
+				if (!added) {
+					g_free(key);
+				}
+				code->test_func = code->func;
+				code->func = code_shared_test;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	g_free(reg_fields);
+}
+
+/* Undo dfvm_share(). */
+void
+dfvm_unshare(dfilter_t *df)
+{
+	int		id;
+	dfvm_code_t	*code;
+
+	for (id = 0; id < df->code_len; id++) {
+		code = &df->code[id];
+
+		if (code->func == code_read_tree_shared) {
+			code->func = code_read_tree;
+		}
+		else if (code->func == code_shared_test) {
+			code->func = code->test_func;
+		}
+		code->slot = -1;
+	}
+
+	g_free(df->shared_regs);
+	df->shared_regs = NULL;
+}
+
+/* Number of applications of a filter counted before its root terms
+ * are reordered */
+#define DFVM_ADAPT_WARMUP	1000
+
+/* Have the interpreter count how often the root terms recorded by
+ * gencode are true, and reorder them after DFVM_ADAPT_WARMUP
+ * applications; compile says whether to lower the filter into
+ * threaded code then. */
+void
+dfvm_adapt(dfilter_t *df, gboolean compile)
+{
+	guint	i;
+
+	df->term_end = g_new0(int, df->insns->len);
+	for (i = 0; i < df->terms->len; i++) {
+		df->term_end[g_array_index(df->terms, dfvm_term_t, i).end] = i + 1;
+	}
+	df->adapt_left = DFVM_ADAPT_WARMUP;
+	df->adapt_compile = compile;
+}
+
+static void
+count_term(dfilter_t *df, int end, gboolean accum)
+{
+	dfvm_term_t	*term;
+
+	term = &g_array_index(df->terms, dfvm_term_t, df->term_end[end] - 1);
+	term->evaluated++;
+	if (accum) {
+		term->passed++;
+	}
+}
+
+/* Order the terms of an "and" by their cost divided by how often they
+ * are false, and those of an "or" by their cost divided by how often
+ * they are true, which minimizes the expected cost of the chain when
+ * the terms are independent. The bytecode of each term is moved as a
+ * whole; its jumps all stay within it. */
+static void
+reorder_terms(dfilter_t *df)
+{
+	dfvm_term_t	*terms, *term;
+	GArray		*new_terms;
+	GPtrArray	*insns, *branches;
+	dfvm_insn_t	*insn;
+	gdouble		*rank, p;
+	guint		*order, n, i, k, tmp;
+	int		id, start, length;
+	gboolean	changed = FALSE;
+
+	n = df->terms->len;
+	terms = (dfvm_term_t *)(void *)df->terms->data;
+	length = df->insns->len;
+
+	rank = g_new(gdouble, n);
+	order = g_new(guint, n);
+	for (i = 0; i < n; i++) {
+		term = &terms[i];
+		if (term->evaluated == 0) {
+			p = 0.5;
+		}
+		else if (df->terms_and) {
+			p = (gdouble)(term->evaluated - term->passed) / term->evaluated;
+		}
+		else {
+			p = (gdouble)term->passed / term->evaluated;
+		}
+		rank[i] = p > 0 ? term->cost / p : G_MAXDOUBLE;
+		order[i] = i;
+	}
+	/* A stable insertion sort; there are few terms. */
+	for (i = 1; i < n; i++) {
+		for (k = i; k > 0 && rank[order[k]] < rank[order[k - 1]]; k--) {
+			tmp = order[k];
+			order[k] = order[k - 1];
+			order[k - 1] = tmp;
+			changed = TRUE;
+		}
+	}
+
+	if (changed) {
+		/* The branches between the terms all go to the final
+		 * RETURN, so any of them will do between any two terms. */
+		branches = g_ptr_array_new();
+		for (i = 0; i < n; i++) {
+			if (terms[i].end != length - 1) {
+				g_ptr_array_add(branches, g_ptr_array_index(df->insns, terms[i].end));
+			}
+		}
+
+		insns = g_ptr_array_sized_new(length);
+		new_terms = g_array_sized_new(FALSE, FALSE, sizeof(dfvm_term_t), n);
+		for (k = 0; k < n; k++) {
+			term = &terms[order[k]];
+			start = insns->len;
+			for (id = term->start; id < term->end; id++) {
+				insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+				if (insn->op == IF_TRUE_GOTO || insn->op == IF_FALSE_GOTO) {
+					g_assert((int)insn->arg1->value.numeric >= term->start &&
+						(int)insn->arg1->value.numeric <= term->end);
+					insn->arg1->value.numeric += start - term->start;
+				}
+				g_ptr_array_add(insns, insn);
+			}
+			term->end = insns->len;
+			term->start = start;
+			g_array_append_val(new_terms, *term);
+			if (k + 1 < n) {
+				g_ptr_array_add(insns, g_ptr_array_index(branches, k));
+			}
+		}
+		g_ptr_array_add(insns, g_ptr_array_index(df->insns, length - 1));
+		g_assert((int)insns->len == length);
+
+		for (id = 0; id < length; id++) {
+			((dfvm_insn_t *)g_ptr_array_index(insns, id))->id = id;
+		}
+
+		g_ptr_array_free(branches, TRUE);
+		g_ptr_array_free(df->insns, TRUE);
+		df->insns = insns;
+		g_array_free(df->terms, TRUE);
+		df->terms = new_terms;
+	}
+
+	g_free(rank);
+	g_free(order);
+	g_free(df->term_end);
+	df->term_end = NULL;
+
+	if (df->adapt_compile) {
+		dfvm_compile(df);
+	}
+}
 
 gboolean
 dfvm_apply(dfilter_t *df, proto_tree *tree)
@@ -428,10 +1210,16 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 	header_field_info	*hfinfo;
 	GList		*param1;
 	GList		*param2;
+	gboolean	adapting, counted = FALSE;
 
 	g_assert(tree);
 
+	if (df->code) {
+		return dfvm_apply_code(df, tree);
+	}
+
 	length = df->insns->len;
+	adapting = (df->adapt_left > 0);
 
 	for (id = 0; id < length; id++) {
 
@@ -527,15 +1315,39 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_IN:
+				accum = any_in(df, arg1->value.numeric,
+						arg2->value.fvalue_set);
+				break;
+
+			case ANY_CONTAINS_ANY:
+				accum = any_contains_any(df, arg1->value.numeric,
+						arg2->value.multi_search);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
 
 			case RETURN:
 				free_register_overhead(df);
+				if (adapting) {
+					/* Unless a branch between the terms
+					 * got us here, the last term did. */
+					if (!counted) {
+						count_term(df, id, accum);
+					}
+					if (--df->adapt_left == 0) {
+						reorder_terms(df);
+					}
+				}
 				return accum;
 
 			case IF_TRUE_GOTO:
+				if (adapting && df->term_end[id]) {
+					count_term(df, id, accum);
+					counted = accum;
+				}
 				if (accum) {
 					id = arg1->value.numeric;
 					goto AGAIN;
@@ -543,6 +1355,10 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				break;
 
 			case IF_FALSE_GOTO:
+				if (adapting && df->term_end[id]) {
+					count_term(df, id, accum);
+					counted = !accum;
+				}
 				if (!accum) {
 					id = arg1->value.numeric;
 					goto AGAIN;
@@ -601,6 +1417,8 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_IN:
+			case ANY_CONTAINS_ANY:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -27,6 +27,8 @@
 #include "syntax-tree.h"
 #include "drange.h"
 #include "dfunctions.h"
+#include "fvalue-set.h"
+#include "multi-search.h"
 
 typedef enum {
 	EMPTY,
@@ -36,7 +38,9 @@ typedef enum {
 	REGISTER,
 	INTEGER,
 	DRANGE,
-	FUNCTION_DEF
+	FUNCTION_DEF,
+	FVALUE_SET,
+	MULTI_SEARCH
 } dfvm_value_type_t;
 
 typedef struct {
@@ -48,6 +52,8 @@ typedef struct {
 		drange_t		*drange;
 		header_field_info	*hfinfo;
         df_func_def_t   *funcdef;
+		fvalue_set_t		*fvalue_set;
+		multi_search_t		*multi_search;
 	} value;
 
 } dfvm_value_t;
@@ -71,6 +77,8 @@ typedef enum {
 	ANY_BITWISE_AND,
 	ANY_CONTAINS,
 	ANY_MATCHES,
+	ANY_IN,
+	ANY_CONTAINS_ANY,
 	MK_RANGE,
     CALL_FUNCTION
 
@@ -85,6 +93,46 @@ typedef struct {
 	dfvm_value_t	*arg4;
 } dfvm_insn_t;
 
+typedef gboolean (*DFVMCmpFunc)(const fvalue_t*, const fvalue_t*);
+
+struct _dfvm_code_t;
+
+typedef gboolean (*DFVMCodeFunc)(dfilter_t *df, proto_tree *tree,
+		const struct _dfvm_code_t *code, gboolean accum);
+
+/* One entry of the threaded code produced by dfvm_compile().
+ * Operands are resolved to plain register numbers and pointers, the
+ * comparator is bound per ftype where the operand type is known, and
+ * a constant right-hand operand is inlined. Conditional branches that
+ * follow an instruction are folded into its next_true/next_false
+ * successors; a successor of -1 means "return". */
+typedef struct _dfvm_code_t {
+	DFVMCodeFunc		func;
+	dfvm_opcode_t		op;
+	int			next_true;
+	int			next_false;
+	int			reg1;
+	int			reg2;
+	int			reg3;
+	int			reg4;
+	header_field_info	*hfinfo;
+	DFVMCmpFunc		cmp;
+	gboolean		cmp_bound;
+	const fvalue_t		*constant;
+	drange_t		*drange;
+	df_func_def_t		*funcdef;
+	const fvalue_set_t	*set;
+	const multi_search_t	*search;
+	/* Literal text that any match of a constant regular expression
+	 * contains, or NULL */
+	const guint8		*literal;
+	guint			literal_len;
+	/* Field or test slot in a dfilter_set_t, or -1; test_func is the
+	 * uncached handler of a shared test */
+	int			slot;
+	DFVMCodeFunc		test_func;
+} dfvm_code_t;
+
 dfvm_insn_t*
 dfvm_insn_new(dfvm_opcode_t op);
 
@@ -103,4 +151,16 @@ dfvm_apply(dfilter_t *df, proto_tree *tree);
 void
 dfvm_init_const(dfilter_t *df);
 
+void
+dfvm_compile(dfilter_t *df);
+
+void
+dfvm_adapt(dfilter_t *df, gboolean compile);
+
+void
+dfvm_share(dfilter_t *df, GHashTable *fields, GHashTable *tests);
+
+void
+dfvm_unshare(dfilter_t *df);
+
 #endif
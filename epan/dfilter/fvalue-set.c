@@ -0,0 +1,453 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "fvalue-set.h"
+
+#include <ftypes/ftypes-int.h>
+#include <wsutil/pint.h>
+
+/* Values are compared through a byte-string key. For the ordered
+ * kinds the key has a fixed width and is big-endian (with the sign
+ * bit flipped for signed integers), so that memcmp() order is value
+ * order. */
+typedef enum {
+	SET_KEY_NONE,
+	SET_KEY_BOOLEAN,
+	SET_KEY_UINT32,
+	SET_KEY_INT32,
+	SET_KEY_UINT64,
+	SET_KEY_INT64,
+	SET_KEY_IPv4,
+	SET_KEY_IPv6,
+	SET_KEY_STRING,
+	SET_KEY_BYTES,
+	SET_KEY_GUID
+} set_key_kind_t;
+
+#define SET_KEY_MAX_WIDTH	16
+
+typedef struct {
+	guint		len;
+	const guint8	*data;
+} set_key_t;
+
+struct _fvalue_set_t {
+	set_key_kind_t	kind;
+	guint		width;		/* key width, for the ordered kinds */
+	GHashTable	*values;	/* set_key_t -> itself */
+	GArray		*ranges;	/* width-byte low and high keys, in pairs */
+	guint		num_ranges;
+	gboolean	finished;
+};
+
+#define RANGE_LOW(set, i) \
+	((set)->ranges->data + (i) * 2 * (set)->width)
+#define RANGE_HIGH(set, i) \
+	(RANGE_LOW(set, i) + (set)->width)
+
+static set_key_kind_t
+key_kind(ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_BOOLEAN:
+			return SET_KEY_BOOLEAN;
+
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_FRAMENUM:
+		case FT_IPXNET:
+			return SET_KEY_UINT32;
+
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			return SET_KEY_INT32;
+
+		case FT_UINT64:
+		case FT_EUI64:
+			return SET_KEY_UINT64;
+
+		case FT_INT64:
+			return SET_KEY_INT64;
+
+		case FT_IPv4:
+			return SET_KEY_IPv4;
+
+		case FT_IPv6:
+			return SET_KEY_IPv6;
+
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			return SET_KEY_STRING;
+
+		case FT_ETHER:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			return SET_KEY_BYTES;
+
+		case FT_GUID:
+			return SET_KEY_GUID;
+
+		case FT_NONE:
+		case FT_PROTOCOL:
+		case FT_FLOAT:
+		case FT_DOUBLE:
+		case FT_ABSOLUTE_TIME:
+		case FT_RELATIVE_TIME:
+		case FT_PCRE:
+		case FT_NUM_TYPES:
+			break;
+	}
+	return SET_KEY_NONE;
+}
+
+static guint
+key_width(set_key_kind_t kind)
+{
+	switch (kind) {
+		case SET_KEY_UINT32:
+		case SET_KEY_INT32:
+		case SET_KEY_IPv4:
+			return 4;
+		case SET_KEY_UINT64:
+		case SET_KEY_INT64:
+			return 8;
+		case SET_KEY_IPv6:
+			return 16;
+		default:
+			return 0;
+	}
+}
+
+gboolean
+fvalue_set_type_supported(ftenum_t ftype)
+{
+	return key_kind(ftype) != SET_KEY_NONE;
+}
+
+gboolean
+fvalue_set_type_ordered(ftenum_t ftype)
+{
+	return key_width(key_kind(ftype)) != 0;
+}
+
+static void
+put_be64(guint8 *buf, guint64 v)
+{
+	phton32(buf, (guint32)(v >> 32));
+	phton32(buf + 4, (guint32)v);
+}
+
+/* Sets key to the key of fv, built in buf (SET_KEY_MAX_WIDTH bytes)
+ * or pointing into fv; returns FALSE if fv is not of the kind of
+ * value held by the set. The netmask or prefix of an address is not
+ * part of its key. */
+static gboolean
+set_key(const fvalue_set_t *set, const fvalue_t *fv, guint8 *buf, set_key_t *key)
+{
+	if (key_kind(fv->ftype->ftype) != set->kind) {
+		return FALSE;
+	}
+
+	key->data = buf;
+	switch (set->kind) {
+		case SET_KEY_BOOLEAN:
+			/* Booleans compare as zero or non-zero. */
+			buf[0] = fv->value.uinteger ? 1 : 0;
+			key->len = 1;
+			break;
+
+		case SET_KEY_UINT32:
+			phton32(buf, fv->value.uinteger);
+			key->len = 4;
+			break;
+
+		case SET_KEY_INT32:
+			phton32(buf, (guint32)fv->value.sinteger ^ 0x80000000U);
+			key->len = 4;
+			break;
+
+		case SET_KEY_UINT64:
+			put_be64(buf, fv->value.integer64);
+			key->len = 8;
+			break;
+
+		case SET_KEY_INT64:
+			put_be64(buf, fv->value.integer64 ^ G_GUINT64_CONSTANT(0x8000000000000000));
+			key->len = 8;
+			break;
+
+		case SET_KEY_IPv4:
+			phton32(buf, fv->value.ipv4.addr);
+			key->len = 4;
+			break;
+
+		case SET_KEY_IPv6:
+			key->data = fv->value.ipv6.addr.bytes;
+			key->len = 16;
+			break;
+
+		case SET_KEY_STRING:
+			key->data = (const guint8 *)fv->value.string;
+			key->len = (guint)strlen(fv->value.string);
+			break;
+
+		case SET_KEY_BYTES:
+			key->data = fv->value.bytes->data;
+			key->len = fv->value.bytes->len;
+			break;
+
+		case SET_KEY_GUID:
+			key->data = (const guint8 *)&fv->value.guid;
+			key->len = (guint)sizeof(e_guid_t);
+			break;
+
+		case SET_KEY_NONE:
+		default:
+			g_assert_not_reached();
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* FNV-1a */
+static guint
+set_key_hash(gconstpointer v)
+{
+	const set_key_t	*key = (const set_key_t *)v;
+	guint32		hash = 2166136261U;
+	guint		i;
+
+	for (i = 0; i < key->len; i++) {
+		hash ^= key->data[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static gboolean
+set_key_equal(gconstpointer v1, gconstpointer v2)
+{
+	const set_key_t	*a = (const set_key_t *)v1;
+	const set_key_t	*b = (const set_key_t *)v2;
+
+	return a->len == b->len && memcmp(a->data, b->data, a->len) == 0;
+}
+
+fvalue_set_t*
+fvalue_set_new(ftenum_t ftype)
+{
+	fvalue_set_t	*set;
+
+	g_assert(fvalue_set_type_supported(ftype));
+
+	set = g_new(fvalue_set_t, 1);
+	set->kind = key_kind(ftype);
+	set->width = key_width(set->kind);
+	/* Each key is allocated together with its data. */
+	set->values = g_hash_table_new_full(set_key_hash, set_key_equal,
+			g_free, NULL);
+	set->ranges = g_array_new(FALSE, FALSE, sizeof(guint8));
+	set->num_ranges = 0;
+	set->finished = FALSE;
+	return set;
+}
+
+void
+fvalue_set_free(fvalue_set_t *set)
+{
+	g_hash_table_destroy(set->values);
+	g_array_free(set->ranges, TRUE);
+	g_free(set);
+}
+
+static void
+add_range_keys(fvalue_set_t *set, const guint8 *low, const guint8 *high)
+{
+	g_assert(!set->finished);
+
+	g_array_append_vals(set->ranges, low, set->width);
+	g_array_append_vals(set->ranges, high, set->width);
+	set->num_ranges++;
+}
+
+void
+fvalue_set_add(fvalue_set_t *set, const fvalue_t *fv)
+{
+	guint8		buf[SET_KEY_MAX_WIDTH];
+	guint8		low[SET_KEY_MAX_WIDTH], high[SET_KEY_MAX_WIDTH];
+	set_key_t	key, *copy;
+	guint32		prefix, i;
+	guint8		mask;
+
+	if (!set_key(set, fv, buf, &key)) {
+		g_assert_not_reached();
+		return;
+	}
+
+	/* A subnet is the range of its addresses. */
+	if (set->kind == SET_KEY_IPv4 && fv->value.ipv4.nmask != 0xffffffff) {
+		phton32(low, fv->value.ipv4.addr & fv->value.ipv4.nmask);
+		phton32(high, fv->value.ipv4.addr | ~fv->value.ipv4.nmask);
+		add_range_keys(set, low, high);
+		return;
+	}
+	if (set->kind == SET_KEY_IPv6 && fv->value.ipv6.prefix < 128) {
+		prefix = fv->value.ipv6.prefix;
+		for (i = 0; i < 16; i++) {
+			if (prefix >= 8) {
+				mask = 0xff;
+				prefix -= 8;
+			}
+			else {
+				mask = (guint8)(0xff << (8 - prefix));
+				prefix = 0;
+			}
+			low[i] = key.data[i] & mask;
+			high[i] = key.data[i] | (guint8)~mask;
+		}
+		add_range_keys(set, low, high);
+		return;
+	}
+
+	copy = (set_key_t *)g_malloc(sizeof(set_key_t) + key.len);
+	copy->len = key.len;
+	copy->data = (const guint8 *)(copy + 1);
+	memcpy(copy + 1, key.data, key.len);
+	g_hash_table_replace(set->values, copy, copy);
+}
+
+gboolean
+fvalue_set_add_range(fvalue_set_t *set, const fvalue_t *low, const fvalue_t *high)
+{
+	guint8		low_buf[SET_KEY_MAX_WIDTH], high_buf[SET_KEY_MAX_WIDTH];
+	set_key_t	low_key, high_key;
+
+	g_assert(set->width != 0);
+
+	if (!set_key(set, low, low_buf, &low_key) ||
+			!set_key(set, high, high_buf, &high_key)) {
+		g_assert_not_reached();
+		return FALSE;
+	}
+	if (memcmp(low_key.data, high_key.data, set->width) > 0) {
+		return FALSE;
+	}
+	add_range_keys(set, low_key.data, high_key.data);
+	return TRUE;
+}
+
+static gint
+range_compare(gconstpointer a, gconstpointer b, gpointer width)
+{
+	return memcmp(a, b, GPOINTER_TO_UINT(width));
+}
+
+void
+fvalue_set_finish(fvalue_set_t *set)
+{
+	guint	i, n;
+
+	g_assert(!set->finished);
+	set->finished = TRUE;
+
+	if (set->num_ranges == 0) {
+		return;
+	}
+
+	/* Sort by low bound, then merge overlapping ranges so that the
+	 * high bounds are sorted too. */
+	g_qsort_with_data(set->ranges->data, set->num_ranges, 2 * set->width,
+			range_compare, GUINT_TO_POINTER(set->width));
+
+	n = 0;
+	for (i = 0; i < set->num_ranges; i++) {
+		if (n > 0 && memcmp(RANGE_LOW(set, i), RANGE_HIGH(set, n - 1), set->width) <= 0) {
+			if (memcmp(RANGE_HIGH(set, i), RANGE_HIGH(set, n - 1), set->width) > 0) {
+				memcpy(RANGE_HIGH(set, n - 1), RANGE_HIGH(set, i), set->width);
+			}
+			continue;
+		}
+		if (n != i) {
+			memmove(RANGE_LOW(set, n), RANGE_LOW(set, i), 2 * set->width);
+		}
+		n++;
+	}
+	set->num_ranges = n;
+	g_array_set_size(set->ranges, n * 2 * set->width);
+}
+
+gboolean
+fvalue_set_contains(const fvalue_set_t *set, const fvalue_t *fv)
+{
+	guint8		buf[SET_KEY_MAX_WIDTH];
+	set_key_t	key;
+	guint		low, high, mid;
+
+	if (!set_key(set, fv, buf, &key)) {
+		return FALSE;
+	}
+
+	if (g_hash_table_lookup(set->values, &key)) {
+		return TRUE;
+	}
+
+	/* Find the last range starting at or below the key. */
+	low = 0;
+	high = set->num_ranges;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (memcmp(RANGE_LOW(set, mid), key.data, set->width) <= 0) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return low > 0 &&
+		memcmp(key.data, RANGE_HIGH(set, low - 1), set->width) <= 0;
+}
+
+guint
+fvalue_set_num_values(const fvalue_set_t *set)
+{
+	return g_hash_table_size(set->values);
+}
+
+guint
+fvalue_set_num_ranges(const fvalue_set_t *set)
+{
+	return set->num_ranges;
+}
@@ -0,0 +1,76 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FVALUE_SET_H
+#define FVALUE_SET_H
+
+#include <glib.h>
+#include <ftypes/ftypes.h>
+
+/** @file
+ * The set of constants tested by the "in" operator.
+ *
+ * Single values are kept in a hash table, so a lookup costs the same
+ * whatever the size of the set. Ranges, and IPv4/IPv6 subnets, are
+ * kept as a sorted array of disjoint intervals searched by bisection.
+ * The set copies what it needs out of the fvalues added to it.
+ */
+
+typedef struct _fvalue_set_t fvalue_set_t;
+
+/* Whether values of ftype can be members of a set. */
+gboolean
+fvalue_set_type_supported(ftenum_t ftype);
+
+/* Whether values of ftype are ordered, so that a set of them may
+ * hold ranges. */
+gboolean
+fvalue_set_type_ordered(ftenum_t ftype);
+
+fvalue_set_t*
+fvalue_set_new(ftenum_t ftype);
+
+void
+fvalue_set_free(fvalue_set_t *set);
+
+/* Add a single value; an IPv4 or IPv6 subnet is added as the
+ * range of its addresses. */
+void
+fvalue_set_add(fvalue_set_t *set, const fvalue_t *fv);
+
+/* Add the range [low, high]; returns FALSE if low is above high. */
+gboolean
+fvalue_set_add_range(fvalue_set_t *set, const fvalue_t *low, const fvalue_t *high);
+
+/* Sort and merge the ranges; must be called once all members are
+ * added and before the set is searched. */
+void
+fvalue_set_finish(fvalue_set_t *set);
+
+gboolean
+fvalue_set_contains(const fvalue_set_t *set, const fvalue_t *fv);
+
+guint
+fvalue_set_num_values(const fvalue_set_t *set);
+
+guint
+fvalue_set_num_ranges(const fvalue_set_t *set);
+
+#endif
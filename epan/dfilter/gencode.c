@@ -27,11 +27,19 @@
 #include "sttype-range.h"
 #include "sttype-test.h"
 #include "sttype-function.h"
+#include "sttype-set.h"
+#include "multi-search.h"
 #include "ftypes/ftypes.h"
 
+#include <ftypes/ftypes-int.h>
+
 static void
 gencode(dfwork_t *dfw, stnode_t *st_node);
 
+/* "contains" tests on the same field that are or'ed together are run
+ * as one multi-pattern search once there are at least this many. */
+#define MULTI_SEARCH_MIN_TESTS	3
+
 static int
 gen_entity(dfwork_t *dfw, stnode_t *st_arg, dfvm_value_t **p_jmp);
 
@@ -277,6 +285,411 @@ gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_ar
 	}
 }
 
+/* The members of the set are moved into an fvalue_set_t that the
+ * instruction owns. */
+static void
+gen_membership(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	dfvm_insn_t		*insn;
+	dfvm_value_t		*val1, *val2;
+	dfvm_value_t		*jmp = NULL;
+	header_field_info	*hfinfo;
+	fvalue_set_t		*set;
+	set_member_t		*member;
+	fvalue_t		*low, *high;
+	GSList			*p;
+	int			reg;
+
+	hfinfo = (header_field_info*)stnode_data(st_arg1);
+	reg = gen_entity(dfw, st_arg1, &jmp);
+
+	set = fvalue_set_new(hfinfo->type);
+	for (p = sttype_set_members(st_arg2); p; p = p->next) {
+		member = (set_member_t *)p->data;
+		low = (fvalue_t *)stnode_data(member->low);
+		if (member->high) {
+			high = (fvalue_t *)stnode_data(member->high);
+			/* semcheck.c has rejected empty ranges */
+			if (!fvalue_set_add_range(set, low, high)) {
+				g_assert_not_reached();
+			}
+			FVALUE_FREE(high);
+			stnode_free(member->high);
+			member->high = NULL;
+		}
+		else {
+			fvalue_set_add(set, low);
+		}
+		FVALUE_FREE(low);
+		stnode_free(member->low);
+		member->low = NULL;
+	}
+	fvalue_set_finish(set);
+
+	insn = dfvm_insn_new(ANY_IN);
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = reg;
+	val2 = dfvm_value_new(FVALUE_SET);
+	val2->value.fvalue_set = set;
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	dfw_append_insn(dfw, insn);
+
+	if (jmp) {
+		jmp->value.numeric = dfw->next_insn_id;
+	}
+}
+
+/* If st_node tests whether a field contains a constant that a
+ * multi-pattern search can look for, returns the first field of that
+ * name; otherwise returns NULL. */
+static header_field_info *
+multi_search_field(stnode_t *st_node)
+{
+	test_op_t		st_op;
+	stnode_t		*st_arg1, *st_arg2;
+	header_field_info	*hfinfo, *first;
+	const guint8		*data;
+	guint			len;
+
+	if (stnode_type_id(st_node) != STTYPE_TEST) {
+		return NULL;
+	}
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	if (st_op != TEST_OP_CONTAINS ||
+			stnode_type_id(st_arg1) != STTYPE_FIELD ||
+			stnode_type_id(st_arg2) != STTYPE_FVALUE) {
+		return NULL;
+	}
+
+	/* Every field of that name must be searched the same way. */
+	first = (header_field_info*)stnode_data(st_arg1);
+	while (first->same_name_prev_id != -1) {
+		first = proto_registrar_get_nth(first->same_name_prev_id);
+	}
+	for (hfinfo = first; hfinfo; hfinfo = hfinfo->same_name_next) {
+		if (hfinfo->type != first->type) {
+			return NULL;
+		}
+	}
+	if (!multi_search_type_supported(first->type) ||
+			fvalue_type_ftenum((fvalue_t *)stnode_data(st_arg2)) != first->type) {
+		return NULL;
+	}
+
+	/* Leave the corner case of an empty value to the ftype. */
+	if (!multi_search_fvalue_bytes((fvalue_t *)stnode_data(st_arg2), &data, &len) ||
+			len == 0) {
+		return NULL;
+	}
+	return first;
+}
+
+/* Collects the operands of a chain of "and"s or of "or"s. */
+static void
+flatten_chain(stnode_t *st_node, test_op_t chain_op, GPtrArray *terms)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+
+	if (stnode_type_id(st_node) == STTYPE_TEST) {
+		sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+		if (st_op == chain_op) {
+			flatten_chain(st_arg1, chain_op, terms);
+			flatten_chain(st_arg2, chain_op, terms);
+			return;
+		}
+	}
+	g_ptr_array_add(terms, st_node);
+}
+
+/* One instruction searching a field for the constants of several
+ * "contains" tests; the constants are moved into a multi_search_t
+ * that the instruction owns. */
+static void
+gen_multi_search(dfwork_t *dfw, GPtrArray *tests)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2;
+	dfvm_value_t	*jmp = NULL;
+	stnode_t	*st_arg1, *st_arg2;
+	multi_search_t	*ms;
+	fvalue_t	*fv;
+	const guint8	*data;
+	guint		i, len;
+	int		reg;
+
+	ms = multi_search_new();
+	for (i = 0; i < tests->len; i++) {
+		sttype_test_get((stnode_t *)g_ptr_array_index(tests, i), NULL, &st_arg1, &st_arg2);
+		fv = (fvalue_t *)stnode_data(st_arg2);
+		if (multi_search_fvalue_bytes(fv, &data, &len)) {
+			multi_search_add(ms, data, len);
+		}
+		FVALUE_FREE(fv);
+		stnode_free(st_arg2);
+		sttype_test_set2_args((stnode_t *)g_ptr_array_index(tests, i), st_arg1, NULL);
+	}
+	multi_search_compile(ms);
+
+	sttype_test_get((stnode_t *)g_ptr_array_index(tests, 0), NULL, &st_arg1, NULL);
+	reg = gen_entity(dfw, st_arg1, &jmp);
+
+	insn = dfvm_insn_new(ANY_CONTAINS_ANY);
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = reg;
+	val2 = dfvm_value_new(MULTI_SEARCH);
+	val2->value.multi_search = ms;
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	dfw_append_insn(dfw, insn);
+
+	if (jmp) {
+		jmp->value.numeric = dfw->next_insn_id;
+	}
+}
+
+/* Estimated costs of evaluating a test, so that the operands of an
+ * "and" or "or" can be evaluated cheapest first: checking for a field
+ * and comparing fixed-size values come before comparing strings, which
+ * come before searching them and matching regular expressions. */
+#define COST_LOAD		1
+#define COST_FIXED		2
+#define COST_SET		3
+#define COST_VARIABLE		4
+#define COST_FUNCTION		4
+#define COST_CONTAINS		8
+#define COST_MATCHES		16
+
+static gboolean
+ftype_fixed_size(ftenum_t ftype)
+{
+	return IS_FT_INT(ftype) || IS_FT_UINT(ftype) || IS_FT_TIME(ftype) ||
+		ftype == FT_BOOLEAN || ftype == FT_FLOAT || ftype == FT_DOUBLE ||
+		ftype == FT_IPv4 || ftype == FT_IPXNET || ftype == FT_ETHER ||
+		ftype == FT_EUI64;
+}
+
+/* Cost of producing a value, and whether comparing it is cheap. */
+static int
+entity_cost(stnode_t *st_arg, gboolean *fixed)
+{
+	GSList	*params;
+	int	cost;
+
+	switch (stnode_type_id(st_arg)) {
+		case STTYPE_FIELD:
+			*fixed = ftype_fixed_size(((header_field_info *)stnode_data(st_arg))->type);
+			return COST_LOAD;
+
+		case STTYPE_RANGE:
+			*fixed = FALSE;
+			return COST_LOAD + entity_cost(sttype_range_entity(st_arg), fixed);
+
+		case STTYPE_FUNCTION:
+			cost = COST_FUNCTION;
+			for (params = sttype_function_params(st_arg); params; params = params->next) {
+				cost += entity_cost((stnode_t *)params->data, fixed);
+			}
+			*fixed = FALSE;
+			return cost;
+
+		default:
+			*fixed = TRUE;
+			return 0;
+	}
+}
+
+static int
+test_cost(stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+	gboolean	fixed1 = TRUE, fixed2 = TRUE;
+	int		cost;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+
+	switch (st_op) {
+		case TEST_OP_EXISTS:
+			return COST_LOAD;
+
+		case TEST_OP_NOT:
+			return test_cost(st_arg1);
+
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			return test_cost(st_arg1) + test_cost(st_arg2);
+
+		case TEST_OP_IN:
+			return entity_cost(st_arg1, &fixed1) + COST_SET;
+
+		default:
+			break;
+	}
+
+	cost = entity_cost(st_arg1, &fixed1) + entity_cost(st_arg2, &fixed2);
+	switch (st_op) {
+		case TEST_OP_CONTAINS:
+			return cost + COST_CONTAINS;
+		case TEST_OP_MATCHES:
+			return cost + COST_MATCHES;
+		default:
+			return cost + ((fixed1 && fixed2) ? COST_FIXED : COST_VARIABLE);
+	}
+}
+
+/* An operand of an "and" or "or", or a group of "contains" tests of
+ * an "or" searched together */
+typedef struct {
+	stnode_t	*term;
+	GPtrArray	*tests;
+	int		cost;
+	guint		index;
+} chain_part_t;
+
+/* Cheapest first; otherwise in the order they were written */
+static gint
+compare_chain_parts(gconstpointer a, gconstpointer b)
+{
+	const chain_part_t	*part_a = (const chain_part_t *)a;
+	const chain_part_t	*part_b = (const chain_part_t *)b;
+
+	if (part_a->cost != part_b->cost)
+		return part_a->cost < part_b->cost ? -1 : 1;
+	return part_a->index < part_b->index ? -1 : (part_a->index > part_b->index);
+}
+
+/* Splits the operands of an "or" into parts, pulling the "contains"
+ * tests on a field together if there are enough of them. A group
+ * takes the place of the first of its tests. */
+static void
+gen_or_parts(GPtrArray *terms, GArray *parts)
+{
+	GHashTable		*counts, *groups;
+	header_field_info	*hfinfo;
+	stnode_t		*term;
+	GPtrArray		*tests;
+	chain_part_t		part;
+	guint			i, count;
+
+	counts = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (i = 0; i < terms->len; i++) {
+		hfinfo = multi_search_field((stnode_t *)g_ptr_array_index(terms, i));
+		if (hfinfo) {
+			count = GPOINTER_TO_UINT(g_hash_table_lookup(counts, hfinfo)) + 1;
+			g_hash_table_insert(counts, hfinfo, GUINT_TO_POINTER(count));
+		}
+	}
+
+	groups = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (i = 0; i < terms->len; i++) {
+		term = (stnode_t *)g_ptr_array_index(terms, i);
+		hfinfo = multi_search_field(term);
+		if (hfinfo && GPOINTER_TO_UINT(g_hash_table_lookup(counts, hfinfo)) >= MULTI_SEARCH_MIN_TESTS) {
+			tests = (GPtrArray *)g_hash_table_lookup(groups, hfinfo);
+			if (!tests) {
+				tests = g_ptr_array_new();
+				g_hash_table_insert(groups, hfinfo, tests);
+				part.term = NULL;
+				part.tests = tests;
+				/* One search, however many tests */
+				part.cost = test_cost(term);
+				part.index = parts->len;
+				g_array_append_val(parts, part);
+			}
+			g_ptr_array_add(tests, term);
+		}
+		else {
+			part.term = term;
+			part.tests = NULL;
+			part.cost = test_cost(term);
+			part.index = parts->len;
+			g_array_append_val(parts, part);
+		}
+	}
+
+	g_hash_table_destroy(groups);
+	g_hash_table_destroy(counts);
+}
+
+/* Generate a chain of "and"s or of "or"s, evaluating its operands
+ * cheapest first; they have no side effects, so their order only
+ * matters to how soon the chain can stop. For the root of the filter,
+ * the terms are recorded so that they can be reordered at run time
+ * by how often they turn out to be true. */
+static void
+gen_chain(dfwork_t *dfw, stnode_t *st_node, test_op_t chain_op)
+{
+	GPtrArray	*terms;
+	GArray		*parts;
+	chain_part_t	part;
+	dfvm_term_t	term;
+	GSList		*jumps = NULL, *l;
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1;
+	gboolean	root;
+	guint		i;
+
+	root = (dfw->terms != NULL && st_node == dfw->st_root);
+
+	terms = g_ptr_array_new();
+	flatten_chain(st_node, chain_op, terms);
+
+	parts = g_array_new(FALSE, FALSE, sizeof(chain_part_t));
+	if (chain_op == TEST_OP_OR) {
+		gen_or_parts(terms, parts);
+	}
+	else {
+		for (i = 0; i < terms->len; i++) {
+			part.term = (stnode_t *)g_ptr_array_index(terms, i);
+			part.tests = NULL;
+			part.cost = test_cost(part.term);
+			part.index = i;
+			g_array_append_val(parts, part);
+		}
+	}
+	g_array_sort(parts, compare_chain_parts);
+
+	for (i = 0; i < parts->len; i++) {
+		part = g_array_index(parts, chain_part_t, i);
+		term.start = dfw->next_insn_id;
+		if (part.tests) {
+			gen_multi_search(dfw, part.tests);
+			g_ptr_array_free(part.tests, TRUE);
+		}
+		else {
+			gencode(dfw, part.term);
+		}
+		term.end = dfw->next_insn_id;
+
+		if (i + 1 < parts->len) {
+			insn = dfvm_insn_new(chain_op == TEST_OP_AND ? IF_FALSE_GOTO : IF_TRUE_GOTO);
+			val1 = dfvm_value_new(INSN_NUMBER);
+			insn->arg1 = val1;
+			dfw_append_insn(dfw, insn);
+			jumps = g_slist_prepend(jumps, val1);
+		}
+
+		if (root) {
+			term.cost = part.cost;
+			term.evaluated = 0;
+			term.passed = 0;
+			g_array_append_val(dfw->terms, term);
+		}
+	}
+	for (l = jumps; l; l = l->next) {
+		((dfvm_value_t *)l->data)->value.numeric = dfw->next_insn_id;
+	}
+	if (root) {
+		dfw->terms_and = (chain_op == TEST_OP_AND);
+	}
+
+	g_slist_free(jumps);
+	g_array_free(parts, TRUE);
+	g_ptr_array_free(terms, TRUE);
+}
+
 /* Parse an entity, returning the reg that it gets put into.
  * p_jmp will be set if it has to be set by the calling code; it should
  * be set to the place to jump to, to return to the calling code,
@@ -364,27 +777,8 @@ gen_test(dfwork_t *dfw, stnode_t *st_node)
 			break;
 
 		case TEST_OP_AND:
-			gencode(dfw, st_arg1);
-
-			insn = dfvm_insn_new(IF_FALSE_GOTO);
-			val1 = dfvm_value_new(INSN_NUMBER);
-			insn->arg1 = val1;
-			dfw_append_insn(dfw, insn);
-
-			gencode(dfw, st_arg2);
-			val1->value.numeric = dfw->next_insn_id;
-			break;
-
 		case TEST_OP_OR:
-			gencode(dfw, st_arg1);
-
-			insn = dfvm_insn_new(IF_TRUE_GOTO);
-			val1 = dfvm_value_new(INSN_NUMBER);
-			insn->arg1 = val1;
-			dfw_append_insn(dfw, insn);
-
-			gencode(dfw, st_arg2);
-			val1->value.numeric = dfw->next_insn_id;
+			gen_chain(dfw, st_node, st_op);
 			break;
 
 		case TEST_OP_EQ:
@@ -422,6 +816,10 @@ gen_test(dfwork_t *dfw, stnode_t *st_node)
 		case TEST_OP_MATCHES:
 			gen_relation(dfw, ANY_MATCHES, st_arg1, st_arg2);
 			break;
+
+		case TEST_OP_IN:
+			gen_membership(dfw, st_arg1, st_arg2);
+			break;
 	}
 }
 
@@ -448,6 +846,8 @@ dfw_gencode(dfwork_t *dfw)
 	int		id, id1, length;
 	dfvm_insn_t	*insn, *insn1, *prev;
 	dfvm_value_t	*arg1;
+	gboolean	*term_end = NULL;
+	guint		i;
 
 	dfw->insns = g_ptr_array_new();
 	dfw->consts = g_ptr_array_new();
@@ -459,6 +859,15 @@ dfw_gencode(dfwork_t *dfw)
 	/* fixup goto */
 	length = dfw->insns->len;
 
+	/* Jumps must stay within the root terms, or they couldn't be
+	 * reordered. */
+	if (dfw->terms && dfw->terms->len) {
+		term_end = g_new0(gboolean, length);
+		for (i = 0; i < dfw->terms->len; i++) {
+			term_end[g_array_index(dfw->terms, dfvm_term_t, i).end] = TRUE;
+		}
+	}
+
 	for (id = 0, prev = NULL; id < length; prev = insn, id++) {
 		insn = (dfvm_insn_t	*)g_ptr_array_index(dfw->insns, id);
 		arg1 = insn->arg1;
@@ -467,7 +876,12 @@ dfw_gencode(dfwork_t *dfw)
 			id1 = arg1->value.numeric;
 			do {
 				insn1 = (dfvm_insn_t*)g_ptr_array_index(dfw->insns, id1);
-				if (insn1->op == revert) {
+				if (term_end && term_end[id1]) {
+					arg1 = insn->arg1;
+					arg1->value.numeric = id1;
+					break;
+				}
+				else if (insn1->op == revert) {
 					/* this one is always false and the branch is not taken*/
 					id1 = id1 +1;
 					continue;
@@ -491,6 +905,7 @@ dfw_gencode(dfwork_t *dfw)
 			} while (1);
 		}
 	}
+	g_free(term_end);
 
 	/* move constants after registers*/
 	if (dfw->first_constant == -1) {
@@ -0,0 +1,312 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "multi-search.h"
+
+#include <ftypes/ftypes-int.h>
+#include <epan/exceptions.h>
+#include <epan/tvbuff.h>
+
+#define NO_STATE	G_MAXUINT32
+
+struct _multi_search_t {
+	GPtrArray	*patterns;	/* GByteArray's, until compiled */
+	guint		num_patterns;
+	/* Bytes that occur in no pattern are in class 0. */
+	guint16		byte_class[256];
+	guint		num_classes;
+	/* The automaton, one row of num_classes transitions per state;
+	 * state 0 is the initial state. */
+	guint32		*delta;
+	guint8		*accept;
+	guint		num_states;
+	/* Bytes that start a pattern */
+	guint8		start_byte[256];
+	guint		num_start_bytes;
+	guint8		first_start_byte;
+	gboolean	compiled;
+};
+
+multi_search_t*
+multi_search_new(void)
+{
+	multi_search_t	*ms;
+
+	ms = g_new0(multi_search_t, 1);
+	ms->patterns = g_ptr_array_new();
+	return ms;
+}
+
+static void
+free_patterns(multi_search_t *ms)
+{
+	guint	i;
+
+	for (i = 0; i < ms->patterns->len; i++) {
+		g_byte_array_free((GByteArray *)g_ptr_array_index(ms->patterns, i), TRUE);
+	}
+	g_ptr_array_free(ms->patterns, TRUE);
+	ms->patterns = NULL;
+}
+
+void
+multi_search_free(multi_search_t *ms)
+{
+	if (ms->patterns) {
+		free_patterns(ms);
+	}
+	g_free(ms->delta);
+	g_free(ms->accept);
+	g_free(ms);
+}
+
+void
+multi_search_add(multi_search_t *ms, const guint8 *pattern, guint len)
+{
+	GByteArray	*copy;
+
+	g_assert(!ms->compiled);
+
+	if (len == 0) {
+		return;
+	}
+	copy = g_byte_array_sized_new(len);
+	g_byte_array_append(copy, pattern, len);
+	g_ptr_array_add(ms->patterns, copy);
+	ms->num_patterns++;
+}
+
+void
+multi_search_compile(multi_search_t *ms)
+{
+	GByteArray	*pattern;
+	guint		i, j, c, nc, total, max_states;
+	guint32		s, r, *fail, *queue;
+	guint		head, tail;
+
+	g_assert(!ms->compiled);
+	ms->compiled = TRUE;
+
+	/* Give every byte used by a pattern a class of its own. */
+	nc = 1;
+	total = 0;
+	for (i = 0; i < ms->patterns->len; i++) {
+		pattern = (GByteArray *)g_ptr_array_index(ms->patterns, i);
+		for (j = 0; j < pattern->len; j++) {
+			if (!ms->byte_class[pattern->data[j]]) {
+				ms->byte_class[pattern->data[j]] = nc++;
+			}
+		}
+		if (!ms->start_byte[pattern->data[0]]) {
+			ms->start_byte[pattern->data[0]] = TRUE;
+			ms->first_start_byte = pattern->data[0];
+			ms->num_start_bytes++;
+		}
+		total += pattern->len;
+	}
+	ms->num_classes = nc;
+
+	/* The trie of the patterns */
+	max_states = total + 1;
+	ms->delta = g_new(guint32, (gsize)max_states * nc);
+	memset(ms->delta, 0xff, (gsize)max_states * nc * sizeof(guint32));
+	ms->accept = g_new0(guint8, max_states);
+	ms->num_states = 1;
+
+	for (i = 0; i < ms->patterns->len; i++) {
+		pattern = (GByteArray *)g_ptr_array_index(ms->patterns, i);
+		s = 0;
+		for (j = 0; j < pattern->len; j++) {
+			c = ms->byte_class[pattern->data[j]];
+			if (ms->delta[(gsize)s * nc + c] == NO_STATE) {
+				ms->delta[(gsize)s * nc + c] = ms->num_states++;
+			}
+			s = ms->delta[(gsize)s * nc + c];
+		}
+		ms->accept[s] = TRUE;
+	}
+	free_patterns(ms);
+
+	/* Compute the failure links breadth first, and replace each
+	 * missing transition by the one of the failure state, so that
+	 * searching takes exactly one transition per byte. */
+	fail = g_new(guint32, ms->num_states);
+	queue = g_new(guint32, ms->num_states);
+	head = tail = 0;
+
+	for (c = 0; c < nc; c++) {
+		s = ms->delta[c];
+		if (s == NO_STATE) {
+			ms->delta[c] = 0;
+		}
+		else {
+			fail[s] = 0;
+			queue[tail++] = s;
+		}
+	}
+
+	while (head < tail) {
+		r = queue[head++];
+		/* A pattern that is a suffix of this state also ends here. */
+		if (ms->accept[fail[r]]) {
+			ms->accept[r] = TRUE;
+		}
+		for (c = 0; c < nc; c++) {
+			s = ms->delta[(gsize)r * nc + c];
+			if (s == NO_STATE) {
+				ms->delta[(gsize)r * nc + c] = ms->delta[(gsize)fail[r] * nc + c];
+			}
+			else {
+				fail[s] = ms->delta[(gsize)fail[r] * nc + c];
+				queue[tail++] = s;
+			}
+		}
+	}
+
+	g_free(fail);
+	g_free(queue);
+
+	ms->delta = g_renew(guint32, ms->delta, (gsize)ms->num_states * nc);
+	ms->accept = g_renew(guint8, ms->accept, ms->num_states);
+}
+
+gboolean
+multi_search_find(const multi_search_t *ms, const guint8 *data, guint len)
+{
+	const guint8	*p, *end;
+	guint32		state = 0;
+
+	g_assert(ms->compiled);
+
+	if (ms->num_patterns == 0) {
+		return FALSE;
+	}
+
+	p = data;
+	end = data + len;
+	while (p < end) {
+		if (state == 0) {
+			/* Nothing matched so far; skip to a byte that
+			 * can start a pattern. */
+			if (ms->num_start_bytes == 1) {
+				p = (const guint8 *)memchr(p, ms->first_start_byte, end - p);
+				if (!p) {
+					return FALSE;
+				}
+			}
+			else {
+				while (!ms->start_byte[*p]) {
+					if (++p == end) {
+						return FALSE;
+					}
+				}
+			}
+		}
+		state = ms->delta[(gsize)state * ms->num_classes + ms->byte_class[*p]];
+		if (ms->accept[state]) {
+			return TRUE;
+		}
+		p++;
+	}
+	return FALSE;
+}
+
+guint
+multi_search_num_patterns(const multi_search_t *ms)
+{
+	return ms->num_patterns;
+}
+
+gboolean
+multi_search_type_supported(ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_PROTOCOL:
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_ETHER:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+gboolean
+multi_search_fvalue_bytes(const fvalue_t *fv, const guint8 **data, guint *len)
+{
+	tvbuff_t		*tvb;
+	volatile gboolean	ok = FALSE;
+
+	switch (fv->ftype->ftype) {
+		case FT_PROTOCOL:
+			tvb = fv->value.tvb;
+			if (!tvb) {
+				return FALSE;
+			}
+			TRY {
+				*len = tvb_length(tvb);
+				*data = tvb_get_ptr(tvb, 0, *len);
+				ok = TRUE;
+			}
+			CATCH_ALL {
+				/* nothing */
+			}
+			ENDTRY;
+			return ok;
+
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			*data = (const guint8 *)fv->value.string;
+			*len = (guint)strlen(fv->value.string);
+			return TRUE;
+
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_ETHER:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			*data = fv->value.bytes->data;
+			*len = fv->value.bytes->len;
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
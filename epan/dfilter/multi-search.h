@@ -0,0 +1,72 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MULTI_SEARCH_H
+#define MULTI_SEARCH_H
+
+#include <glib.h>
+#include <ftypes/ftypes.h>
+
+/** @file
+ * Searching for any of a set of byte strings in one pass, used to run
+ * many "contains" tests on the same field.
+ *
+ * The patterns are compiled into an Aho-Corasick automaton whose input
+ * alphabet is reduced to the bytes that occur in the patterns. While
+ * the automaton is in its initial state, the search skips ahead with
+ * memchr() or a lookup table to the next byte that can start a pattern.
+ */
+
+typedef struct _multi_search_t multi_search_t;
+
+multi_search_t*
+multi_search_new(void);
+
+void
+multi_search_free(multi_search_t *ms);
+
+/* Add a pattern; the data is copied. Empty patterns are ignored. */
+void
+multi_search_add(multi_search_t *ms, const guint8 *pattern, guint len);
+
+/* Build the automaton; must be called once all patterns are added and
+ * before searching. */
+void
+multi_search_compile(multi_search_t *ms);
+
+/* Whether any of the patterns occurs in data. */
+gboolean
+multi_search_find(const multi_search_t *ms, const guint8 *data, guint len);
+
+guint
+multi_search_num_patterns(const multi_search_t *ms);
+
+/* Whether "contains" on values of ftype searches the bytes returned by
+ * multi_search_fvalue_bytes(). */
+gboolean
+multi_search_type_supported(ftenum_t ftype);
+
+/* Points data at the bytes that "contains" and "matches" search in a
+ * string, byte array or protocol value; returns FALSE if fv is of
+ * another type or has no data. */
+gboolean
+multi_search_fvalue_bytes(const fvalue_t *fv, const guint8 **data, guint *len);
+
+#endif
@@ -28,6 +28,8 @@
 #include "sttype-range.h"
 #include "sttype-test.h"
 #include "sttype-function.h"
+#include "sttype-set.h"
+#include "fvalue-set.h"
 
 #include <epan/exceptions.h>
 #include <epan/packet.h>
@@ -412,6 +414,7 @@ check_exists(dfwork_t *dfw, stnode_t *st_arg1)
 		case STTYPE_TEST:
 		case STTYPE_INTEGER:
 		case STTYPE_FVALUE:
+		case STTYPE_SET:
 		case STTYPE_NUM_TYPES:
 			g_assert_not_reached();
 	}
@@ -1238,6 +1241,194 @@ header_field_info   *hfinfo;
 			g_assert_not_reached();
 	}
 }
+/* Gives a value found in a value_string (always an FT_UINT32 or
+ * FT_UINT64) the integer type of the field it is a member for. */
+static fvalue_t*
+retype_integer_fvalue(fvalue_t *fv, ftenum_t ftype)
+{
+	fvalue_t	*new_fv;
+	guint64		val;
+
+	if (fvalue_type_ftenum(fv) == ftype) {
+		return fv;
+	}
+
+	if (fvalue_type_ftenum(fv) == FT_UINT64)
+		val = fvalue_get_integer64(fv);
+	else
+		val = fvalue_get_uinteger(fv);
+	FVALUE_FREE(fv);
+
+	new_fv = fvalue_new(ftype);
+	switch (ftype) {
+		case FT_UINT64:
+		case FT_INT64:
+			fvalue_set_integer64(new_fv, val);
+			break;
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			fvalue_set_sinteger(new_fv, (gint32)val);
+			break;
+		default:
+			fvalue_set_uinteger(new_fv, (guint32)val);
+			break;
+	}
+	return new_fv;
+}
+
+/* Converts a member of a set to a value of the field's type, or
+ * returns NULL and sets the error message. */
+static fvalue_t*
+set_member_fvalue(dfwork_t *dfw, header_field_info *hfinfo,
+		sttype_id_t type, char *s)
+{
+	fvalue_t	*fvalue;
+
+	if (type == STTYPE_STRING)
+		fvalue = dfilter_fvalue_from_string(dfw, hfinfo->type, s);
+	else
+		fvalue = dfilter_fvalue_from_unparsed(dfw, hfinfo->type, s, FALSE);
+
+	if (!fvalue) {
+		/* check value_string */
+		fvalue = mk_fvalue_from_val_string(dfw, hfinfo, s);
+		if (fvalue) {
+			fvalue = retype_integer_fvalue(fvalue, hfinfo->type);
+		}
+	}
+	return fvalue;
+}
+
+/* Frees the values the members of a set have been converted to, if
+ * checking a later member fails. */
+static void
+free_set_fvalues(stnode_t *st_set)
+{
+	GSList		*p;
+	set_member_t	*member;
+
+	for (p = sttype_set_members(st_set); p; p = p->next) {
+		member = (set_member_t *)p->data;
+		if (member->low && stnode_type_id(member->low) == STTYPE_FVALUE) {
+			FVALUE_FREE((fvalue_t *)stnode_data(member->low));
+			stnode_free(member->low);
+			member->low = NULL;
+		}
+		if (member->high && stnode_type_id(member->high) == STTYPE_FVALUE) {
+			FVALUE_FREE((fvalue_t *)stnode_data(member->high));
+			stnode_free(member->high);
+			member->high = NULL;
+		}
+	}
+}
+
+/* Converts each member of a set to a value, or a range of values, of
+ * the field's type. */
+static void
+check_set_members(dfwork_t *dfw, header_field_info *hfinfo, stnode_t *st_set)
+{
+	ftenum_t		ftype = hfinfo->type;
+	GSList			*p;
+	set_member_t		*member;
+	sttype_id_t		type;
+	fvalue_t		*low, *high;
+	char			*s, *sep, *low_s;
+
+	for (p = sttype_set_members(st_set); p; p = p->next) {
+		member = (set_member_t *)p->data;
+		type = stnode_type_id(member->low);
+
+		switch (type) {
+			case STTYPE_STRING:
+			case STTYPE_UNPARSED:
+				s = (char *)stnode_data(member->low);
+				break;
+			case STTYPE_FIELD:
+				/* Names such as "tcp" may be value_string
+				 * entries as well as fields. */
+				s = (char *)((header_field_info *)stnode_data(member->low))->abbrev;
+				type = STTYPE_UNPARSED;
+				break;
+			default:
+				dfilter_fail(dfw, "Only values can be members of a set.");
+				THROW(TypeError);
+				return;
+		}
+
+		/* "low..high" */
+		sep = NULL;
+		if (type == STTYPE_UNPARSED && fvalue_set_type_ordered(ftype)) {
+			sep = strstr(s, "..");
+		}
+
+		high = NULL;
+		if (sep) {
+			low_s = g_strndup(s, sep - s);
+			low = set_member_fvalue(dfw, hfinfo, type, low_s);
+			g_free(low_s);
+			if (!low) {
+				THROW(TypeError);
+			}
+			high = set_member_fvalue(dfw, hfinfo, type, sep + 2);
+			if (!high) {
+				FVALUE_FREE(low);
+				THROW(TypeError);
+			}
+			if (fvalue_gt(low, high)) {
+				FVALUE_FREE(low);
+				FVALUE_FREE(high);
+				dfilter_fail(dfw, "The range \"%s\" is empty.", s);
+				THROW(TypeError);
+			}
+		}
+		else {
+			low = set_member_fvalue(dfw, hfinfo, type, s);
+			if (!low) {
+				THROW(TypeError);
+			}
+		}
+
+		stnode_free(member->low);
+		member->low = stnode_new(STTYPE_FVALUE, low);
+		if (high) {
+			member->high = stnode_new(STTYPE_FVALUE, high);
+		}
+	}
+}
+
+/* Check the semantics of a set membership test */
+static void
+check_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	header_field_info	*hfinfo;
+
+	DebugLog(("   4 check_relation_in()\n"));
+
+	if (stnode_type_id(st_arg1) != STTYPE_FIELD) {
+		dfilter_fail(dfw, "Only a field can be tested for membership in a set.");
+		THROW(TypeError);
+	}
+
+	hfinfo = (header_field_info*)stnode_data(st_arg1);
+
+	if (!fvalue_set_type_supported(hfinfo->type)) {
+		dfilter_fail(dfw, "%s (type=%s) cannot participate in 'in' comparison.",
+				hfinfo->abbrev, ftype_pretty_name(hfinfo->type));
+		THROW(TypeError);
+	}
+
+	TRY {
+		check_set_members(dfw, hfinfo, st_arg2);
+	}
+	CATCH(TypeError) {
+		/* The syntax tree doesn't own the values */
+		free_set_fvalues(st_arg2);
+		RETHROW;
+	}
+	ENDTRY;
+}
 
 /* Check the semantics of any type of TEST */
 static void
@@ -1314,6 +1505,9 @@ check_test(dfwork_t *dfw, stnode_t *st_node, GPtrArray *deprecated)
 			break;
 		case TEST_OP_MATCHES:
 			check_relation(dfw, "matches", TRUE, ftype_can_matches, st_node, st_arg1, st_arg2);			break;
+		case TEST_OP_IN:
+			check_relation_in(dfw, st_arg1, st_arg2);
+			break;
 
 		default:
 			g_assert_not_reached();
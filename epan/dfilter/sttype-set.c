@@ -0,0 +1,148 @@
+/* sttype-set.c
+ * Syntax tree node holding the members of a display filter set
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+
+#include "syntax-tree.h"
+#include "sttype-set.h"
+
+typedef struct {
+	guint32		magic;
+	GSList		*members;
+	GSList		*last;
+} set_t;
+
+#define SET_MAGIC	0xc2d4e37a
+
+static gpointer
+set_new(gpointer junk)
+{
+	set_t		*set;
+
+	g_assert(junk == NULL);
+
+	set = g_new(set_t, 1);
+
+	set->magic = SET_MAGIC;
+	set->members = NULL;
+	set->last = NULL;
+
+	return (gpointer) set;
+}
+
+static void
+set_append(set_t *set, stnode_t *low, stnode_t *high)
+{
+	set_member_t	*member;
+	GSList		*link;
+
+	member = g_new(set_member_t, 1);
+	member->low = low;
+	member->high = high;
+
+	/* Keep a pointer to the tail, as sets may be large. */
+	link = g_slist_alloc();
+	link->data = member;
+	link->next = NULL;
+	if (set->last) {
+		set->last->next = link;
+	}
+	else {
+		set->members = link;
+	}
+	set->last = link;
+}
+
+static gpointer
+set_dup(gconstpointer data)
+{
+	const set_t	*org = (const set_t *)data;
+	set_t		*set;
+	GSList		*p;
+	set_member_t	*member;
+
+	set = (set_t *)set_new(NULL);
+
+	for (p = org->members; p; p = p->next) {
+		member = (set_member_t *)p->data;
+		set_append(set, stnode_dup(member->low), stnode_dup(member->high));
+	}
+	return (gpointer) set;
+}
+
+static void
+set_free(gpointer value)
+{
+	set_t		*set = (set_t *)value;
+	GSList		*p;
+	set_member_t	*member;
+
+	assert_magic(set, SET_MAGIC);
+
+	for (p = set->members; p; p = p->next) {
+		member = (set_member_t *)p->data;
+		if (member->low)
+			stnode_free(member->low);
+		if (member->high)
+			stnode_free(member->high);
+		g_free(member);
+	}
+	g_slist_free(set->members);
+	g_free(set);
+}
+
+void
+sttype_set_add(stnode_t *node, stnode_t *low, stnode_t *high)
+{
+	set_t	*set;
+
+	set = (set_t*)stnode_data(node);
+	assert_magic(set, SET_MAGIC);
+
+	set_append(set, low, high);
+}
+
+GSList*
+sttype_set_members(stnode_t *node)
+{
+	set_t	*set;
+
+	set = (set_t*)stnode_data(node);
+	assert_magic(set, SET_MAGIC);
+
+	return set->members;
+}
+
+void
+sttype_register_set(void)
+{
+	static sttype_t set_type = {
+		STTYPE_SET,
+		"SET",
+		set_new,
+		set_free,
+		set_dup
+	};
+
+	sttype_register(&set_type);
+}
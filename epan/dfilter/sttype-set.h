@@ -0,0 +1,43 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef STTYPE_SET_H
+#define STTYPE_SET_H
+
+#include "syntax-tree.h"
+
+/* A member of a set: a single value, or the range [low, high] if
+ * high is not NULL. */
+typedef struct {
+	stnode_t	*low;
+	stnode_t	*high;
+} set_member_t;
+
+/* Append a member to a set stnode_t; the set takes over low and high. */
+void
+sttype_set_add(stnode_t *node, stnode_t *low, stnode_t *high);
+
+/* Get the list of set_member_t's of a set stnode_t. The nodes of a
+ * member may be replaced, freeing the old ones. */
+GSList*
+sttype_set_members(stnode_t *node);
+
+#endif
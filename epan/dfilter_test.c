@@ -0,0 +1,221 @@
+/* dfilter_test.c
+ * Tests of the cache of compiled display filters and of filter sets
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "epan.h"
+#include "epan_dissect.h"
+#include "proto.h"
+#include "dfilter/dfilter.h"
+#include "register.h"
+
+/* Number of filters dfilter_compile_cached() keeps */
+#define CACHE_SIZE 32
+
+/* Matches an empty tree */
+#define MATCHING_FILTER "!frame"
+
+static epan_dissect_t test_edt;
+
+static dfilter_t *
+compile_cached(const char *text)
+{
+    dfilter_t *df = NULL;
+    gchar *err_msg = NULL;
+
+    if (!dfilter_compile_cached(text, &df, &err_msg)) {
+        g_test_message("%s: %s", text, err_msg);
+        g_free(err_msg);
+        g_assert_not_reached();
+    }
+    g_assert(df != NULL);
+    return df;
+}
+
+static void
+dfilter_test_cache_hit(void)
+{
+    dfilter_t *df1, *df2;
+
+    dfilter_cache_clear();
+    df1 = compile_cached("frame.len > 10");
+    df2 = compile_cached("frame.len > 10");
+    g_assert(df1 == df2);
+
+    /* Each holds its own reference */
+    dfilter_free(df1);
+    g_assert(!dfilter_apply(df2, test_edt.tree));
+    dfilter_free(df2);
+
+    /* Text that doesn't compile isn't kept */
+    df1 = NULL;
+    g_assert(!dfilter_compile_cached("frame.len >", &df1, NULL));
+    g_assert(df1 == NULL);
+    g_assert(!dfilter_compile_cached("frame.len >", &df1, NULL));
+}
+
+static void
+dfilter_test_cache_eviction(void)
+{
+    dfilter_t *df1, *df2;
+    char text[32];
+    int i;
+
+    dfilter_cache_clear();
+    df1 = compile_cached(MATCHING_FILTER);
+
+    /* Push it out with as many others */
+    for (i = 0; i < CACHE_SIZE; i++) {
+        g_snprintf(text, sizeof text, "frame.len == %d", i);
+        dfilter_free(compile_cached(text));
+    }
+
+    /* It's compiled again, but the old one is still ours */
+    df2 = compile_cached(MATCHING_FILTER);
+    g_assert(df1 != df2);
+    g_assert(dfilter_apply(df1, test_edt.tree));
+    g_assert(dfilter_apply(df2, test_edt.tree));
+    dfilter_free(df1);
+    dfilter_free(df2);
+
+    /* The most recently used ones stay */
+    df1 = compile_cached("frame.len == 1");
+    for (i = 0; i < CACHE_SIZE - 1; i++) {
+        g_snprintf(text, sizeof text, "frame.len != %d", i);
+        dfilter_free(compile_cached(text));
+    }
+    df2 = compile_cached("frame.len == 1");
+    g_assert(df1 == df2);
+    dfilter_free(df1);
+    dfilter_free(df2);
+}
+
+static void
+dfilter_test_cache_set(void)
+{
+    dfilter_set_t *set1, *set2;
+    dfilter_t *df;
+    const guint32 *matched;
+
+    dfilter_cache_clear();
+    set1 = dfilter_set_new();
+    set2 = dfilter_set_new();
+
+    /* The same filter in two sets; only the first shares with it */
+    df = compile_cached(MATCHING_FILTER);
+    dfilter_set_add(set1, df);
+    dfilter_set_add(set2, compile_cached(MATCHING_FILTER));
+    matched = dfilter_set_apply_edt(set1, &test_edt);
+    g_assert(DFILTER_SET_MATCHED(matched, 0));
+    matched = dfilter_set_apply_edt(set2, &test_edt);
+    g_assert(DFILTER_SET_MATCHED(matched, 0));
+
+    /* Only its first set is told when it goes, so free the other one
+     * before letting go of its reference */
+    dfilter_set_free(set2);
+    dfilter_free(df);
+
+    /* The cache still holds it, so it stays in the set */
+    dfilter_free(df);
+    matched = dfilter_set_apply_edt(set1, &test_edt);
+    g_assert(DFILTER_SET_MATCHED(matched, 0));
+
+    /* Once the cache lets go of it, it never matches */
+    dfilter_cache_clear();
+    matched = dfilter_set_apply_edt(set1, &test_edt);
+    g_assert(!DFILTER_SET_MATCHED(matched, 0));
+    g_assert(dfilter_set_size(set1) == 1);
+    dfilter_set_free(set1);
+
+    /* A set freed first leaves the cached filter usable */
+    set1 = dfilter_set_new();
+    df = compile_cached(MATCHING_FILTER);
+    dfilter_set_add(set1, df);
+    dfilter_set_free(set1);
+    dfilter_free(df);
+    df = compile_cached(MATCHING_FILTER);
+    g_assert(dfilter_apply(df, test_edt.tree));
+    set1 = dfilter_set_new();
+    dfilter_set_add(set1, df);
+    matched = dfilter_set_apply_edt(set1, &test_edt);
+    g_assert(DFILTER_SET_MATCHED(matched, 0));
+    dfilter_set_free(set1);
+    dfilter_free(df);
+    dfilter_cache_clear();
+}
+
+static void
+dfilter_test_cache_adaptive(void)
+{
+    dfilter_t *df1, *df2;
+
+    dfilter_cache_clear();
+    dfilter_set_adaptive_order(TRUE);
+    df1 = compile_cached("frame.len > 10 and frame.cap_len > 10");
+    df2 = compile_cached("frame.len > 10 and frame.cap_len > 10");
+    dfilter_set_adaptive_order(FALSE);
+
+    /* They reorder themselves, so they aren't shared */
+    g_assert(df1 != df2);
+    dfilter_free(df1);
+    dfilter_free(df2);
+}
+
+int
+main(int argc, char **argv)
+{
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/dfilter/cache/hit",       dfilter_test_cache_hit);
+    g_test_add_func("/dfilter/cache/eviction",  dfilter_test_cache_eviction);
+    g_test_add_func("/dfilter/cache/set",       dfilter_test_cache_set);
+    g_test_add_func("/dfilter/cache/adaptive",  dfilter_test_cache_adaptive);
+
+    epan_init(register_all_protocols, register_all_protocol_handoffs, NULL, NULL);
+    memset(&test_edt, 0, sizeof test_edt);
+    test_edt.tree = proto_tree_create_root(NULL);
+
+    result = g_test_run();
+
+    proto_tree_free(test_edt.tree);
+    epan_cleanup();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
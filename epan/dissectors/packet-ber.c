@@ -4481,6 +4481,8 @@ proto_register_ber(void)
                                users_flds);
 
     proto_ber = proto_register_protocol("Basic Encoding Rules (ASN.1 X.690)", "BER", "ber");
+    /* ASN.1 dissectors add BER fields by calling its routines */
+    register_helper_protocol(proto_ber);
 
     ber_handle = new_register_dissector("ber", dissect_ber, proto_ber);
 
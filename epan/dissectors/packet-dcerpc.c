@@ -6373,6 +6373,8 @@ proto_register_dcerpc(void)
     expert_module_t* expert_dcerpc;
 
     proto_dcerpc = proto_register_protocol("Distributed Computing Environment / Remote Procedure Call (DCE/RPC)", "DCERPC", "dcerpc");
+    /* DCE/RPC interfaces add DCERPC fields by calling its routines */
+    register_helper_protocol(proto_dcerpc);
     proto_register_field_array(proto_dcerpc, hf, array_length(hf));
     proto_register_subtree_array(ett, array_length(ett));
     expert_dcerpc = expert_register_protocol(proto_dcerpc);
@@ -1028,6 +1028,8 @@ proto_register_ftp(void)
     expert_module_t* expert_ftp;
 
     proto_ftp = proto_register_protocol("File Transfer Protocol (FTP)", "FTP", "ftp");
+    /* Sets up the conversations for the data connections */
+    register_stateful_protocol(proto_ftp);
 
     register_dissector("ftp", dissect_ftp, proto_ftp);
     proto_ftp_data = proto_register_protocol("FTP Data", "FTP-DATA", "ftp-data");
@@ -28,7 +28,6 @@
 #include <wsutil/pint.h>
 
 
-#include "packet-frame.h"
 #include "packet-eth.h"
 #include "packet-pktap.h"
 
@@ -81,6 +80,7 @@ static gint ett_pktap = -1;
 static expert_field ei_pktap_hdrlen_too_short = EI_INIT;
 
 static dissector_handle_t pktap_handle;
+static dissector_table_t wtap_encap_table;
 
 /*
  * XXX - these are little-endian in the captures I've seen, but Apple
@@ -202,7 +202,7 @@ dissect_pktap(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
 
 	if (rectype == PKT_REC_PACKET) {
 		next_tvb = tvb_new_subset_remaining(tvb, pkt_len);
-		dissector_try_uint(wtap_encap_dissector_table,
+		dissector_try_uint(wtap_encap_table,
 		    wtap_pcap_encap_to_wtap_encap(dlt), next_tvb, pinfo, tree);
 	}
 }
@@ -284,6 +284,7 @@ void
 proto_reg_handoff_pktap(void)
 {
 	dissector_add_uint("wtap_encap", WTAP_ENCAP_PKTAP, pktap_handle);
+	wtap_encap_table = find_dissector_table("wtap_encap");
 }
 
 /*
@@ -57,7 +57,6 @@
 /* Needed for wtap_pcap_encap_to_wtap_encap(). */
 #include <wiretap/pcap-encap.h>
 
-#include "packet-frame.h"
 #include "packet-eth.h"
 #include "packet-ieee80211.h"
 #include "packet-ppi.h"
@@ -337,6 +336,8 @@ static dissector_handle_t ieee80211_ht_handle;
 static dissector_handle_t ppi_gps_handle, ppi_vector_handle, ppi_sensor_handle, ppi_antenna_handle;
 static dissector_handle_t ppi_fnet_handle;
 
+static dissector_table_t wtap_encap_table;
+
 static const true_false_string tfs_ppi_head_flag_alignment = { "32-bit aligned", "Not aligned" };
 static const true_false_string tfs_tsft_ms = { "milliseconds", "microseconds" };
 static const true_false_string tfs_ht20_40 = { "HT40", "HT20" };
@@ -1007,7 +1008,7 @@ dissect_ppi(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
     if (is_ht) { /* We didn't hit the reassembly code */
         call_dissector(ieee80211_ht_handle, next_tvb, pinfo, tree);
     } else {
-        dissector_try_uint(wtap_encap_dissector_table,
+        dissector_try_uint(wtap_encap_table,
             wtap_pcap_encap_to_wtap_encap(dlt), next_tvb, pinfo, tree);
     }
 }
@@ -1382,6 +1383,7 @@ proto_reg_handoff_ppi(void)
     ppi_sensor_handle = find_dissector("ppi_sensor");
     ppi_antenna_handle = find_dissector("ppi_antenna");
     ppi_fnet_handle = find_dissector("ppi_fnet");
+    wtap_encap_table = find_dissector_table("wtap_encap");
 
     dissector_add_uint("wtap_encap", WTAP_ENCAP_PPI, ppi_handle);
 }
@@ -3979,6 +3979,8 @@ proto_register_rpc(void)
 	expert_module_t* expert_rpc;
 
 	proto_rpc = proto_register_protocol("Remote Procedure Call", "RPC", "rpc");
+	/* RPC programs add RPC fields by calling its routines */
+	register_helper_protocol(proto_rpc);
 
 	/* this is a dummy dissector for all those unknown rpc programs */
 	proto_register_field_array(proto_rpc, hf, array_length(hf));
@@ -213,6 +213,7 @@ static expert_field ei_no_more_data = EI_INIT;
 static expert_field ei_caplen_too_big = EI_INIT;
 
 static dissector_handle_t data_handle;
+static dissector_table_t wtap_encap_table;
 
 /* User definable values */
 static gboolean rpcap_desegment = TRUE;
@@ -874,7 +875,7 @@ dissect_rpcap_packet (tvbuff_t *tvb, packet_info *pinfo, proto_tree *top_tree,
 
   new_tvb = tvb_new_subset (tvb, offset, caplen, len);
   if (decode_content && linktype != WTAP_ENCAP_UNKNOWN) {
-    dissector_try_uint(wtap_encap_dissector_table, linktype, new_tvb, pinfo, top_tree);
+    dissector_try_uint(wtap_encap_table, linktype, new_tvb, pinfo, top_tree);
 
     if (!info_added) {
       /* Only indicate when not added before */
@@ -1466,6 +1467,7 @@ proto_reg_handoff_rpcap (void)
 
   if (!rpcap_prefs_initialized) {
     data_handle = find_dissector ("data");
+    wtap_encap_table = find_dissector_table ("wtap_encap");
     rpcap_prefs_initialized = TRUE;
 
     heur_dissector_add ("tcp", dissect_rpcap_heur_tcp, proto_rpcap);
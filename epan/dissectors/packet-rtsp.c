@@ -1450,6 +1450,8 @@ proto_register_rtsp(void)
 
     proto_rtsp = proto_register_protocol("Real Time Streaming Protocol",
         "RTSP", "rtsp");
+    /* Sets up the conversations for the RTP/RDT streams */
+    register_stateful_protocol(proto_rtsp);
 
     proto_register_field_array(proto_rtsp, hf, array_length(hf));
     proto_register_subtree_array(ett, array_length(ett));
@@ -3058,6 +3058,8 @@ proto_register_sdp(void)
 
     proto_sdp = proto_register_protocol("Session Description Protocol",
                                         "SDP", "sdp");
+    /* Sets up the conversations for the media streams */
+    register_stateful_protocol(proto_sdp);
     proto_register_field_array(proto_sdp, hf, array_length(hf));
     proto_register_subtree_array(ett, array_length(ett));
     expert_sdp = expert_register_protocol(proto_sdp);
@@ -4049,6 +4049,8 @@ proto_register_ssl(void)
     /* Register the protocol name and description */
     proto_ssl = proto_register_protocol("Secure Sockets Layer",
                                         "SSL", "ssl");
+    /* Tracks the sessions and keys later records are decrypted with */
+    register_stateful_protocol(proto_ssl);
 
     /* Required function calls to register the header fields and
      * subtrees used */
@@ -708,19 +708,19 @@ init_tcp_conversation_data(packet_info *pinfo)
     tcpd=wmem_new0(wmem_file_scope(), struct tcp_analysis);
     tcpd->flow1.win_scale=-1;
     tcpd->flow1.window = G_MAXUINT32;
-    tcpd->flow1.multisegment_pdus=wmem_tree_new(wmem_file_scope());
+    tcpd->flow1.multisegment_pdus=wmem_tree_new_btree(wmem_file_scope());
     /*
     tcpd->flow1.username = NULL;
     tcpd->flow1.command = NULL;
     */
     tcpd->flow2.window = G_MAXUINT32;
     tcpd->flow2.win_scale=-1;
-    tcpd->flow2.multisegment_pdus=wmem_tree_new(wmem_file_scope());
+    tcpd->flow2.multisegment_pdus=wmem_tree_new_btree(wmem_file_scope());
     /*
     tcpd->flow2.username = NULL;
     tcpd->flow2.command = NULL;
     */
-    tcpd->acked_table=wmem_tree_new(wmem_file_scope());
+    tcpd->acked_table=wmem_tree_new_btree(wmem_file_scope());
     tcpd->ts_first.secs=pinfo->fd->abs_ts.secs;
     tcpd->ts_first.nsecs=pinfo->fd->abs_ts.nsecs;
     nstime_set_zero(&tcpd->ts_mru_syn);
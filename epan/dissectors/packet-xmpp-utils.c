@@ -775,7 +775,8 @@ gchar*
 proto_item_get_text(proto_item *item)
 {
     field_info *fi = NULL;
-    gchar *result;
+    gchar label_str[ITEM_LABEL_LENGTH];
+    const gchar *label;
 
     if(item == NULL)
         return NULL;
@@ -785,12 +786,11 @@ proto_item_get_text(proto_item *item)
     if(fi==NULL)
         return NULL;
 
-    if (fi->rep == NULL)
+    label = proto_item_get_label(fi, label_str);
+    if (label == NULL)
         return NULL;
 
-
-    result = wmem_strdup(wmem_packet_scope(), fi->rep->representation);
-    return result;
+    return wmem_strdup(wmem_packet_scope(), label);
 }
 
 
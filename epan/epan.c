@@ -47,6 +47,7 @@
 #include "oids.h"
 #include "wmem/wmem.h"
 #include "expert.h"
+#include "label_fmt.h"
 
 #ifdef HAVE_LUA
 #include <lua.h>
@@ -129,6 +130,7 @@ epan_cleanup(void)
 {
 	dfilter_cleanup();
 	proto_cleanup();
+	label_fmt_cleanup();
 	prefs_cleanup();
 	packet_cleanup();
 	expert_cleanup();
@@ -256,6 +258,7 @@ epan_dissect_init(epan_dissect_t *edt, epan_t *session, const gboolean create_pr
 	}
 	else {
 		edt->pi.pool = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
+		wmem_allocator_set_name(edt->pi.pool, "pinfo");
 	}
 
 	if (create_proto_tree) {
@@ -318,6 +321,13 @@ epan_dissect_fake_protocols(epan_dissect_t *edt, const gboolean fake_protocols)
 		proto_tree_set_fake_protocols(edt->tree, fake_protocols);
 }
 
+void
+epan_dissect_use_field_vector(epan_dissect_t *edt)
+{
+	if (edt && edt->tree && !PTREE_DATA(edt->tree)->visible)
+		proto_tree_use_field_vector(edt->tree);
+}
+
 void
 epan_dissect_run(epan_dissect_t *edt, int file_type_subtype,
         struct wtap_pkthdr *phdr, tvbuff_t *tvb, frame_data *fd,
@@ -176,6 +176,14 @@ WS_DLL_PUBLIC
 void
 epan_dissect_fake_protocols(epan_dissect_t *edt, const gboolean fake_protocols);
 
+/** Only record the fields that are primed, for looking up with
+ * proto_get_finfo_ptr_array(), rather than building a protocol tree of
+ * them; this is not done if the tree is visible, e.g. because a Lua
+ * script wants to see all fields */
+WS_DLL_PUBLIC
+void
+epan_dissect_use_field_vector(epan_dissect_t *edt);
+
 /** run a single packet dissection */
 WS_DLL_PUBLIC
 void
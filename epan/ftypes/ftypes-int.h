@@ -28,6 +28,9 @@
 void
 ftype_register(enum ftenum ftype, ftype_t *ft);
 
+ftype_t*
+ftype_lookup(enum ftenum ftype);
+
 /* These are the ftype registration functions that need to be called.
  * This list and the initialization function could be produced
  * via a script, like the dissector registration, but there's so few
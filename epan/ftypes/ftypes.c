@@ -65,6 +65,16 @@ ftype_register(enum ftenum ftype, ftype_t *ft)
 	g_assert(ftype < FT_NUM_TYPES);	\
 	result = type_list[ftype];
 
+/* Given an ftenum number, return its ftype_t*, for callers (such as the
+ * display filter engine) that bind an ftype's operations ahead of time. */
+ftype_t*
+ftype_lookup(enum ftenum ftype)
+{
+	ftype_t	*ft;
+
+	FTYPE_LOOKUP(ftype, ft);
+	return ft;
+}
 
 
 /* from README.dissector:
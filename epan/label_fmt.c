@@ -0,0 +1,395 @@
+/* label_fmt.c
+ * Keeping a printf-style format and its arguments, to be formatted
+ * only if and when the result is needed
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/wmem/wmem.h>
+
+#include "label_fmt.h"
+
+/*
+ * Each conversion is formatted on its own, with g_snprintf() and a
+ * copy of the conversion specification; this is the longest one we
+ * bother with.
+ */
+#define LABEL_FMT_MAX_SPEC	32
+
+/* More arguments than this, and it's formatted there and then */
+#define LABEL_FMT_MAX_ARGS	32
+
+/* What a conversion takes from the argument list */
+enum {
+	ARG_NONE,	/* "%%" */
+	ARG_INT,
+	ARG_LONG,
+	ARG_LLONG,
+	ARG_SIZE,
+	ARG_DOUBLE,
+	ARG_PTR,
+	ARG_STR
+};
+
+/*
+ * String arguments are mostly names out of value_strings and the like,
+ * which turn up over and over, so we keep one copy of those rather than
+ * one for every label.  Anything with a digit in it is probably a value
+ * formatted by the dissector, so it is copied instead, as is everything
+ * once we have this many.
+ */
+#define LABEL_FMT_MAX_INTERN_LEN	64
+#define LABEL_FMT_MAX_INTERNED		16384
+
+static GHashTable *interned_strings = NULL;
+
+/*
+ * Parse the conversion specification after a '%'; returns where it
+ * ends, or NULL if it's one we don't handle.
+ */
+static const char *
+parse_conversion(const char *p, int *type, int *precision)
+{
+	const char *start = p;
+	int         length = 0;	/* 1 for l, 2 for ll, 3 for size_t */
+
+	*precision = -1;
+
+	for (;; p++) {
+		switch (*p) {
+		case '-': case '+': case ' ': case '#': case '0': case '\'':
+			continue;
+		}
+		break;
+	}
+	if (*p == '*')
+		return NULL;
+	while (g_ascii_isdigit(*p))
+		p++;
+	if (*p == '$')
+		return NULL;
+	if (*p == '.') {
+		p++;
+		if (*p == '*')
+			return NULL;
+		*precision = 0;
+		while (g_ascii_isdigit(*p)) {
+			if (*precision < 100000)
+				*precision = *precision * 10 + (*p - '0');
+			p++;
+		}
+	}
+
+	switch (*p) {
+	case 'h':
+		p++;
+		if (*p == 'h')
+			p++;
+		break;
+	case 'l':
+		p++;
+		length = 1;
+		if (*p == 'l') {
+			p++;
+			length = 2;
+		}
+		break;
+	case 'q':
+		p++;
+		length = 2;
+		break;
+	case 'z':
+		p++;
+		length = 3;
+		break;
+	case 'I':
+		/* G_GINT64_MODIFIER and friends with MSVC */
+		if (p[1] == '6' && p[2] == '4') {
+			p += 3;
+			length = 2;
+		} else if (p[1] == '3' && p[2] == '2') {
+			p += 3;
+		} else {
+			p++;
+			length = 3;
+		}
+		break;
+	}
+
+	switch (*p) {
+	case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+		*type = length == 1 ? ARG_LONG :
+			length == 2 ? ARG_LLONG :
+			length == 3 ? ARG_SIZE : ARG_INT;
+		break;
+	case 'c':
+		if (length != 0)
+			return NULL;
+		*type = ARG_INT;
+		break;
+	case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+		if (length > 1)
+			return NULL;
+		*type = ARG_DOUBLE;
+		break;
+	case 'p':
+		if (length != 0)
+			return NULL;
+		*type = ARG_PTR;
+		break;
+	case 's':
+		if (length != 0)
+			return NULL;
+		*type = ARG_STR;
+		break;
+	case '%':
+		if (p != start)
+			return NULL;
+		*type = ARG_NONE;
+		break;
+	default:
+		return NULL;
+	}
+	p++;
+
+	/* Room for the '%' and the terminator */
+	if (p - start + 2 > LABEL_FMT_MAX_SPEC)
+		return NULL;
+
+	return p;
+}
+
+static const char *
+label_fmt_copy_string(wmem_allocator_t *scope, const char *s, int precision)
+{
+	gsize       len;
+	gboolean    has_digit = FALSE;
+	const char *interned;
+	char       *copy;
+
+	if (precision >= 0) {
+		/* Needn't be terminated, so look no further */
+		const char *end = (const char *)memchr(s, '\0', precision);
+
+		len = end ? (gsize)(end - s) : (gsize)precision;
+		return wmem_strndup(scope, s, len);
+	}
+
+	for (len = 0; s[len] != '\0'; len++) {
+		if (g_ascii_isdigit(s[len]))
+			has_digit = TRUE;
+	}
+	if (has_digit || len > LABEL_FMT_MAX_INTERN_LEN)
+		return wmem_strndup(scope, s, len);
+
+	if (interned_strings == NULL)
+		interned_strings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	interned = (const char *)g_hash_table_lookup(interned_strings, s);
+	if (interned != NULL)
+		return interned;
+	if (g_hash_table_size(interned_strings) >= LABEL_FMT_MAX_INTERNED)
+		return wmem_strndup(scope, s, len);
+
+	copy = g_strndup(s, len);
+	g_hash_table_insert(interned_strings, copy, copy);
+	return copy;
+}
+
+label_fmt_t *
+label_fmt_new(wmem_allocator_t *scope, const char *format, va_list ap)
+{
+	label_fmt_t *lf;
+	const char  *p;
+	char        *format_copy;
+	gsize        format_len;
+	guint        nargs = 0;
+	guint        arg;
+	int          type;
+	guint8       types[LABEL_FMT_MAX_ARGS];
+	int          precisions[LABEL_FMT_MAX_ARGS];
+
+	/* Make sure we can handle all of it before touching ap */
+	for (p = format; (p = strchr(p, '%')) != NULL; ) {
+		p = parse_conversion(p + 1, &type, &precisions[nargs]);
+		if (p == NULL)
+			return NULL;
+		if (type != ARG_NONE) {
+			types[nargs++] = (guint8)type;
+			if (nargs == LABEL_FMT_MAX_ARGS)
+				return NULL;
+		}
+	}
+
+	format_len = strlen(format);
+	lf = (label_fmt_t *)wmem_alloc(scope, sizeof (label_fmt_t) +
+			(nargs > 0 ? nargs - 1 : 0) * sizeof (label_fmt_arg_t) +
+			format_len + 1);
+	format_copy = (char *)&lf->args[nargs > 0 ? nargs : 1];
+	memcpy(format_copy, format, format_len + 1);
+	lf->next = NULL;
+	lf->kind = 0;
+	lf->nargs = (guint16)nargs;
+	lf->format = format_copy;
+
+	for (arg = 0; arg < nargs; arg++) {
+		switch (types[arg]) {
+		case ARG_INT:
+			lf->args[arg].i = va_arg(ap, gint);
+			break;
+		case ARG_LONG:
+			lf->args[arg].l = va_arg(ap, glong);
+			break;
+		case ARG_LLONG:
+			lf->args[arg].ll = va_arg(ap, gint64);
+			break;
+		case ARG_SIZE:
+			lf->args[arg].z = va_arg(ap, gsize);
+			break;
+		case ARG_DOUBLE:
+			lf->args[arg].d = va_arg(ap, gdouble);
+			break;
+		case ARG_PTR:
+			lf->args[arg].p = va_arg(ap, const void *);
+			break;
+		case ARG_STR:
+			lf->args[arg].s = va_arg(ap, const char *);
+			if (lf->args[arg].s != NULL)
+				lf->args[arg].s = label_fmt_copy_string(scope, lf->args[arg].s, precisions[arg]);
+			break;
+		}
+	}
+
+	return lf;
+}
+
+/*
+ * Add n bytes of text; returns FALSE, with buf terminated, if it didn't
+ * all fit.
+ */
+static gboolean
+label_fmt_append(char *buf, gsize size, gsize *total, const char *text, gsize n)
+{
+	if (*total + n >= size) {
+		memcpy(buf + *total, text, size - 1 - *total);
+		buf[size - 1] = '\0';
+		*total += n;
+		return FALSE;
+	}
+	memcpy(buf + *total, text, n);
+	*total += n;
+	return TRUE;
+}
+
+int
+label_fmt_format(const label_fmt_t *lf, char *buf, gsize size)
+{
+	const char *p = lf->format;
+	const char *literal, *end;
+	char        spec[LABEL_FMT_MAX_SPEC];
+	gsize       total = 0;
+	gulong      room;
+	int         ret = 0;
+	guint       arg = 0;
+	int         type, precision;
+
+	g_assert(size > 0);
+
+	for (;;) {
+		literal = p;
+		while (*p != '\0' && *p != '%')
+			p++;
+		if (!label_fmt_append(buf, size, &total, literal, p - literal))
+			return (int)total;
+		if (*p == '\0')
+			break;
+
+		/* It parsed in label_fmt_new(), so it still does */
+		end = parse_conversion(p + 1, &type, &precision);
+		if (type == ARG_NONE) {
+			p = end;
+			if (!label_fmt_append(buf, size, &total, "%", 1))
+				return (int)total;
+			continue;
+		}
+		memcpy(spec, p, end - p);
+		spec[end - p] = '\0';
+		p = end;
+
+		room = (gulong)(size - total);
+		switch (type) {
+		case ARG_INT:
+			ret = g_snprintf(buf + total, room, spec, lf->args[arg].i);
+			break;
+		case ARG_LONG:
+			ret = g_snprintf(buf + total, room, spec, lf->args[arg].l);
+			break;
+		case ARG_LLONG:
+			ret = g_snprintf(buf + total, room, spec, lf->args[arg].ll);
+			break;
+		case ARG_SIZE:
+			ret = g_snprintf(buf + total, room, spec, lf->args[arg].z);
+			break;
+		case ARG_DOUBLE:
+			ret = g_snprintf(buf + total, room, spec, lf->args[arg].d);
+			break;
+		case ARG_PTR:
+			ret = g_snprintf(buf + total, room, spec, lf->args[arg].p);
+			break;
+		case ARG_STR:
+			ret = g_snprintf(buf + total, room, spec, lf->args[arg].s);
+			break;
+		}
+		arg++;
+		if (ret > 0)
+			total += ret;
+		if (total >= size)
+			return (int)total;
+	}
+
+	buf[total] = '\0';
+	return (int)total;
+}
+
+void
+label_fmt_cleanup(void)
+{
+	if (interned_strings != NULL) {
+		g_hash_table_destroy(interned_strings);
+		interned_strings = NULL;
+	}
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
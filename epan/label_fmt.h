@@ -0,0 +1,92 @@
+/* label_fmt.h
+ * Definitions for keeping a printf-style format and its arguments,
+ * to be formatted only if and when the result is needed
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __LABEL_FMT_H__
+#define __LABEL_FMT_H__
+
+#include <stdarg.h>
+
+#include <glib.h>
+
+#include <epan/wmem/wmem.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** One argument of a label_fmt_t; strings are copies, or interned. */
+typedef union {
+	gint          i;
+	glong         l;
+	gint64        ll;
+	gsize         z;
+	gdouble       d;
+	const void   *p;
+	const char   *s;
+} label_fmt_arg_t;
+
+/** A format, and the arguments to go with it. */
+typedef struct _label_fmt_t {
+	struct _label_fmt_t *next;	/**< for the caller to chain these */
+	guint16          kind;		/**< for the caller's use */
+	guint16          nargs;
+	const char      *format;	/**< a copy of the format */
+	label_fmt_arg_t  args[1];	/**< nargs of them */
+} label_fmt_t;
+
+/** Keep a format and the arguments in ap, so that label_fmt_format() can
+ * produce what g_vsnprintf() would have.  The result, the copy of the
+ * format, and copies of any strings are allocated in scope.
+ *
+ * This handles the conversions dissectors use in labels.  If the format
+ * has anything else, such as '*' widths or positional arguments, NULL is
+ * returned and ap is left alone, so that the caller can format it there
+ * and then.
+ *
+ * @param scope where to allocate the result
+ * @param format the printf-style format
+ * @param ap the arguments for it
+ * @return the format and arguments, or NULL
+ */
+label_fmt_t *label_fmt_new(wmem_allocator_t *scope, const char *format, va_list ap);
+
+/** Format a label_fmt_t, as g_vsnprintf() would have formatted its
+ * format and arguments.
+ *
+ * @param lf the format and arguments
+ * @param buf where to put the result, which is always terminated
+ * @param size the size of buf
+ * @return the length of the whole result, which is at least size if
+ * it was truncated
+ */
+int label_fmt_format(const label_fmt_t *lf, char *buf, gsize size);
+
+/** Free the strings label_fmt_new() kept one copy of; there must be no
+ * label_fmt_t left that uses them. */
+void label_fmt_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __LABEL_FMT_H__ */
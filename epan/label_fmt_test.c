@@ -0,0 +1,240 @@
+/* label_fmt_test.c
+ * Tests that deferred item labels come out as g_snprintf() makes them
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdarg.h>
+#include <string.h>
+#include <glib.h>
+
+#include "label_fmt.h"
+#include "wmem/wmem.h"
+
+static wmem_allocator_t *test_scope;
+
+/*
+ * Format with label_fmt_new() and label_fmt_format(), into buffers of
+ * every size from 1 to one more than the result needs, and check that
+ * each comes out as g_vsnprintf() makes it, truncation included.
+ */
+static void
+check_format(const char *format, ...)
+{
+    va_list      ap, aq;
+    label_fmt_t *lf;
+    gchar       *expected, *buf;
+    gsize        len, size;
+    int          ret;
+
+    va_start(ap, format);
+    G_VA_COPY(aq, ap);
+    len = g_vsnprintf(NULL, 0, format, aq);
+    va_end(aq);
+
+    G_VA_COPY(aq, ap);
+    lf = label_fmt_new(test_scope, format, aq);
+    va_end(aq);
+    if (lf == NULL) {
+        g_test_message("\"%s\" wasn't deferred", format);
+        g_assert_not_reached();
+    }
+
+    expected = (gchar *)g_malloc(len + 1);
+    buf = (gchar *)g_malloc(len + 1);
+    for (size = 1; size <= len + 1; size++) {
+        G_VA_COPY(aq, ap);
+        g_vsnprintf(expected, (gulong)size, format, aq);
+        va_end(aq);
+
+        memset(buf, 'X', len + 1);
+        ret = label_fmt_format(lf, buf, size);
+        g_assert_cmpstr(buf, ==, expected);
+        if (size > len)
+            g_assert_cmpint(ret, ==, (int)len);
+        else
+            g_assert_cmpint(ret, >=, (int)size);
+    }
+    va_end(ap);
+
+    g_free(expected);
+    g_free(buf);
+}
+
+static label_fmt_t *
+defer(const char *format, ...)
+{
+    va_list      ap;
+    label_fmt_t *lf;
+
+    va_start(ap, format);
+    lf = label_fmt_new(test_scope, format, ap);
+    va_end(ap);
+    g_assert(lf != NULL);
+    return lf;
+}
+
+/* Formats that label_fmt_new() leaves to the caller */
+static void
+check_not_deferred(const char *format, ...)
+{
+    va_list      ap;
+    label_fmt_t *lf;
+
+    va_start(ap, format);
+    lf = label_fmt_new(test_scope, format, ap);
+    va_end(ap);
+    g_assert(lf == NULL);
+}
+
+static void
+label_fmt_test_integers(void)
+{
+    check_format("Length: %d", 1234);
+    check_format("Offset: %d", -42);
+    check_format("%i and %i", G_MININT32, G_MAXINT32);
+    check_format("Flags: %u", G_MAXUINT32);
+    check_format("Type: 0x%x, 0x%X", 0xbeef, 0xcafe);
+    check_format("Mode: %o", 0755);
+    check_format("%c%c%c", 'a', 'b', 'c');
+    check_format("%hd %hhu", (short)-2, (unsigned char)200);
+    check_format("%ld %lu %lx", -123456L, 123456UL, 0xfeedUL);
+    check_format("%" G_GINT64_MODIFIER "d", G_GINT64_CONSTANT(-1234567890123));
+    check_format("%" G_GINT64_MODIFIER "u", G_GUINT64_CONSTANT(18446744073709551615));
+    check_format("0x%016" G_GINT64_MODIFIER "x", G_GUINT64_CONSTANT(0x123456789abcdef));
+    check_format("%" G_GSIZE_FORMAT " bytes", (gsize)65536);
+}
+
+static void
+label_fmt_test_doubles(void)
+{
+    check_format("%f", 3.14159);
+    check_format("%e", -0.000123);
+    check_format("%E", 6.02e23);
+    check_format("%g %G", 100000.0, 0.0000123);
+    check_format("%.3f seconds", 1.0005);
+    check_format("%10.2f|%-10.2f|", 2.5, -2.5);
+}
+
+static void
+label_fmt_test_strings(void)
+{
+    char         source[16], digits[16];
+    const char   unterminated[4] = { 'a', 'b', 'c', 'd' };
+    label_fmt_t *lf;
+    char         buf[64];
+
+    check_format("Name: %s", "Ethernet");
+    check_format("Version %s", "1.2.3");
+    check_format("%s", "");
+    check_format("[%s] %s", "Expert Info", "Malformed Packet");
+    check_format("%.3s", "truncated");
+    check_format("%.4s", unterminated);
+    check_format("%10s|%-10s|", "right", "left");
+    check_format("%s: %p", "pointer", (void *)&source);
+    check_format("100%% of %s", "it");
+
+    /* Strings are copied, interned or not, so changing them afterwards
+     * doesn't change the label */
+    g_strlcpy(source, "Request", sizeof source);
+    g_strlcpy(digits, "Frame 12", sizeof digits);
+    lf = defer("%s, %s", source, digits);
+    g_strlcpy(source, "Response", sizeof source);
+    g_strlcpy(digits, "Frame 34", sizeof digits);
+    label_fmt_format(lf, buf, sizeof buf);
+    g_assert_cmpstr(buf, ==, "Request, Frame 12");
+
+    /* A string seen before is formatted as it was then */
+    lf = defer("%s", "Request");
+    label_fmt_format(lf, buf, sizeof buf);
+    g_assert_cmpstr(buf, ==, "Request");
+}
+
+static void
+label_fmt_test_flags(void)
+{
+    check_format("%5d|%-5d|%05d", 42, 42, 42);
+    check_format("%+d % d", 7, 7);
+    check_format("%#x %#o", 255, 8);
+    check_format("%08.3f", -1.5);
+    check_format("%.0d|%.5d", 0, 42);
+}
+
+static void
+label_fmt_test_truncation(void)
+{
+    GString *long_label = g_string_new("");
+    int      i;
+
+    /* Longer than ITEM_LABEL_LENGTH */
+    for (i = 0; i < 40; i++)
+        g_string_append(long_label, "segment ");
+    check_format("%s", long_label->str);
+    check_format("Data (%u bytes): %s, more", 320, long_label->str);
+    check_format("%300d|", 1);
+    g_string_free(long_label, TRUE);
+}
+
+static void
+label_fmt_test_not_deferred(void)
+{
+    check_not_deferred("%*d", 5, 42);
+    check_not_deferred("%.*s", 3, "abc");
+    check_not_deferred("%1$d", 42);
+    check_not_deferred("%n", NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/label_fmt/integers",      label_fmt_test_integers);
+    g_test_add_func("/label_fmt/doubles",       label_fmt_test_doubles);
+    g_test_add_func("/label_fmt/strings",       label_fmt_test_strings);
+    g_test_add_func("/label_fmt/flags",         label_fmt_test_flags);
+    g_test_add_func("/label_fmt/truncation",    label_fmt_test_truncation);
+    g_test_add_func("/label_fmt/not_deferred",  label_fmt_test_not_deferred);
+
+    wmem_init();
+    test_scope = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
+    result = g_test_run();
+    wmem_destroy_allocator(test_scope);
+    label_fmt_cleanup();
+    wmem_cleanup();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
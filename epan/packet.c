@@ -96,6 +96,27 @@ struct dissector_table {
 	int		param;
 };
 
+/*
+ * An entry in the hash table portion of a dissector table.
+ */
+struct dtbl_entry {
+	dissector_handle_t initial;
+	dissector_handle_t current;
+};
+
+/*
+ * A dissector handle.
+ */
+struct dissector_handle {
+	const char	*name;		/* dissector name */
+	gboolean	is_new;		/* TRUE if new-style dissector */
+	union {
+		dissector_t	old;
+		new_dissector_t	new_d;
+	} dissector;
+	protocol_t	*protocol;
+};
+
 static GHashTable *dissector_tables = NULL;
 
 /*
@@ -139,6 +160,9 @@ destroy_dissector_table(void *data)
 	g_slice_free(struct dissector_table, data);
 }
 
+static void prune_init(void);
+static void prune_cleanup(void);
+
 void
 packet_init(void)
 {
@@ -150,6 +174,8 @@ packet_init(void)
 
 	heur_dissector_lists = g_hash_table_new_full(g_str_hash, g_str_equal,
 			NULL, destroy_heuristic_dissector_list);
+
+	prune_init();
 }
 
 void
@@ -174,6 +200,7 @@ packet_cleanup(void)
 	g_hash_table_destroy(dissector_tables);
 	g_hash_table_destroy(registered_dissectors);
 	g_hash_table_destroy(heur_dissector_lists);
+	prune_cleanup();
 }
 
 /*
@@ -416,6 +443,548 @@ final_registration_all_protocols(void)
 }
 
 
+/*
+ * Minimal dissection.
+ *
+ * While proto_init() runs the registration routines, what each one does
+ * is recorded against the protocols that "proto_register_XXX" registers,
+ * so that "proto_reg_handoff_XXX" is counted for them too: the dissector
+ * tables and heuristic lists it registers or looks up, and the dissector
+ * handles it creates or looks up.  A protocol may hand data to the
+ * protocols of those handles and of every handle in those tables and
+ * lists, including the ones added to them later on, e.g. by "Decode As".
+ * A lookup made by a dissector while it dissects could be made for any
+ * protocol, so it is recorded in "prune_anywhere", along with the
+ * protocols registered outside the routines, e.g. by plugins or Lua,
+ * which are never skipped.
+ *
+ * A protocol is live if it is required, may hand data to a live protocol
+ * or may hand it to anything, through a handle without a protocol; the
+ * protocols in "prune_anywhere" are live, and stateful protocols are on
+ * the first pass.  A call to the dissector of a protocol that isn't live
+ * is skipped, unless the dissector may refuse the data and the caller
+ * could then hand it to a live protocol instead.
+ *
+ * Nothing is skipped if something in "prune_anywhere" may hand data to
+ * a live protocol, or if a required protocol has its fields added by
+ * other protocols' dissectors: a helper protocol, one without a handle,
+ * or every protocol, as for frame.protocols.
+ */
+typedef struct {
+	GSList		*protos;	/* protocols registered */
+	GSList		*tables;	/* dissector tables registered or looked up */
+	GSList		*heur_lists;	/* heuristic lists registered or looked up */
+	GSList		*handles;	/* handles created or looked up */
+} prune_routine_t;
+
+typedef struct {
+	GHashTable	*callers;	/* protocol -> protocols that may call it */
+	GHashTable	*unknown;	/* protocols that may call anything */
+	GHashTable	*anywhere;	/* protocols that may be called from anywhere */
+	gboolean	anywhere_unknown; /* anything may be called from anywhere */
+} prune_graph_t;
+
+typedef struct prune_pass {
+	gboolean	enabled;	/* FALSE if nothing may be skipped */
+	GHashTable	*live;		/* protocols that can't be skipped */
+	GHashTable	*live_callers;	/* protocols that may hand data to one */
+} prune_pass_t;
+
+static gboolean minimal_dissection = FALSE;
+static gboolean prune_require_all = FALSE;
+static GSList *stateful_protocols = NULL;
+static GSList *helper_protocols = NULL;
+static GHashTable *prune_required = NULL;
+
+/* What the registration routines did, by name without the prefix */
+static GHashTable *prune_routines = NULL;
+static prune_routine_t *prune_routine = NULL;	/* the routine being run */
+static prune_routine_t prune_anywhere;
+static guint prune_dissecting = 0;		/* records being dissected */
+static GHashTable *prune_handle_protos = NULL;	/* protocols with a handle */
+
+/* Bumped whenever what may be skipped could have changed */
+static guint prune_version = 0;
+static guint prune_pass_version = 0;
+
+/* The protocols recorded against a routine, which alone may be skipped */
+static GHashTable *prune_known = NULL;
+static prune_pass_t prune_first;
+static prune_pass_t prune_later;
+
+/* The pass for the frame being dissected, or NULL if nothing may be
+ * skipped in it */
+static const prune_pass_t *prune_frame = NULL;
+
+static gboolean
+prune_set_has(GHashTable *set, const int proto_id)
+{
+	return g_hash_table_lookup_extended(set, GINT_TO_POINTER(proto_id),
+					    NULL, NULL);
+}
+
+static gboolean
+prune_set_add(GHashTable *set, const int proto_id)
+{
+	if (prune_set_has(set, proto_id))
+		return FALSE;
+	g_hash_table_insert(set, GINT_TO_POINTER(proto_id), NULL);
+	return TRUE;
+}
+
+static GHashTable *
+prune_set_new(void)
+{
+	return g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+static void
+prune_routine_free(gpointer data)
+{
+	prune_routine_t *routine = (prune_routine_t *)data;
+
+	g_slist_free(routine->protos);
+	g_slist_free(routine->tables);
+	g_slist_free(routine->heur_lists);
+	g_slist_free(routine->handles);
+	g_slice_free(prune_routine_t, routine);
+}
+
+static void
+prune_pass_free(prune_pass_t *pass)
+{
+	if (pass->live != NULL) {
+		g_hash_table_destroy(pass->live);
+		g_hash_table_destroy(pass->live_callers);
+		pass->live = NULL;
+		pass->live_callers = NULL;
+	}
+}
+
+static void
+prune_cleanup(void)
+{
+	if (prune_routines != NULL) {
+		g_hash_table_destroy(prune_routines);
+		g_hash_table_destroy(prune_handle_protos);
+		prune_routines = NULL;
+		prune_handle_protos = NULL;
+	}
+	g_slist_free(prune_anywhere.protos);
+	g_slist_free(prune_anywhere.tables);
+	g_slist_free(prune_anywhere.heur_lists);
+	g_slist_free(prune_anywhere.handles);
+	memset(&prune_anywhere, 0, sizeof prune_anywhere);
+	prune_routine = NULL;
+
+	if (prune_known != NULL) {
+		g_hash_table_destroy(prune_known);
+		prune_known = NULL;
+	}
+	prune_pass_free(&prune_first);
+	prune_pass_free(&prune_later);
+	prune_frame = NULL;
+	prune_version++;
+}
+
+static void
+prune_init(void)
+{
+	prune_routines = g_hash_table_new_full(g_str_hash, g_str_equal,
+					       NULL, prune_routine_free);
+	prune_handle_protos = prune_set_new();
+}
+
+void
+minimal_dissection_note_routine(const char *name)
+{
+	prune_routine = NULL;
+	if (name == NULL)
+		return;
+
+	if (g_str_has_prefix(name, "proto_register_"))
+		name += strlen("proto_register_");
+	else if (g_str_has_prefix(name, "proto_reg_handoff_"))
+		name += strlen("proto_reg_handoff_");
+
+	prune_routine = (prune_routine_t *)g_hash_table_lookup(prune_routines, name);
+	if (prune_routine == NULL) {
+		prune_routine = g_slice_new0(prune_routine_t);
+		g_hash_table_insert(prune_routines, (gpointer)name, prune_routine);
+	}
+}
+
+/* Add something done by the routine being run, if any, or done from
+ * anywhere.  Outside the routines the same thing can be done again and
+ * again, e.g. by a dissector looking up a handle whenever it's called. */
+static void
+prune_record(GSList **list, gpointer item)
+{
+	if (g_slist_find(*list, item) != NULL)
+		return;
+	*list = g_slist_prepend(*list, item);
+	prune_version++;
+}
+
+void
+minimal_dissection_note_protocol(const int proto_id)
+{
+	prune_record(prune_routine != NULL ? &prune_routine->protos :
+		     &prune_anywhere.protos, GINT_TO_POINTER(proto_id));
+}
+
+/* The routine being run, if any.  Otherwise, a lookup made while
+ * dissecting may be made by any protocol; lookups made when setting
+ * preferences or "Decode As" entries, or by the protocols registered
+ * outside the routines, which are never skipped, don't matter. */
+static prune_routine_t *
+prune_recording_routine(void)
+{
+	if (prune_routine != NULL)
+		return prune_routine;
+	return prune_dissecting > 0 ? &prune_anywhere : NULL;
+}
+
+static void
+prune_note_table(dissector_table_t table)
+{
+	prune_routine_t *routine = prune_recording_routine();
+
+	if (routine != NULL)
+		prune_record(&routine->tables, table);
+}
+
+static void
+prune_note_heur_list(heur_dissector_list_t list)
+{
+	prune_routine_t *routine = prune_recording_routine();
+
+	if (routine != NULL)
+		prune_record(&routine->heur_lists, list);
+}
+
+static void
+prune_note_handle(dissector_handle_t handle)
+{
+	prune_routine_t *routine = prune_recording_routine();
+
+	if (routine != NULL)
+		prune_record(&routine->handles, handle);
+}
+
+static void
+prune_note_new_handle(dissector_handle_t handle)
+{
+	if (handle->protocol != NULL)
+		prune_set_add(prune_handle_protos, proto_get_id(handle->protocol));
+	prune_note_handle(handle);
+}
+
+void
+set_minimal_dissection(const gboolean enable)
+{
+	if (prune_required != NULL) {
+		g_hash_table_destroy(prune_required);
+		prune_required = NULL;
+	}
+	prune_frame = NULL;
+	prune_require_all = FALSE;
+	prune_version++;
+
+	minimal_dissection = enable;
+	if (enable)
+		prune_required = prune_set_new();
+}
+
+gboolean
+minimal_dissection_enabled(void)
+{
+	return minimal_dissection;
+}
+
+void
+minimal_dissection_require_protocol(const int proto_id)
+{
+	if (!minimal_dissection)
+		return;
+
+	if (proto_id == -1) {
+		if (!prune_require_all) {
+			prune_require_all = TRUE;
+			prune_version++;
+		}
+	} else if (prune_set_add(prune_required, proto_id)) {
+		prune_version++;
+	}
+}
+
+void
+minimal_dissection_require_field(const int hfid)
+{
+	int parent;
+
+	if (!minimal_dissection)
+		return;
+
+	/* frame.protocols lists every protocol dissected */
+	if (hfid == proto_registrar_get_id_byname("frame.protocols")) {
+		minimal_dissection_require_protocol(-1);
+		return;
+	}
+
+	/* A protocol is its own parent here */
+	parent = proto_registrar_get_parent(hfid);
+	minimal_dissection_require_protocol(parent == -1 ? hfid : parent);
+}
+
+void
+register_stateful_protocol(const int proto_id)
+{
+	stateful_protocols = g_slist_prepend(stateful_protocols,
+					     GINT_TO_POINTER(proto_id));
+}
+
+void
+register_helper_protocol(const int proto_id)
+{
+	helper_protocols = g_slist_prepend(helper_protocols,
+					   GINT_TO_POINTER(proto_id));
+}
+
+/* The protocols in protos may call callee, the protocol of a handle, or
+ * anything if it's -1; if protos is NULL, any protocol may. */
+static void
+prune_add_callee(prune_graph_t *graph, GSList *protos, const int callee)
+{
+	GSList *l;
+
+	if (protos == NULL) {
+		if (callee == -1)
+			graph->anywhere_unknown = TRUE;
+		else
+			prune_set_add(graph->anywhere, callee);
+		return;
+	}
+
+	for (l = protos; l != NULL; l = l->next) {
+		int caller = GPOINTER_TO_INT(l->data);
+
+		if (callee == -1) {
+			prune_set_add(graph->unknown, caller);
+		} else if (callee != caller) {
+			GSList *callers = (GSList *)g_hash_table_lookup(graph->callers,
+									GINT_TO_POINTER(callee));
+
+			g_hash_table_insert(graph->callers, GINT_TO_POINTER(callee),
+					    g_slist_prepend(callers, GINT_TO_POINTER(caller)));
+		}
+	}
+}
+
+static void
+prune_add_handle(prune_graph_t *graph, GSList *protos, dissector_handle_t handle)
+{
+	if (handle != NULL)
+		prune_add_callee(graph, protos, handle->protocol != NULL ?
+				 proto_get_id(handle->protocol) : -1);
+}
+
+/* Add what the protocols in protos may call, given what was recorded */
+static void
+prune_add_routine(prune_graph_t *graph, GSList *protos,
+		  const prune_routine_t *routine)
+{
+	GSList         *l, *h;
+	GHashTableIter  iter;
+	gpointer        value;
+
+	for (l = routine->tables; l != NULL; l = l->next) {
+		dissector_table_t table = (dissector_table_t)l->data;
+
+		for (h = table->dissector_handles; h != NULL; h = h->next)
+			prune_add_handle(graph, protos, (dissector_handle_t)h->data);
+
+		g_hash_table_iter_init(&iter, table->hash_table);
+		while (g_hash_table_iter_next(&iter, NULL, &value)) {
+			dtbl_entry_t *dtbl_entry = (dtbl_entry_t *)value;
+
+			prune_add_handle(graph, protos, dtbl_entry->initial);
+			prune_add_handle(graph, protos, dtbl_entry->current);
+		}
+	}
+
+	for (l = routine->heur_lists; l != NULL; l = l->next) {
+		heur_dissector_list_t list = (heur_dissector_list_t)l->data;
+
+		for (h = list->dissectors; h != NULL; h = h->next) {
+			heur_dtbl_entry_t *hdtbl_entry = (heur_dtbl_entry_t *)h->data;
+
+			prune_add_callee(graph, protos, hdtbl_entry->protocol != NULL ?
+					 proto_get_id(hdtbl_entry->protocol) : -1);
+		}
+	}
+
+	for (l = routine->handles; l != NULL; l = l->next)
+		prune_add_handle(graph, protos, (dissector_handle_t)l->data);
+}
+
+/* Make proto_id, and every protocol that may hand data to it, live */
+static void
+prune_mark_live(prune_pass_t *pass, const prune_graph_t *graph, const int proto_id)
+{
+	GSList *l;
+
+	if (!prune_set_add(pass->live, proto_id))
+		return;
+
+	l = (GSList *)g_hash_table_lookup(graph->callers, GINT_TO_POINTER(proto_id));
+	for (; l != NULL; l = l->next) {
+		prune_set_add(pass->live_callers, GPOINTER_TO_INT(l->data));
+		prune_mark_live(pass, graph, GPOINTER_TO_INT(l->data));
+	}
+}
+
+static void
+prune_build_pass(prune_pass_t *pass, const prune_graph_t *graph,
+		 const gboolean enabled, const gboolean first_pass)
+{
+	GHashTableIter  iter;
+	gpointer        key;
+	GSList         *l;
+
+	prune_pass_free(pass);
+	pass->live = prune_set_new();
+	pass->live_callers = prune_set_new();
+
+	g_hash_table_iter_init(&iter, prune_required);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+		prune_mark_live(pass, graph, GPOINTER_TO_INT(key));
+
+	g_hash_table_iter_init(&iter, graph->unknown);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		prune_set_add(pass->live_callers, GPOINTER_TO_INT(key));
+		prune_mark_live(pass, graph, GPOINTER_TO_INT(key));
+	}
+	for (l = prune_anywhere.protos; l != NULL; l = l->next) {
+		prune_set_add(pass->live_callers, GPOINTER_TO_INT(l->data));
+		prune_mark_live(pass, graph, GPOINTER_TO_INT(l->data));
+	}
+
+	if (first_pass) {
+		for (l = stateful_protocols; l != NULL; l = l->next)
+			prune_mark_live(pass, graph, GPOINTER_TO_INT(l->data));
+	}
+
+	pass->enabled = enabled && !graph->anywhere_unknown;
+	g_hash_table_iter_init(&iter, graph->anywhere);
+	while (pass->enabled && g_hash_table_iter_next(&iter, &key, NULL)) {
+		if (prune_set_has(pass->live, GPOINTER_TO_INT(key)))
+			pass->enabled = FALSE;
+	}
+}
+
+static void
+prune_update(void)
+{
+	prune_graph_t   graph;
+	GHashTableIter  iter;
+	gpointer        key, value;
+	GSList         *l;
+	gboolean        enabled = TRUE;
+
+	graph.callers = g_hash_table_new(g_direct_hash, g_direct_equal);
+	graph.unknown = prune_set_new();
+	graph.anywhere = prune_set_new();
+	graph.anywhere_unknown = FALSE;
+
+	if (prune_known != NULL)
+		g_hash_table_destroy(prune_known);
+	prune_known = prune_set_new();
+
+	g_hash_table_iter_init(&iter, prune_routines);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		const prune_routine_t *routine = (const prune_routine_t *)value;
+
+		/* A routine that registered no protocol did its work for
+		 * protocols we don't know of */
+		prune_add_routine(&graph, routine->protos, routine);
+		for (l = routine->protos; l != NULL; l = l->next)
+			prune_set_add(prune_known, GPOINTER_TO_INT(l->data));
+	}
+	prune_add_routine(&graph, NULL, &prune_anywhere);
+
+	/* A protocol registered outside the routines as well isn't known */
+	for (l = prune_anywhere.protos; l != NULL; l = l->next)
+		g_hash_table_remove(prune_known, l->data);
+
+	g_hash_table_iter_init(&iter, prune_required);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		if (g_slist_find(helper_protocols, key) != NULL ||
+		    !prune_set_has(prune_handle_protos, GPOINTER_TO_INT(key)))
+			enabled = FALSE;
+	}
+
+	prune_build_pass(&prune_first, &graph, enabled, TRUE);
+	prune_build_pass(&prune_later, &graph, enabled, FALSE);
+	prune_pass_version = prune_version;
+
+	g_hash_table_iter_init(&iter, graph.callers);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		g_slist_free((GSList *)value);
+	g_hash_table_destroy(graph.callers);
+	g_hash_table_destroy(graph.unknown);
+	g_hash_table_destroy(graph.anywhere);
+}
+
+/* Decide what may be skipped while dissecting a frame */
+static void
+prune_frame_begin(const frame_data *fd)
+{
+	const prune_pass_t *pass;
+
+	prune_frame = NULL;
+	if (!minimal_dissection || prune_require_all)
+		return;
+
+	if (prune_known == NULL || prune_pass_version != prune_version)
+		prune_update();
+	pass = fd->flags.visited ? &prune_later : &prune_first;
+	if (pass->enabled)
+		prune_frame = pass;
+}
+
+/* The protocol that is handing data to a dissector, i.e. the last one
+ * added to the layers; if that protocol is already done with, it was
+ * still reached from the one handing the data. */
+static int
+prune_current_layer(packet_info *pinfo)
+{
+	wmem_list_frame_t *tail;
+
+	tail = wmem_list_tail(pinfo->layers);
+	if (tail == NULL)
+		return -1;
+	return GPOINTER_TO_INT(wmem_list_frame_data(tail));
+}
+
+static gboolean
+prune_skip_call(const int caller_id, dissector_handle_t handle)
+{
+	const int proto_id = proto_get_id(handle->protocol);
+
+	/* The top-level dissector is always called */
+	if (caller_id == -1 || prune_set_has(prune_frame->live, proto_id) ||
+	    !prune_set_has(prune_known, proto_id))
+		return FALSE;
+
+	/* If a new-style dissector would refuse the data, its caller
+	 * could try a live protocol next */
+	if (handle->is_new && prune_set_has(prune_frame->live_callers, caller_id))
+		return FALSE;
+
+	return TRUE;
+}
+
 /* Creates the top-most tvbuff and calls dissect_frame() */
 void
 dissect_record(epan_dissect_t *edt, int file_type_subtype,
@@ -423,6 +992,7 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype,
 {
 	const char *volatile record_type;
 	frame_data_t frame_dissector_data;
+	const prune_pass_t *saved_frame = prune_frame;
 
 	switch (phdr->rec_type) {
 
@@ -484,6 +1054,9 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype,
 		frame_dissector_data.pkt_comment = NULL;
 	frame_dissector_data.file_type_subtype = file_type_subtype;
 
+	prune_frame_begin(fd);
+	prune_dissecting++;
+
 	TRY {
 		/* Add this tvbuffer into the data_src list */
 		add_new_data_source(&edt->pi, edt->tvb, record_type);
@@ -504,6 +1077,9 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype,
 	}
 	ENDTRY;
 
+	prune_dissecting--;
+	prune_frame = saved_frame;
+
 	fd->flags.visited = 1;
 }
 
@@ -574,19 +1150,6 @@ dissect_file(epan_dissect_t *edt, struct wtap_pkthdr *phdr,
 
 /*********************** code added for sub-dissector lookup *********************/
 
-/*
- * A dissector handle.
- */
-struct dissector_handle {
-	const char	*name;		/* dissector name */
-	gboolean	is_new;		/* TRUE if new-style dissector */
-	union {
-		dissector_t	old;
-		new_dissector_t	new_d;
-	} dissector;
-	protocol_t	*protocol;
-};
-
 /* This function will return
  * old style dissector :
  *   length of the payload or 1 of the payload is empty
@@ -598,18 +1161,10 @@ struct dissector_handle {
  * and if the dissector rejected the packet.
  */
 static int
-call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
-			      packet_info *pinfo, proto_tree *tree, void *data)
+call_dissector_function(dissector_handle_t handle, tvbuff_t *tvb,
+			packet_info *pinfo, proto_tree *tree, void *data)
 {
-	const char *saved_proto;
-	int         len;
-
-	saved_proto = pinfo->current_proto;
-
-	if (handle->protocol != NULL) {
-		pinfo->current_proto =
-			proto_get_protocol_short_name(handle->protocol);
-	}
+	int len;
 
 	if (handle->is_new) {
 		len = (*handle->dissector.new_d)(tvb, pinfo, tree, data);
@@ -625,6 +1180,40 @@ call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
 			len = 1;
 		}
 	}
+	return len;
+}
+
+static int
+call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
+			      packet_info *pinfo, proto_tree *tree, void *data)
+{
+	const char  *saved_proto;
+	int          saved_tag;
+	volatile int len = 0;
+
+	saved_proto = pinfo->current_proto;
+
+	if (handle->protocol != NULL) {
+		pinfo->current_proto =
+			proto_get_protocol_short_name(handle->protocol);
+	}
+
+	if (handle->protocol != NULL && wmem_accounting_enabled()) {
+		/*
+		 * Count what the dissector allocates against its
+		 * protocol, and give the tag back even if it throws.
+		 */
+		saved_tag = wmem_accounting_set_tag(proto_get_id(handle->protocol));
+		TRY {
+			len = call_dissector_function(handle, tvb, pinfo, tree, data);
+		}
+		FINALLY {
+			wmem_accounting_set_tag(saved_tag);
+		}
+		ENDTRY;
+	} else {
+		len = call_dissector_function(handle, tvb, pinfo, tree, data);
+	}
 
 	pinfo->current_proto = saved_proto;
 
@@ -662,6 +1251,17 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 		return 0;
 	}
 
+	if (prune_frame != NULL && handle->protocol != NULL) {
+		if (prune_skip_call(prune_current_layer(pinfo), handle)) {
+			/*
+			 * Nothing needed can come out of it; claim the
+			 * data so that nothing else is tried on it.
+			 */
+			len = tvb_length(tvb);
+			return len > 0 ? len : 1;
+		}
+	}
+
 	saved_proto = pinfo->current_proto;
 	saved_can_desegment = pinfo->can_desegment;
 	saved_layers_len = wmem_list_count(pinfo->layers);
@@ -824,19 +1424,22 @@ call_dissector_work_error(dissector_handle_t handle, tvbuff_t *tvb,
 	return len;
 }
 
-/*
- * An entry in the hash table portion of a dissector table.
- */
-struct dtbl_entry {
-	dissector_handle_t initial;
-	dissector_handle_t current;
-};
+static dissector_table_t
+lookup_dissector_table(const char *name)
+{
+	return (dissector_table_t)g_hash_table_lookup( dissector_tables, name );
+}
 
 /* Finds a dissector table by table name. */
 dissector_table_t
 find_dissector_table(const char *name)
 {
-	return (dissector_table_t)g_hash_table_lookup( dissector_tables, name );
+	dissector_table_t sub_dissectors = lookup_dissector_table(name);
+
+	/* Whoever looks a table up may hand data to its dissectors */
+	if (sub_dissectors != NULL)
+		prune_note_table(sub_dissectors);
+	return sub_dissectors;
 }
 
 /* Find an entry in a uint dissector table. */
@@ -896,7 +1499,7 @@ dissector_add_uint(const char *name, const guint32 pattern, dissector_handle_t h
 	dissector_table_t  sub_dissectors;
 	dtbl_entry_t      *dtbl_entry;
 
-	sub_dissectors = find_dissector_table(name);
+	sub_dissectors = lookup_dissector_table(name);
 
 	/*
 	 * Make sure the dissector table exists.
@@ -979,7 +1582,7 @@ void
 dissector_delete_uint(const char *name, const guint32 pattern,
 	dissector_handle_t handle _U_)
 {
-	dissector_table_t sub_dissectors = find_dissector_table( name);
+	dissector_table_t sub_dissectors = lookup_dissector_table(name);
 	dtbl_entry_t *dtbl_entry;
 
 	/* sanity check */
@@ -1024,7 +1627,7 @@ dissector_delete_all_check (gpointer key _U_, gpointer value, gpointer user_data
 /* Delete all entries from a dissector table. */
 void dissector_delete_all(const char *name, dissector_handle_t handle)
 {
-	dissector_table_t sub_dissectors = find_dissector_table(name);
+	dissector_table_t sub_dissectors = lookup_dissector_table(name);
 	g_assert (sub_dissectors);
 
 	g_hash_table_foreach_remove (sub_dissectors->hash_table, dissector_delete_all_check, handle);
@@ -1035,7 +1638,7 @@ void dissector_delete_all(const char *name, dissector_handle_t handle)
 void
 dissector_change_uint(const char *name, const guint32 pattern, dissector_handle_t handle)
 {
-	dissector_table_t sub_dissectors = find_dissector_table( name);
+	dissector_table_t sub_dissectors = lookup_dissector_table(name);
 	dtbl_entry_t *dtbl_entry;
 
 	/* sanity check */
@@ -1047,6 +1650,7 @@ dissector_change_uint(const char *name, const guint32 pattern, dissector_handle_
 	dtbl_entry = find_uint_dtbl_entry(sub_dissectors, pattern);
 	if (dtbl_entry != NULL) {
 		dtbl_entry->current = handle;
+		prune_version++;
 		return;
 	}
 
@@ -1065,13 +1669,14 @@ dissector_change_uint(const char *name, const guint32 pattern, dissector_handle_
 	/* do the table insertion */
 	g_hash_table_insert( sub_dissectors->hash_table,
 			     GUINT_TO_POINTER( pattern), (gpointer)dtbl_entry);
+	prune_version++;
 }
 
 /* Reset an entry in a uint dissector table to its initial value. */
 void
 dissector_reset_uint(const char *name, const guint32 pattern)
 {
-	dissector_table_t  sub_dissectors = find_dissector_table( name);
+	dissector_table_t  sub_dissectors = lookup_dissector_table(name);
 	dtbl_entry_t      *dtbl_entry;
 
 	/* sanity check */
@@ -1178,7 +1783,7 @@ dissector_get_uint_handle(dissector_table_t const sub_dissectors, const guint32
 dissector_handle_t
 dissector_get_default_uint_handle(const char *name, const guint32 uint_val)
 {
-	dissector_table_t sub_dissectors = find_dissector_table(name);
+	dissector_table_t sub_dissectors = lookup_dissector_table(name);
 
 	if (sub_dissectors != NULL) {
 		dtbl_entry_t *dtbl_entry = find_uint_dtbl_entry(sub_dissectors, uint_val);
@@ -1234,7 +1839,7 @@ void
 dissector_add_string(const char *name, const gchar *pattern,
 		     dissector_handle_t handle)
 {
-	dissector_table_t  sub_dissectors = find_dissector_table( name);
+	dissector_table_t  sub_dissectors = lookup_dissector_table(name);
 	dtbl_entry_t      *dtbl_entry;
 	char *key;
 
@@ -1306,7 +1911,7 @@ void
 dissector_delete_string(const char *name, const gchar *pattern,
 	dissector_handle_t handle _U_)
 {
-	dissector_table_t  sub_dissectors = find_dissector_table( name);
+	dissector_table_t  sub_dissectors = lookup_dissector_table(name);
 	dtbl_entry_t      *dtbl_entry;
 
 	/* sanity check */
@@ -1331,7 +1936,7 @@ void
 dissector_change_string(const char *name, const gchar *pattern,
 			dissector_handle_t handle)
 {
-	dissector_table_t  sub_dissectors = find_dissector_table( name);
+	dissector_table_t  sub_dissectors = lookup_dissector_table(name);
 	dtbl_entry_t      *dtbl_entry;
 
 	/* sanity check */
@@ -1343,6 +1948,7 @@ dissector_change_string(const char *name, const gchar *pattern,
 	dtbl_entry = find_string_dtbl_entry(sub_dissectors, pattern);
 	if (dtbl_entry != NULL) {
 		dtbl_entry->current = handle;
+		prune_version++;
 		return;
 	}
 
@@ -1361,13 +1967,14 @@ dissector_change_string(const char *name, const gchar *pattern,
 	/* do the table insertion */
 	g_hash_table_insert( sub_dissectors->hash_table, (gpointer)g_strdup(pattern),
 			     (gpointer)dtbl_entry);
+	prune_version++;
 }
 
 /* Reset an entry in a string sub-dissector table to its initial value. */
 void
 dissector_reset_string(const char *name, const gchar *pattern)
 {
-	dissector_table_t  sub_dissectors = find_dissector_table( name);
+	dissector_table_t  sub_dissectors = lookup_dissector_table(name);
 	dtbl_entry_t      *dtbl_entry;
 
 	/* sanity check */
@@ -1466,7 +2073,7 @@ dissector_get_string_handle(dissector_table_t sub_dissectors,
 dissector_handle_t
 dissector_get_default_string_handle(const char *name, const gchar *string)
 {
-	dissector_table_t sub_dissectors = find_dissector_table(name);
+	dissector_table_t sub_dissectors = lookup_dissector_table(name);
 
 	if (sub_dissectors != NULL) {
 		dtbl_entry_t *dtbl_entry = find_string_dtbl_entry(sub_dissectors, string);
@@ -1509,7 +2116,7 @@ dissector_compare_filter_name(gconstpointer dissector_a, gconstpointer dissector
 void
 dissector_add_for_decode_as(const char *name, dissector_handle_t handle)
 {
-	dissector_table_t  sub_dissectors = find_dissector_table( name);
+	dissector_table_t  sub_dissectors = lookup_dissector_table(name);
 	GSList            *entry;
 
 	/*
@@ -1537,6 +2144,7 @@ dissector_add_for_decode_as(const char *name, dissector_handle_t handle)
 	/* Add it to the list. */
 	sub_dissectors->dissector_handles =
 		g_slist_insert_sorted(sub_dissectors->dissector_handles, (gpointer)handle, (GCompareFunc)dissector_compare_filter_name);
+	prune_version++;
 }
 
 dissector_handle_t
@@ -1646,7 +2254,7 @@ dissector_table_foreach (const char *table_name,
 			 gpointer    user_data)
 {
 	dissector_foreach_info_t info;
-	dissector_table_t        sub_dissectors = find_dissector_table(table_name);
+	dissector_table_t        sub_dissectors = lookup_dissector_table(table_name);
 
 	info.table_name    = table_name;
 	info.selector_type = sub_dissectors->type;
@@ -1664,7 +2272,7 @@ dissector_table_foreach_handle(const char     *table_name,
 			       DATFunc_handle  func,
 			       gpointer        user_data)
 {
-	dissector_table_t sub_dissectors = find_dissector_table(table_name);
+	dissector_table_t sub_dissectors = lookup_dissector_table(table_name);
 	GSList *tmp;
 
 	for (tmp = sub_dissectors->dissector_handles; tmp != NULL;
@@ -1723,7 +2331,7 @@ dissector_table_foreach_changed (const char *table_name,
 				 gpointer    user_data)
 {
 	dissector_foreach_info_t info;
-	dissector_table_t sub_dissectors = find_dissector_table(table_name);
+	dissector_table_t sub_dissectors = lookup_dissector_table(table_name);
 
 	info.table_name    = table_name;
 	info.selector_type = sub_dissectors->type;
@@ -1842,13 +2450,14 @@ register_dissector_table(const char *name, const char *ui_name, const ftenum_t t
 	sub_dissectors->type    = type;
 	sub_dissectors->param   = param;
 	g_hash_table_insert( dissector_tables, (gpointer)name, (gpointer) sub_dissectors );
+	prune_note_table(sub_dissectors);
 	return sub_dissectors;
 }
 
 const char *
 get_dissector_table_ui_name(const char *name)
 {
-	dissector_table_t sub_dissectors = find_dissector_table(name);
+	dissector_table_t sub_dissectors = lookup_dissector_table(name);
 	if (!sub_dissectors) return NULL;
 
 	return sub_dissectors->ui_name;
@@ -1857,7 +2466,7 @@ get_dissector_table_ui_name(const char *name)
 ftenum_t
 get_dissector_table_selector_type(const char *name)
 {
-	dissector_table_t sub_dissectors = find_dissector_table(name);
+	dissector_table_t sub_dissectors = lookup_dissector_table(name);
 	if (!sub_dissectors) return FT_NONE;
 
 	return sub_dissectors->type;
@@ -1866,28 +2475,39 @@ get_dissector_table_selector_type(const char *name)
 int
 get_dissector_table_param(const char *name)
 {
-	dissector_table_t sub_dissectors = find_dissector_table(name);
+	dissector_table_t sub_dissectors = lookup_dissector_table(name);
 	if (!sub_dissectors) return 0;
 
 	return sub_dissectors->param;
 }
 
+static heur_dissector_list_t
+lookup_heur_dissector_list(const char *name)
+{
+	return (heur_dissector_list_t)g_hash_table_lookup(heur_dissector_lists, name);
+}
+
 /* Finds a heuristic dissector table by table name. */
 heur_dissector_list_t
 find_heur_dissector_list(const char *name)
 {
-	return (heur_dissector_list_t)g_hash_table_lookup(heur_dissector_lists, name);
+	heur_dissector_list_t sub_dissectors = lookup_heur_dissector_list(name);
+
+	/* Whoever looks a list up may hand data to its dissectors */
+	if (sub_dissectors != NULL)
+		prune_note_heur_list(sub_dissectors);
+	return sub_dissectors;
 }
 
 gboolean
 has_heur_dissector_list(const gchar *name) {
-	return (find_heur_dissector_list(name) != NULL);
+	return (lookup_heur_dissector_list(name) != NULL);
 }
 
 void
 heur_dissector_add(const char *name, heur_dissector_t dissector, const int proto)
 {
-	heur_dissector_list_t  sub_dissectors = find_heur_dissector_list(name);
+	heur_dissector_list_t  sub_dissectors = lookup_heur_dissector_list(name);
 	const char            *proto_name;
 	heur_dtbl_entry_t     *hdtbl_entry;
 
@@ -1918,6 +2538,7 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const int proto
 	/* do the table insertion */
 	sub_dissectors->dissectors = g_slist_prepend(sub_dissectors->dissectors,
 	    (gpointer)hdtbl_entry);
+	prune_version++;
 }
 
 
@@ -1933,7 +2554,7 @@ find_matching_heur_dissector( gconstpointer a, gconstpointer b) {
 
 void
 heur_dissector_delete(const char *name, heur_dissector_t dissector, const int proto) {
-	heur_dissector_list_t  sub_dissectors = find_heur_dissector_list(name);
+	heur_dissector_list_t  sub_dissectors = lookup_heur_dissector_list(name);
 	heur_dtbl_entry_t      hdtbl_entry;
 	GSList                *found_entry;
 
@@ -1957,7 +2578,7 @@ heur_dissector_delete(const char *name, heur_dissector_t dissector, const int pr
 
 void
 heur_dissector_set_enabled(const char *name, heur_dissector_t dissector, const int proto, const gboolean enabled) {
-	heur_dissector_list_t  sub_dissectors = find_heur_dissector_list(name);
+	heur_dissector_list_t  sub_dissectors = lookup_heur_dissector_list(name);
 	GSList                *found_entry;
 	heur_dtbl_entry_t      hdtbl_entry;
 
@@ -1990,6 +2611,9 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	guint              saved_layers_len = 0;
 	heur_dtbl_entry_t *hdtbl_entry;
 	int                proto_id;
+	int                saved_tag = WMEM_ACCOUNTING_NO_TAG;
+	gboolean           accounting = wmem_accounting_enabled();
+	volatile gboolean  accepted = FALSE;
 
 	/* can_desegment is set to 2 by anyone which offers this api/service.
 	   then everytime a subdissector is called it is decremented by one.
@@ -2041,7 +2665,20 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 
 		pinfo->heur_list_name = hdtbl_entry->list_name;
 
-		if ((hdtbl_entry->dissector)(tvb, pinfo, tree, data)) {
+		if (accounting) {
+			saved_tag = wmem_accounting_set_tag(proto_id);
+			TRY {
+				accepted = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+			}
+			FINALLY {
+				wmem_accounting_set_tag(saved_tag);
+			}
+			ENDTRY;
+		} else {
+			accepted = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+		}
+
+		if (accepted) {
 			*heur_dtbl_entry = hdtbl_entry;
 			status = TRUE;
 			break;
@@ -2096,7 +2733,7 @@ heur_dissector_table_foreach (const char  *table_name,
 			      gpointer     user_data)
 {
 	heur_dissector_foreach_info_t info;
-	heur_dissector_list_t         sub_dissectors = find_heur_dissector_list(table_name);
+	heur_dissector_list_t         sub_dissectors = lookup_heur_dissector_list(table_name);
 
 	info.table_name    = table_name;
 	info.caller_func   = func;
@@ -2212,6 +2849,7 @@ register_heur_dissector_list(const char *name)
 	sub_dissectors->dissectors = NULL;	/* initially empty */
 	g_hash_table_insert(heur_dissector_lists, (gpointer)name,
 			    (gpointer) sub_dissectors);
+	prune_note_heur_list(sub_dissectors);
 	return sub_dissectors;
 }
 
@@ -2276,11 +2914,22 @@ get_dissector_names(void)
 	return g_hash_table_get_keys(registered_dissectors);
 }
 
+static dissector_handle_t
+lookup_dissector(const char *name)
+{
+	return (dissector_handle_t)g_hash_table_lookup(registered_dissectors, name);
+}
+
 /* Find a registered dissector by name. */
 dissector_handle_t
 find_dissector(const char *name)
 {
-	return (dissector_handle_t)g_hash_table_lookup(registered_dissectors, name);
+	dissector_handle_t handle = lookup_dissector(name);
+
+	/* Whoever looks a handle up may call it */
+	if (handle != NULL)
+		prune_note_handle(handle);
+	return handle;
 }
 
 /* Get a dissector name from handle. */
@@ -2304,6 +2953,7 @@ create_dissector_handle(dissector_t dissector, const int proto)
 	handle->is_new        = FALSE;
 	handle->dissector.old = dissector;
 	handle->protocol      = find_protocol_by_id(proto);
+	prune_note_new_handle(handle);
 
 	return handle;
 }
@@ -2318,6 +2968,7 @@ new_create_dissector_handle(new_dissector_t dissector, const int proto)
 	handle->is_new		= TRUE;
 	handle->dissector.new_d = dissector;
 	handle->protocol	= find_protocol_by_id(proto);
+	prune_note_new_handle(handle);
 
 	return handle;
 }
@@ -2339,6 +2990,7 @@ register_dissector(const char *name, dissector_t dissector, const int proto)
 
 	g_hash_table_insert(registered_dissectors, (gpointer)name,
 			    (gpointer) handle);
+	prune_note_new_handle(handle);
 
 	return handle;
 }
@@ -2359,6 +3011,7 @@ new_register_dissector(const char *name, new_dissector_t dissector, const int pr
 
 	g_hash_table_insert(registered_dissectors, (gpointer)name,
 			    (gpointer) handle);
+	prune_note_new_handle(handle);
 
 	return handle;
 }
@@ -2416,6 +3069,8 @@ void call_heur_dissector_direct(heur_dtbl_entry_t *heur_dtbl_entry, tvbuff_t *tv
 	const char        *saved_curr_proto;
 	const char        *saved_heur_list_name;
 	guint16            saved_can_desegment;
+	int                saved_tag = WMEM_ACCOUNTING_NO_TAG;
+	gboolean           accounting = wmem_accounting_enabled();
 
 	int                proto_id;
 
@@ -2449,8 +3104,20 @@ void call_heur_dissector_direct(heur_dtbl_entry_t *heur_dtbl_entry, tvbuff_t *tv
 	pinfo->heur_list_name = heur_dtbl_entry->list_name;
 
 	/* call the dissector, as we have saved the result heuristic failure is an error */
-	if(!(*heur_dtbl_entry->dissector)(tvb, pinfo, tree, data))
-		g_assert_not_reached();
+	if (accounting) {
+		saved_tag = wmem_accounting_set_tag(proto_id);
+		TRY {
+			if(!(*heur_dtbl_entry->dissector)(tvb, pinfo, tree, data))
+				g_assert_not_reached();
+		}
+		FINALLY {
+			wmem_accounting_set_tag(saved_tag);
+		}
+		ENDTRY;
+	} else {
+		if(!(*heur_dtbl_entry->dissector)(tvb, pinfo, tree, data))
+			g_assert_not_reached();
+	}
 
 	/* Restore info from caller */
 	pinfo->can_desegment = saved_can_desegment;
@@ -2477,7 +3144,7 @@ dissector_dump_decodes_display(const gchar *table_name,
 			       gpointer user_data _U_)
 {
 	guint32             selector       = (guint32)(unsigned long) key;
-	dissector_table_t   sub_dissectors = find_dissector_table(table_name);
+	dissector_table_t   sub_dissectors = lookup_dissector_table(table_name);
 	dtbl_entry_t       *dtbl_entry;
 	dissector_handle_t  handle;
 	gint                proto_id;
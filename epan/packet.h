@@ -519,6 +519,52 @@ WS_DLL_PUBLIC int call_dissector_only(dissector_handle_t handle, tvbuff_t *tvb,
 WS_DLL_PUBLIC void call_heur_dissector_direct(heur_dtbl_entry_t *heur_dtbl_entry, tvbuff_t *tvb,
     packet_info *pinfo, proto_tree *tree, void *data);
 
+/*
+ * Minimal dissection.
+ *
+ * When enabled, a dissector reached through a handle or a dissector
+ * table is skipped if its protocol can't lead to any protocol whose
+ * fields are required.  Which protocols can lead to which is worked out
+ * from what the registration routines registered and looked up: a
+ * protocol may hand data to the handles it creates or looks up, and to
+ * every handle in the dissector tables and heuristic lists it registers
+ * or looks up.  Display filters require the fields they use when they
+ * are compiled, and tap listeners the protocol feeding them when they
+ * are registered.
+ *
+ * The Protocol and Info columns then describe the deepest protocol that
+ * was dissected.
+ */
+
+/** Turn minimal dissection on or off; this also forgets what has been
+ * required so far. */
+WS_DLL_PUBLIC void set_minimal_dissection(const gboolean enable);
+
+/** TRUE if minimal dissection is on. */
+WS_DLL_PUBLIC gboolean minimal_dissection_enabled(void);
+
+/** Require the protocol of a field, e.g. one to be printed. */
+WS_DLL_PUBLIC void minimal_dissection_require_field(const int hfid);
+
+/** Require a protocol; -1 requires every protocol, which turns off
+ * skipping until minimal dissection is next turned on. */
+WS_DLL_PUBLIC void minimal_dissection_require_protocol(const int proto_id);
+
+/** Register a protocol whose dissector keeps state other dissectors
+ * depend upon, e.g. by setting up conversations for them, so that it
+ * is never skipped on the first pass over the packets. */
+WS_DLL_PUBLIC void register_stateful_protocol(const int proto_id);
+
+/** Register a protocol whose fields other dissectors add by calling its
+ * routines directly rather than through a handle, e.g. BER, so that
+ * requiring it turns off skipping. */
+WS_DLL_PUBLIC void register_helper_protocol(const int proto_id);
+
+/* Used by proto_init() to say which registration routine is being run,
+ * or NULL once it's done, and by proto_register_protocol(). */
+extern void minimal_dissection_note_routine(const char *name);
+extern void minimal_dissection_note_protocol(const int proto_id);
+
 /* Do all one-time initialization. */
 extern void dissect_init(void);
 
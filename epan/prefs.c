@@ -2228,6 +2228,12 @@ prefs_register_modules(void)
                                    10,
                                    &prefs.gui_fileopen_preview);
 
+    prefs_register_bool_preference(gui_module, "fileopen.seek_index",
+                                   "Save seek indexes for compressed files",
+                                   "Save where the File Open dialog can seek to in a compressed file"
+                                   " in a .seekidx file next to it, so it opens faster next time?",
+                                   &prefs.gui_fileopen_seek_index);
+
     prefs_register_bool_preference(gui_module, "ask_unsaved",
                                    "Ask to save unsaved capture files",
                                    "Ask to save unsaved capture files?",
@@ -2938,6 +2944,7 @@ pre_init_prefs(void)
     prefs.gui_recent_files_count_max = 10;
     prefs.gui_fileopen_dir           = (char *) get_persdatafile_dir();
     prefs.gui_fileopen_preview       = 3;
+    prefs.gui_fileopen_seek_index    = FALSE;
     prefs.gui_ask_unsaved            = TRUE;
     prefs.gui_find_wrap              = TRUE;
     prefs.gui_use_pref_save          = FALSE;
@@ -35,6 +35,7 @@
 #include <epan/packet-range.h>
 #include <epan/print.h>
 #include <epan/charsets.h>
+#include <epan/ipv4.h>
 #include <epan/dissectors/packet-data.h>
 #include <epan/dissectors/packet-frame.h>
 #include <wsutil/filesystem.h>
@@ -68,6 +69,8 @@ typedef struct {
     epan_dissect_t  *edt;
 } write_field_data_t;
 
+typedef struct _columnar_column columnar_column_t;
+
 struct _output_fields {
     gboolean     print_header;
     gchar        separator;
@@ -76,8 +79,11 @@ struct _output_fields {
     GPtrArray   *fields;
     GHashTable  *field_indicies;
     GPtrArray  **field_values;
+    gint       **field_hfids;
     gchar        quote;
     gboolean     includes_col_fields;
+    columnar_column_t *columnar;
+    guint32      columnar_rows;
 };
 
 static gchar *get_field_hex_value(GSList *src_list, field_info *fi);
@@ -93,6 +99,8 @@ static void print_pdml_geninfo(proto_tree *tree, FILE *fh);
 
 static void proto_tree_get_node_field_values(proto_node *node, gpointer data);
 
+static void columnar_free(output_fields_t *fields);
+
 gboolean
 proto_tree_print(print_args_t *print_args, epan_dissect_t *edt,
                  GHashTable *output_only_tables, print_stream_t *stream)
@@ -286,10 +294,8 @@ proto_tree_write_node_pdml(proto_node *node, gpointer data)
     /* Text label. It's printed as a field with no name. */
     if (fi->hfinfo->id == hf_text_only) {
         /* Get the text */
-        if (fi->rep) {
-            label_ptr = fi->rep->representation;
-        }
-        else {
+        label_ptr = proto_item_get_label(fi, label_str);
+        if (label_ptr == NULL) {
             label_ptr = "";
         }
 
@@ -1013,6 +1019,17 @@ void output_fields_free(output_fields_t* fields)
             g_free(fields->field_values);
         }
 
+        if (NULL != fields->field_hfids) {
+            for(i = 0; i < fields->fields->len; ++i) {
+                g_free(fields->field_hfids[i]);
+            }
+            g_free(fields->field_hfids);
+        }
+
+        if (NULL != fields->columnar) {
+            columnar_free(fields);
+        }
+
         for(i = 0; i < fields->fields->len; ++i) {
             gchar* field = (gchar *)g_ptr_array_index(fields->fields,i);
             g_free(field);
@@ -1063,6 +1080,99 @@ output_field_check(void *data, void *user_data)
 
 }
 
+/* Returns the first of the fields registered with the given abbreviation,
+ * or NULL; the rest follow it through same_name_next */
+static header_field_info *
+output_field_first_hfinfo(const gchar *field)
+{
+    header_field_info *hfinfo;
+
+    if (!strncmp(field, COLUMN_FIELD_FILTER, strlen(COLUMN_FIELD_FILTER)))
+        return NULL;
+
+    hfinfo = proto_registrar_get_byname(field);
+    while (hfinfo && hfinfo->same_name_prev_id != -1)
+        hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+    return hfinfo;
+}
+
+static void
+output_field_prime(void *data, void *user_data)
+{
+    gchar *field = (gchar *)data;
+    epan_dissect_t *edt = (epan_dissect_t *)user_data;
+    header_field_info *hfinfo;
+
+    for (hfinfo = output_field_first_hfinfo(field); hfinfo; hfinfo = hfinfo->same_name_next)
+        proto_tree_prime_hfid(edt->tree, hfinfo->id);
+}
+
+void
+output_fields_prime_edt(output_fields_t *fields, epan_dissect_t *edt)
+{
+    g_assert(fields);
+
+    if (fields->fields == NULL) {
+        return;
+    }
+
+    g_ptr_array_foreach(fields->fields, output_field_prime, edt);
+}
+
+static void
+output_field_require(void *data, void *user_data _U_)
+{
+    gchar *field = (gchar *)data;
+    header_field_info *hfinfo;
+
+    /* The columns come from all the protocols in a packet */
+    if (!strncmp(field, COLUMN_FIELD_FILTER, strlen(COLUMN_FIELD_FILTER))) {
+        minimal_dissection_require_protocol(-1);
+        return;
+    }
+
+    for (hfinfo = output_field_first_hfinfo(field); hfinfo; hfinfo = hfinfo->same_name_next)
+        minimal_dissection_require_field(hfinfo->id);
+}
+
+void
+output_fields_require(output_fields_t *fields)
+{
+    g_assert(fields);
+
+    if (fields->fields == NULL || !minimal_dissection_enabled()) {
+        return;
+    }
+
+    g_ptr_array_foreach(fields->fields, output_field_require, NULL);
+}
+
+gboolean
+output_fields_can_use_field_vector(output_fields_t *fields)
+{
+    gsize i;
+    header_field_info *hfinfo;
+
+    if (fields->fields == NULL) {
+        return TRUE;
+    }
+
+    /* Text items and protocols are written out using their labels,
+     * which aren't generated without a visible tree. */
+    for (i = 0; i < fields->fields->len; i++) {
+        gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
+
+        for (hfinfo = output_field_first_hfinfo(field); hfinfo; hfinfo = hfinfo->same_name_next) {
+            if (hfinfo->id == hf_text_only)
+                return FALSE;
+            if (hfinfo->type == FT_PROTOCOL && hfinfo->id != proto_data)
+                return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
 gboolean
 output_fields_valid(output_fields_t *fields)
 {
@@ -1294,6 +1404,76 @@ static void proto_tree_get_node_field_values(proto_node *node, gpointer data)
     }
 }
 
+/*
+ * In field vector mode, the items for the fields are all hung off the
+ * root, in the order they were added.  Pick up those for fields that
+ * share their name with others from there, so that their values come
+ * out in that order rather than grouped by field.
+ */
+static void proto_tree_get_shared_field_values(proto_node *node, gpointer data)
+{
+    write_field_data_t *call_data;
+    field_info *fi;
+    gpointer    field_index;
+
+    call_data = (write_field_data_t *)data;
+    fi = PNODE_FINFO(node);
+
+    field_index = g_hash_table_lookup(call_data->fields->field_indicies, fi->hfinfo->abbrev);
+    if (NULL != field_index &&
+        call_data->fields->field_hfids[GPOINTER_TO_UINT(field_index) - 1][1] != -1) {
+        format_field_values(call_data->fields, field_index,
+                            get_node_field_value(fi, call_data->edt) /* g_ alloc'd string */
+            );
+    }
+}
+
+/* Prepare a lookup table from string abbreviation for field to its index. */
+static void
+output_fields_prepare_indicies(output_fields_t *fields)
+{
+    gsize i;
+
+    if (NULL != fields->field_indicies)
+        return;
+
+    fields->field_indicies = g_hash_table_new(g_str_hash, g_str_equal);
+
+    i = 0;
+    while (i < fields->fields->len) {
+        gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
+        /* Store field indicies +1 so that zero is not a valid value,
+         * and can be distinguished from NULL as a pointer.
+         */
+        ++i;
+        g_hash_table_insert(fields->field_indicies, field, GUINT_TO_POINTER(i));
+    }
+}
+
+/* Prepare, for each field, the list of ids of the fields with its name,
+ * terminated by -1. */
+static void
+output_fields_prepare_hfids(output_fields_t *fields)
+{
+    gsize i;
+
+    if (NULL != fields->field_hfids)
+        return;
+
+    fields->field_hfids = g_new0(gint*, fields->fields->len);  /* free'd in output_fields_free() */
+    for (i = 0; i < fields->fields->len; i++) {
+        gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
+        header_field_info *hfinfo;
+        GArray *hfids = g_array_new(FALSE, FALSE, sizeof (gint));
+        gint end = -1;
+
+        for (hfinfo = output_field_first_hfinfo(field); hfinfo; hfinfo = hfinfo->same_name_next)
+            g_array_append_val(hfids, hfinfo->id);
+        g_array_append_val(hfids, end);
+        fields->field_hfids[i] = (gint *)g_array_free(hfids, FALSE);
+    }
+}
+
 void write_fields_proto_tree(output_fields_t *fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh)
 {
     gsize     i;
@@ -1311,20 +1491,7 @@ void write_fields_proto_tree(output_fields_t *fields, epan_dissect_t *edt, colum
     data.fields = fields;
     data.edt = edt;
 
-    if (NULL == fields->field_indicies) {
-        /* Prepare a lookup table from string abbreviation for field to its index. */
-        fields->field_indicies = g_hash_table_new(g_str_hash, g_str_equal);
-
-        i = 0;
-        while (i < fields->fields->len) {
-            gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
-            /* Store field indicies +1 so that zero is not a valid value,
-             * and can be distinguished from NULL as a pointer.
-             */
-            ++i;
-            g_hash_table_insert(fields->field_indicies, field, GUINT_TO_POINTER(i));
-        }
-    }
+    output_fields_prepare_indicies(fields);
 
     /* Array buffer to store values for this packet              */
     /*  Allocate an array for the 'GPtrarray *' the first time   */
@@ -1335,8 +1502,39 @@ void write_fields_proto_tree(output_fields_t *fields, epan_dissect_t *edt, colum
     if (NULL == fields->field_values)
         fields->field_values = g_new0(GPtrArray*, fields->fields->len);  /* free'd in output_fields_free() */
 
-    proto_tree_children_foreach(edt->tree, proto_tree_get_node_field_values,
-                                &data);
+    if (proto_tree_uses_field_vector(edt->tree)) {
+        /* Only the primed fields were recorded, so just pick them up. */
+        gboolean shared = FALSE;
+
+        output_fields_prepare_hfids(fields);
+
+        for (i = 0; i < fields->fields->len; i++) {
+            gint      *hfid = fields->field_hfids[i];
+            GPtrArray *finfos;
+            guint      j;
+
+            if (*hfid == -1)
+                continue;
+            if (hfid[1] != -1) {
+                shared = TRUE;
+                continue;
+            }
+            finfos = proto_get_finfo_ptr_array(edt->tree, *hfid);
+            if (NULL == finfos)
+                continue;
+            for (j = 0; j < finfos->len; j++) {
+                format_field_values(fields, GUINT_TO_POINTER(i + 1),
+                                    get_node_field_value((field_info *)g_ptr_array_index(finfos, j), edt));
+            }
+        }
+
+        if (shared)
+            proto_tree_children_foreach(edt->tree, proto_tree_get_shared_field_values,
+                                        &data);
+    } else {
+        proto_tree_children_foreach(edt->tree, proto_tree_get_node_field_values,
+                                    &data);
+    }
 
     if (fields->includes_col_fields) {
         for (col = 0; col < cinfo->num_cols; col++) {
@@ -1384,14 +1582,892 @@ void write_fields_finale(output_fields_t* fields _U_ , FILE *fh _U_)
     /* Nothing to do */
 }
 
+/*
+ * Columnar output; see the description of the format in print.h.
+ */
+#define COLUMNAR_MAGIC          "WSCOLUMN"
+#define COLUMNAR_VERSION        1
+#define COLUMNAR_CHUNK_ROWS     8192
+#define COLUMNAR_TAG_CHUNK      1
+#define COLUMNAR_TAG_END        0xFFFFFFFFU
+
+/* Column types */
+enum {
+    COLUMNAR_STRING,
+    COLUMNAR_BOOL,
+    COLUMNAR_INT,
+    COLUMNAR_UINT,
+    COLUMNAR_FLOAT,
+    COLUMNAR_TIMESTAMP,
+    COLUMNAR_DURATION,
+    COLUMNAR_FIXED_BINARY
+};
+
+#define COLUMNAR_FLAG_LIST      0x1
+
+struct _columnar_column {
+    guint32     type;
+    guint32     width;          /* bytes per value, if fixed */
+    GByteArray *validity;       /* one bit per row, if not a list */
+    GByteArray *offsets;        /* into the values, per row, if a list */
+    GByteArray *values;         /* the values, bits, or dictionary indices */
+    guint32     nvalues;
+    GHashTable *dict;           /* strings in this chunk, to their index + 1 */
+    GByteArray *dict_offsets;
+    GByteArray *dict_data;
+};
+
+static void
+columnar_append_u32(GByteArray *buf, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    g_byte_array_append(buf, (const guint8 *)&value, 4);
+}
+
+static void
+columnar_append_u64(GByteArray *buf, guint64 value)
+{
+    value = GUINT64_TO_LE(value);
+    g_byte_array_append(buf, (const guint8 *)&value, 8);
+}
+
+/* Set or clear bit n, the bits up to which have been set or cleared */
+static void
+columnar_set_bit(GByteArray *bits, guint32 n, gboolean set)
+{
+    if (n % 8 == 0) {
+        guint8 zero = 0;
+
+        g_byte_array_append(bits, &zero, 1);
+    }
+    if (set)
+        bits->data[n / 8] |= 1 << (n % 8);
+}
+
+/* Work out the column type for the fields with the given name; fields
+ * whose values don't map onto the same type are written as strings */
+static void
+columnar_column_type(const gchar *field, guint32 *type, guint32 *width)
+{
+    header_field_info *hfinfo;
+    guint32            this_type, this_width;
+
+    *type  = COLUMNAR_STRING;
+    *width = 0;
+
+    for (hfinfo = output_field_first_hfinfo(field); hfinfo; hfinfo = hfinfo->same_name_next) {
+        this_width = 8;
+        switch (hfinfo->type) {
+        case FT_BOOLEAN:
+            this_type  = COLUMNAR_BOOL;
+            this_width = 0;
+            break;
+        case FT_UINT8:
+        case FT_UINT16:
+        case FT_UINT24:
+        case FT_UINT32:
+        case FT_FRAMENUM:
+        case FT_IPXNET:
+            this_type  = COLUMNAR_UINT;
+            this_width = 4;
+            break;
+        case FT_UINT64:
+            this_type  = COLUMNAR_UINT;
+            break;
+        case FT_INT8:
+        case FT_INT16:
+        case FT_INT24:
+        case FT_INT32:
+            this_type  = COLUMNAR_INT;
+            this_width = 4;
+            break;
+        case FT_INT64:
+            this_type  = COLUMNAR_INT;
+            break;
+        case FT_FLOAT:
+        case FT_DOUBLE:
+            this_type  = COLUMNAR_FLOAT;
+            break;
+        case FT_ABSOLUTE_TIME:
+            this_type  = COLUMNAR_TIMESTAMP;
+            break;
+        case FT_RELATIVE_TIME:
+            this_type  = COLUMNAR_DURATION;
+            break;
+        case FT_IPv4:
+            this_type  = COLUMNAR_FIXED_BINARY;
+            this_width = FT_IPv4_LEN;
+            break;
+        case FT_IPv6:
+            this_type  = COLUMNAR_FIXED_BINARY;
+            this_width = FT_IPv6_LEN;
+            break;
+        case FT_ETHER:
+            this_type  = COLUMNAR_FIXED_BINARY;
+            this_width = FT_ETHER_LEN;
+            break;
+        default:
+            *type  = COLUMNAR_STRING;
+            *width = 0;
+            return;
+        }
+
+        if (hfinfo->same_name_prev_id == -1) {
+            *type  = this_type;
+            *width = this_width;
+        } else if (this_type != *type || this_width != *width) {
+            *type  = COLUMNAR_STRING;
+            *width = 0;
+            return;
+        }
+    }
+}
+
+/* Start a new chunk */
+static void
+columnar_reset(output_fields_t *fields)
+{
+    gsize              i;
+    columnar_column_t *col;
+
+    for (i = 0; i < fields->fields->len; i++) {
+        col = &fields->columnar[i];
+        g_byte_array_set_size(col->validity, 0);
+        g_byte_array_set_size(col->offsets, 0);
+        g_byte_array_set_size(col->values, 0);
+        col->nvalues = 0;
+        if (fields->occurrence == 'a')
+            columnar_append_u32(col->offsets, 0);
+        if (col->type == COLUMNAR_STRING) {
+            g_hash_table_remove_all(col->dict);
+            g_byte_array_set_size(col->dict_offsets, 0);
+            g_byte_array_set_size(col->dict_data, 0);
+            columnar_append_u32(col->dict_offsets, 0);
+        }
+    }
+    fields->columnar_rows = 0;
+}
+
+static void
+columnar_append_string(columnar_column_t *col, const gchar *str)
+{
+    gpointer index;
+    guint32  i;
+
+    index = g_hash_table_lookup(col->dict, str);
+    if (index != NULL) {
+        i = GPOINTER_TO_UINT(index) - 1;
+    } else {
+        i = g_hash_table_size(col->dict);
+        g_hash_table_insert(col->dict, g_strdup(str), GUINT_TO_POINTER(i + 1));
+        g_byte_array_append(col->dict_data, (const guint8 *)str, (guint)strlen(str));
+        columnar_append_u32(col->dict_offsets, col->dict_data->len);
+    }
+    columnar_append_u32(col->values, i);
+}
+
+/* Add a value, or a placeholder for a missing one if fi is NULL */
+static void
+columnar_append_value(columnar_column_t *col, field_info *fi, epan_dissect_t *edt)
+{
+    static const guint8 zeroes[FT_IPv6_LEN];
+    gchar    *str;
+    nstime_t *ts;
+    guint32   addr;
+    union {
+        gdouble d;
+        guint64 u;
+    } floating;
+
+    if (fi == NULL) {
+        if (col->type == COLUMNAR_BOOL)
+            columnar_set_bit(col->values, col->nvalues, FALSE);
+        else if (col->type == COLUMNAR_STRING)
+            columnar_append_u32(col->values, 0);
+        else
+            g_byte_array_append(col->values, zeroes, col->width);
+        col->nvalues++;
+        return;
+    }
+
+    switch (col->type) {
+    case COLUMNAR_BOOL:
+        columnar_set_bit(col->values, col->nvalues, fvalue_get_integer64(&fi->value) != 0);
+        break;
+    case COLUMNAR_INT:
+        if (col->width == 4)
+            columnar_append_u32(col->values, (guint32)fvalue_get_sinteger(&fi->value));
+        else
+            columnar_append_u64(col->values, fvalue_get_integer64(&fi->value));
+        break;
+    case COLUMNAR_UINT:
+        if (col->width == 4)
+            columnar_append_u32(col->values, fvalue_get_uinteger(&fi->value));
+        else
+            columnar_append_u64(col->values, fvalue_get_integer64(&fi->value));
+        break;
+    case COLUMNAR_FLOAT:
+        floating.d = fvalue_get_floating(&fi->value);
+        columnar_append_u64(col->values, floating.u);
+        break;
+    case COLUMNAR_TIMESTAMP:
+    case COLUMNAR_DURATION:
+        ts = (nstime_t *)fvalue_get(&fi->value);
+        columnar_append_u64(col->values, (guint64)((gint64)ts->secs * 1000000000 + ts->nsecs));
+        break;
+    case COLUMNAR_FIXED_BINARY:
+        if (fi->hfinfo->type == FT_IPv4) {
+            addr = ipv4_get_net_order_addr((ipv4_addr *)fvalue_get(&fi->value));
+            g_byte_array_append(col->values, (const guint8 *)&addr, FT_IPv4_LEN);
+        } else {
+            g_byte_array_append(col->values, (const guint8 *)fvalue_get(&fi->value), col->width);
+        }
+        break;
+    default:
+        str = get_node_field_value(fi, edt);
+        columnar_append_string(col, str);
+        g_free(str);
+        break;
+    }
+    col->nvalues++;
+}
+
+/* Write a buffer, preceded by its length and padded to 8 bytes */
+static void
+columnar_write_buffer(FILE *fh, const guint8 *data, gsize len)
+{
+    static const guint8 zeroes[8];
+    guint64 le_len = GUINT64_TO_LE((guint64)len);
+
+    fwrite(&le_len, 1, 8, fh);
+    if (len != 0)
+        fwrite(data, 1, len, fh);
+    if (len % 8 != 0)
+        fwrite(zeroes, 1, 8 - len % 8, fh);
+}
+
+static void
+columnar_write_chunk(output_fields_t *fields, FILE *fh)
+{
+    GByteArray        *header;
+    columnar_column_t *col;
+    gsize              i;
+
+    if (fields->columnar_rows == 0)
+        return;
+
+    header = g_byte_array_new();
+    columnar_append_u32(header, COLUMNAR_TAG_CHUNK);
+    columnar_append_u32(header, 0);
+    columnar_append_u64(header, fields->columnar_rows);
+    fwrite(header->data, 1, header->len, fh);
+    g_byte_array_free(header, TRUE);
+
+    for (i = 0; i < fields->fields->len; i++) {
+        col = &fields->columnar[i];
+        if (fields->occurrence == 'a')
+            columnar_write_buffer(fh, col->offsets->data, col->offsets->len);
+        else
+            columnar_write_buffer(fh, col->validity->data, col->validity->len);
+        columnar_write_buffer(fh, col->values->data, col->values->len);
+        if (col->type == COLUMNAR_STRING) {
+            columnar_write_buffer(fh, col->dict_offsets->data, col->dict_offsets->len);
+            columnar_write_buffer(fh, col->dict_data->data, col->dict_data->len);
+        }
+    }
+
+    columnar_reset(fields);
+}
+
+static void
+columnar_free(output_fields_t *fields)
+{
+    gsize              i;
+    columnar_column_t *col;
+
+    for (i = 0; i < fields->fields->len; i++) {
+        col = &fields->columnar[i];
+        g_byte_array_free(col->validity, TRUE);
+        g_byte_array_free(col->offsets, TRUE);
+        g_byte_array_free(col->values, TRUE);
+        if (col->type == COLUMNAR_STRING) {
+            g_hash_table_destroy(col->dict);
+            g_byte_array_free(col->dict_offsets, TRUE);
+            g_byte_array_free(col->dict_data, TRUE);
+        }
+    }
+    g_free(fields->columnar);
+    fields->columnar = NULL;
+}
+
+void write_columnar_preamble(output_fields_t* fields, FILE *fh)
+{
+    GByteArray        *header = g_byte_array_new();
+    columnar_column_t *col;
+    gsize              i;
+    guint32            name_len;
+    static const guint8 zeroes[8];
+
+    g_assert(fields);
+    g_assert(fields->fields);
+    g_assert(fh);
+
+    g_byte_array_append(header, (const guint8 *)COLUMNAR_MAGIC, 8);
+    columnar_append_u32(header, COLUMNAR_VERSION);
+    columnar_append_u32(header, fields->fields->len);
+
+    fields->columnar = g_new0(columnar_column_t, fields->fields->len);  /* free'd in write_columnar_finale() */
+    for (i = 0; i < fields->fields->len; i++) {
+        const gchar *field = (const gchar *)g_ptr_array_index(fields->fields, i);
+
+        col = &fields->columnar[i];
+        columnar_column_type(field, &col->type, &col->width);
+        col->validity = g_byte_array_new();
+        col->offsets  = g_byte_array_new();
+        col->values   = g_byte_array_new();
+        if (col->type == COLUMNAR_STRING) {
+            col->dict         = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+            col->dict_offsets = g_byte_array_new();
+            col->dict_data    = g_byte_array_new();
+        }
+
+        name_len = (guint32)strlen(field);
+        columnar_append_u32(header, col->type);
+        columnar_append_u32(header, col->width);
+        columnar_append_u32(header, fields->occurrence == 'a' ? COLUMNAR_FLAG_LIST : 0);
+        columnar_append_u32(header, name_len);
+        g_byte_array_append(header, (const guint8 *)field, name_len);
+        if (name_len % 8 != 0)
+            g_byte_array_append(header, zeroes, 8 - name_len % 8);
+    }
+
+    fwrite(header->data, 1, header->len, fh);
+    g_byte_array_free(header, TRUE);
+
+    columnar_reset(fields);
+}
+
+/* Returns the text of the column named by a "_ws.col." field, or NULL */
+static const gchar *
+columnar_col_data(column_info *cinfo, const gchar *field)
+{
+    gint col;
+
+    if (cinfo == NULL)
+        return NULL;
+
+    for (col = 0; col < cinfo->num_cols; col++) {
+        if (strcmp(field + strlen(COLUMN_FIELD_FILTER), cinfo->col_title[col]) == 0)
+            return cinfo->col_data[col];
+    }
+    return NULL;
+}
+
+void write_columnar_proto_tree(output_fields_t *fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh)
+{
+    columnar_column_t *col;
+    gsize              i;
+    gint              *hfid;
+    GPtrArray         *finfos;
+    field_info        *fi;
+    const gchar       *col_data;
+    gboolean           present;
+    guint              j;
+
+    g_assert(fields->columnar);
+    g_assert(edt);
+
+    output_fields_prepare_hfids(fields);
+
+    for (i = 0; i < fields->fields->len; i++) {
+        const gchar *field = (const gchar *)g_ptr_array_index(fields->fields, i);
+
+        col = &fields->columnar[i];
+
+        if (!strncmp(field, COLUMN_FIELD_FILTER, strlen(COLUMN_FIELD_FILTER))) {
+            /* Columns are always strings */
+            col_data = columnar_col_data(cinfo, field);
+            present = col_data != NULL;
+            if (present) {
+                columnar_append_string(col, col_data);
+                col->nvalues++;
+            } else if (fields->occurrence != 'a') {
+                columnar_append_value(col, NULL, edt);
+            }
+        } else {
+            /* The fields were primed, so they can just be picked up */
+            fi = NULL;
+            for (hfid = fields->field_hfids[i]; *hfid != -1; hfid++) {
+                finfos = proto_get_finfo_ptr_array(edt->tree, *hfid);
+                if (finfos == NULL || finfos->len == 0)
+                    continue;
+                switch (fields->occurrence) {
+                case 'f':
+                    if (fi == NULL)
+                        fi = (field_info *)g_ptr_array_index(finfos, 0);
+                    break;
+                case 'l':
+                    fi = (field_info *)g_ptr_array_index(finfos, finfos->len - 1);
+                    break;
+                default:
+                    for (j = 0; j < finfos->len; j++)
+                        columnar_append_value(col, (field_info *)g_ptr_array_index(finfos, j), edt);
+                    break;
+                }
+            }
+            present = fi != NULL;
+            if (fields->occurrence != 'a')
+                columnar_append_value(col, fi, edt);
+        }
+
+        if (fields->occurrence == 'a')
+            columnar_append_u32(col->offsets, col->nvalues);
+        else
+            columnar_set_bit(col->validity, fields->columnar_rows, present);
+    }
+
+    if (++fields->columnar_rows == COLUMNAR_CHUNK_ROWS)
+        columnar_write_chunk(fields, fh);
+}
+
+void write_columnar_finale(output_fields_t* fields, FILE *fh)
+{
+    GByteArray *trailer = g_byte_array_new();
+
+    g_assert(fields->columnar);
+
+    columnar_write_chunk(fields, fh);
+    columnar_append_u32(trailer, COLUMNAR_TAG_END);
+    columnar_append_u32(trailer, 0);
+    fwrite(trailer->data, 1, trailer->len, fh);
+    g_byte_array_free(trailer, TRUE);
+
+    columnar_free(fields);
+}
+
+/*
+ * JSON output.  Each packet is written as one object, on a line of its
+ * own, so that the output can be read a packet at a time or handed
+ * straight to a bulk indexer; with bulk_index, each one is preceded by
+ * the Elasticsearch "index" action for it.
+ *
+ * A packet is put together in json_buf, which is kept from packet to
+ * packet, and written out in one go.  The key for each field, up to but
+ * not including its closing quote, is escaped the first time the field
+ * turns up, and kept in json_keys by field id; fields with the same name
+ * get the same pointer, so that they can be told apart from the rest
+ * just by comparing it.
+ */
+static gboolean      json_bulk_index = FALSE;
+static GString      *json_buf        = NULL;
+static GPtrArray    *json_keys       = NULL;
+static GStringChunk *json_key_chunk  = NULL;
+/* The nodes to be written at each level of the tree */
+static GPtrArray    *json_levels     = NULL;
+
+typedef struct {
+    GString        *buf;
+    epan_dissect_t *edt;
+    guint           depth;
+    GHashTable     *field_indicies;     /* the fields given with -e, if any */
+} write_json_data;
+
+/* The nodes with one name, in json_write_members() */
+typedef struct {
+    guint first;                /* index of the first of them */
+    guint last;                 /* and of the last */
+    guint count;
+    guint with_children;        /* how many have subtrees */
+} json_group_t;
+
+#define JSON_NO_NEXT G_MAXUINT
+
+static gboolean json_write_members(write_json_data *jdata, GPtrArray *nodes);
+
+/* Append str, escaped, to buf; bytes that aren't part of valid UTF-8
+ * are taken to be ISO 8859-1. */
+static void
+json_append_escaped(GString *buf, const gchar *str)
+{
+    const gchar *p   = str;
+    const gchar *run = str;
+    gunichar     c;
+    guchar       b;
+
+    for (;;) {
+        b = (guchar)*p;
+        if (b >= 0x20 && b < 0x80 && b != '"' && b != '\\') {
+            p++;
+            continue;
+        }
+        if (b >= 0x80) {
+            c = g_utf8_get_char_validated(p, -1);
+            if (c != (gunichar)-1 && c != (gunichar)-2) {
+                p = g_utf8_next_char(p);
+                continue;
+            }
+        }
+
+        g_string_append_len(buf, run, p - run);
+        switch (b) {
+        case '\0':
+            return;
+        case '"':
+            g_string_append(buf, "\\\"");
+            break;
+        case '\\':
+            g_string_append(buf, "\\\\");
+            break;
+        case '\n':
+            g_string_append(buf, "\\n");
+            break;
+        case '\r':
+            g_string_append(buf, "\\r");
+            break;
+        case '\t':
+            g_string_append(buf, "\\t");
+            break;
+        default:
+            g_string_append_printf(buf, "\\u%04x", b);
+            break;
+        }
+        run = ++p;
+    }
+}
+
+static const gchar *
+json_key(header_field_info *hfinfo)
+{
+    const gchar *key;
+    GString     *s;
+
+    if ((guint)hfinfo->id >= json_keys->len)
+        g_ptr_array_set_size(json_keys, hfinfo->id + 1);
+    key = (const gchar *)g_ptr_array_index(json_keys, hfinfo->id);
+    if (key != NULL)
+        return key;
+
+    s = g_string_new("\"");
+    json_append_escaped(s, hfinfo->abbrev);
+    /* Elasticsearch won't have dots in field names */
+    if (json_bulk_index)
+        g_strdelimit(s->str, ".", '_');
+    key = g_string_chunk_insert_const(json_key_chunk, s->str);
+    g_string_free(s, TRUE);
+
+    g_ptr_array_index(json_keys, hfinfo->id) = (gpointer)key;
+    return key;
+}
+
+#define json_node_key(node) json_key(PNODE_FINFO(node)->hfinfo)
+
+/* Hidden items are left out, unless they're fields given with -e */
+static gboolean
+json_node_hidden(write_json_data *jdata, proto_node *node)
+{
+    return PROTO_ITEM_IS_HIDDEN(node) &&
+           (jdata->field_indicies == NULL ||
+            g_hash_table_lookup(jdata->field_indicies, PNODE_FINFO(node)->hfinfo->abbrev) == NULL);
+}
+
+/* Write the children of node, other than hidden ones, as an object */
+static void
+json_write_object(write_json_data *jdata, proto_node *node)
+{
+    GPtrArray  *children;
+    proto_node *child;
+
+    if (jdata->depth == json_levels->len)
+        g_ptr_array_add(json_levels, g_ptr_array_new());
+    children = (GPtrArray *)g_ptr_array_index(json_levels, jdata->depth);
+    g_ptr_array_set_size(children, 0);
+
+    for (child = node->first_child; child != NULL; child = child->next) {
+        if (!json_node_hidden(jdata, child))
+            g_ptr_array_add(children, child);
+    }
+
+    jdata->depth++;
+    g_string_append_c(jdata->buf, '{');
+    json_write_members(jdata, children);
+    g_string_append_c(jdata->buf, '}');
+    jdata->depth--;
+}
+
+/* Protocols are objects holding their fields; anything else is the
+ * string form of its value. */
+static void
+json_write_value(write_json_data *jdata, proto_node *node)
+{
+    field_info *fi = PNODE_FINFO(node);
+    gchar      *value;
+
+    if (fi->hfinfo->type == FT_PROTOCOL) {
+        json_write_object(jdata, node);
+        return;
+    }
+
+    value = get_node_field_value(fi, jdata->edt);
+    g_string_append_c(jdata->buf, '"');
+    json_append_escaped(jdata->buf, value);
+    g_string_append_c(jdata->buf, '"');
+    g_free(value);
+}
+
+/*
+ * Write nodes as the members of an object.  Nodes with the same name
+ * are written together, as an array of values; the subtrees of fields,
+ * as opposed to protocols, go in a "<name>_tree" member of their own.
+ * Returns TRUE if anything was written.
+ */
+static gboolean
+json_write_members(write_json_data *jdata, GPtrArray *nodes)
+{
+    GString      *buf = jdata->buf;
+    GHashTable   *group_index;
+    GArray       *groups;
+    guint        *next;
+    json_group_t *group;
+    json_group_t  new_group;
+    proto_node   *node;
+    const gchar  *key;
+    gpointer      index;
+    guint         i, g, n;
+
+    if (nodes->len == 0)
+        return FALSE;
+
+    /* Group the nodes by name in one pass, by key, as fields with the
+     * same name share it; the nodes of each group are linked through
+     * next[], in order. */
+    group_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+    groups = g_array_sized_new(FALSE, FALSE, sizeof (json_group_t), nodes->len);
+    next = g_new(guint, nodes->len);
+    for (i = 0; i < nodes->len; i++) {
+        node = (proto_node *)g_ptr_array_index(nodes, i);
+        key = json_node_key(node);
+        next[i] = JSON_NO_NEXT;
+
+        if (g_hash_table_lookup_extended(group_index, key, NULL, &index)) {
+            group = &g_array_index(groups, json_group_t, GPOINTER_TO_UINT(index));
+            next[group->last] = i;
+            group->last = i;
+            group->count++;
+        } else {
+            new_group.first = new_group.last = i;
+            new_group.count = 1;
+            new_group.with_children = 0;
+            g_hash_table_insert(group_index, (gpointer)key, GUINT_TO_POINTER(groups->len));
+            g_array_append_val(groups, new_group);
+            group = &g_array_index(groups, json_group_t, groups->len - 1);
+        }
+        if (node->first_child != NULL)
+            group->with_children++;
+    }
+    g_hash_table_destroy(group_index);
+
+    for (g = 0; g < groups->len; g++) {
+        group = &g_array_index(groups, json_group_t, g);
+        node = (proto_node *)g_ptr_array_index(nodes, group->first);
+        key = json_node_key(node);
+
+        if (g > 0)
+            g_string_append_c(buf, ',');
+        g_string_append(buf, key);
+        g_string_append(buf, "\":");
+        if (group->count > 1)
+            g_string_append_c(buf, '[');
+        for (i = group->first, n = 0; i != JSON_NO_NEXT; i = next[i]) {
+            if (n++ > 0)
+                g_string_append_c(buf, ',');
+            json_write_value(jdata, (proto_node *)g_ptr_array_index(nodes, i));
+        }
+        if (group->count > 1)
+            g_string_append_c(buf, ']');
+
+        if (group->with_children == 0 || PNODE_FINFO(node)->hfinfo->type == FT_PROTOCOL)
+            continue;
+
+        g_string_append_c(buf, ',');
+        g_string_append(buf, key);
+        g_string_append(buf, "_tree\":");
+        if (group->with_children > 1)
+            g_string_append_c(buf, '[');
+        for (i = group->first, n = 0; i != JSON_NO_NEXT; i = next[i]) {
+            proto_node *other = (proto_node *)g_ptr_array_index(nodes, i);
+
+            if (other->first_child != NULL) {
+                if (n++ > 0)
+                    g_string_append_c(buf, ',');
+                json_write_object(jdata, other);
+            }
+        }
+        if (group->with_children > 1)
+            g_string_append_c(buf, ']');
+    }
+
+    g_array_free(groups, TRUE);
+    g_free(next);
+    return TRUE;
+}
+
+/* Find the nodes for the fields given with -e, not looking inside those,
+ * nor inside hidden ones */
+static void
+json_select_nodes(write_json_data *jdata, proto_node *node, GPtrArray *selected)
+{
+    proto_node *child;
+
+    for (child = node->first_child; child != NULL; child = child->next) {
+        if (g_hash_table_lookup(jdata->field_indicies, PNODE_FINFO(child)->hfinfo->abbrev) != NULL)
+            g_ptr_array_add(selected, child);
+        else if (!PROTO_ITEM_IS_HIDDEN(child))
+            json_select_nodes(jdata, child, selected);
+    }
+}
+
+/* Write the columns given with -e as members; returns TRUE if any were */
+static gboolean
+json_write_columns(output_fields_t *fields, column_info *cinfo, GString *buf, gboolean first)
+{
+    gint   col;
+    gchar *col_name;
+
+    for (col = 0; col < cinfo->num_cols; col++) {
+        col_name = g_strdup_printf("%s%s", COLUMN_FIELD_FILTER, cinfo->col_title[col]);
+        if (g_hash_table_lookup(fields->field_indicies, col_name) != NULL) {
+            if (!first)
+                g_string_append_c(buf, ',');
+            first = FALSE;
+            g_string_append_c(buf, '"');
+            json_append_escaped(buf, col_name);
+            g_string_append(buf, "\":\"");
+            json_append_escaped(buf, cinfo->col_data[col]);
+            g_string_append_c(buf, '"');
+        }
+        g_free(col_name);
+    }
+
+    return !first;
+}
+
+void
+write_json_preamble(gboolean bulk_index, FILE *fh _U_)
+{
+    if (json_keys != NULL && bulk_index != json_bulk_index) {
+        /* The keys are written differently */
+        g_ptr_array_set_size(json_keys, 0);
+        g_string_chunk_clear(json_key_chunk);
+    }
+    json_bulk_index = bulk_index;
+
+    if (json_buf == NULL) {
+        json_buf       = g_string_sized_new(4096);
+        json_keys      = g_ptr_array_new();
+        json_key_chunk = g_string_chunk_new(4096);
+        json_levels    = g_ptr_array_new();
+    }
+}
+
+void
+write_json_proto_tree(output_fields_t *fields, epan_dissect_t *edt, FILE *fh)
+{
+    write_json_data data;
+    nstime_t        ts = edt->pi.fd->abs_ts;
+    GPtrArray      *selected;
+    gboolean        wrote;
+
+    g_assert(json_buf != NULL);
+
+    data.buf            = json_buf;
+    data.edt            = edt;
+    data.depth          = 0;
+    data.field_indicies = NULL;
+
+    g_string_truncate(json_buf, 0);
+
+    if (json_bulk_index) {
+        time_t     secs = ts.secs;
+        struct tm *tm   = gmtime(&secs);
+
+        /* One index a day, as Logstash does it */
+        if (tm != NULL)
+            g_string_append_printf(json_buf,
+                                   "{\"index\":{\"_index\":\"packets-%04d-%02d-%02d\",\"_type\":\"pcap_file\"}}\n",
+                                   tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday);
+        else
+            g_string_append(json_buf, "{\"index\":{\"_index\":\"packets\",\"_type\":\"pcap_file\"}}\n");
+    }
+
+    g_string_append_printf(json_buf, "{\"timestamp\":\"%" G_GINT64_MODIFIER "d\",\"layers\":",
+                           (gint64)ts.secs * 1000 + ts.nsecs / 1000000);
+
+    if (fields != NULL && output_fields_num_fields(fields) != 0) {
+        /* Just the fields and protocols asked for, and what's under them */
+        output_fields_prepare_indicies(fields);
+        data.field_indicies = fields->field_indicies;
+        if (json_levels->len == 0)
+            g_ptr_array_add(json_levels, g_ptr_array_new());
+        selected = (GPtrArray *)g_ptr_array_index(json_levels, 0);
+        g_ptr_array_set_size(selected, 0);
+        json_select_nodes(&data, edt->tree, selected);
+
+        data.depth = 1;
+        g_string_append_c(json_buf, '{');
+        wrote = json_write_members(&data, selected);
+        if (fields->includes_col_fields && edt->pi.cinfo != NULL)
+            json_write_columns(fields, edt->pi.cinfo, json_buf, !wrote);
+        g_string_append_c(json_buf, '}');
+    } else {
+        json_write_object(&data, edt->tree);
+    }
+
+    g_string_append(json_buf, "}\n");
+    fwrite(json_buf->str, 1, json_buf->len, fh);
+}
+
+void
+write_json_finale(FILE *fh _U_)
+{
+    guint i;
+
+    if (json_buf == NULL)
+        return;
+
+    for (i = 0; i < json_levels->len; i++)
+        g_ptr_array_free((GPtrArray *)g_ptr_array_index(json_levels, i), TRUE);
+    g_ptr_array_free(json_levels, TRUE);
+    g_ptr_array_free(json_keys, TRUE);
+    g_string_chunk_free(json_key_chunk);
+    g_string_free(json_buf, TRUE);
+    json_levels    = NULL;
+    json_keys      = NULL;
+    json_key_chunk = NULL;
+    json_buf       = NULL;
+}
+
+/* Returns the label the item was given, in a g_malloced string, or NULL
+ * if it wasn't given one */
+static gchar*
+get_node_field_label(field_info *fi)
+{
+    gchar label_str[ITEM_LABEL_LENGTH];
+    const gchar *label;
+
+    label = proto_item_get_label(fi, label_str);
+    return label ? g_strdup(label) : NULL;
+}
+
 /* Returns an g_malloced string */
 gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
 {
+    gchar *label;
+
     if (fi->hfinfo->id == hf_text_only) {
         /* Text label.
          * Get the text */
-        if (fi->rep) {
-            return g_strdup(fi->rep->representation);
+        if ((label = get_node_field_label(fi)) != NULL) {
+            return label;
         }
         else {
             return get_field_hex_value(edt->pi.data_src, fi);
@@ -1410,8 +2486,8 @@ gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
         {
         case FT_PROTOCOL:
             /* Print out the full details for the protocol. */
-            if (fi->rep) {
-                return g_strdup(fi->rep->representation);
+            if ((label = get_node_field_label(fi)) != NULL) {
+                return label;
             } else {
                 /* Just print out the protocol abbreviation */
                 return g_strdup(fi->hfinfo->abbrev);
@@ -1478,6 +2554,9 @@ output_fields_t* output_fields_new(void)
     fields->fields              = NULL; /*Do lazy initialisation */
     fields->field_indicies      = NULL;
     fields->field_values        = NULL;
+    fields->field_hfids         = NULL;
+    fields->columnar            = NULL;
+    fields->columnar_rows       = 0;
     fields->quote               ='\0';
     fields->includes_col_fields = FALSE;
     return fields;
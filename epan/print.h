@@ -93,6 +93,13 @@ WS_DLL_PUBLIC gsize output_fields_num_fields(output_fields_t* info);
 WS_DLL_PUBLIC gboolean output_fields_set_option(output_fields_t* info, gchar* option);
 WS_DLL_PUBLIC void output_fields_list_options(FILE *fh);
 WS_DLL_PUBLIC gboolean output_fields_has_cols(output_fields_t* info);
+/** Prime an epan_dissect_t with the fields to be written. */
+WS_DLL_PUBLIC void output_fields_prime_edt(output_fields_t* info, epan_dissect_t *edt);
+/** Require the protocols of the fields to be written with minimal dissection. */
+WS_DLL_PUBLIC void output_fields_require(output_fields_t* info);
+/** Can the fields be written from an epan_dissect_t that only records
+ *  them in a field vector, see epan_dissect_use_field_vector()? */
+WS_DLL_PUBLIC gboolean output_fields_can_use_field_vector(output_fields_t* info);
 
 /*
  * Higher-level packet-printing code.
@@ -108,6 +115,10 @@ WS_DLL_PUBLIC void write_pdml_preamble(FILE *fh, const gchar* filename);
 WS_DLL_PUBLIC void write_pdml_proto_tree(epan_dissect_t *edt, FILE *fh);
 WS_DLL_PUBLIC void write_pdml_finale(FILE *fh);
 
+WS_DLL_PUBLIC void write_json_preamble(gboolean bulk_index, FILE *fh);
+WS_DLL_PUBLIC void write_json_proto_tree(output_fields_t* fields, epan_dissect_t *edt, FILE *fh);
+WS_DLL_PUBLIC void write_json_finale(FILE *fh);
+
 WS_DLL_PUBLIC void write_psml_preamble(column_info *cinfo, FILE *fh);
 WS_DLL_PUBLIC void write_psml_columns(epan_dissect_t *edt, FILE *fh);
 WS_DLL_PUBLIC void write_psml_finale(FILE *fh);
@@ -121,6 +132,46 @@ WS_DLL_PUBLIC void write_fields_preamble(output_fields_t* fields, FILE *fh);
 WS_DLL_PUBLIC void write_fields_proto_tree(output_fields_t* fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh);
 WS_DLL_PUBLIC void write_fields_finale(output_fields_t* fields, FILE *fh);
 
+/*
+ * The fields, written in binary, a column per field, in chunks of rows.
+ * The buffers for each column are laid out as the Apache Arrow columnar
+ * format lays out those of the corresponding type, so that they can be
+ * handed to Arrow, or written as Parquet, without conversion.
+ *
+ * Everything is little-endian, and everything is padded to a multiple of
+ * 8 bytes:
+ *
+ *   "WSCOLUMN", version (u32, 1), number of columns (u32)
+ *   for each column: type (u32), bytes per value (u32), flags (u32),
+ *     length of the field name (u32), the field name
+ *   for each chunk: 1 (u32), 0 (u32), number of rows (u64),
+ *     then the buffers of each column
+ *   0xFFFFFFFF (u32), 0 (u32)
+ *
+ * Each buffer is its length in bytes (u64) followed by its contents.
+ *
+ * The types are 0, a string, dictionary-encoded; 1, a boolean; 2, a
+ * signed integer and 3, an unsigned one, 4 or 8 bytes; 4, a double; 5,
+ * an absolute time and 6, a relative one, in nanoseconds (i64); and
+ * 7, fixed-size binary, such as an address (IPv4, Ethernet or IPv6).
+ * Values of fields whose types don't map onto one of these, and of
+ * fields with the same name but different types, are written as
+ * strings.  Columns given with "_ws.col." are strings.
+ *
+ * If flag 1 is set, which it is when all occurrences of the fields are
+ * written, each row holds a list of values: the first buffer of the
+ * column has the offset of each row's first value, and of the end of the
+ * last one (i32).  Otherwise each row holds one value, which might be
+ * missing, and the first buffer is a bitmap, with a bit set for each row
+ * that has one.  Then comes the buffer of values: a bitmap for booleans,
+ * the values themselves for fixed-size types, or indices (i32) into the
+ * chunk's dictionary for strings, followed by two more buffers with the
+ * offsets (i32) and UTF-8 contents of the strings in the dictionary.
+ */
+WS_DLL_PUBLIC void write_columnar_preamble(output_fields_t* fields, FILE *fh);
+WS_DLL_PUBLIC void write_columnar_proto_tree(output_fields_t* fields, epan_dissect_t *edt, column_info *cinfo, FILE *fh);
+WS_DLL_PUBLIC void write_columnar_finale(output_fields_t* fields, FILE *fh);
+
 WS_DLL_PUBLIC gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt);
 
 #ifdef __cplusplus
@@ -42,6 +42,7 @@
 #include "address_types.h"
 #include "oids.h"
 #include "proto.h"
+#include "label_fmt.h"
 #include "epan_dissect.h"
 #include "tvbuff.h"
 #include "wmem/wmem.h"
@@ -53,6 +54,7 @@
 #include "osi-utils.h"
 #include "expert.h"
 #include "show_exception.h"
+#include "dfilter/dfilter.h"
 
 #include <wsutil/plugins.h>
 
@@ -294,10 +296,19 @@ static GList *protocols = NULL;
 static GPtrArray *deregistered_fields = NULL;
 static GPtrArray *deregistered_data = NULL;
 
+/* Proto nodes, field_infos and item labels, which make up most of the
+ * allocations done while dissecting, come from slabs in the packet pool,
+ * created for the tree the first time they're needed.  */
+#define PNODE_SLAB(node, slab, type)					\
+	((node)->tree_data->slab != NULL ? (node)->tree_data->slab :	\
+	 ((node)->tree_data->slab = wmem_slab_new_type(PNODE_POOL(node), type)))
+
 /* Contains information about a field when a dissector calls
  * proto_tree_add_item.  */
-#define FIELD_INFO_NEW(pool, fi)  fi = wmem_new(pool, field_info)
-#define FIELD_INFO_FREE(pool, fi) wmem_free(pool, fi)
+#define FIELD_INFO_NEW(node, fi)					\
+	fi = (field_info *)wmem_slab_alloc(PNODE_SLAB(node, finfo_slab, field_info))
+#define FIELD_INFO_FREE(node, fi)					\
+	wmem_slab_free(PNODE_SLAB(node, finfo_slab, field_info), fi)
 
 /* Contains the space for proto_nodes. */
 #define PROTO_NODE_INIT(node)			\
@@ -305,14 +316,16 @@ static GPtrArray *deregistered_data = NULL;
 	node->last_child = NULL;		\
 	node->next = NULL;
 
-#define PROTO_NODE_FREE(pool, node)			\
-	wmem_free(pool, node)
+#define PROTO_NODE_NEW(node, pnode)					\
+	pnode = (proto_node *)wmem_slab_alloc(PNODE_SLAB(node, node_slab, proto_node))
+#define PROTO_NODE_FREE(node, pnode)					\
+	wmem_slab_free(PNODE_SLAB(node, node_slab, proto_node), pnode)
 
 /* String space for protocol and field items for the GUI */
-#define ITEM_LABEL_NEW(pool, il)			\
-	il = wmem_new(pool, item_label_t);
-#define ITEM_LABEL_FREE(pool, il)			\
-	wmem_free(pool, il);
+#define ITEM_LABEL_NEW(node, il)					\
+	il = (item_label_t *)wmem_slab_alloc(PNODE_SLAB(node, label_slab, item_label_t));
+#define ITEM_LABEL_FREE(node, il)					\
+	wmem_slab_free(PNODE_SLAB(node, label_slab, item_label_t), il);
 
 #define PROTO_REGISTRAR_GET_NTH(hfindex, hfinfo)						\
 	if((guint)hfindex >= gpa_hfinfo.len && getenv("WIRESHARK_ABORT_ON_DISSECTOR_BUG"))	\
@@ -442,6 +455,23 @@ register_dissector_plugin_type(void)
 }
 #endif /* HAVE_PLUGINS */
 
+typedef struct {
+	register_cb	cb;
+	gpointer	client_data;
+} register_cb_data_t;
+
+/* Tell minimal dissection which registration routine is being run before
+   passing the callback on */
+static void
+register_routine_cb(register_action_e action, const char *message, gpointer client_data)
+{
+	register_cb_data_t *data = (register_cb_data_t *)client_data;
+
+	minimal_dissection_note_routine(message);
+	if (data->cb)
+		(*data->cb)(action, message, data->client_data);
+}
+
 /* initialize data structures and register protocols and fields */
 void
 proto_init(void (register_all_protocols_func)(register_cb cb, gpointer client_data),
@@ -449,6 +479,8 @@ proto_init(void (register_all_protocols_func)(register_cb cb, gpointer client_da
 	   register_cb cb,
 	   gpointer client_data)
 {
+	register_cb_data_t cb_data;
+
 	proto_cleanup();
 
 	proto_names        = g_hash_table_new_full(g_int_hash, g_int_equal, g_free, NULL);
@@ -482,7 +514,10 @@ proto_init(void (register_all_protocols_func)(register_cb cb, gpointer client_da
 	   dissector tables, and dissectors to be called through a
 	   handle, and do whatever one-time initialization it needs to
 	   do. */
-	register_all_protocols_func(cb, client_data);
+	cb_data.cb = cb;
+	cb_data.client_data = client_data;
+	register_all_protocols_func(register_routine_cb, &cb_data);
+	minimal_dissection_note_routine(NULL);
 
 #ifdef HAVE_PLUGINS
 	/* Now call the registration routines for all disssector
@@ -496,7 +531,8 @@ proto_init(void (register_all_protocols_func)(register_cb cb, gpointer client_da
 	   dissectors; those routines register the dissector in other
 	   dissectors' handoff tables, and fetch any dissector handles
 	   they need. */
-	register_all_handoffs_func(cb, client_data);
+	register_all_handoffs_func(register_routine_cb, &cb_data);
+	minimal_dissection_note_routine(NULL);
 
 #ifdef HAVE_PLUGINS
 	/* Now do the same with plugins. */
@@ -642,10 +678,8 @@ proto_tree_children_foreach(proto_tree *tree, proto_tree_foreach_func func,
 }
 
 static void
-free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
+unprime_hfid(gint hfid)
 {
-	GPtrArray         *ptrs = (GPtrArray *)value;
-	gint               hfid = (gint)(long)key;
 	header_field_info *hfinfo;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
@@ -661,10 +695,36 @@ free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
 		}
 		hfinfo->ref_type = HF_REF_TYPE_NONE;
 	}
+}
+
+static void
+free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
+{
+	GPtrArray         *ptrs = (GPtrArray *)value;
+	gint               hfid = (gint)(long)key;
+
+	unprime_hfid(hfid);
 
 	g_ptr_array_free(ptrs, TRUE);
 }
 
+/* Empty the field vector, keeping the arrays for the next packet; the
+ * field_infos in it are cleaned up with the rest of the tree, as their
+ * items hang off the root. */
+static void
+field_vector_reset(tree_data_t *tree_data)
+{
+	guint i;
+	gint  hfid;
+
+	for (i = 0; i < tree_data->field_vector_ids->len; i++) {
+		hfid = g_array_index(tree_data->field_vector_ids, gint, i);
+		unprime_hfid(hfid);
+		g_ptr_array_set_size(tree_data->field_vector[hfid], 0);
+	}
+	g_array_set_size(tree_data->field_vector_ids, 0);
+}
+
 static void
 proto_tree_free_node(proto_node *node, gpointer data _U_)
 {
@@ -692,6 +752,9 @@ proto_tree_reset(proto_tree *tree)
 		g_hash_table_remove_all(tree_data->interesting_hfids);
 	}
 
+	if (tree_data->field_vector)
+		field_vector_reset(tree_data);
+
 	/* Reset track of the number of children */
 	tree_data->count = 0;
 
@@ -716,6 +779,25 @@ proto_tree_free(proto_tree *tree)
 		g_hash_table_destroy(tree_data->interesting_hfids);
 	}
 
+	if (tree_data->field_vector) {
+		guint i;
+
+		field_vector_reset(tree_data);
+		for (i = 0; i < tree_data->field_vector_len; i++) {
+			if (tree_data->field_vector[i])
+				g_ptr_array_free(tree_data->field_vector[i], TRUE);
+		}
+		g_free(tree_data->field_vector);
+		g_array_free(tree_data->field_vector_ids, TRUE);
+	}
+
+	if (tree_data->node_slab)
+		wmem_destroy_slab(tree_data->node_slab);
+	if (tree_data->finfo_slab)
+		wmem_destroy_slab(tree_data->finfo_slab);
+	if (tree_data->label_slab)
+		wmem_destroy_slab(tree_data->label_slab);
+
 	g_slice_free(tree_data_t, tree_data);
 
 	g_slice_free(proto_tree, tree);
@@ -1587,6 +1669,29 @@ get_time_value(tvbuff_t *tvb, const gint start, const gint length, const guint e
 	}
 }
 
+static void
+tree_data_add_field_vector(tree_data_t *tree_data, field_info *fi)
+{
+	gint       hfid = fi->hfinfo->id;
+	GPtrArray *ptrs;
+
+	if ((guint)hfid >= tree_data->field_vector_len) {
+		/* Registered since the tree was put in field vector mode */
+		tree_data->field_vector = g_renew(GPtrArray *, tree_data->field_vector, gpa_hfinfo.len);
+		memset(tree_data->field_vector + tree_data->field_vector_len, 0,
+		       (gpa_hfinfo.len - tree_data->field_vector_len) * sizeof (GPtrArray *));
+		tree_data->field_vector_len = gpa_hfinfo.len;
+	}
+
+	ptrs = tree_data->field_vector[hfid];
+	if (!ptrs)
+		ptrs = tree_data->field_vector[hfid] = g_ptr_array_new();
+	if (ptrs->len == 0)
+		g_array_append_val(tree_data->field_vector_ids, hfid);
+
+	g_ptr_array_add(ptrs, fi);
+}
+
 static void
 tree_data_add_maybe_interesting_field(tree_data_t *tree_data, field_info *fi)
 {
@@ -1595,6 +1700,11 @@ tree_data_add_maybe_interesting_field(tree_data_t *tree_data, field_info *fi)
 	if (hfinfo->ref_type == HF_REF_TYPE_DIRECT) {
 		GPtrArray *ptrs = NULL;
 
+		if (tree_data->field_vector) {
+			tree_data_add_field_vector(tree_data, fi);
+			return;
+		}
+
 		if (tree_data->interesting_hfids == NULL) {
 			/* Initialize the hash because we now know that it is needed */
 			tree_data->interesting_hfids =
@@ -3857,12 +3967,18 @@ proto_tree_add_node(proto_tree *tree, field_info *fi)
 		/* XXX - is it safe to continue here? */
 	}
 
-	pnode = wmem_new(PNODE_POOL(tree), proto_node);
+	PROTO_NODE_NEW(tree, pnode);
 	PROTO_NODE_INIT(pnode);
 	pnode->parent = tnode;
 	PNODE_FINFO(pnode) = fi;
 	pnode->tree_data = PTREE_DATA(tree);
 
+	/* In field vector mode only the field vector is looked at, so
+	   don't bother building the hierarchy; the item keeps its parent
+	   for the dissector's sake, but is linked in under the root. */
+	if (pnode->tree_data->field_vector && fi->hfinfo->ref_type == HF_REF_TYPE_DIRECT)
+		tnode = pnode->tree_data->field_vector_root;
+
 	if (tnode->last_child != NULL) {
 		sibling = tnode->last_child;
 		DISSECTOR_ASSERT(sibling->next == NULL);
@@ -4029,7 +4145,7 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 {
 	field_info *fi;
 
-	FIELD_INFO_NEW(PNODE_POOL(tree), fi);
+	FIELD_INFO_NEW(tree, fi);
 
 	fi->hfinfo     = hfinfo;
 	fi->start      = start;
@@ -4041,6 +4157,7 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 		FI_SET_FLAG(fi, FI_HIDDEN);
 	fvalue_init(&fi->value, fi->hfinfo->type);
 	fi->rep        = NULL;
+	fi->rep_fmt    = NULL;
 
 	/* add the data source tvbuff */
 	fi->ds_tvb = tvb ? tvb_get_ds_tvb(tvb) : NULL;
@@ -4051,6 +4168,68 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 	return fi;
 }
 
+/*
+ * Labels given by dissectors are only formatted if and when something
+ * asks for them, with proto_item_fill_label(); until then, fi->rep_fmt
+ * has the formats and arguments for them, in a list of pieces of these
+ * kinds.
+ */
+#define LABEL_TEXT	0	/* the whole label */
+#define LABEL_VALUE	1	/* the field's value, after its name */
+#define LABEL_APPEND	2	/* added to the end of the label */
+
+/* Keep a format and its arguments for the label; returns FALSE, with ap
+   untouched, if the format has to be formatted there and then. */
+static gboolean
+proto_item_defer_label(proto_item *pi, field_info *fi, guint16 kind,
+		       const char *format, va_list ap)
+{
+	label_fmt_t *lf, *last;
+
+	lf = label_fmt_new(PNODE_POOL(pi), format, ap);
+	if (lf == NULL)
+		return FALSE;
+	lf->kind = kind;
+
+	if (kind == LABEL_APPEND && fi->rep_fmt != NULL) {
+		for (last = fi->rep_fmt; last->next != NULL; last = last->next)
+			;
+		last->next = lf;
+	} else
+		fi->rep_fmt = lf;
+
+	return TRUE;
+}
+
+/* The start of the label for a field's value: the bits of a bitfield,
+   and the name of the field. */
+static int
+label_fill_value_prefix(field_info *fi, gchar *label_str)
+{
+	header_field_info *hf = fi->hfinfo;
+	int                ret = 0;
+
+	if (hf->bitmask && (hf->type == FT_BOOLEAN || IS_FT_UINT(hf->type))) {
+		guint64 val;
+		char *p;
+
+		if (IS_FT_UINT(hf->type))
+			val = fvalue_get_uinteger(&fi->value);
+		else
+			val = fvalue_get_integer64(&fi->value);
+
+		val <<= hfinfo_bitshift(hf);
+
+		p = decode_bitfield_value(label_str, val, hf->bitmask, hfinfo_bitwidth(hf));
+		ret = (int) (p - label_str);
+	}
+
+	/* put in the hf name */
+	ret += g_snprintf(label_str + ret, ITEM_LABEL_LENGTH - ret, "%s: ", hf->name);
+
+	return ret;
+}
+
 /* If the protocol tree is to be visible, set the representation of a
    proto_tree entry with the name of the field for the item and with
    the value formatted with the supplied printf-style format and
@@ -4065,30 +4244,14 @@ proto_tree_set_representation_value(proto_item *pi, const char *format, va_list
 	if (PTREE_DATA(pi)->visible && !PROTO_ITEM_IS_HIDDEN(pi)) {
 		int               ret = 0;
 		field_info        *fi = PITEM_FINFO(pi);
-		header_field_info *hf;
 
 		DISSECTOR_ASSERT(fi);
 
-		hf = fi->hfinfo;
-
-		ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
-		if (hf->bitmask && (hf->type == FT_BOOLEAN || IS_FT_UINT(hf->type))) {
-			guint64 val;
-			char *p;
-
-			if (IS_FT_UINT(hf->type))
-				val = fvalue_get_uinteger(&fi->value);
-			else
-				val = fvalue_get_integer64(&fi->value);
-
-			val <<= hfinfo_bitshift(hf);
-
-			p = decode_bitfield_value(fi->rep->representation, val, hf->bitmask, hfinfo_bitwidth(hf));
-			ret = (int) (p - fi->rep->representation);
-		}
+		if (proto_item_defer_label(pi, fi, LABEL_VALUE, format, ap))
+			return;
 
-		/* put in the hf name */
-		ret += g_snprintf(fi->rep->representation + ret, ITEM_LABEL_LENGTH - ret, "%s: ", hf->name);
+		ITEM_LABEL_NEW(pi, fi->rep);
+		ret = label_fill_value_prefix(fi, fi->rep->representation);
 
 		/* If possible, Put in the value of the string */
 		if (ret < ITEM_LABEL_LENGTH) {
@@ -4116,7 +4279,10 @@ proto_tree_set_representation(proto_item *pi, const char *format, va_list ap)
 	DISSECTOR_ASSERT(fi);
 
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
-		ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
+		if (proto_item_defer_label(pi, fi, LABEL_TEXT, format, ap))
+			return;
+
+		ITEM_LABEL_NEW(pi, fi->rep);
 		ret = g_vsnprintf(fi->rep->representation, ITEM_LABEL_LENGTH,
 				  format, ap);
 		if (ret >= ITEM_LABEL_LENGTH) {
@@ -4563,9 +4729,10 @@ proto_item_set_text(proto_item *pi, const char *format, ...)
 		return;
 
 	if (fi->rep) {
-		ITEM_LABEL_FREE(PNODE_POOL(pi), fi->rep);
+		ITEM_LABEL_FREE(pi, fi->rep);
 		fi->rep = NULL;
 	}
+	fi->rep_fmt = NULL;
 
 	va_start(ap, format);
 	proto_tree_set_representation(pi, format, ap);
@@ -4578,6 +4745,7 @@ proto_item_append_text(proto_item *pi, const char *format, ...)
 {
 	field_info *fi = NULL;
 	size_t      curlen;
+	gboolean    deferred;
 	va_list     ap;
 
 	TRY_TO_FAKE_THIS_REPR_VOID(pi);
@@ -4588,13 +4756,20 @@ proto_item_append_text(proto_item *pi, const char *format, ...)
 	}
 
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
-		/*
-		 * If we don't already have a representation,
-		 * generate the default representation.
-		 */
 		if (fi->rep == NULL) {
-			ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
+			va_start(ap, format);
+			deferred = proto_item_defer_label(pi, fi, LABEL_APPEND, format, ap);
+			va_end(ap);
+			if (deferred)
+				return;
+
+			/*
+			 * Generate the representation we have so far,
+			 * or the default representation, to append to.
+			 */
+			ITEM_LABEL_NEW(pi, fi->rep);
 			proto_item_fill_label(fi, fi->rep->representation);
+			fi->rep_fmt = NULL;
 		}
 
 		curlen = strlen(fi->rep->representation);
@@ -4628,8 +4803,9 @@ proto_item_prepend_text(proto_item *pi, const char *format, ...)
 		 * generate the default representation.
 		 */
 		if (fi->rep == NULL) {
-			ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
+			ITEM_LABEL_NEW(pi, fi->rep);
 			proto_item_fill_label(fi, representation);
+			fi->rep_fmt = NULL;
 		} else
 			g_strlcpy(representation, fi->rep->representation, ITEM_LABEL_LENGTH);
 
@@ -4724,9 +4900,42 @@ proto_tree_create_root(packet_info *pinfo)
 	/* Keep track of the number of children */
 	pnode->tree_data->count = 0;
 
+	pnode->tree_data->node_slab = NULL;
+	pnode->tree_data->finfo_slab = NULL;
+	pnode->tree_data->label_slab = NULL;
+
+	pnode->tree_data->field_vector = NULL;
+	pnode->tree_data->field_vector_len = 0;
+	pnode->tree_data->field_vector_ids = NULL;
+	pnode->tree_data->field_vector_root = NULL;
+
 	return (proto_tree *)pnode;
 }
 
+void
+proto_tree_use_field_vector(proto_tree *tree)
+{
+	tree_data_t *tree_data = PTREE_DATA(tree);
+
+	/* Labels would never be looked at, and nor would anything else */
+	g_assert(!tree_data->visible);
+	g_assert(tree->parent == NULL);
+
+	if (tree_data->field_vector)
+		return;
+
+	tree_data->field_vector_len = gpa_hfinfo.len;
+	tree_data->field_vector = g_new0(GPtrArray *, tree_data->field_vector_len);
+	tree_data->field_vector_ids = g_array_new(FALSE, FALSE, sizeof (gint));
+	tree_data->field_vector_root = tree;
+}
+
+gboolean
+proto_tree_uses_field_vector(const proto_tree *tree)
+{
+	return tree && PTREE_DATA(tree)->field_vector != NULL;
+}
+
 
 /* "prime" a proto_tree with a single hfid that a dfilter
  * is interested in. */
@@ -5002,6 +5211,7 @@ proto_register_protocol(const char *name, const char *short_name,
 
 	proto_id = proto_register_field_init(hfinfo, hfinfo->parent);
 	protocol->proto_id = proto_id;
+	minimal_dissection_note_protocol(proto_id);
 	return proto_id;
 }
 
@@ -5404,6 +5614,8 @@ proto_unregister_field (const int parent, gint hf_id)
 			g_hash_table_steal(gpa_name_map, hfi->abbrev);
 			g_ptr_array_remove_index_fast(proto->fields, i);
 			g_ptr_array_add(deregistered_fields, gpa_hfinfo.hfi[hf_id]);
+			/* Cached filters may refer to it. */
+			dfilter_cache_clear();
 			return;
 		}
 	}
@@ -6017,8 +6229,75 @@ label_fill_descr(char *label_str, gsize pos, const header_field_info *hfinfo, co
 	return pos;
 }
 
+static void
+proto_item_fill_default_label(field_info *fi, gchar *label_str);
+
+/* Format the label pieces in fi->rep_fmt, as the eager code in
+   proto_tree_set_representation(), proto_tree_set_representation_value()
+   and proto_item_append_text() would have. */
+static void
+proto_item_fill_deferred_label(field_info *fi, gchar *label_str)
+{
+	const label_fmt_t *lf = fi->rep_fmt;
+	int                pos = 0;
+	int                ret;
+
+	if (lf->kind == LABEL_APPEND) {
+		/* Appended to the default representation */
+		proto_item_fill_default_label(fi, label_str);
+		pos = (int)strlen(label_str);
+	}
+
+	for (; lf != NULL; lf = lf->next) {
+		switch (lf->kind) {
+
+		case LABEL_TEXT:
+			ret = label_fmt_format(lf, label_str, ITEM_LABEL_LENGTH);
+			if (ret >= ITEM_LABEL_LENGTH)
+				LABEL_MARK_TRUNCATED_START(label_str);
+			break;
+
+		case LABEL_VALUE:
+			ret = label_fill_value_prefix(fi, label_str);
+			if (ret < ITEM_LABEL_LENGTH)
+				ret += label_fmt_format(lf, label_str + ret, ITEM_LABEL_LENGTH - ret);
+			if (ret >= ITEM_LABEL_LENGTH)
+				LABEL_MARK_TRUNCATED_START(label_str);
+			break;
+
+		case LABEL_APPEND:
+			label_fmt_format(lf, label_str + pos, ITEM_LABEL_LENGTH - pos);
+			break;
+		}
+		pos = (int)strlen(label_str);
+	}
+}
+
 void
 proto_item_fill_label(field_info *fi, gchar *label_str)
+{
+	if (fi && fi->rep_fmt)
+		proto_item_fill_deferred_label(fi, label_str);
+	else
+		proto_item_fill_default_label(fi, label_str);
+}
+
+const gchar *
+proto_item_get_label(field_info *fi, gchar *label_str)
+{
+	if (fi == NULL)
+		return NULL;
+	if (fi->rep)
+		return fi->rep->representation;
+	if (fi->rep_fmt) {
+		proto_item_fill_deferred_label(fi, label_str);
+		return label_str;
+	}
+	return NULL;
+}
+
+static void
+proto_item_fill_default_label(field_info *fi, gchar *label_str)
 {
 	header_field_info *hfinfo;
 	guint8		  *bytes;
@@ -6829,10 +7108,21 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 {
+	tree_data_t *tree_data;
+
 	if (!tree)
 		return NULL;
 
-	if (PTREE_DATA(tree)->interesting_hfids != NULL)
+	tree_data = PTREE_DATA(tree);
+	if (tree_data->field_vector != NULL) {
+		if ((guint)id < tree_data->field_vector_len &&
+		    tree_data->field_vector[id] != NULL &&
+		    tree_data->field_vector[id]->len > 0)
+			return tree_data->field_vector[id];
+		return NULL;
+	}
+
+	if (tree_data->interesting_hfids != NULL)
 		return (GPtrArray *)g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
 					   GINT_TO_POINTER(id));
 	else
@@ -6847,6 +7137,9 @@ proto_tracking_interesting_fields(const proto_tree *tree)
 	if (!tree)
 		return FALSE;
 
+	if (PTREE_DATA(tree)->field_vector != NULL)
+		return PTREE_DATA(tree)->field_vector_ids->len > 0;
+
 	interesting_hfids = PTREE_DATA(tree)->interesting_hfids;
 
 	return (interesting_hfids != NULL) && g_hash_table_size(interesting_hfids);
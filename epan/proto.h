@@ -581,6 +581,8 @@ typedef struct _item_label_t {
 	char representation[ITEM_LABEL_LENGTH];
 } item_label_t;
 
+struct _label_fmt_t;
+
 
 /** Contains the field information for the proto_item. */
 typedef struct field_info {
@@ -592,6 +594,7 @@ typedef struct field_info {
 	gint			 tree_type;       /**< one of ETT_ or -1 */
 	guint32			 flags;           /**< bitfield like FI_GENERATED, ... */
 	item_label_t		*rep;             /**< string for GUI tree */
+	struct _label_fmt_t	*rep_fmt;         /**< what rep would be, if not formatted yet */
 	tvbuff_t		*ds_tvb;          /**< data source tvbuff */
 	fvalue_t		 value;
 } field_info;
@@ -664,6 +667,17 @@ typedef struct {
     gboolean     fake_protocols;
     gint         count;
     struct _packet_info *pinfo;
+    /* Where proto_nodes, field_infos and item labels are allocated
+       from in pinfo->pool; created when first needed */
+    wmem_slab_t *node_slab;
+    wmem_slab_t *finfo_slab;
+    wmem_slab_t *label_slab;
+    /* In field vector mode, the field_infos of primed fields, indexed
+       by hfid, and the hfids that have something in there */
+    GPtrArray  **field_vector;
+    guint        field_vector_len;
+    GArray      *field_vector_ids;
+    struct _proto_node *field_vector_root;
 } tree_data_t;
 
 /** Each proto_tree, proto_item is one of these. */
@@ -923,6 +937,21 @@ proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols);
 extern void
 proto_tree_prime_hfid(proto_tree *tree, const int hfid);
 
+/** Put an invisible tree into field vector mode: only items for primed
+ fields are recorded, in a vector indexed by field id that
+ proto_get_finfo_ptr_array() looks them up in, and they are hung
+ directly off the root rather than under their parents.  Items for
+ anything else are faked as usual.
+ @param tree the root of the tree */
+extern void
+proto_tree_use_field_vector(proto_tree *tree);
+
+/** Is the tree in field vector mode?
+ @param tree the tree
+ @return TRUE if proto_tree_use_field_vector() was called for it */
+WS_DLL_PUBLIC gboolean
+proto_tree_uses_field_vector(const proto_tree *tree);
+
 /** Get a parent item of a subtree.
  @param tree the tree to get the parent from
  @return parent item */
@@ -1930,13 +1959,27 @@ proto_item_append_string(proto_item *pi, const char *str);
 
 
 
-/** Fill given label_str with string representation of field
+/** Fill given label_str with string representation of field; that's
+ the label the item was given, if it hasn't been formatted into fi->rep
+ yet, otherwise one made from the field's name and value
  @param fi the item to get the info from
  @param label_str the string to fill
  @todo think about changing the parameter profile */
 WS_DLL_PUBLIC void
 proto_item_fill_label(field_info *fi, gchar *label_str);
 
+/** Get the label an item was given with proto_item_set_text(),
+ proto_item_append_text() or one of the proto_tree_add_xxx_format()
+ functions, rather than the one that would be made from the field's
+ name and value. Use this rather than fi->rep, which the label may
+ not have been formatted into yet.
+ @param fi the item to get the label of
+ @param label_str a buffer of ITEM_LABEL_LENGTH bytes the label may be
+ formatted into
+ @return the label, or NULL if the item wasn't given one */
+WS_DLL_PUBLIC const gchar *
+proto_item_get_label(field_info *fi, gchar *label_str);
+
 
 /** Register a new protocol.
  @param name the full name of the new protocol
@@ -835,6 +835,81 @@ LINK_FRAG(fragment_head *fd_head,fragment_item *fd)
 	fd_i->next=fd;
 }
 
+/*
+ * If the fragments of a datagram follow one another without gaps or
+ * overlaps, make a composite tvbuff of them, rather than copying them
+ * into a new buffer, and hand them over to it; otherwise return NULL.
+ *
+ * When a reassembly is being extended, the fragments of the earlier
+ * reassembly refer to its data; if they come first, as they should,
+ * that data goes into the composite, and *old_tvb_data is handed over
+ * to it too.
+ */
+static tvbuff_t *
+fragment_composite_data(fragment_head *fd_head, tvbuff_t **old_tvb_data,
+		 const guint32 size, const gboolean block_seq)
+{
+	fragment_item *fd_i;
+	fragment_item *last_fd = NULL;
+	guint32 dfpos = 0, old_len = 0;
+	gboolean subsets = FALSE;
+	tvbuff_t *composite_tvb;
+
+	if (size == 0)
+		return NULL;
+
+	for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+		if (block_seq && last_fd && last_fd->offset == fd_i->offset)
+			return NULL;	/* duplicate/retransmission/overlap */
+		last_fd = fd_i;
+		if (fd_i->flags & FD_SUBSET_TVB) {
+			if (dfpos != old_len)
+				return NULL;
+			old_len += fd_i->len;
+			subsets = TRUE;
+		}
+		if (!fd_i->len)
+			continue;
+		if (!fd_i->tvb_data || (!block_seq && fd_i->offset != dfpos))
+			return NULL;
+		if (!(fd_i->flags & FD_SUBSET_TVB) &&
+		    tvb_captured_length(fd_i->tvb_data) != fd_i->len)
+			return NULL;
+		dfpos += fd_i->len;
+	}
+	if (dfpos != size)
+		return NULL;
+	if (subsets && (!*old_tvb_data ||
+	    tvb_captured_length(*old_tvb_data) != old_len))
+		return NULL;
+
+	composite_tvb = tvb_new_composite();
+	if (subsets && old_len)
+		tvb_composite_append(composite_tvb, *old_tvb_data);
+	for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+		if (fd_i->len && !(fd_i->flags & FD_SUBSET_TVB))
+			tvb_composite_append(composite_tvb, fd_i->tvb_data);
+	}
+	tvb_composite_finalize_data_source(composite_tvb);
+
+	for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+		if (fd_i->flags & FD_SUBSET_TVB)
+			fd_i->flags &= ~FD_SUBSET_TVB;
+		else if (fd_i->tvb_data && fd_i->len)
+			tvb_add_to_chain(composite_tvb, fd_i->tvb_data);
+		else if (fd_i->tvb_data)
+			tvb_free(fd_i->tvb_data);
+		fd_i->tvb_data = NULL;
+	}
+	if (subsets) {
+		/* The subsets are chained to it */
+		tvb_add_to_chain(composite_tvb, *old_tvb_data);
+		*old_tvb_data = NULL;
+	}
+
+	return composite_tvb;
+}
+
 /*
  * This function adds a new fragment to the fragment hash table.
  * If this is the first fragment seen for this datagram, a new entry
@@ -1059,6 +1134,15 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 */
 	/* store old data just in case */
 	old_tvb_data=fd_head->tvb_data;
+	fd_head->tvb_data = fragment_composite_data(fd_head, &old_tvb_data, fd_head->datalen, FALSE);
+	if (fd_head->tvb_data) {
+		if (old_tvb_data)
+			tvb_add_to_chain(tvb, old_tvb_data);
+		fd_head->flags |= FD_DEFRAGMENTED;
+		fd_head->reassembled_in=pinfo->fd->num;
+		return TRUE;
+	}
+
 	data = (guint8 *) g_malloc(fd_head->datalen);
 	fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
 	tvb_set_free_cb(fd_head->tvb_data, g_free);
@@ -1495,10 +1579,19 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 
 	/* store old data in case the fd_i->data pointers refer to it */
 	old_tvb_data=fd_head->tvb_data;
+	fd_head->len = size;		/* record size for caller	*/
+	fd_head->tvb_data = fragment_composite_data(fd_head, &old_tvb_data, size, TRUE);
+	if (fd_head->tvb_data) {
+		if (old_tvb_data)
+			tvb_free(old_tvb_data);
+		fd_head->flags |= FD_DEFRAGMENTED;
+		fd_head->reassembled_in=pinfo->fd->num;
+		return;
+	}
+
 	data = (guint8 *) g_malloc(size);
 	fd_head->tvb_data = tvb_new_real_data(data, size, size);
 	tvb_set_free_cb(fd_head->tvb_data, g_free);
-	fd_head->len = size;		/* record size for caller	*/
 
 	/* add all data fragments */
 	last_fd=NULL;
@@ -1515,6 +1515,157 @@ test_missing_data_fragment_add_seq_next_3(void)
 }
 
 
+/**********************************************************************************
+ *
+ * reassembly into composite tvbuffs
+ *
+ *********************************************************************************/
+
+/* Checks the reassembled data against the pieces of data it was made of,
+ * including ranges that span them */
+static void
+check_reassembled(tvbuff_t *reassembled, const guint8 *expected, guint len)
+{
+    guint8 *copy;
+    guint offset;
+
+    ASSERT_EQ(len,tvb_captured_length(reassembled));
+
+    copy = (guint8 *)tvb_memdup(NULL, reassembled, 0, len);
+    ASSERT(!memcmp(copy,expected,len));
+    wmem_free(NULL, copy);
+
+    for (offset = 0; offset + 8 <= len; offset++) {
+        ASSERT(!memcmp(tvb_get_ptr(reassembled,offset,8),expected+offset,8));
+        ASSERT_EQ(offset,tvb_find_guint8(reassembled,offset,-1,expected[offset]));
+    }
+    ASSERT(!memcmp(tvb_get_ptr(reassembled,0,len),expected,len));
+}
+
+/* Fragments that follow one another without gaps or overlaps, added out
+ * of order with fragment_add; their data is handed over to the
+ * reassembled data rather than copied.
+ *   frame  frag_offset  len  more  tvb_offset
+ *     1         0        30    T      10
+ *     2        60        40    F     100
+ *     3        30        30    T      50
+ */
+static void
+test_fragment_add_composite(void)
+{
+    fragment_head *fd_head;
+    fragment_item *fd;
+    guint8 expected[100];
+
+    printf("Starting test test_fragment_add_composite\n");
+
+    pinfo.fd->num = 1;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
+                         0, 30, TRUE);
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 2;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 100, &pinfo, 12, NULL,
+                         60, 40, FALSE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 3;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 50, &pinfo, 12, NULL,
+                         30, 30, TRUE);
+    ASSERT_NE(NULL,fd_head);
+
+    ASSERT_EQ(100,fd_head->datalen);
+    ASSERT_EQ(3,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET,fd_head->flags);
+    ASSERT_NE(NULL,fd_head->tvb_data);
+
+    for (fd = fd_head->next; fd != NULL; fd = fd->next) {
+        ASSERT_EQ(0,fd->flags);
+        ASSERT_EQ(NULL,fd->tvb_data);
+    }
+
+    memcpy(expected, data+10, 30);
+    memcpy(expected+30, data+50, 30);
+    memcpy(expected+60, data+100, 40);
+    check_reassembled(fd_head->tvb_data, expected, 100);
+}
+
+/* Overlapping fragments still have their data copied, and checked.
+ *   frame  frag_offset  len  more  tvb_offset
+ *     1         0        40    T      10
+ *     2        50        20    F      60
+ *     3        30        20    T      40
+ */
+static void
+test_fragment_add_overlap(void)
+{
+    fragment_head *fd_head;
+
+    printf("Starting test test_fragment_add_overlap\n");
+
+    pinfo.fd->num = 1;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
+                         0, 40, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 2;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 60, &pinfo, 12, NULL,
+                         50, 20, FALSE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 3;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 40, &pinfo, 12, NULL,
+                         30, 20, TRUE);
+    ASSERT_NE(NULL,fd_head);
+
+    ASSERT_EQ(70,fd_head->datalen);
+    ASSERT_EQ(3,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_OVERLAP,fd_head->flags);
+    check_reassembled(fd_head->tvb_data, (const guint8 *)data+10, 70);
+}
+
+/* A partial reassembly extended by another fragment; the earlier
+ * reassembled data comes first in the new one.
+ *    seqno   frame  offset   len   more_frags
+ *      0       1       10     50   F
+ *      1       2      100     40   F
+ */
+static void
+test_fragment_add_seq_partial_composite(void)
+{
+    fragment_head *fd_head;
+    guint8 expected[90];
+
+    printf("Starting test test_fragment_add_seq_partial_composite\n");
+
+    pinfo.fd->num = 1;
+    fd_head=fragment_add_seq(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
+                             0, 50, FALSE, 0);
+    ASSERT_NE(NULL,fd_head);
+    ASSERT_EQ(50,fd_head->len);
+    check_reassembled(fd_head->tvb_data, (const guint8 *)data+10, 50);
+
+    fragment_set_partial_reassembly(&test_reassembly_table, &pinfo, 12, NULL);
+
+    pinfo.fd->num = 2;
+    fd_head=fragment_add_seq(&test_reassembly_table, tvb, 100, &pinfo, 12, NULL,
+                             1, 40, FALSE, 0);
+    ASSERT_NE(NULL,fd_head);
+
+    ASSERT_EQ(90,fd_head->len);
+    ASSERT_EQ(1,fd_head->datalen);
+    ASSERT_EQ(2,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_BLOCKSEQUENCE|FD_DATALEN_SET,fd_head->flags);
+    ASSERT_EQ(0,fd_head->next->flags);
+    ASSERT_EQ(NULL,fd_head->next->tvb_data);
+    ASSERT_EQ(NULL,fd_head->next->next->tvb_data);
+
+    memcpy(expected, data+10, 50);
+    memcpy(expected+50, data+100, 40);
+    check_reassembled(fd_head->tvb_data, expected, 90);
+}
+
 /**********************************************************************************
  *
  * main
@@ -1542,6 +1693,9 @@ main(int argc _U_, char **argv _U_)
         test_missing_data_fragment_add_seq_next,
         test_missing_data_fragment_add_seq_next_2,
         test_missing_data_fragment_add_seq_next_3,
+        test_fragment_add_composite,
+        test_fragment_add_overlap,
+        test_fragment_add_seq_partial_composite,
 #if 0
         test_fragment_add_seq_check_multiple
 #endif
@@ -34,6 +34,7 @@
 
 #include <string.h>
 #include <epan/packet_info.h>
+#include <epan/packet.h>
 #include <epan/dfilter/dfilter.h>
 #include <epan/tap.h>
 
@@ -68,6 +69,7 @@ typedef struct _tap_listener_t {
 	gboolean needs_redraw;
 	guint flags;
 	dfilter_t *code;
+	guint set_index;
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
@@ -75,6 +77,12 @@ typedef struct _tap_listener_t {
 } tap_listener_t;
 static volatile tap_listener_t *tap_listener_queue=NULL;
 
+/* The filters of all tap listeners, applied as one dfilter_set_t so
+ * that listeners share field loads and common tests and each filter
+ * runs at most once per packet. It is rebuilt on demand after the
+ * listener queue or any listener's filter changes. */
+static dfilter_set_t *tap_filter_set=NULL;
+
 #ifdef HAVE_PLUGINS
 
 #include <gmodule.h>
@@ -276,6 +284,24 @@ void tap_build_interesting (epan_dissect_t *edt)
 	}
 }
 
+static void
+tap_invalidate_filter_set(void)
+{
+	dfilter_set_free(tap_filter_set);
+	tap_filter_set=NULL;
+}
+
+static void
+tap_build_filter_set(void)
+{
+	tap_listener_t *tl;
+
+	tap_filter_set=dfilter_set_new();
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		tl->set_index=dfilter_set_add(tap_filter_set, tl->code);
+	}
+}
+
 /* This function is used to delete/initialize the tap queue and prime an
    epan_dissect_t with all the filters for tap listeners.
    To free the tap queue, we just prepend the used queue to the free queue.
@@ -317,6 +343,11 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 		return;
 	}
 
+	if(!tap_filter_set){
+		tap_build_filter_set();
+	}
+	dfilter_set_clear_results(tap_filter_set);
+
 	/* loop over all tap listeners and call the listener callback
 	   for all packets that match the filter. */
 	for(i=0;i<tap_packet_index;i++){
@@ -325,7 +356,7 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 			if(tp->tap_id==tl->tap_id){
 				gboolean passed=TRUE;
 				if(tl->code){
-					passed=dfilter_apply_edt(tl->code, edt);
+					passed=dfilter_set_apply_one_edt(tap_filter_set, tl->set_index, edt);
 				}
 				if(passed && tl->packet){
 					tl->needs_redraw|=tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
@@ -486,7 +517,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->needs_redraw=TRUE;
 	tl->flags=flags;
 	if(fstring){
-		if(!dfilter_compile(fstring, &tl->code, &err_msg)){
+		if(!dfilter_compile_cached(fstring, &tl->code, &err_msg)){
 			error_string = g_string_new("");
 			g_string_printf(error_string,
 			    "Filter \"%s\" is invalid - %s",
@@ -497,6 +528,14 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 		}
 	}
 
+	/* with minimal dissection, the protocol feeding the tap must be
+	   dissected; most taps are named after it.  If there's no such
+	   protocol, or the listener looks at the whole tree or the
+	   columns, every protocol must be */
+	minimal_dissection_require_protocol(
+	    (flags&(TL_REQUIRES_PROTO_TREE|TL_REQUIRES_COLUMNS)) ?
+	    -1 : proto_get_id_by_filter_name(tapname));
+
 	tl->tap_id=tap_id;
 	tl->tapdata=tapdata;
 	tl->reset=reset;
@@ -504,6 +543,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->draw=draw;
 	tl->next=(tap_listener_t *)tap_listener_queue;
 
+	tap_invalidate_filter_set();
 	tap_listener_queue=tl;
 
 	return NULL;
@@ -535,13 +575,14 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 	}
 
 	if(tl){
+		tap_invalidate_filter_set();
 		if(tl->code){
 			dfilter_free(tl->code);
 			tl->code=NULL;
 		}
 		tl->needs_redraw=TRUE;
 		if(fstring){
-			if(!dfilter_compile(fstring, &tl->code, &err_msg)){
+			if(!dfilter_compile_cached(fstring, &tl->code, &err_msg)){
 				error_string = g_string_new("");
 				g_string_printf(error_string,
 						 "Filter \"%s\" is invalid - %s",
@@ -581,6 +622,7 @@ remove_tap_listener(void *tapdata)
 	}
 
 	if(tl){
+		tap_invalidate_filter_set();
 		if(tl->code){
 			dfilter_free(tl->code);
 		}
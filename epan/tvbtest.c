@@ -284,6 +284,84 @@ test(tvbuff_t *tvb, const gchar* name,
 	return TRUE;
 }
 
+/* Tests contiguous pointers to, and searches of, ranges of a composite
+ * tvbuff that span its members.
+ * Returns TRUE if all tests succeeed, FALSE if any test fails */
+gboolean
+test_composite(tvbuff_t *tvb, const gchar* name,
+	       guint8* expected_data, guint expected_length)
+{
+	const guint8		*first_ptr, *ptr;
+	guint			offset, length, limit, i;
+	gint			result, expected_find, expected_pbrk;
+	guint8			needles[3];
+	guchar			found_needle;
+
+	/* Search for the last byte, and for it or the one in the middle,
+	 * from each offset, up to the end and up to the byte before it */
+	needles[0] = expected_data[expected_length - 1];
+	needles[1] = expected_data[expected_length / 2];
+	needles[2] = 0;
+	for (offset = 0; offset < expected_length; offset++) {
+		for (limit = expected_length - offset - 1;
+		     limit <= expected_length - offset; limit++) {
+			expected_find = expected_pbrk = -1;
+			for (i = offset + limit; i > offset; i--) {
+				if (expected_data[i - 1] == needles[0])
+					expected_find = expected_pbrk = i - 1;
+				else if (expected_data[i - 1] == needles[1])
+					expected_pbrk = i - 1;
+			}
+
+			result = tvb_find_guint8(tvb, offset, limit, needles[0]);
+			if (result != expected_find) {
+				printf("15: Failed TVB=%s Offset=%u Limit=%u "
+						"find_guint8 found %d, not %d\n",
+						name, offset, limit, result, expected_find);
+				failed = TRUE;
+				return FALSE;
+			}
+
+			result = tvb_pbrk_guint8(tvb, offset, limit, needles, &found_needle);
+			if (result != expected_pbrk ||
+			    (result != -1 && found_needle != expected_data[result])) {
+				printf("16: Failed TVB=%s Offset=%u Limit=%u "
+						"pbrk_guint8 found %d, not %d\n",
+						name, offset, limit, result, expected_pbrk);
+				failed = TRUE;
+				return FALSE;
+			}
+		}
+	}
+
+	/* A pointer handed out stays good while others are made */
+	first_ptr = tvb_get_ptr(tvb, 1, 5);
+
+	for (length = 1; length <= expected_length; length++) {
+		for (offset = 0; offset + length <= expected_length; offset++) {
+			ptr = tvb_get_ptr(tvb, offset, length);
+			if (memcmp(ptr, &expected_data[offset], length) != 0) {
+				printf("13: Failed TVB=%s Offset=%u Length=%u "
+						"Bad get_ptr\n",
+						name, offset, length);
+				failed = TRUE;
+				return FALSE;
+			}
+		}
+	}
+
+	if (memcmp(first_ptr, &expected_data[1], 5) != 0) {
+		printf("14: Failed TVB=%s Offset=1 Length=5 "
+				"Pointer no longer good\n", name);
+		failed = TRUE;
+		return FALSE;
+	}
+
+	printf("Passed composite TVB=%s\n", name);
+
+	return TRUE;
+}
+
 gboolean
 skip(tvbuff_t *tvb _U_, gchar* name,
 		guint8* expected_data _U_, guint expected_length _U_)
@@ -312,10 +390,10 @@ run_tests(void)
 	guint		subset_length[6];
 	guint		subset_reported_length[6];
 	guint8		temp;
-	guint8		*comp[6];
-	tvbuff_t	*tvb_comp[6];
-	guint		comp_length[6];
-	guint		comp_reported_length[6];
+	guint8		*comp[8];
+	tvbuff_t	*tvb_comp[8];
+	guint		comp_length[8];
+	guint		comp_reported_length[8];
 	int		len;
 
 	tvb_parent = tvb_new_real_data("", 0, 0);
@@ -483,6 +561,50 @@ run_tests(void)
 	test(tvb_comp[4], "Composite 4", comp[4], comp_length[4], comp_reported_length[4]);
 	test(tvb_comp[5], "Composite 5", comp[5], comp_length[5], comp_reported_length[5]);
 
+	/* Many subsets, none of them next to the one before */
+	printf("Making Composite 6\n");
+	tvb_comp[6]		= tvb_new_composite();
+	comp_length[6]		= 0;
+	comp_reported_length[6]	= 0;
+	comp[6]			= (guint8*)g_malloc(14 * (1 + 2 + 3));
+	for (i = 0; i < 14; i++) {
+		for (j = 2; j >= 0; j--) {
+			memcpy(&comp[6][comp_length[6]], &small[j][i], 3 - j);
+			tvb_composite_append(tvb_comp[6],
+				tvb_new_subset(tvb_small[j], i, 3 - j, 3 - j));
+			comp_length[6] += 3 - j;
+			comp_reported_length[6] += 3 - j;
+		}
+	}
+	tvb_composite_finalize(tvb_comp[6]);
+
+	/* A composite of composites, with a real in between */
+	printf("Making Composite 7\n");
+	tvb_comp[7]		= tvb_new_composite();
+	comp_length[7]		= comp_length[6] + small_length[2] + comp_length[4];
+	comp_reported_length[7]	= comp_reported_length[6] +
+					small_reported_length[2] +
+					comp_reported_length[4];
+	comp[7]			= (guint8*)g_malloc(comp_length[7]);
+	len = 0;
+	memcpy(&comp[7][len], comp[6], comp_length[6]);
+	len += comp_length[6];
+	memcpy(&comp[7][len], small[2], small_length[2]);
+	len += small_length[2];
+	memcpy(&comp[7][len], comp[4], comp_length[4]);
+	tvb_composite_append(tvb_comp[7], tvb_comp[6]);
+	tvb_composite_append(tvb_comp[7], tvb_small[2]);
+	tvb_composite_append(tvb_comp[7], tvb_comp[4]);
+	tvb_composite_finalize(tvb_comp[7]);
+
+	test(tvb_comp[6], "Composite 6", comp[6], comp_length[6], comp_reported_length[6]);
+	test(tvb_comp[7], "Composite 7", comp[7], comp_length[7], comp_reported_length[7]);
+
+	test_composite(tvb_comp[1], "Composite 1", comp[1], comp_length[1]);
+	test_composite(tvb_comp[3], "Composite 3", comp[3], comp_length[3]);
+	test_composite(tvb_comp[6], "Composite 6", comp[6], comp_length[6]);
+	test_composite(tvb_comp[7], "Composite 7", comp[7], comp_length[7]);
+
 	/* free memory. */
 	/* Don't free: comp[0] */
 	g_free(comp[1]);
@@ -490,6 +612,8 @@ run_tests(void)
 	g_free(comp[3]);
 	g_free(comp[4]);
 	g_free(comp[5]);
+	g_free(comp[6]);
+	g_free(comp[7]);
 
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
 }
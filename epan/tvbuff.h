@@ -219,6 +219,12 @@ WS_DLL_PUBLIC tvbuff_t *tvb_new_composite(void);
  * occur, data access can finally happen after this finalization. */
 WS_DLL_PUBLIC void tvb_composite_finalize(tvbuff_t *tvb);
 
+/** Mark a composite tvbuff as initialized, as tvb_composite_finalize()
+ * does, but make it a data source of its own rather than chaining it to
+ * its first member. Chain the tvbuffs its members depend upon to it with
+ * tvb_add_to_chain() to have them freed along with it. */
+WS_DLL_PUBLIC void tvb_composite_finalize_data_source(tvbuff_t *tvb);
+
 
 /* Get amount of captured data in the buffer (which is *NOT* necessarily the
  * length of the packet). You probably want tvb_reported_length instead. */
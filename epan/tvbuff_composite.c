@@ -23,18 +23,35 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "tvbuff.h"
 #include "tvbuff-int.h"
 #include "proto.h"	/* XXX - only used for DISSECTOR_ASSERT, probably a new header file? */
 
 typedef struct {
+	/* The members, as appended and prepended until the tvbuff
+	 * is finalized. */
 	GSList		*tvbs;
 
-	/* Used for quick testing to see if this
-	 * is the tvbuff that a COMPOSITE is
-	 * interested in. */
+	/* The members once the tvbuff is finalized, with the members
+	 * of any composite member in its place, and the offset at
+	 * which each one starts, followed by the total length, so that
+	 * the member an offset is in can be found with a binary search. */
+	tvbuff_t	**members;
+	guint		num_members;
 	guint		*start_offsets;
-	guint		*end_offsets;
+
+	/* The member found last, tried first next time. */
+	guint		last_member;
+
+	/* Copies of ranges that span members, made when a contiguous
+	 * pointer to them is needed, sorted by offset, and the number of
+	 * bytes in them; once that would exceed the length of the data,
+	 * the whole of it is copied instead. */
+	GPtrArray	*spans;
+	guint		span_bytes;
+	guint8		*flat;
 
 } tvb_comp_t;
 
@@ -44,64 +61,164 @@ struct tvb_composite {
 	tvb_comp_t	composite;
 };
 
+typedef struct {
+	guint		offset;
+	guint		length;
+	guint8		*data;
+} tvb_comp_span_t;
+
 static void
 composite_free(tvbuff_t *tvb)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
+	guint i;
 
 	g_slist_free(composite->tvbs);
 
+	g_free(composite->members);
 	g_free(composite->start_offsets);
-	g_free(composite->end_offsets);
-	if (tvb->real_data) {
-		/*
-		 * XXX - do this with a union?
-		 */
-		g_free((gpointer)tvb->real_data);
+	if (composite->spans) {
+		for (i = 0; i < composite->spans->len; i++)
+			g_free(g_ptr_array_index(composite->spans, i));
+		g_ptr_array_free(composite->spans, TRUE);
 	}
+	g_free(composite->flat);
 }
 
 static guint
 composite_offset(const tvbuff_t *tvb, const guint counter)
 {
 	const struct tvb_composite *composite_tvb = (const struct tvb_composite *) tvb;
-	const tvbuff_t *member = (const tvbuff_t *)composite_tvb->composite.tvbs->data;
+	const tvbuff_t *member = composite_tvb->composite.members[0];
 
 	return tvb_offset_from_real_beginning_counter(member, counter);
 }
 
+/*
+ * Find the member that abs_offset is in, or return num_members if
+ * it's at the end of the data.
+ */
+static guint
+composite_find_member(tvb_comp_t *composite, guint abs_offset)
+{
+	guint lo, hi, mid;
+
+	if (abs_offset >= composite->start_offsets[composite->num_members])
+		return composite->num_members;
+
+	/* Data tends to be looked at in order */
+	lo = composite->last_member;
+	if (composite->start_offsets[lo] <= abs_offset &&
+	    abs_offset < composite->start_offsets[lo + 1])
+		return lo;
+
+	/* start_offsets[lo] <= abs_offset < start_offsets[hi] */
+	lo = 0;
+	hi = composite->num_members;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (composite->start_offsets[mid] <= abs_offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	composite->last_member = lo;
+	return lo;
+}
+
+static void *composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_length);
+
+/* Make the whole of the data contiguous */
+static const guint8 *
+composite_flatten(tvbuff_t *tvb)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+
+	composite->flat = (guint8 *)g_malloc(tvb->length);
+	composite_memcpy(tvb, composite->flat, 0, tvb->length);
+	tvb->real_data = composite->flat;
+	return tvb->real_data;
+}
+
+/*
+ * A copy of a range spanning members, made only once.  Pointers that
+ * have been handed out have to stay good until the tvbuff is freed, so
+ * the copies are kept; the one with the highest offset at or before the
+ * range is reused if it covers it.
+ */
+static const guint8 *
+composite_get_span(tvbuff_t *tvb, guint abs_offset, guint abs_length)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	tvb_comp_span_t *span;
+	guint lo, hi, mid;
+
+	if (composite->spans == NULL)
+		composite->spans = g_ptr_array_new();
+
+	/* spans[lo..] start after abs_offset */
+	lo = 0;
+	hi = composite->spans->len;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		span = (tvb_comp_span_t *)g_ptr_array_index(composite->spans, mid);
+		if (span->offset <= abs_offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo > 0) {
+		span = (tvb_comp_span_t *)g_ptr_array_index(composite->spans, lo - 1);
+		if (abs_offset + abs_length <= span->offset + span->length)
+			return span->data + (abs_offset - span->offset);
+	}
+
+	/* Rather than keep more copies than there is data, copy it all */
+	if (abs_length > tvb->length - composite->span_bytes)
+		return composite_flatten(tvb) + abs_offset;
+
+	span = (tvb_comp_span_t *)g_malloc(sizeof(tvb_comp_span_t) + abs_length);
+	span->offset = abs_offset;
+	span->length = abs_length;
+	span->data = (guint8 *)(span + 1);
+	composite_memcpy(tvb, span->data, abs_offset, abs_length);
+	composite->span_bytes += abs_length;
+
+	/* Insert it at lo, after any others at the same offset */
+	g_ptr_array_add(composite->spans, NULL);
+	memmove(&composite->spans->pdata[lo + 1], &composite->spans->pdata[lo],
+		(composite->spans->len - 1 - lo) * sizeof(gpointer));
+	composite->spans->pdata[lo] = span;
+	return span->data;
+}
+
 static const guint8*
 composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return "";
 	}
 
+	member_tvb = composite->members[i];
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
@@ -111,12 +228,12 @@ composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 		DISSECTOR_ASSERT(!tvb->real_data);
 		return tvb_get_ptr(member_tvb, member_offset, abs_length);
 	}
+	else if (abs_offset == 0 && abs_length == tvb->length) {
+		return composite_flatten(tvb);
+	}
 	else {
-		tvb->real_data = (guint8 *)tvb_memdup(NULL, tvb, 0, -1);
-		return tvb->real_data + abs_offset;
+		return composite_get_span(tvb, abs_offset, abs_length);
 	}
-
-	DISSECTOR_ASSERT_NOT_REACHED();
 }
 
 static void *
@@ -125,63 +242,89 @@ composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_lengt
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	guint8 *target = (guint8 *) _target;
 
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
 	guint	    member_offset, member_length;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
-	/* Maybe the range specified by offset/length
-	 * is contiguous inside one of the member tvbuffs */
-	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	composite = &composite_tvb->composite;
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return target;
 	}
 
-	member_offset = abs_offset - composite->start_offsets[i];
+	/* Copy the part that's in each member in turn */
+	while (abs_length > 0) {
+		DISSECTOR_ASSERT(i < composite->num_members);
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_length = composite->start_offsets[i + 1] - abs_offset;
+		if (member_length > abs_length)
+			member_length = abs_length;
 
-	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
-		DISSECTOR_ASSERT(!tvb->real_data);
-		return tvb_memcpy(member_tvb, target, member_offset, abs_length);
-	}
-	else {
-		/* The requested data is non-contiguous inside
-		 * the member tvb. We have to memcpy() the part that's in the member tvb,
-		 * then iterate across the other member tvb's, copying their portions
-		 * until we have copied all data.
-		 */
-		member_length = tvb_length_remaining(member_tvb, member_offset);
-
-		/* composite_memcpy() can't handle a member_length of zero. */
-		DISSECTOR_ASSERT(member_length > 0);
-
-		tvb_memcpy(member_tvb, target, member_offset, member_length);
+		tvb_memcpy(composite->members[i], target, member_offset, member_length);
+		target		+= member_length;
 		abs_offset	+= member_length;
 		abs_length	-= member_length;
+		i++;
+	}
 
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
-		}
+	return _target;
+}
 
-		return target;
+static gint
+composite_find_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, guint8 needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i;
+	guint	    member_offset, member_length;
+	gint	    result;
+
+	/* Search each member in turn */
+	for (i = composite_find_member(composite, abs_offset);
+	     limit > 0 && i < composite->num_members; i++) {
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_length = composite->start_offsets[i + 1] - abs_offset;
+		if (member_length > limit)
+			member_length = limit;
+
+		result = tvb_find_guint8(composite->members[i], member_offset, member_length, needle);
+		if (result != -1)
+			return composite->start_offsets[i] + result;
+		abs_offset += member_length;
+		limit	   -= member_length;
 	}
+	return -1;
+}
 
-	DISSECTOR_ASSERT_NOT_REACHED();
+static gint
+composite_pbrk_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const guint8 *needles, guchar *found_needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i;
+	guint	    member_offset, member_length;
+	gint	    result;
+
+	/* Search each member in turn */
+	for (i = composite_find_member(composite, abs_offset);
+	     limit > 0 && i < composite->num_members; i++) {
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_length = composite->start_offsets[i + 1] - abs_offset;
+		if (member_length > limit)
+			member_length = limit;
+
+		result = tvb_pbrk_guint8(composite->members[i], member_offset, member_length, needles, found_needle);
+		if (result != -1)
+			return composite->start_offsets[i] + result;
+		abs_offset += member_length;
+		limit	   -= member_length;
+	}
+	return -1;
 }
 
 static const struct tvb_ops tvb_composite_ops = {
@@ -191,8 +334,8 @@ static const struct tvb_ops tvb_composite_ops = {
 	composite_offset,     /* offset */
 	composite_get_ptr,    /* get_ptr */
 	composite_memcpy,     /* memcpy */
-	NULL,                 /* find_guint8 XXX */
-	NULL,                 /* pbrk_guint8 XXX */
+	composite_find_guint8, /* find_guint8 */
+	composite_pbrk_guint8, /* pbrk_guint8 */
 	NULL,                 /* clone */
 };
 
@@ -203,6 +346,10 @@ static const struct tvb_ops tvb_composite_ops = {
  *      tvb is finalized.
  *      This means that composite tvb members must all be in the same chain.
  *      ToDo: enforce this: By searching the chain?
+ *
+ *   2. A composite member of a composite tvb is replaced by its own members,
+ *      so that looking things up doesn't get slower as composites are
+ *      built out of composites, as when reassembling a PDU bit by bit.
  */
 tvbuff_t *
 tvb_new_composite(void)
@@ -212,8 +359,13 @@ tvb_new_composite(void)
 	tvb_comp_t *composite = &composite_tvb->composite;
 
 	composite->tvbs		 = NULL;
+	composite->members	 = NULL;
+	composite->num_members	 = 0;
 	composite->start_offsets = NULL;
-	composite->end_offsets	 = NULL;
+	composite->last_member	 = 0;
+	composite->spans	 = NULL;
+	composite->span_bytes	 = 0;
+	composite->flat		 = NULL;
 
 	return tvb;
 }
@@ -254,15 +406,27 @@ tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member)
 	composite->tvbs = g_slist_prepend(composite->tvbs, member);
 }
 
-void
-tvb_composite_finalize(tvbuff_t *tvb)
+static void
+composite_add_member(tvbuff_t *tvb, tvbuff_t *member_tvb)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+
+	composite->members[composite->num_members] = member_tvb;
+	composite->start_offsets[composite->num_members] = tvb->length;
+	composite->num_members++;
+	tvb->length += member_tvb->length;
+}
+
+static void
+composite_index(tvbuff_t *tvb)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	GSList	   *slist;
-	guint	    num_members;
+	guint	    num_members, i;
 	tvbuff_t   *member_tvb;
-	tvb_comp_t *composite;
-	int	    i = 0;
+	tvb_comp_t *composite, *member_composite;
+	gboolean    contiguous;
 
 	DISSECTOR_ASSERT(tvb && !tvb->initialized);
 	DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops);
@@ -270,30 +434,78 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	DISSECTOR_ASSERT(tvb->reported_length == 0);
 
 	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
 
 	/* Dissectors should not create composite TVBs if they're not going to
 	 * put at least one TVB in them.
 	 * (Without this check--or something similar--we'll seg-fault below.)
 	 */
-	DISSECTOR_ASSERT(num_members);
+	DISSECTOR_ASSERT(composite->tvbs);
+
+	num_members = 0;
+	for (slist = composite->tvbs; slist != NULL; slist = slist->next) {
+		member_tvb = (tvbuff_t *)slist->data;
+		if (member_tvb->ops == &tvb_composite_ops) {
+			DISSECTOR_ASSERT(member_tvb->initialized);
+			num_members += ((struct tvb_composite *) member_tvb)->composite.num_members;
+		} else
+			num_members++;
+	}
 
-	composite->start_offsets = g_new(guint, num_members);
-	composite->end_offsets = g_new(guint, num_members);
+	composite->members = g_new(tvbuff_t *, num_members);
+	composite->start_offsets = g_new(guint, num_members + 1);
 
 	for (slist = composite->tvbs; slist != NULL; slist = slist->next) {
-		DISSECTOR_ASSERT((guint) i < num_members);
 		member_tvb = (tvbuff_t *)slist->data;
-		composite->start_offsets[i] = tvb->length;
-		tvb->length += member_tvb->length;
+		if (member_tvb->ops == &tvb_composite_ops) {
+			member_composite = &((struct tvb_composite *) member_tvb)->composite;
+			for (i = 0; i < member_composite->num_members; i++)
+				composite_add_member(tvb, member_composite->members[i]);
+		} else
+			composite_add_member(tvb, member_tvb);
 		tvb->reported_length += member_tvb->reported_length;
-		composite->end_offsets[i] = tvb->length - 1;
-		i++;
 	}
+	composite->start_offsets[composite->num_members] = tvb->length;
 
-	DISSECTOR_ASSERT(composite->tvbs);
+	/*
+	 * If the members' data is all there, one after the other, as
+	 * with subsets of the same data, just point to it.
+	 */
+	contiguous = TRUE;
+	for (i = 0; contiguous && i < composite->num_members; i++) {
+		member_tvb = composite->members[i];
+		if (!member_tvb->real_data ||
+		    (i > 0 && member_tvb->real_data != composite->members[i - 1]->real_data + composite->members[i - 1]->length))
+			contiguous = FALSE;
+	}
+	if (contiguous)
+		tvb->real_data = composite->members[0]->real_data;
+}
+
+void
+tvb_composite_finalize(tvbuff_t *tvb)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+
+	composite_index(tvb);
 
 	tvb_add_to_chain((tvbuff_t *)composite->tvbs->data, tvb); /* chain composite tvb to first member */
+	g_slist_free(composite->tvbs);
+	composite->tvbs = NULL;
+	tvb->initialized = TRUE;
+}
+
+void
+tvb_composite_finalize_data_source(tvbuff_t *tvb)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+
+	composite_index(tvb);
+
+	g_slist_free(composite->tvbs);
+	composite->tvbs = NULL;
+	tvb->ds_tvb = tvb;
 	tvb->initialized = TRUE;
 }
 
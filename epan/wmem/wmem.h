@@ -24,6 +24,7 @@
 #ifndef __WMEM_H__
 #define __WMEM_H__
 
+#include "wmem_accounting.h"
 #include "wmem_array.h"
 #include "wmem_core.h"
 #include "wmem_list.h"
@@ -31,6 +32,7 @@
 #include "wmem_miscutl.h"
 #include "wmem_queue.h"
 #include "wmem_scopes.h"
+#include "wmem_slab.h"
 #include "wmem_stack.h"
 #include "wmem_strbuf.h"
 #include "wmem_strutl.h"
@@ -0,0 +1,184 @@
+/* wmem_accounting.c
+ * Wireshark Memory Manager Accounting
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "wmem_core.h"
+#include "wmem_allocator.h"
+#include "wmem_accounting.h"
+#include "wmem_accounting_int.h"
+
+/* The counts for all the allocators with the same name */
+typedef struct _wmem_accounting_t {
+    const char               *name;
+    wmem_accounting_counts_t *counts; /* indexed by tag + 1 */
+    guint                     num_counts;
+    struct _wmem_accounting_t *next;
+} wmem_accounting_t;
+
+gboolean wmem_accounting_on = FALSE;
+
+static int                current_tag = WMEM_ACCOUNTING_NO_TAG;
+static wmem_accounting_t *accountings = NULL;
+static wmem_accounting_t *last_accounting = NULL;
+
+void
+wmem_accounting_enable(void)
+{
+    wmem_accounting_on = TRUE;
+}
+
+gboolean
+wmem_accounting_enabled(void)
+{
+    return wmem_accounting_on;
+}
+
+void
+wmem_allocator_set_name(wmem_allocator_t *allocator, const char *name)
+{
+    allocator->name       = name;
+    allocator->accounting = NULL;
+}
+
+int
+wmem_accounting_set_tag(int tag)
+{
+    int old_tag = current_tag;
+
+    current_tag = tag < 0 ? WMEM_ACCOUNTING_NO_TAG : tag;
+
+    return old_tag;
+}
+
+static wmem_accounting_t *
+wmem_accounting_lookup(const char *name)
+{
+    wmem_accounting_t *acct;
+
+    for (acct = accountings; acct; acct = acct->next) {
+        if (strcmp(acct->name, name) == 0) {
+            return acct;
+        }
+    }
+
+    acct = wmem_new0(NULL, wmem_accounting_t);
+    acct->name = name;
+    if (last_accounting) {
+        last_accounting->next = acct;
+    }
+    else {
+        accountings = acct;
+    }
+    last_accounting = acct;
+
+    return acct;
+}
+
+void
+wmem_accounting_count(wmem_allocator_t *allocator, const size_t size,
+        gboolean new_object)
+{
+    wmem_accounting_t        *acct = allocator->accounting;
+    wmem_accounting_counts_t *counts;
+    guint                     idx = current_tag + 1;
+
+    if (acct == NULL) {
+        acct = wmem_accounting_lookup(allocator->name);
+        allocator->accounting = acct;
+    }
+
+    if (idx >= acct->num_counts) {
+        guint num_counts = MAX(idx + 1, acct->num_counts * 2);
+
+        acct->counts = (wmem_accounting_counts_t *)wmem_realloc(NULL,
+                acct->counts, num_counts * sizeof(wmem_accounting_counts_t));
+        memset(acct->counts + acct->num_counts, 0,
+                (num_counts - acct->num_counts) * sizeof(wmem_accounting_counts_t));
+        acct->num_counts = num_counts;
+    }
+
+    counts = &acct->counts[idx];
+    if (new_object) {
+        counts->objects++;
+        counts->total_objects++;
+    }
+    counts->bytes       += size;
+    counts->total_bytes += size;
+}
+
+void
+wmem_accounting_free_all(wmem_allocator_t *allocator)
+{
+    wmem_accounting_t *acct = allocator->accounting;
+    guint              i;
+
+    for (i = 0; i < acct->num_counts; i++) {
+        acct->counts[i].objects = 0;
+        acct->counts[i].bytes   = 0;
+    }
+}
+
+void
+wmem_accounting_foreach(wmem_accounting_func func, void *user_data)
+{
+    wmem_accounting_t *acct;
+    guint              i;
+
+    for (acct = accountings; acct; acct = acct->next) {
+        for (i = 0; i < acct->num_counts; i++) {
+            if (acct->counts[i].total_objects || acct->counts[i].total_bytes) {
+                func(acct->name, (int)i - 1, &acct->counts[i], user_data);
+            }
+        }
+    }
+}
+
+void
+wmem_accounting_cleanup(void)
+{
+    wmem_accounting_t *acct;
+
+    while (accountings) {
+        acct = accountings;
+        accountings = acct->next;
+        wmem_free(NULL, acct->counts);
+        wmem_free(NULL, acct);
+    }
+    last_accounting = NULL;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,120 @@
+/* wmem_accounting.h
+ * Definitions for the Wireshark Memory Manager Accounting
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WMEM_ACCOUNTING_H__
+#define __WMEM_ACCOUNTING_H__
+
+#include <glib.h>
+
+#include "wmem_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @addtogroup wmem
+ *  @{
+ *    @defgroup wmem-accounting Accounting
+ *
+ *    Counts the objects and bytes allocated from named allocators, broken
+ *    down by a tag that says who is allocating, e.g. the protocol being
+ *    dissected. Allocators with the same name share their counts. It is off
+ *    unless turned on, and costs a single test per allocation while off.
+ *
+ *    Only what is asked for is counted: reallocations count their new size
+ *    again, and memory given back with wmem_free() isn't subtracted.
+ *
+ *    @{
+ */
+
+/** The tag of allocations nobody in particular is responsible for. */
+#define WMEM_ACCOUNTING_NO_TAG (-1)
+
+typedef struct _wmem_accounting_counts_t {
+    guint64 objects;       /**< Allocated since an allocator with the name
+                                was last freed */
+    guint64 bytes;
+    guint64 total_objects; /**< Allocated since accounting was turned on */
+    guint64 total_bytes;
+} wmem_accounting_counts_t;
+
+/** Function signature for wmem_accounting_foreach(). */
+typedef void (*wmem_accounting_func)(const char *name, int tag,
+        const wmem_accounting_counts_t *counts, void *user_data);
+
+/** Turn accounting on. It can't be turned off again. */
+WS_DLL_PUBLIC
+void
+wmem_accounting_enable(void);
+
+/** Returns TRUE if accounting has been turned on. */
+WS_DLL_PUBLIC
+gboolean
+wmem_accounting_enabled(void);
+
+/** Give an allocator a name, under which what is allocated from it is
+ * counted. Allocators without one aren't counted.
+ *
+ * @param allocator The allocator.
+ * @param name      The name, which must outlive the allocator.
+ */
+WS_DLL_PUBLIC
+void
+wmem_allocator_set_name(wmem_allocator_t *allocator, const char *name);
+
+/** Set the tag allocations are counted under from now on.
+ *
+ * @param tag A non-negative number, or WMEM_ACCOUNTING_NO_TAG.
+ * @return    The previous tag, to be put back when done.
+ */
+WS_DLL_PUBLIC
+int
+wmem_accounting_set_tag(int tag);
+
+/** Call a function for each name and tag anything has been counted under,
+ * in the order the names were first used and then by tag.
+ */
+WS_DLL_PUBLIC
+void
+wmem_accounting_foreach(wmem_accounting_func func, void *user_data);
+
+/**   @}
+ *  @} */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WMEM_ACCOUNTING_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
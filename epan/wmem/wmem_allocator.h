@@ -32,6 +32,7 @@ extern "C" {
 #endif /* __cplusplus */
 
 struct _wmem_user_cb_container_t;
+struct _wmem_accounting_t;
 
 /* See section "4. Internal Design" of doc/README.wmem for details
  * on this structure */
@@ -49,6 +50,10 @@ struct _wmem_allocator_t {
     /* Callback List */
     struct _wmem_user_cb_container_t *callbacks;
 
+    /* Accounting, see wmem_accounting.c */
+    const char                *name;
+    struct _wmem_accounting_t *accounting;
+
     /* Implementation details */
     void                        *private_data;
     enum _wmem_allocator_type_t  type;
@@ -26,6 +26,7 @@
 #include <glib.h>
 
 #include "wmem_core.h"
+#include "wmem_accounting_int.h"
 #include "wmem_scopes.h"
 #include "wmem_map_int.h"
 #include "wmem_user_cb_int.h"
@@ -53,6 +54,10 @@ wmem_alloc(wmem_allocator_t *allocator, const size_t size)
         return NULL;
     }
 
+    if (G_UNLIKELY(wmem_accounting_on) && allocator->name) {
+        wmem_accounting_count(allocator, size, TRUE);
+    }
+
     return allocator->alloc(allocator->private_data, size);
 }
 
@@ -105,6 +110,10 @@ wmem_realloc(wmem_allocator_t *allocator, void *ptr, const size_t size)
 
     g_assert(allocator->in_scope);
 
+    if (G_UNLIKELY(wmem_accounting_on) && allocator->name) {
+        wmem_accounting_count(allocator, size, FALSE);
+    }
+
     return allocator->realloc(allocator->private_data, ptr, size);
 }
 
@@ -114,6 +123,9 @@ wmem_free_all_real(wmem_allocator_t *allocator, gboolean final)
     wmem_call_callbacks(allocator,
             final ? WMEM_CB_DESTROY_EVENT : WMEM_CB_FREE_EVENT);
     allocator->free_all(allocator->private_data);
+    if (allocator->accounting) {
+        wmem_accounting_free_all(allocator);
+    }
 }
 
 void
@@ -152,8 +164,10 @@ wmem_allocator_new(const wmem_allocator_type_t type)
 
     allocator = wmem_new(NULL, wmem_allocator_t);
     allocator->type      = real_type;
-    allocator->callbacks = NULL;
-    allocator->in_scope  = TRUE;
+    allocator->callbacks  = NULL;
+    allocator->in_scope   = TRUE;
+    allocator->name       = NULL;
+    allocator->accounting = NULL;
 
     switch (real_type) {
         case WMEM_ALLOCATOR_SIMPLE:
@@ -221,6 +235,7 @@ void
 wmem_cleanup(void)
 {
     wmem_cleanup_scopes();
+    wmem_accounting_cleanup();
 }
 
 /*
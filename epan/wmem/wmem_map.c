@@ -21,13 +21,24 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include "config.h"
+
+#include <string.h>
+
 #include <glib.h>
 
+#include <wsutil/bits_ctz.h>
+
 #include "wmem_core.h"
 #include "wmem_map.h"
 #include "wmem_map_int.h"
 
-static guint32 x; /* Used for universal integer hashing (see the HASH macro) */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WMEM_MAP_SSE2
+#endif
+
+static guint64 x; /* Used for universal integer hashing (see the HASH macro) */
 
 /* Used for the wmem_strong_hash() function */
 static guint32 preseed;
@@ -36,19 +47,32 @@ static guint32 postseed;
 void
 wmem_init_hashing(void)
 {
-    x = g_random_int();
-    if G_UNLIKELY(x == 0)
-        x = 1;
+    /* odd, so that multiplying by it loses no bits */
+    x = ((guint64)g_random_int() << 32 | g_random_int()) | 1;
 
     preseed  = g_random_int();
     postseed = g_random_int();
 }
 
-typedef struct _wmem_map_item_t {
+/* The map is an open-addressing table along the lines of Google's "Swiss
+ * table". Alongside the slots is an array with a control byte per slot,
+ * which says whether the slot is empty, has been deleted from, or is full,
+ * in which case it holds 7 bits of the key's hash. A lookup compares a group
+ * of 16 control bytes with those bits at once, with SSE2 where available,
+ * and only calls the equality function on the slots that match, so that it
+ * rarely has to look at more than one group and one key.
+ *
+ * The control bytes of the first group are repeated after the last slot,
+ * so that a group can start at any slot. */
+#define GROUP_WIDTH 16
+
+#define CTRL_EMPTY   ((guint8)0x80)
+#define CTRL_DELETED ((guint8)0xFE)
+
+typedef struct _wmem_map_slot_t {
     const void *key;
     void *value;
-    struct _wmem_map_item_t *next;
-} wmem_map_item_t;
+} wmem_map_slot_t;
 
 struct _wmem_map_t {
     guint count; /* number of items stored */
@@ -59,7 +83,12 @@ struct _wmem_map_t {
      * logarithms is expensive. */
     guint capacity;
 
-    wmem_map_item_t **table;
+    /* number of empty slots that can still be filled before the table has
+     * to grow; deleted slots can be filled again at no cost */
+    guint growth_left;
+
+    wmem_map_slot_t *slots;
+    guint8          *ctrl;
 
     GHashFunc  hash_func;
     GEqualFunc eql_func;
@@ -75,11 +104,83 @@ struct _wmem_map_t {
  * do the 2^x operation. */
 #define CAPACITY(MAP) ((guint)(1 << (MAP)->capacity))
 
+/* The table is kept at most 7/8 full, counting deleted slots, so that every
+ * probe sequence ends at an empty slot. */
+#define MAX_LOAD(CAP) ((CAP) - (CAP) / 8)
+
 /* Efficient universal integer hashing:
  * https://en.wikipedia.org/wiki/Universal_hashing#Avoiding_modular_arithmetic
- */
-#define HASH(MAP, KEY) \
-    ((guint32)(((MAP)->hash_func(KEY) * x) >> (32 - (MAP)->capacity)))
+ * The top 7 bits go in the control byte, the bits below them pick the
+ * slot to start probing at. */
+#define HASH(MAP, KEY) ((guint64)(MAP)->hash_func(KEY) * x)
+#define H1(MAP, H)     ((guint)(((H) << 7) >> (64 - (MAP)->capacity)))
+#define H2(H)          ((guint8)((H) >> 57))
+
+/* Bit i of the result is set if control byte i of the group matches */
+#ifdef WMEM_MAP_SSE2
+static inline guint32
+group_match(const guint8 *group, guint8 h2)
+{
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+
+    return (guint32)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h2)));
+}
+
+static inline guint32
+group_match_empty_or_deleted(const guint8 *group)
+{
+    /* those are the control bytes with the top bit set */
+    return (guint32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+}
+#else
+static inline guint32
+group_match(const guint8 *group, guint8 h2)
+{
+    guint32 mask = 0;
+    int     i;
+
+    for (i = 0; i < GROUP_WIDTH; i++) {
+        if (group[i] == h2)
+            mask |= 1 << i;
+    }
+    return mask;
+}
+
+static inline guint32
+group_match_empty_or_deleted(const guint8 *group)
+{
+    guint32 mask = 0;
+    int     i;
+
+    for (i = 0; i < GROUP_WIDTH; i++) {
+        if (group[i] & 0x80)
+            mask |= 1 << i;
+    }
+    return mask;
+}
+#endif
+
+#define group_match_empty(GROUP) group_match((GROUP), CTRL_EMPTY)
+
+static inline void
+set_ctrl(wmem_map_t *map, guint i, guint8 ctrl)
+{
+    map->ctrl[i] = ctrl;
+    if (i < GROUP_WIDTH)
+        map->ctrl[CAPACITY(map) + i] = ctrl;
+}
+
+static void
+wmem_map_alloc_table(wmem_map_t *map)
+{
+    guint cap = CAPACITY(map);
+
+    map->slots = (wmem_map_slot_t *)wmem_alloc(map->allocator,
+            cap * sizeof(wmem_map_slot_t) + cap + GROUP_WIDTH);
+    map->ctrl  = (guint8 *)(map->slots + cap);
+    memset(map->ctrl, CTRL_EMPTY, cap + GROUP_WIDTH);
+    map->growth_left = MAX_LOAD(cap) - map->count;
+}
 
 wmem_map_t *
 wmem_map_new(wmem_allocator_t *allocator,
@@ -91,79 +192,121 @@ wmem_map_new(wmem_allocator_t *allocator,
 
     map->count     = 0;
     map->capacity  = WMEM_MAP_DEFAULT_CAPACITY;
-    map->table     = wmem_alloc0_array(allocator, wmem_map_item_t*, CAPACITY(map));
     map->hash_func = hash_func;
     map->eql_func  = eql_func;
     map->allocator = allocator;
 
+    wmem_map_alloc_table(map);
+
     return map;
 }
 
-static inline void
-wmem_map_grow(wmem_map_t *map)
+/* Probe groups at triangular offsets, which visits every group of a table
+ * whose size is a power of two. */
+#define PROBE_START(MAP, H, POS, STEP) \
+    ((POS) = H1((MAP), (H)), (STEP) = 0)
+#define PROBE_NEXT(MAP, POS, STEP) \
+    ((STEP) += GROUP_WIDTH, (POS) = ((POS) + (STEP)) & (CAPACITY(MAP) - 1))
+
+/* The slot holding the key, or -1 */
+static inline gint
+wmem_map_find(wmem_map_t *map, const void *key, guint64 h)
+{
+    guint   pos, step, i;
+    guint32 mask;
+
+    for (PROBE_START(map, h, pos, step); ; PROBE_NEXT(map, pos, step)) {
+        for (mask = group_match(map->ctrl + pos, H2(h)); mask; mask &= mask - 1) {
+            i = (pos + ws_ctz(mask)) & (CAPACITY(map) - 1);
+            if (map->eql_func(key, map->slots[i].key)) {
+                return (gint)i;
+            }
+        }
+        if (group_match_empty(map->ctrl + pos)) {
+            return -1;
+        }
+    }
+}
+
+/* The first slot a key with the given hash can go in */
+static inline guint
+wmem_map_find_free(wmem_map_t *map, guint64 h)
+{
+    guint   pos, step;
+    guint32 mask;
+
+    for (PROBE_START(map, h, pos, step); ; PROBE_NEXT(map, pos, step)) {
+        mask = group_match_empty_or_deleted(map->ctrl + pos);
+        if (mask) {
+            return (pos + ws_ctz(mask)) & (CAPACITY(map) - 1);
+        }
+    }
+}
+
+/* Move the items to a new table, twice the size unless it's the deleted
+ * slots that filled this one up. */
+static void
+wmem_map_rehash(wmem_map_t *map)
 {
-    wmem_map_item_t **old_table, *cur, *nxt;
-    guint             old_cap, i, slot;
+    wmem_map_slot_t *old_slots;
+    guint8          *old_ctrl;
+    guint            old_cap, i, slot;
+    guint64          h;
 
-    /* store the old table and capacity */
-    old_table = map->table;
+    old_slots = map->slots;
+    old_ctrl  = map->ctrl;
     old_cap   = CAPACITY(map);
 
-    /* double the size (capacity is base-2 logarithm, so this just means
-     * increment it) and allocate new table */
-    map->capacity++;
-    map->table = wmem_alloc0_array(map->allocator, wmem_map_item_t*, CAPACITY(map));
-
-    /* copy all the elements over from the old table */
-    for (i=0; i<old_cap; i++) {
-        cur = old_table[i];
-        while (cur) {
-            nxt              = cur->next;
-            slot             = HASH(map, cur->key);
-            cur->next        = map->table[slot];
-            map->table[slot] = cur;
-            cur              = nxt;
+    if (map->count >= MAX_LOAD(old_cap) / 2) {
+        map->capacity++;
+    }
+    wmem_map_alloc_table(map);
+
+    for (i = 0; i < old_cap; i++) {
+        if (!(old_ctrl[i] & 0x80)) {
+            h    = HASH(map, old_slots[i].key);
+            slot = wmem_map_find_free(map, h);
+            set_ctrl(map, slot, H2(h));
+            map->slots[slot] = old_slots[i];
         }
     }
 
-    /* free the old table */
-    wmem_free(map->allocator, old_table);
+    wmem_free(map->allocator, old_slots);
 }
 
 void *
 wmem_map_insert(wmem_map_t *map, const void *key, void *value)
 {
-    wmem_map_item_t **item;
-    void *old_val;
-
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
-
-    /* check existing items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* replace and return old value for this key */
-            old_val = (*item)->value;
-            (*item)->value = value;
-            return old_val;
-        }
-        item = &((*item)->next);
+    guint64 h;
+    gint    found;
+    guint   slot;
+    void   *old_val;
+
+    h = HASH(map, key);
+
+    /* replace and return old value for an existing key */
+    found = wmem_map_find(map, key, h);
+    if (found >= 0) {
+        old_val = map->slots[found].value;
+        map->slots[found].value = value;
+        return old_val;
     }
 
-    /* insert new item */
-    (*item) = wmem_new(map->allocator, wmem_map_item_t);
-
-    (*item)->key   = key;
-    (*item)->value = value;
-    (*item)->next  = NULL;
+    slot = wmem_map_find_free(map, h);
+    if (map->ctrl[slot] == CTRL_EMPTY) {
+        /* make room if we are about to be over-full */
+        if (map->growth_left == 0) {
+            wmem_map_rehash(map);
+            slot = wmem_map_find_free(map, h);
+        }
+        map->growth_left--;
+    }
 
+    set_ctrl(map, slot, H2(h));
+    map->slots[slot].key   = key;
+    map->slots[slot].value = value;
     map->count++;
 
-    /* increase size if we are over-full */
-    if (map->count >= CAPACITY(map)) {
-        wmem_map_grow(map);
-    }
-
     /* no previous entry, return NULL */
     return NULL;
 }
@@ -171,47 +314,49 @@ wmem_map_insert(wmem_map_t *map, const void *key, void *value)
 void *
 wmem_map_lookup(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t *item;
-
-    /* find correct slot */
-    item = map->table[HASH(map, key)];
+    gint found;
 
-    /* scan list of items in this slot for the correct value */
-    while (item) {
-        if (map->eql_func(key, item->key)) {
-            return item->value;
-        }
-        item = item->next;
-    }
+    found = wmem_map_find(map, key, HASH(map, key));
 
-    return NULL;
+    return found >= 0 ? map->slots[found].value : NULL;
 }
 
 void *
 wmem_map_remove(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t **item, *tmp;
-    void *value;
+    gint     found;
+    guint    before;
+    guint32  empty_before, empty_after;
+    int      run;
+
+    found = wmem_map_find(map, key, HASH(map, key));
+    if (found < 0) {
+        /* didn't find it */
+        return NULL;
+    }
 
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
-
-    /* check the items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* found it */
-            tmp     = (*item);
-            value   = tmp->value;
-            (*item) = tmp->next;
-            wmem_free(map->allocator, tmp);
-            map->count--;
-            return value;
-        }
-        item = &((*item)->next);
+    /* If there's an empty slot less than a group away on either side, no
+     * probe can have gone past this slot while it was full, so it can be
+     * made empty again rather than deleted. */
+    before       = (found - GROUP_WIDTH) & (CAPACITY(map) - 1);
+    empty_before = group_match_empty(map->ctrl + before);
+    empty_after  = group_match_empty(map->ctrl + found);
+    if (empty_before && empty_after) {
+        for (run = 0; !(empty_before & (1 << (GROUP_WIDTH - 1 - run))); run++)
+            ;
+        run += ws_ctz(empty_after);
+    } else {
+        run = GROUP_WIDTH;
+    }
+    if (run < GROUP_WIDTH) {
+        set_ctrl(map, found, CTRL_EMPTY);
+        map->growth_left++;
+    } else {
+        set_ctrl(map, found, CTRL_DELETED);
     }
 
-    /* didn't find it */
-    return NULL;
+    map->count--;
+    return map->slots[found].value;
 }
 
 /* Borrowed from Perl 5.18. This is based on Bob Jenkin's one-at-a-time
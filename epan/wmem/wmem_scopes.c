@@ -24,6 +24,7 @@
 #include <glib.h>
 
 #include "wmem_core.h"
+#include "wmem_accounting.h"
 #include "wmem_scopes.h"
 #include "wmem_allocator.h"
 
@@ -139,6 +140,10 @@ wmem_init_scopes(void)
     file_scope   = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
     epan_scope   = wmem_allocator_new(WMEM_ALLOCATOR_SIMPLE);
 
+    wmem_allocator_set_name(packet_scope, "packet");
+    wmem_allocator_set_name(file_scope,   "file");
+    wmem_allocator_set_name(epan_scope,   "epan");
+
     /* Scopes are initialized to TRUE by default on creation */
     packet_scope->in_scope = FALSE;
     file_scope->in_scope   = FALSE;
@@ -0,0 +1,163 @@
+/* wmem_slab.c
+ * Wireshark Memory Manager Slab
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "wmem_core.h"
+#include "wmem_allocator.h"
+#include "wmem_slab.h"
+#include "wmem_user_cb.h"
+
+/* The same alignment as the block allocators give */
+#define WMEM_ALIGN_AMOUNT (2 * sizeof (gsize))
+#define WMEM_ALIGN_SIZE(SIZE) ((~(WMEM_ALIGN_AMOUNT-1)) & \
+        ((SIZE) + (WMEM_ALIGN_AMOUNT-1)))
+
+/* Objects are cut out of pages of about this size. Small enough that a
+ * packet with a short protocol tree doesn't waste much, big enough that
+ * one with a long one only takes a few allocations. */
+#define WMEM_SLAB_PAGE_SIZE (16 * 1024)
+
+typedef struct _wmem_slab_free_t {
+    struct _wmem_slab_free_t *next;
+} wmem_slab_free_t;
+
+struct _wmem_slab_t {
+    wmem_allocator_t *allocator;
+    size_t            chunk_size;
+    size_t            page_size;
+    guint8           *pos;       /* the next object in the current page */
+    guint8           *end;       /* the end of the current page */
+    wmem_slab_free_t *free_list;
+    gboolean          passthrough;
+    guint             cb_id;
+};
+
+static gboolean
+wmem_slab_cb(wmem_allocator_t *allocator _U_, wmem_cb_event_t event,
+        void *user_data)
+{
+    wmem_slab_t *slab = (wmem_slab_t *)user_data;
+
+    if (event == WMEM_CB_DESTROY_EVENT) {
+        wmem_free(NULL, slab);
+        return FALSE;
+    }
+
+    /* The pages are gone along with everything else */
+    slab->pos       = NULL;
+    slab->end       = NULL;
+    slab->free_list = NULL;
+    return TRUE;
+}
+
+wmem_slab_t *
+wmem_slab_new(wmem_allocator_t *allocator, const size_t chunk_size)
+{
+    wmem_slab_t *slab;
+
+    slab = wmem_new(NULL, wmem_slab_t);
+
+    slab->allocator  = allocator;
+    slab->chunk_size = WMEM_ALIGN_SIZE(MAX(chunk_size, sizeof(wmem_slab_free_t)));
+    slab->page_size  = MAX(WMEM_SLAB_PAGE_SIZE / slab->chunk_size, 1) * slab->chunk_size;
+    slab->pos        = NULL;
+    slab->end        = NULL;
+    slab->free_list  = NULL;
+
+    /* Leave the allocators meant for debugging to see every object */
+    slab->passthrough = allocator->type == WMEM_ALLOCATOR_SIMPLE ||
+                        allocator->type == WMEM_ALLOCATOR_STRICT;
+
+    slab->cb_id = wmem_register_callback(allocator, wmem_slab_cb, slab);
+
+    return slab;
+}
+
+void
+wmem_destroy_slab(wmem_slab_t *slab)
+{
+    wmem_unregister_callback(slab->allocator, slab->cb_id);
+    wmem_free(NULL, slab);
+}
+
+void *
+wmem_slab_alloc(wmem_slab_t *slab)
+{
+    void *ptr;
+
+    if (slab->free_list) {
+        ptr = slab->free_list;
+        slab->free_list = slab->free_list->next;
+        return ptr;
+    }
+
+    if (slab->pos == slab->end) {
+        if (slab->passthrough) {
+            return wmem_alloc(slab->allocator, slab->chunk_size);
+        }
+        slab->pos = (guint8 *)wmem_alloc(slab->allocator, slab->page_size);
+        slab->end = slab->pos + slab->page_size;
+    }
+
+    ptr = slab->pos;
+    slab->pos += slab->chunk_size;
+    return ptr;
+}
+
+void *
+wmem_slab_alloc0(wmem_slab_t *slab)
+{
+    return memset(wmem_slab_alloc(slab), 0, slab->chunk_size);
+}
+
+void
+wmem_slab_free(wmem_slab_t *slab, void *ptr)
+{
+    wmem_slab_free_t *chunk;
+
+    if (slab->passthrough) {
+        wmem_free(slab->allocator, ptr);
+        return;
+    }
+
+    chunk = (wmem_slab_free_t *)ptr;
+    chunk->next = slab->free_list;
+    slab->free_list = chunk;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
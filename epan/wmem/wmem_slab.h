@@ -0,0 +1,138 @@
+/* wmem_slab.h
+ * Definitions for the Wireshark Memory Manager Slab
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WMEM_SLAB_H__
+#define __WMEM_SLAB_H__
+
+#include <glib.h>
+
+#include "wmem_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @addtogroup wmem
+ *  @{
+ *    @defgroup wmem-slab Slab
+ *
+ *    A front end to an allocator for many objects of one size. Objects are
+ *    cut out of pages allocated from the allocator by bumping a pointer, so
+ *    they have no per-object header and cost no call into the allocator, and
+ *    they go away all at once with the rest of the allocator's memory when it
+ *    is freed. Objects freed before then are kept on a free list and handed
+ *    out again first.
+ *
+ *    Unlike other wmem data structures, a slab outlives wmem_free_all() on its
+ *    allocator, so that it can be set up once for a pool that is emptied after
+ *    each packet. It is destroyed along with the allocator, or earlier with
+ *    wmem_destroy_slab().
+ *
+ *    With the simple and strict allocators, which exist to find memory errors,
+ *    every object is allocated from the allocator on its own.
+ *
+ *    @{
+ */
+
+struct _wmem_slab_t;
+typedef struct _wmem_slab_t wmem_slab_t;
+
+/** Creates a slab handing out objects of the given size from the given
+ * allocator.
+ *
+ * @param allocator The allocator the objects are allocated from.
+ * @param chunk_size The size of every object.
+ * @return The new slab.
+ */
+WS_DLL_PUBLIC
+wmem_slab_t *
+wmem_slab_new(wmem_allocator_t *allocator, const size_t chunk_size)
+G_GNUC_MALLOC;
+
+/** Creates a slab handing out objects of the given type.
+ *
+ * @param allocator The allocator the objects are allocated from.
+ * @param type The type of the objects.
+ * @return The new slab.
+ */
+#define wmem_slab_new_type(allocator, type) \
+    wmem_slab_new((allocator), sizeof(type))
+
+/** Destroys a slab. Objects allocated with it are not freed until its
+ * allocator is.
+ *
+ * @param slab The slab to destroy.
+ */
+WS_DLL_PUBLIC
+void
+wmem_destroy_slab(wmem_slab_t *slab);
+
+/** Allocates an object.
+ *
+ * @param slab The slab to allocate from.
+ * @return The new, uninitialized, object.
+ */
+WS_DLL_PUBLIC
+void *
+wmem_slab_alloc(wmem_slab_t *slab)
+G_GNUC_MALLOC;
+
+/** Allocates an object and zeroes it.
+ *
+ * @param slab The slab to allocate from.
+ * @return The new object.
+ */
+WS_DLL_PUBLIC
+void *
+wmem_slab_alloc0(wmem_slab_t *slab)
+G_GNUC_MALLOC;
+
+/** Returns an object to the slab, to be handed out again.
+ *
+ * @param slab The slab the object was allocated from.
+ * @param ptr The object.
+ */
+WS_DLL_PUBLIC
+void
+wmem_slab_free(wmem_slab_t *slab, void *ptr);
+
+/**   @}
+ *  @} */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WMEM_SLAB_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -52,6 +52,8 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
     allocator->type = type;
     allocator->callbacks = NULL;
     allocator->in_scope = TRUE;
+    allocator->name = NULL;
+    allocator->accounting = NULL;
 
     switch (type) {
         case WMEM_ALLOCATOR_SIMPLE:
@@ -377,6 +379,127 @@ wmem_test_allocator_strict(void)
     wmem_test_allocator_jumbo(WMEM_ALLOCATOR_STRICT, &wmem_strict_check_canaries);
 }
 
+#define SLAB_CHUNK_WORDS 6
+
+static void
+wmem_test_slab_type(wmem_allocator_type_t type)
+{
+    wmem_allocator_t *allocator;
+    wmem_slab_t      *slab, *extra_slab;
+    guint32          *ptrs[MAX_SIMULTANEOUS_ALLOCS];
+    guint32          *ptr;
+    int               i, j, round;
+
+    allocator = wmem_allocator_force_new(type);
+    slab = wmem_slab_new(allocator, SLAB_CHUNK_WORDS * sizeof(guint32));
+
+    /* the slab has to work the same after each free_all */
+    for (round = 0; round < 3; round++) {
+        for (i = 0; i < MAX_SIMULTANEOUS_ALLOCS; i++) {
+            ptrs[i] = (guint32 *)wmem_slab_alloc(slab);
+            g_assert(((gsize)ptrs[i] & (sizeof(gsize) - 1)) == 0);
+            for (j = 0; j < SLAB_CHUNK_WORDS; j++) {
+                ptrs[i][j] = (guint32)i;
+            }
+        }
+        for (i = 0; i < MAX_SIMULTANEOUS_ALLOCS; i++) {
+            for (j = 0; j < SLAB_CHUNK_WORDS; j++) {
+                g_assert(ptrs[i][j] == (guint32)i);
+            }
+        }
+
+        wmem_slab_free(slab, ptrs[5]);
+        wmem_slab_free(slab, ptrs[7]);
+        ptr = (guint32 *)wmem_slab_alloc0(slab);
+        for (j = 0; j < SLAB_CHUNK_WORDS; j++) {
+            g_assert(ptr[j] == 0);
+        }
+        if (type != WMEM_ALLOCATOR_STRICT) {
+            g_assert(ptr == ptrs[7]);
+            g_assert(wmem_slab_alloc(slab) == ptrs[5]);
+        }
+        g_assert(ptrs[6][0] == 6);
+
+        wmem_free_all(allocator);
+    }
+
+    /* a slab can go before its allocator... */
+    extra_slab = wmem_slab_new_type(allocator, double);
+    *(double *)wmem_slab_alloc(extra_slab) = 1.0;
+    wmem_destroy_slab(extra_slab);
+    wmem_free_all(allocator);
+
+    /* ...or along with it */
+    wmem_slab_alloc(slab);
+    wmem_destroy_allocator(allocator);
+}
+
+static void
+wmem_test_slab(void)
+{
+    wmem_test_slab_type(WMEM_ALLOCATOR_BLOCK_FAST);
+    wmem_test_slab_type(WMEM_ALLOCATOR_BLOCK);
+    wmem_test_slab_type(WMEM_ALLOCATOR_STRICT);
+}
+
+static wmem_accounting_counts_t accounting_seen[3];
+
+static void
+wmem_test_accounting_cb(const char *name, int tag,
+        const wmem_accounting_counts_t *counts, void *user_data)
+{
+    g_assert(user_data == expected_user_data);
+
+    if (strcmp(name, "test") == 0) {
+        g_assert(tag == WMEM_ACCOUNTING_NO_TAG || tag == 1);
+        accounting_seen[tag + 1] = *counts;
+    }
+}
+
+static void
+wmem_test_accounting(void)
+{
+    wmem_allocator_t *allocator, *other;
+    void             *ptr;
+    int               old_tag;
+
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_STRICT);
+    other     = wmem_allocator_force_new(WMEM_ALLOCATOR_STRICT);
+    wmem_allocator_set_name(allocator, "test");
+    expected_user_data = GINT_TO_POINTER(g_test_rand_int());
+
+    wmem_accounting_enable();
+    g_assert(wmem_accounting_enabled());
+
+    old_tag = wmem_accounting_set_tag(1);
+    wmem_alloc(allocator, 10);
+    ptr = wmem_alloc(allocator, 20);
+    wmem_realloc(allocator, ptr, 30);
+    wmem_alloc(other, 100);
+    g_assert(wmem_accounting_set_tag(WMEM_ACCOUNTING_NO_TAG) == 1);
+    wmem_alloc(allocator, 5);
+
+    memset(accounting_seen, 0, sizeof(accounting_seen));
+    wmem_accounting_foreach(wmem_test_accounting_cb, expected_user_data);
+    g_assert(accounting_seen[0].objects == 1);
+    g_assert(accounting_seen[0].bytes   == 5);
+    g_assert(accounting_seen[2].objects == 2);
+    g_assert(accounting_seen[2].bytes   == 60);
+    g_assert(accounting_seen[1].total_objects == 0);
+
+    /* freeing the allocator keeps only the totals */
+    wmem_free_all(allocator);
+    memset(accounting_seen, 0, sizeof(accounting_seen));
+    wmem_accounting_foreach(wmem_test_accounting_cb, expected_user_data);
+    g_assert(accounting_seen[2].objects       == 0);
+    g_assert(accounting_seen[2].total_objects == 2);
+    g_assert(accounting_seen[2].total_bytes   == 60);
+
+    wmem_accounting_set_tag(old_tag);
+    wmem_destroy_allocator(other);
+    wmem_destroy_allocator(allocator);
+}
+
 /* UTILITY TESTING FUNCTIONS (/wmem/utils/) */
 
 static void
@@ -658,6 +781,22 @@ wmem_test_map(void)
         ret = wmem_map_remove(map, GINT_TO_POINTER(i));
         g_assert(ret == NULL);
     }
+    /* removing and reinserting, so that the table fills up with deleted
+     * slots */
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(i));
+    }
+    for (i=0; i<CONTAINER_ITERS*4; i++) {
+        ret = wmem_map_remove(map, GINT_TO_POINTER(i));
+        g_assert(ret == GINT_TO_POINTER(i));
+        ret = wmem_map_insert(map, GINT_TO_POINTER(i+CONTAINER_ITERS),
+                GINT_TO_POINTER(i+CONTAINER_ITERS));
+        g_assert(ret == NULL);
+    }
+    for (i=0; i<CONTAINER_ITERS*5; i++) {
+        ret = wmem_map_lookup(map, GINT_TO_POINTER(i));
+        g_assert(ret == (i < CONTAINER_ITERS*4 ? NULL : GINT_TO_POINTER(i)));
+    }
     wmem_free_all(allocator);
 
     map = wmem_map_new(allocator, wmem_str_hash, g_str_equal);
@@ -782,6 +921,10 @@ wmem_test_strbuf(void)
     g_assert_cmpstr(wmem_strbuf_get_str(strbuf), ==, "TES");
     g_assert(wmem_strbuf_get_len(strbuf) == 3);
 
+    wmem_strbuf_append_len(strbuf, "TING", 2);
+    g_assert_cmpstr(wmem_strbuf_get_str(strbuf), ==, "TESTI");
+    g_assert(wmem_strbuf_get_len(strbuf) == 5);
+
     strbuf = wmem_strbuf_sized_new(allocator, 10, 10);
     g_assert(strbuf);
     g_assert_cmpstr(wmem_strbuf_get_str(strbuf), ==, "");
@@ -799,6 +942,10 @@ wmem_test_strbuf(void)
     g_assert_cmpstr(wmem_strbuf_get_str(strbuf), ==, "FUZZ3abcd");
     g_assert(wmem_strbuf_get_len(strbuf) == 9);
 
+    wmem_strbuf_append_len(strbuf, "abcdefghijklmnopqrstuvwxyz", 26);
+    g_assert_cmpstr(wmem_strbuf_get_str(strbuf), ==, "FUZZ3abcd");
+    g_assert(wmem_strbuf_get_len(strbuf) == 9);
+
     wmem_strbuf_append_c(strbuf, 'q');
     g_assert_cmpstr(wmem_strbuf_get_str(strbuf), ==, "FUZZ3abcd");
     g_assert(wmem_strbuf_get_len(strbuf) == 9);
@@ -829,11 +976,17 @@ wmem_test_strbuf(void)
     wmem_destroy_allocator(allocator);
 }
 
+static wmem_tree_t *
+wmem_test_new_tree(wmem_allocator_t *allocator, gboolean btree)
+{
+    return btree ? wmem_tree_new_btree(allocator) : wmem_tree_new(allocator);
+}
+
 static void
-wmem_test_tree(void)
+wmem_test_tree_type(gboolean btree)
 {
     wmem_allocator_t   *allocator, *extra_allocator;
-    wmem_tree_t        *tree;
+    wmem_tree_t        *tree, *other;
     guint32             i;
     int                 seen_values = 0;
     int                 j;
@@ -846,7 +999,7 @@ wmem_test_tree(void)
     allocator       = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
     extra_allocator = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
 
-    tree = wmem_tree_new(allocator);
+    tree = wmem_test_new_tree(allocator, btree);
     g_assert(tree);
     g_assert(wmem_tree_is_empty(tree));
 
@@ -862,7 +1015,7 @@ wmem_test_tree(void)
     }
     wmem_free_all(allocator);
 
-    tree = wmem_tree_new(allocator);
+    tree = wmem_test_new_tree(allocator, btree);
     for (i=0; i<CONTAINER_ITERS; i++) {
         guint32 rand_int = g_test_rand_int();
         wmem_tree_insert32(tree, rand_int, GINT_TO_POINTER(i));
@@ -870,8 +1023,25 @@ wmem_test_tree(void)
     }
     wmem_free_all(allocator);
 
+    /* test lookups of random keys against a tree of the other kind */
+    tree  = wmem_test_new_tree(allocator, btree);
+    other = wmem_test_new_tree(allocator, !btree);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        guint32 rand_int = g_test_rand_int_range(0, CONTAINER_ITERS * 8);
+        wmem_tree_insert32(tree, rand_int, GINT_TO_POINTER(i));
+        wmem_tree_insert32(other, rand_int, GINT_TO_POINTER(i));
+    }
+    for (i=0; i<CONTAINER_ITERS * 8; i++) {
+        g_assert(wmem_tree_lookup32(tree, i) == wmem_tree_lookup32(other, i));
+        g_assert(wmem_tree_lookup32_le(tree, i) ==
+                wmem_tree_lookup32_le(other, i));
+    }
+    wmem_free_all(allocator);
+
     /* test auto-reset functionality */
-    tree = wmem_tree_new_autoreset(allocator, extra_allocator);
+    tree = btree ?
+        wmem_tree_new_btree_autoreset(allocator, extra_allocator) :
+        wmem_tree_new_autoreset(allocator, extra_allocator);
     for (i=0; i<CONTAINER_ITERS; i++) {
         g_assert(wmem_tree_lookup32(tree, i) == NULL);
         wmem_tree_insert32(tree, i, GINT_TO_POINTER(i));
@@ -885,7 +1055,7 @@ wmem_test_tree(void)
     wmem_free_all(allocator);
 
     /* test array key functionality */
-    tree = wmem_tree_new(allocator);
+    tree = wmem_test_new_tree(allocator, btree);
     key_count = g_random_int_range(1, WMEM_TREE_MAX_KEY_COUNT);
     for (j=0; j<key_count; j++) {
         keys[j].length = g_random_int_range(1, WMEM_TREE_MAX_KEY_LEN);
@@ -901,7 +1071,7 @@ wmem_test_tree(void)
     }
     wmem_free_all(allocator);
 
-    tree = wmem_tree_new(allocator);
+    tree = wmem_test_new_tree(allocator, btree);
     keys[0].length = 1;
     keys[0].key    = wmem_new(allocator, guint32);
     *(keys[0].key) = 0;
@@ -923,7 +1093,7 @@ wmem_test_tree(void)
     wmem_free_all(allocator);
 
     /* test string key functionality */
-    tree = wmem_tree_new(allocator);
+    tree = wmem_test_new_tree(allocator, btree);
     for (i=0; i<CONTAINER_ITERS; i++) {
         str_key = wmem_test_rand_string(allocator, 1, 64);
         wmem_tree_insert_string(tree, str_key, GINT_TO_POINTER(i), 0);
@@ -932,7 +1102,7 @@ wmem_test_tree(void)
     }
     wmem_free_all(allocator);
 
-    tree = wmem_tree_new(allocator);
+    tree = wmem_test_new_tree(allocator, btree);
     for (i=0; i<CONTAINER_ITERS; i++) {
         str_key = wmem_test_rand_string(allocator, 1, 64);
         wmem_tree_insert_string(tree, str_key, GINT_TO_POINTER(i),
@@ -943,7 +1113,7 @@ wmem_test_tree(void)
     wmem_free_all(allocator);
 
     /* test for-each functionality */
-    tree = wmem_tree_new(allocator);
+    tree = wmem_test_new_tree(allocator, btree);
     expected_user_data = GINT_TO_POINTER(g_test_rand_int());
     for (i=0; i<CONTAINER_ITERS; i++) {
         gint tmp;
@@ -982,6 +1152,281 @@ wmem_test_tree(void)
     wmem_destroy_allocator(allocator);
 }
 
+static void
+wmem_test_tree(void)
+{
+    wmem_test_tree_type(FALSE);
+}
+
+static void
+wmem_test_btree(void)
+{
+    wmem_test_tree_type(TRUE);
+}
+
+/* TIMING TESTS (/wmem/timing/), only run in perf mode ("-m perf") */
+
+/* About the size of a proto_node; each round is like dissecting a packet
+ * with a fair sized protocol tree. */
+#define TIMING_CHUNK_SIZE 48
+#define TIMING_CHUNKS     2000
+#define TIMING_ROUNDS     5000
+
+static void
+wmem_time_slab(void)
+{
+    wmem_allocator_t *allocator;
+    wmem_slab_t      *slab;
+    double            pool_time, slab_time;
+    int               i, j;
+
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_BLOCK_FAST);
+
+    g_test_timer_start();
+    for (i = 0; i < TIMING_ROUNDS; i++) {
+        for (j = 0; j < TIMING_CHUNKS; j++) {
+            memset(wmem_alloc(allocator, TIMING_CHUNK_SIZE), 0, TIMING_CHUNK_SIZE);
+        }
+        wmem_free_all(allocator);
+    }
+    pool_time = g_test_timer_elapsed();
+
+    slab = wmem_slab_new(allocator, TIMING_CHUNK_SIZE);
+    g_test_timer_start();
+    for (i = 0; i < TIMING_ROUNDS; i++) {
+        for (j = 0; j < TIMING_CHUNKS; j++) {
+            memset(wmem_slab_alloc(slab), 0, TIMING_CHUNK_SIZE);
+        }
+        wmem_free_all(allocator);
+    }
+    slab_time = g_test_timer_elapsed();
+
+    g_test_message("%d rounds of %d %d-byte allocations: block_fast %.3fs, slab %.3fs",
+            TIMING_ROUNDS, TIMING_CHUNKS, TIMING_CHUNK_SIZE, pool_time, slab_time);
+
+    wmem_destroy_allocator(allocator);
+}
+
+/* The chained hash map wmem_map used to be, to compare with */
+typedef struct _chained_map_item_t {
+    const void *key;
+    void *value;
+    struct _chained_map_item_t *next;
+} chained_map_item_t;
+
+typedef struct {
+    guint count;
+    guint capacity;
+    chained_map_item_t **table;
+    wmem_allocator_t *allocator;
+} chained_map_t;
+
+#define CHAINED_HASH(MAP, KEY) \
+    ((guint32)((g_direct_hash(KEY) * 2654435761U) >> (32 - (MAP)->capacity)))
+
+static chained_map_t *
+chained_map_new(wmem_allocator_t *allocator)
+{
+    chained_map_t *map = wmem_new(allocator, chained_map_t);
+
+    map->count     = 0;
+    map->capacity  = 5;
+    map->table     = wmem_alloc0_array(allocator, chained_map_item_t*, 1 << map->capacity);
+    map->allocator = allocator;
+    return map;
+}
+
+static void
+chained_map_insert(chained_map_t *map, const void *key, void *value)
+{
+    chained_map_item_t **item, **old_table, *cur, *nxt;
+    guint old_cap, i, slot;
+
+    item = &(map->table[CHAINED_HASH(map, key)]);
+    while (*item) {
+        if ((*item)->key == key) {
+            (*item)->value = value;
+            return;
+        }
+        item = &((*item)->next);
+    }
+    (*item) = wmem_new(map->allocator, chained_map_item_t);
+    (*item)->key   = key;
+    (*item)->value = value;
+    (*item)->next  = NULL;
+
+    if (++map->count >= (guint)(1 << map->capacity)) {
+        old_table = map->table;
+        old_cap   = 1 << map->capacity;
+        map->capacity++;
+        map->table = wmem_alloc0_array(map->allocator, chained_map_item_t*, 1 << map->capacity);
+        for (i=0; i<old_cap; i++) {
+            for (cur = old_table[i]; cur; cur = nxt) {
+                nxt              = cur->next;
+                slot             = CHAINED_HASH(map, cur->key);
+                cur->next        = map->table[slot];
+                map->table[slot] = cur;
+            }
+        }
+        wmem_free(map->allocator, old_table);
+    }
+}
+
+static void *
+chained_map_lookup(chained_map_t *map, const void *key)
+{
+    chained_map_item_t *item;
+
+    for (item = map->table[CHAINED_HASH(map, key)]; item; item = item->next) {
+        if (item->key == key) {
+            return item->value;
+        }
+    }
+    return NULL;
+}
+
+static void *
+chained_map_remove(chained_map_t *map, const void *key)
+{
+    chained_map_item_t **item, *tmp;
+    void *value;
+
+    for (item = &(map->table[CHAINED_HASH(map, key)]); *item; item = &((*item)->next)) {
+        if ((*item)->key == key) {
+            tmp     = *item;
+            value   = tmp->value;
+            *item   = tmp->next;
+            wmem_free(map->allocator, tmp);
+            map->count--;
+            return value;
+        }
+    }
+    return NULL;
+}
+
+/* Spread the keys out, as pointers or hashed values would be */
+#define TIMING_MAP_KEY(i) GUINT_TO_POINTER((guint)(i) * 2654435769U + 1)
+
+static void
+wmem_time_map_size(guint n)
+{
+    wmem_allocator_t *allocator;
+    wmem_map_t       *map;
+    chained_map_t    *chained;
+    double            times[2][4];
+    guint             i;
+
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_BLOCK);
+
+    chained = chained_map_new(allocator);
+    g_test_timer_start();
+    for (i=0; i<n; i++)
+        chained_map_insert(chained, TIMING_MAP_KEY(i), GUINT_TO_POINTER(i));
+    times[0][0] = g_test_timer_elapsed();
+    g_test_timer_start();
+    for (i=0; i<n; i++)
+        g_assert(chained_map_lookup(chained, TIMING_MAP_KEY(i)) == GUINT_TO_POINTER(i));
+    times[0][1] = g_test_timer_elapsed();
+    g_test_timer_start();
+    for (i=n; i<2*n; i++)
+        g_assert(chained_map_lookup(chained, TIMING_MAP_KEY(i)) == NULL);
+    times[0][2] = g_test_timer_elapsed();
+    g_test_timer_start();
+    for (i=0; i<n; i++)
+        chained_map_remove(chained, TIMING_MAP_KEY(i));
+    times[0][3] = g_test_timer_elapsed();
+    wmem_free_all(allocator);
+
+    map = wmem_map_new(allocator, g_direct_hash, g_direct_equal);
+    g_test_timer_start();
+    for (i=0; i<n; i++)
+        wmem_map_insert(map, TIMING_MAP_KEY(i), GUINT_TO_POINTER(i));
+    times[1][0] = g_test_timer_elapsed();
+    g_test_timer_start();
+    for (i=0; i<n; i++)
+        g_assert(wmem_map_lookup(map, TIMING_MAP_KEY(i)) == GUINT_TO_POINTER(i));
+    times[1][1] = g_test_timer_elapsed();
+    g_test_timer_start();
+    for (i=n; i<2*n; i++)
+        g_assert(wmem_map_lookup(map, TIMING_MAP_KEY(i)) == NULL);
+    times[1][2] = g_test_timer_elapsed();
+    g_test_timer_start();
+    for (i=0; i<n; i++)
+        wmem_map_remove(map, TIMING_MAP_KEY(i));
+    times[1][3] = g_test_timer_elapsed();
+
+    g_test_message("%u entries, insert/lookup/lookup missing/remove: "
+            "chained %.3f/%.3f/%.3f/%.3fs, wmem_map %.3f/%.3f/%.3f/%.3fs", n,
+            times[0][0], times[0][1], times[0][2], times[0][3],
+            times[1][0], times[1][1], times[1][2], times[1][3]);
+
+    wmem_destroy_allocator(allocator);
+}
+
+static void
+wmem_time_map(void)
+{
+    wmem_time_map_size(1000000);
+    wmem_time_map_size(10000000);
+}
+
+/* Out of order, and 8 apart for the _le lookups */
+#define TIMING_TREE_KEY(i) (((guint32)(i) * 2654435769U) << 3)
+/* Look them up in another order than they were inserted in, so that the
+ * nodes aren't visited in the order they were allocated */
+#define TIMING_TREE_SHUFFLE(i, n) ((guint)(((guint64)(i) * 40503U) % (n)))
+
+static void
+wmem_time_tree_size(guint n)
+{
+    wmem_allocator_t *allocator;
+    wmem_tree_t      *tree;
+    double            times[2][3];
+    guint             i, j, pass;
+    gboolean          btree;
+
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_BLOCK);
+
+    for (btree = FALSE; btree <= TRUE; btree++) {
+        tree = wmem_test_new_tree(allocator, btree);
+        g_test_timer_start();
+        for (i=0; i<n; i++)
+            wmem_tree_insert32(tree, TIMING_TREE_KEY(i), GUINT_TO_POINTER(i + 1));
+        times[btree][0] = g_test_timer_elapsed();
+        g_test_timer_start();
+        for (pass=0; pass<4; pass++)
+            for (i=0; i<n; i++) {
+                j = TIMING_TREE_SHUFFLE(i, n);
+                g_assert(wmem_tree_lookup32(tree, TIMING_TREE_KEY(j)) ==
+                        GUINT_TO_POINTER(j + 1));
+            }
+        times[btree][1] = g_test_timer_elapsed();
+        g_test_timer_start();
+        for (pass=0; pass<4; pass++)
+            for (i=0; i<n; i++) {
+                j = TIMING_TREE_SHUFFLE(i, n);
+                g_assert(wmem_tree_lookup32_le(tree, TIMING_TREE_KEY(j) + 5) ==
+                        GUINT_TO_POINTER(j + 1));
+            }
+        times[btree][2] = g_test_timer_elapsed();
+        wmem_free_all(allocator);
+    }
+
+    g_test_message("%u entries, insert/4x lookup/4x lookup_le: "
+            "red/black %.3f/%.3f/%.3fs, B+ %.3f/%.3f/%.3fs", n,
+            times[0][0], times[0][1], times[0][2],
+            times[1][0], times[1][1], times[1][2]);
+
+    wmem_destroy_allocator(allocator);
+}
+
+static void
+wmem_time_tree(void)
+{
+    wmem_time_tree_size(100000);
+    wmem_time_tree_size(1000000);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -996,6 +1441,8 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/allocator/simple",    wmem_test_allocator_simple);
     g_test_add_func("/wmem/allocator/strict",    wmem_test_allocator_strict);
     g_test_add_func("/wmem/allocator/callbacks", wmem_test_allocator_callbacks);
+    g_test_add_func("/wmem/allocator/slab",      wmem_test_slab);
+    g_test_add_func("/wmem/allocator/accounting", wmem_test_accounting);
 
     g_test_add_func("/wmem/utils/misc",    wmem_test_miscutls);
     g_test_add_func("/wmem/utils/strings", wmem_test_strutls);
@@ -1007,6 +1454,13 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/datastruct/stack",  wmem_test_stack);
     g_test_add_func("/wmem/datastruct/strbuf", wmem_test_strbuf);
     g_test_add_func("/wmem/datastruct/tree",   wmem_test_tree);
+    g_test_add_func("/wmem/datastruct/btree",  wmem_test_btree);
+
+    if (g_test_perf()) {
+        g_test_add_func("/wmem/timing/slab", wmem_time_slab);
+        g_test_add_func("/wmem/timing/map",  wmem_time_map);
+        g_test_add_func("/wmem/timing/tree", wmem_time_tree);
+    }
 
     ret = g_test_run();
 
@@ -57,8 +57,44 @@ struct _wmem_tree_t {
     wmem_tree_node_t *root;
     guint             master_cb_id;
     guint             slave_cb_id;
+
+    /* B+ tree backend, see below */
+    gboolean          is_btree;
+    void             *btree_root;
+    guint             btree_height; /* levels of inner nodes above the leaves */
 };
 
+/* The B+ tree backend keeps up to BTREE_ORDER keys per node, packed together
+ * so that a node is searched without chasing pointers, with the data in the
+ * leaves, which are linked together in key order. Nodes are split in half
+ * when full; as nothing is ever removed, the smallest key under a child is
+ * the separator before it in its parent, which is what makes lookup32_le a
+ * single descent.
+ *
+ * Trees with a single leaf start it small and grow it, so that the many small
+ * subtrees of array keys don't each take a full-sized node. */
+#define BTREE_ORDER      32
+#define BTREE_MIN_LEAF   4
+#define BTREE_MAX_HEIGHT 16
+
+typedef struct _wmem_btree_leaf_t {
+    struct _wmem_btree_leaf_t *next;
+    guint32 count;
+    guint32 capacity;
+    guint32 subtrees; /* bit i is set if value i is a subtree */
+} wmem_btree_leaf_t;
+
+/* the values, then the keys, follow the header */
+#define LEAF_SIZE(CAP)     (sizeof(wmem_btree_leaf_t) + (CAP) * (sizeof(void *) + sizeof(guint32)))
+#define LEAF_VALUES(LEAF)  ((void **)((LEAF) + 1))
+#define LEAF_KEYS(LEAF)    ((guint32 *)(LEAF_VALUES(LEAF) + (LEAF)->capacity))
+
+typedef struct _wmem_btree_inner_t {
+    guint32  count; /* number of children */
+    guint32  keys[BTREE_ORDER - 1]; /* keys[i] is the smallest key under children[i+1] */
+    void    *children[BTREE_ORDER];
+} wmem_btree_inner_t;
+
 static wmem_tree_node_t *
 node_uncle(wmem_tree_node_t *node)
 {
@@ -225,9 +261,23 @@ wmem_tree_new(wmem_allocator_t *allocator)
     wmem_tree_t *tree;
 
     tree = wmem_new(allocator, wmem_tree_t);
-    tree->master    = allocator;
-    tree->allocator = allocator;
-    tree->root      = NULL;
+    tree->master       = allocator;
+    tree->allocator    = allocator;
+    tree->root         = NULL;
+    tree->is_btree     = FALSE;
+    tree->btree_root   = NULL;
+    tree->btree_height = 0;
+
+    return tree;
+}
+
+wmem_tree_t *
+wmem_tree_new_btree(wmem_allocator_t *allocator)
+{
+    wmem_tree_t *tree;
+
+    tree = wmem_tree_new(allocator);
+    tree->is_btree = TRUE;
 
     return tree;
 }
@@ -238,7 +288,9 @@ wmem_tree_reset_cb(wmem_allocator_t *allocator _U_, wmem_cb_event_t event,
 {
     wmem_tree_t *tree = (wmem_tree_t *)user_data;
 
-    tree->root = NULL;
+    tree->root         = NULL;
+    tree->btree_root   = NULL;
+    tree->btree_height = 0;
 
     if (event == WMEM_CB_DESTROY_EVENT) {
         wmem_unregister_callback(tree->master, tree->master_cb_id);
@@ -265,9 +317,12 @@ wmem_tree_new_autoreset(wmem_allocator_t *master, wmem_allocator_t *slave)
     wmem_tree_t *tree;
 
     tree = wmem_new(master, wmem_tree_t);
-    tree->master    = master;
-    tree->allocator = slave;
-    tree->root      = NULL;
+    tree->master       = master;
+    tree->allocator    = slave;
+    tree->root         = NULL;
+    tree->is_btree     = FALSE;
+    tree->btree_root   = NULL;
+    tree->btree_height = 0;
 
     tree->master_cb_id = wmem_register_callback(master, wmem_tree_destroy_cb,
             tree);
@@ -277,10 +332,289 @@ wmem_tree_new_autoreset(wmem_allocator_t *master, wmem_allocator_t *slave)
     return tree;
 }
 
+wmem_tree_t *
+wmem_tree_new_btree_autoreset(wmem_allocator_t *master, wmem_allocator_t *slave)
+{
+    wmem_tree_t *tree;
+
+    tree = wmem_tree_new_autoreset(master, slave);
+    tree->is_btree = TRUE;
+
+    return tree;
+}
+
 gboolean
 wmem_tree_is_empty(wmem_tree_t *tree)
 {
-    return tree->root == NULL;
+    return tree->root == NULL && tree->btree_root == NULL;
+}
+
+/* The number of keys that are less than or equal to the given key. Nodes are
+ * small enough that comparing against every key, with no branches to
+ * mispredict, beats a binary search. */
+static inline guint
+btree_upper_bound(const guint32 *keys, guint count, guint32 key)
+{
+    guint i, n = 0;
+
+    for (i = 0; i < count; i++) {
+        n += keys[i] <= key;
+    }
+
+    return n;
+}
+
+static wmem_btree_leaf_t *
+btree_find_leaf(wmem_tree_t *tree, guint32 key)
+{
+    wmem_btree_inner_t *inner;
+    void               *node = tree->btree_root;
+    guint               level;
+
+    for (level = tree->btree_height; level > 0; level--) {
+        inner = (wmem_btree_inner_t *)node;
+        node  = inner->children[btree_upper_bound(inner->keys, inner->count - 1, key)];
+    }
+
+    return (wmem_btree_leaf_t *)node;
+}
+
+static void *
+btree_lookup32(wmem_tree_t *tree, guint32 key, gboolean le)
+{
+    wmem_btree_leaf_t *leaf;
+    guint              pos;
+
+    if (!tree->btree_root) {
+        return NULL;
+    }
+
+    leaf = btree_find_leaf(tree, key);
+    pos  = btree_upper_bound(LEAF_KEYS(leaf), leaf->count, key);
+
+    /* Only the first leaf can start with a key bigger than the one we
+     * were led to it by, so if there is no smaller key here there is
+     * none anywhere. */
+    if (pos == 0 || (!le && LEAF_KEYS(leaf)[pos - 1] != key)) {
+        return NULL;
+    }
+
+    return LEAF_VALUES(leaf)[pos - 1];
+}
+
+static wmem_btree_leaf_t *
+btree_new_leaf(wmem_allocator_t *allocator, guint32 capacity)
+{
+    wmem_btree_leaf_t *leaf;
+
+    leaf = (wmem_btree_leaf_t *)wmem_alloc(allocator, LEAF_SIZE(capacity));
+    leaf->next     = NULL;
+    leaf->count    = 0;
+    leaf->capacity = capacity;
+    leaf->subtrees = 0;
+
+    return leaf;
+}
+
+static wmem_btree_leaf_t *
+btree_grow_leaf(wmem_allocator_t *allocator, wmem_btree_leaf_t *leaf)
+{
+    guint32 old_capacity = leaf->capacity;
+
+    leaf = (wmem_btree_leaf_t *)wmem_realloc(allocator, leaf,
+            LEAF_SIZE(MIN(old_capacity * 2, BTREE_ORDER)));
+    leaf->capacity = MIN(old_capacity * 2, BTREE_ORDER);
+
+    /* the keys come after the values, which now have more room */
+    memmove(LEAF_KEYS(leaf), LEAF_VALUES(leaf) + old_capacity,
+            leaf->count * sizeof(guint32));
+
+    return leaf;
+}
+
+static void
+btree_leaf_insert(wmem_btree_leaf_t *leaf, guint pos, guint32 key,
+        void *value, gboolean is_subtree)
+{
+    guint64 below = leaf->subtrees & (((guint64)1 << pos) - 1);
+
+    memmove(LEAF_KEYS(leaf) + pos + 1, LEAF_KEYS(leaf) + pos,
+            (leaf->count - pos) * sizeof(guint32));
+    memmove(LEAF_VALUES(leaf) + pos + 1, LEAF_VALUES(leaf) + pos,
+            (leaf->count - pos) * sizeof(void *));
+    LEAF_KEYS(leaf)[pos]   = key;
+    LEAF_VALUES(leaf)[pos] = value;
+
+    leaf->subtrees = (guint32)(below | (((guint64)leaf->subtrees >> pos) << (pos + 1)) |
+            ((guint64)(is_subtree ? 1 : 0) << pos));
+    leaf->count++;
+}
+
+static void
+btree_inner_insert(wmem_btree_inner_t *inner, guint slot, guint32 key,
+        void *child)
+{
+    memmove(inner->keys + slot + 1, inner->keys + slot,
+            (inner->count - 1 - slot) * sizeof(guint32));
+    memmove(inner->children + slot + 2, inner->children + slot + 1,
+            (inner->count - 1 - slot) * sizeof(void *));
+    inner->keys[slot]         = key;
+    inner->children[slot + 1] = child;
+    inner->count++;
+}
+
+/* Split a full inner node while adding a child to it; returns the new right
+ * half, with *key set to the smallest key under it. */
+static wmem_btree_inner_t *
+btree_inner_split(wmem_allocator_t *allocator, wmem_btree_inner_t *inner,
+        guint slot, guint32 *key, void *child)
+{
+    wmem_btree_inner_t *right;
+    guint32             keys[BTREE_ORDER];
+    void               *children[BTREE_ORDER + 1];
+    guint               half = (BTREE_ORDER + 1) / 2;
+
+    memcpy(keys, inner->keys, slot * sizeof(guint32));
+    keys[slot] = *key;
+    memcpy(keys + slot + 1, inner->keys + slot,
+            (BTREE_ORDER - 1 - slot) * sizeof(guint32));
+    memcpy(children, inner->children, (slot + 1) * sizeof(void *));
+    children[slot + 1] = child;
+    memcpy(children + slot + 2, inner->children + slot + 1,
+            (BTREE_ORDER - 1 - slot) * sizeof(void *));
+
+    right = wmem_new(allocator, wmem_btree_inner_t);
+
+    inner->count = half;
+    memcpy(inner->keys, keys, (half - 1) * sizeof(guint32));
+    memcpy(inner->children, children, half * sizeof(void *));
+
+    *key = keys[half - 1];
+
+    right->count = BTREE_ORDER + 1 - half;
+    memcpy(right->keys, keys + half, (right->count - 1) * sizeof(guint32));
+    memcpy(right->children, children + half, right->count * sizeof(void *));
+
+    return right;
+}
+
+#define CREATE_DATA(TRANSFORM, DATA) ((TRANSFORM) ? (TRANSFORM)(DATA) : (DATA))
+static void *
+btree_lookup_or_insert32(wmem_tree_t *tree, guint32 key,
+        void*(*func)(void*), void* data, gboolean is_subtree, gboolean replace)
+{
+    wmem_btree_inner_t *path[BTREE_MAX_HEIGHT];
+    guint               slots[BTREE_MAX_HEIGHT];
+    wmem_btree_inner_t *inner, *root;
+    wmem_btree_leaf_t  *leaf, *right;
+    void               *node, *value;
+    guint               depth, pos, half;
+    guint32             sep;
+
+    if (!tree->btree_root) {
+        tree->btree_root   = btree_new_leaf(tree->allocator, BTREE_MIN_LEAF);
+        tree->btree_height = 0;
+    }
+
+    /* walk down to the leaf, remembering the way */
+    node = tree->btree_root;
+    for (depth = 0; depth < tree->btree_height; depth++) {
+        inner        = (wmem_btree_inner_t *)node;
+        path[depth]  = inner;
+        slots[depth] = btree_upper_bound(inner->keys, inner->count - 1, key);
+        node         = inner->children[slots[depth]];
+    }
+    leaf = (wmem_btree_leaf_t *)node;
+
+    pos = btree_upper_bound(LEAF_KEYS(leaf), leaf->count, key);
+    if (pos > 0 && LEAF_KEYS(leaf)[pos - 1] == key) {
+        /* this key already exists, so just return the data pointer */
+        if (replace) {
+            LEAF_VALUES(leaf)[pos - 1] = CREATE_DATA(func, data);
+            if (is_subtree) {
+                leaf->subtrees |= 1U << (pos - 1);
+            }
+            else {
+                leaf->subtrees &= ~(1U << (pos - 1));
+            }
+        }
+        return LEAF_VALUES(leaf)[pos - 1];
+    }
+
+    value = CREATE_DATA(func, data);
+
+    if (leaf->count == leaf->capacity && leaf->capacity < BTREE_ORDER) {
+        /* only a tree's single leaf is ever less than full-sized */
+        leaf = btree_grow_leaf(tree->allocator, leaf);
+        tree->btree_root = leaf;
+    }
+    if (leaf->count < leaf->capacity) {
+        btree_leaf_insert(leaf, pos, key, value, is_subtree);
+        return value;
+    }
+
+    /* split the leaf in half, unless keys are being appended, in which case
+     * the left one is left (nearly) full */
+    if (pos == BTREE_ORDER && !leaf->next) {
+        half = BTREE_ORDER - 1;
+    }
+    else {
+        half = BTREE_ORDER / 2;
+    }
+    right = btree_new_leaf(tree->allocator, BTREE_ORDER);
+    right->count = BTREE_ORDER - half;
+    memcpy(LEAF_KEYS(right), LEAF_KEYS(leaf) + half, right->count * sizeof(guint32));
+    memcpy(LEAF_VALUES(right), LEAF_VALUES(leaf) + half, right->count * sizeof(void *));
+    right->subtrees = leaf->subtrees >> half;
+    leaf->subtrees &= (1U << half) - 1;
+    leaf->count = half;
+    right->next = leaf->next;
+    leaf->next  = right;
+
+    if (pos <= half) {
+        btree_leaf_insert(leaf, pos, key, value, is_subtree);
+    }
+    else {
+        btree_leaf_insert(right, pos - half, key, value, is_subtree);
+    }
+
+    /* and add it to the parents, splitting them as needed */
+    sep  = LEAF_KEYS(right)[0];
+    node = right;
+    while (depth > 0) {
+        depth--;
+        inner = path[depth];
+        if (inner->count < BTREE_ORDER) {
+            btree_inner_insert(inner, slots[depth], sep, node);
+            return value;
+        }
+        node = btree_inner_split(tree->allocator, inner, slots[depth], &sep, node);
+    }
+
+    /* the root was split, so the tree grows a level */
+    g_assert(tree->btree_height + 1 < BTREE_MAX_HEIGHT);
+    root = wmem_new(tree->allocator, wmem_btree_inner_t);
+    root->count       = 2;
+    root->keys[0]     = sep;
+    root->children[0] = tree->btree_root;
+    root->children[1] = node;
+    tree->btree_root  = root;
+    tree->btree_height++;
+
+    return value;
+}
+
+static wmem_btree_leaf_t *
+btree_first_leaf(wmem_tree_t *tree)
+{
+    void  *node = tree->btree_root;
+    guint  level;
+
+    for (level = tree->btree_height; level > 0; level--) {
+        node = ((wmem_btree_inner_t *)node)->children[0];
+    }
+
+    return (wmem_btree_leaf_t *)node;
 }
 
 static wmem_tree_node_t *
@@ -304,7 +638,6 @@ create_node(wmem_allocator_t *allocator, wmem_tree_node_t *parent, guint32 key,
     return node;
 }
 
-#define CREATE_DATA(TRANSFORM, DATA) ((TRANSFORM) ? (TRANSFORM)(DATA) : (DATA))
 static void *
 lookup_or_insert32(wmem_tree_t *tree, guint32 key,
         void*(*func)(void*), void* data, gboolean is_subtree, gboolean replace)
@@ -312,6 +645,11 @@ lookup_or_insert32(wmem_tree_t *tree, guint32 key,
     wmem_tree_node_t *node     = tree->root;
     wmem_tree_node_t *new_node = NULL;
 
+    if (tree->is_btree) {
+        return btree_lookup_or_insert32(tree, key, func, data, is_subtree,
+                replace);
+    }
+
     /* is this the first node ?*/
     if (!node) {
         new_node = create_node(tree->allocator, NULL, key,
@@ -374,6 +712,10 @@ wmem_tree_lookup32(wmem_tree_t *tree, guint32 key)
 {
     wmem_tree_node_t *node = tree->root;
 
+    if (tree->is_btree) {
+        return btree_lookup32(tree, key, FALSE);
+    }
+
     while (node) {
         if (key == node->key32) {
             return node->data;
@@ -394,6 +736,10 @@ wmem_tree_lookup32_le(wmem_tree_t *tree, guint32 key)
 {
     wmem_tree_node_t *node = tree->root;
 
+    if (tree->is_btree) {
+        return btree_lookup32(tree, key, TRUE);
+    }
+
     while (node) {
         if (key == node->key32) {
             return node->data;
@@ -545,7 +891,13 @@ wmem_tree_lookup_string(wmem_tree_t* tree, const gchar* k, guint32 flags)
 static void *
 create_sub_tree(void* d)
 {
-    return wmem_tree_new(((wmem_tree_t *)d)->allocator);
+    wmem_tree_t *tree = (wmem_tree_t *)d;
+
+    /* subtrees use the same backend as the tree they're in */
+    if (tree->is_btree) {
+        return wmem_tree_new_btree(tree->allocator);
+    }
+    return wmem_tree_new(tree->allocator);
 }
 
 void
@@ -656,10 +1008,42 @@ wmem_tree_foreach_nodes(wmem_tree_node_t* node, wmem_foreach_func callback,
     return FALSE;
 }
 
+static gboolean
+btree_foreach(wmem_tree_t* tree, wmem_foreach_func callback,
+        void *user_data)
+{
+    wmem_btree_leaf_t *leaf;
+    guint32            i;
+    gboolean           stop_traverse;
+
+    for (leaf = btree_first_leaf(tree); leaf; leaf = leaf->next) {
+        for (i = 0; i < leaf->count; i++) {
+            if (leaf->subtrees & (1U << i)) {
+                stop_traverse = wmem_tree_foreach(
+                        (wmem_tree_t *)LEAF_VALUES(leaf)[i], callback, user_data);
+            } else {
+                stop_traverse = callback(LEAF_VALUES(leaf)[i], user_data);
+            }
+            if (stop_traverse) {
+                return TRUE;
+            }
+        }
+    }
+
+    return FALSE;
+}
+
 gboolean
 wmem_tree_foreach(wmem_tree_t* tree, wmem_foreach_func callback,
         void *user_data)
 {
+    if (tree->is_btree) {
+        if (!tree->btree_root)
+            return FALSE;
+
+        return btree_foreach(tree, callback, user_data);
+    }
+
     if(!tree->root)
         return FALSE;
 
@@ -695,6 +1079,26 @@ wmem_tree_print_nodes(const char *prefix, wmem_tree_node_t *node, guint32 level)
         wmem_print_subtree((wmem_tree_t *)node->data, level+1);
 }
 
+static void
+wmem_btree_print_leaves(wmem_tree_t *tree, guint32 level)
+{
+    wmem_btree_leaf_t *leaf;
+    guint32            i, j;
+
+    for (leaf = btree_first_leaf(tree); leaf; leaf = leaf->next) {
+        for (i = 0; i < leaf->count; i++) {
+            for (j=0; j<level; j++) {
+                printf("    ");
+            }
+            printf("LEAF:%p key:%u %s:%p\n", (void *)leaf, LEAF_KEYS(leaf)[i],
+                    (leaf->subtrees & (1U << i))?"tree":"data",
+                    LEAF_VALUES(leaf)[i]);
+            if (leaf->subtrees & (1U << i))
+                wmem_print_subtree((wmem_tree_t *)LEAF_VALUES(leaf)[i], level+1);
+        }
+    }
+}
+
 static void
 wmem_print_subtree(wmem_tree_t *tree, guint32 level)
 {
@@ -707,6 +1111,15 @@ wmem_print_subtree(wmem_tree_t *tree, guint32 level)
         printf("    ");
     }
 
+    if (tree->is_btree) {
+        printf("WMEM btree:%p root:%p height:%u\n", (void *)tree,
+                tree->btree_root, tree->btree_height);
+        if (tree->btree_root) {
+            wmem_btree_print_leaves(tree, level);
+        }
+        return;
+    }
+
     printf("WMEM tree:%p root:%p\n", (void *)tree, (void *)tree->root);
     if (tree->root) {
         wmem_tree_print_nodes("Root-", tree->root, level);
@@ -42,6 +42,11 @@ extern "C" {
  *    time for lookups, compared to linked lists that are O(n). This means
  *    red/black trees scale very well when many objects are being stored.
  *
+ *    Trees created with wmem_tree_new_btree() are instead B+ trees, with many
+ *    keys packed together in each node, which take fewer cache misses to
+ *    search when the tree is large and looked up much more often than it is
+ *    inserted into. Both kinds support the same functions.
+ *
  *    @{
  */
 
@@ -72,6 +77,19 @@ wmem_tree_t *
 wmem_tree_new_autoreset(wmem_allocator_t *master, wmem_allocator_t *slave)
 G_GNUC_MALLOC;
 
+/** Creates a tree like wmem_tree_new(), but kept as a B+ tree. Subtrees made
+ * by the array and string functions are B+ trees as well. */
+WS_DLL_PUBLIC
+wmem_tree_t *
+wmem_tree_new_btree(wmem_allocator_t *allocator)
+G_GNUC_MALLOC;
+
+/** Creates a tree like wmem_tree_new_autoreset(), but kept as a B+ tree. */
+WS_DLL_PUBLIC
+wmem_tree_t *
+wmem_tree_new_btree_autoreset(wmem_allocator_t *master, wmem_allocator_t *slave)
+G_GNUC_MALLOC;
+
 /** Returns true if the tree is empty (has no nodes). */
 WS_DLL_PUBLIC
 gboolean
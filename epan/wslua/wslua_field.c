@@ -174,11 +174,16 @@ WSLUA_METAMETHOD FieldInfo__call(lua_State* L) {
                 return 1;
             }
         case FT_NONE:
-                if (fi->ws_fi->length > 0 && fi->ws_fi->rep) {
+                if (fi->ws_fi->length > 0) {
                     /* it has a length, but calling fvalue_get() on an FT_NONE asserts,
                        so get the label instead (it's a FT_NONE, so a label is what it basically is) */
-                    lua_pushstring(L, fi->ws_fi->rep->representation);
-                    return 1;
+                    gchar label_str[ITEM_LABEL_LENGTH];
+                    const gchar *label = proto_item_get_label(fi->ws_fi, label_str);
+
+                    if (label) {
+                        lua_pushstring(L, label);
+                        return 1;
+                    }
                 }
                 return 0;
         case FT_BYTES:
@@ -68,6 +68,7 @@
 #include "cfile.h"
 #include "file.h"
 #include "fileset.h"
+#include "filter_cache.h"
 #include "frame_tvbuff.h"
 
 #include "ui/alert_box.h"
@@ -152,6 +153,9 @@ static void ref_time_packets(capture_file *cf);
 #define MIN_QUANTUM         200000
 #define MIN_NUMBER_OF_PACKET 1500
 
+/* Number of display filters whose results are kept by rescan_packets() */
+#define FILTER_CACHE_MAX_FILTERS 8
+
 /*
  * We could probably use g_signal_...() instead of the callbacks below but that
  * would require linking our CLI programs to libgobject and creating an object
@@ -301,6 +305,7 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   wtap  *wth;
   gchar *err_info;
 
+  wtap_set_use_seek_indexes(prefs.gui_fileopen_seek_index);
   wth = wtap_open_offline(fname, type, err, &err_info, TRUE);
   if (wth == NULL)
     goto fail;
@@ -446,6 +451,8 @@ cf_close(capture_file *cf)
 
   dfilter_free(cf->rfcode);
   cf->rfcode = NULL;
+  filter_cache_free(cf->filter_cache);
+  cf->filter_cache = NULL;
   if (cf->frames != NULL) {
     free_frame_data_sequence(cf->frames);
     cf->frames = NULL;
@@ -546,7 +553,7 @@ cf_read(capture_file *cf, gboolean reloading)
    * We assume this will not fail since cf->dfilter is only set in
    * cf_filter IFF the filter was valid.
    */
-  compiled = dfilter_compile(cf->dfilter, &dfcode, NULL);
+  compiled = dfilter_compile_cached(cf->dfilter, &dfcode, NULL);
   g_assert(!cf->dfilter || (compiled && dfcode));
 
   /* Get the union of the flags for all tap listeners. */
@@ -793,7 +800,7 @@ cf_continue_tail(capture_file *cf, volatile int to_read, int *err)
    * We assume this will not fail since cf->dfilter is only set in
    * cf_filter IFF the filter was valid.
    */
-  compiled = dfilter_compile(cf->dfilter, &dfcode, NULL);
+  compiled = dfilter_compile_cached(cf->dfilter, &dfcode, NULL);
   g_assert(!cf->dfilter || (compiled && dfcode));
 
   /* Get the union of the flags for all tap listeners. */
@@ -920,7 +927,7 @@ cf_finish_tail(capture_file *cf, int *err)
    * We assume this will not fail since cf->dfilter is only set in
    * cf_filter IFF the filter was valid.
    */
-  compiled = dfilter_compile(cf->dfilter, &dfcode, NULL);
+  compiled = dfilter_compile_cached(cf->dfilter, &dfcode, NULL);
   g_assert(!cf->dfilter || (compiled && dfcode));
 
   /* Get the union of the flags for all tap listeners. */
@@ -1181,6 +1188,32 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
   return row;
 }
 
+/* Do what add_packet_to_packet_list() does for a frame already in the
+   packet list, given whether it passes the display filter, without
+   dissecting it. */
+static void
+add_filtered_packet_to_packet_list(frame_data *fdata, capture_file *cf,
+    gboolean passed, gboolean depended_upon)
+{
+  frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                &cf->ref, cf->prev_dis);
+  cf->prev_cap = fdata;
+
+  fdata->flags.passed_dfilter = passed ? 1 : 0;
+  if (depended_upon)
+    fdata->flags.dependent_of_displayed = 1;
+
+  if (fdata->flags.passed_dfilter || fdata->flags.ref_time)
+  {
+    cf->displayed_count++;
+    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
+    cf->prev_dis = fdata;
+    if (cf->first_displayed == 0)
+      cf->first_displayed = fdata->num;
+    cf->last_displayed = fdata->num;
+  }
+}
+
 /* read in a new packet */
 /* returns the row of the new packet in the packet list or -1 if not displayed */
 static int
@@ -1312,6 +1345,20 @@ cf_merge_files(char **out_filenamep, int in_file_count,
     GString                     *comment_gstr;
 
     fake_interface_ids = TRUE;
+
+    /* We need the headers of all the files, so they all have to be open */
+    for (i = 0; i < in_file_count; i++) {
+      if (in_files[i].wth == NULL &&
+          !merge_reopen_in_file(&in_files[i], &open_err, &err_info)) {
+        ws_close(out_fd);
+        merge_close_in_files(in_file_count, in_files);
+        g_free(in_files);
+        cf_open_failure_alert_box(in_filenames[i], open_err, err_info,
+                                  FALSE, 0);
+        return CF_ERROR;
+      }
+    }
+
     /* Create SHB info */
     shb_hdr      = wtap_file_get_shb_info(in_files[0].wth);
     comment_gstr = g_string_new("");
@@ -1455,8 +1502,13 @@ cf_merge_files(char **out_filenamep, int in_file_count,
     if (data_offset >= progbar_nextstep) {
         /* Get the sum of the seek positions in all of the files. */
         file_pos = 0;
-        for (i = 0; i < in_file_count; i++)
-          file_pos += wtap_read_so_far(in_files[i].wth);
+        for (i = 0; i < in_file_count; i++) {
+          /* Files are only open from when we get to them until their end */
+          if (in_files[i].wth != NULL)
+            file_pos += wtap_read_so_far(in_files[i].wth);
+          else if (in_files[i].state == AT_EOF)
+            file_pos += in_files[i].size;
+        }
         progbar_val = (gfloat) file_pos / (gfloat) f_len;
         if (progbar_val > 1.0f) {
           /* Some file probably grew while we were reading it.
@@ -1672,7 +1724,7 @@ cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
      * and try to compile it.
      */
     dftext = g_strdup(dftext);
-    if (!dfilter_compile(dftext, &dfcode, &err_msg)) {
+    if (!dfilter_compile_cached(dftext, &dfcode, &err_msg)) {
       /* The attempt failed; report an error. */
       simple_message_box(ESD_TYPE_ERROR, NULL,
           "See the help for a description of the display filter syntax.",
@@ -1816,14 +1868,34 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   gboolean    add_to_packet_list = FALSE;
   gboolean    compiled;
   guint32     frames_count;
+  gchar      *filter_key;
+  const filter_results *cached = NULL;
+  const filter_results *narrowed = NULL;
 
   /* Compile the current display filter.
    * We assume this will not fail since cf->dfilter is only set in
    * cf_filter IFF the filter was valid.
    */
-  compiled = dfilter_compile(cf->dfilter, &dfcode, NULL);
+  compiled = dfilter_compile_cached(cf->dfilter, &dfcode, NULL);
   g_assert(!cf->dfilter || (compiled && dfcode));
 
+  if (cf->filter_cache == NULL)
+    cf->filter_cache = filter_cache_new(FILTER_CACHE_MAX_FILTERS);
+  filter_key = filter_cache_key(cf->dfilter, dfcode);
+
+  if (redissect) {
+    /* The frames may dissect differently now. */
+    filter_cache_clear(cf->filter_cache);
+  } else if (filter_key != NULL && !tap_listeners_require_dissection()) {
+    /* If we know which frames pass this filter, we needn't dissect them
+       again; if we know which frames pass a filter this one narrows
+       down, we need only dissect those. Tap listeners want to see
+       every frame dissected, though. */
+    cached = filter_cache_lookup(cf->filter_cache, filter_key);
+    if (cached == NULL)
+      narrowed = filter_cache_lookup_narrowed(cf->filter_cache, filter_key);
+  }
+
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
   cinfo = (tap_flags & TL_REQUIRES_COLUMNS) ? &cf->cinfo : NULL;
@@ -1972,9 +2044,6 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     /* Frame dependencies from the previous dissection/filtering are no longer valid. */
     fdata->flags.dependent_of_displayed = 0;
 
-    if (!cf_read_record(cf, fdata))
-      break; /* error reading the frame */
-
     /* If the previous frame is displayed, and we haven't yet seen the
        selected frame, remember that frame - it's the closest one we've
        yet seen before the selected frame. */
@@ -1983,10 +2052,22 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
       preceding_frame = prev_frame;
     }
 
-    add_packet_to_packet_list(fdata, cf, &edt, dfcode,
-                                    cinfo, &cf->phdr,
-                                    ws_buffer_start_ptr(&cf->buf),
-                                    add_to_packet_list);
+    if (cached != NULL && framenum <= filter_results_count(cached)) {
+      add_filtered_packet_to_packet_list(fdata, cf,
+                                         filter_results_passed(cached, framenum),
+                                         filter_results_depended_upon(cached, framenum));
+    } else if (narrowed != NULL && framenum <= filter_results_count(narrowed) &&
+               !filter_results_passed(narrowed, framenum)) {
+      add_filtered_packet_to_packet_list(fdata, cf, FALSE, FALSE);
+    } else {
+      if (!cf_read_record(cf, fdata))
+        break; /* error reading the frame */
+
+      add_packet_to_packet_list(fdata, cf, &edt, dfcode,
+                                      cinfo, &cf->phdr,
+                                      ws_buffer_start_ptr(&cf->buf),
+                                      add_to_packet_list);
+    }
 
     /* If this frame is displayed, and this is the first frame we've
        seen displayed after the selected frame, remember this frame -
@@ -2010,6 +2091,13 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
 
   epan_dissect_cleanup(&edt);
 
+  /* Remember which frames passed the filter, unless we were stopped
+     before getting through all of them. */
+  if (filter_key != NULL && framenum > frames_count &&
+      (cached == NULL || filter_results_count(cached) < frames_count))
+    filter_cache_add(cf->filter_cache, filter_key, cf->frames, frames_count);
+  g_free(filter_key);
+
   /* We are done redissecting the packet list. */
   cf->redissecting = FALSE;
 
@@ -3895,6 +3983,9 @@ cf_ignore_frame(capture_file *cf, frame_data *frame)
     frame->flags.ignored = TRUE;
     if (cf->count > cf->ignored_count)
       cf->ignored_count++;
+    /* The frame no longer dissects as it used to. */
+    if (cf->filter_cache != NULL)
+      filter_cache_clear(cf->filter_cache);
   }
 }
 
@@ -3908,6 +3999,9 @@ cf_unignore_frame(capture_file *cf, frame_data *frame)
     frame->flags.ignored = FALSE;
     if (cf->ignored_count > 0)
       cf->ignored_count--;
+    /* The frame no longer dissects as it used to. */
+    if (cf->filter_cache != NULL)
+      filter_cache_clear(cf->filter_cache);
   }
 }
 
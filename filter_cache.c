@@ -0,0 +1,332 @@
+/* filter_cache.c
+ * Per-frame results of the last display filters applied to a capture file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/proto.h>
+#include <epan/frame_data.h>
+
+#include "filter_cache.h"
+
+struct _filter_results {
+  gchar   *key;
+  guint32  count;
+  guint32 *passed;          /* one bit per frame, frame 1 first */
+  guint32 *depended_upon;
+};
+
+struct _filter_cache {
+  guint    max_filters;
+  GList   *results;         /* most recently used first */
+};
+
+/*
+ * Fields whose values can change without the frames being dissected
+ * anew, so that the results of a filter testing them can't be kept.
+ */
+static const char *volatile_fields[] = {
+  "frame.marked",
+  "frame.ignored",
+  "frame.ref_time",
+  "frame.time_relative",
+  "frame.time_delta_displayed",
+  "frame.comment",
+  "frame.comment.expert",
+  "frame.coloring_rule.name",
+  "frame.coloring_rule.string",
+  NULL
+};
+
+/* Spellings of the same operator; the first of each pair is kept. */
+static const char *operator_synonyms[][2] = {
+  { "&&", "and" },
+  { "||", "or" },
+  { "!",  "not" },
+  { "==", "eq" },
+  { "!=", "ne" },
+  { ">",  "gt" },
+  { ">=", "ge" },
+  { "<",  "lt" },
+  { "<=", "le" },
+  { "&",  "bitwise_and" },
+  { NULL, NULL }
+};
+
+#define OPERATOR_CHARS  "!=<>&|~"
+#define PUNCT_CHARS     "()[]{},"
+
+filter_cache *
+filter_cache_new(guint max_filters)
+{
+  filter_cache *fc = g_new0(filter_cache, 1);
+
+  fc->max_filters = max_filters;
+  return fc;
+}
+
+static void
+filter_results_free(gpointer data, gpointer user_data _U_)
+{
+  filter_results *fr = (filter_results *)data;
+
+  g_free(fr->key);
+  g_free(fr->passed);
+  g_free(fr->depended_upon);
+  g_free(fr);
+}
+
+void
+filter_cache_clear(filter_cache *fc)
+{
+  g_list_foreach(fc->results, filter_results_free, NULL);
+  g_list_free(fc->results);
+  fc->results = NULL;
+}
+
+void
+filter_cache_free(filter_cache *fc)
+{
+  if (fc == NULL)
+    return;
+
+  filter_cache_clear(fc);
+  g_free(fc);
+}
+
+static gboolean
+filter_uses_volatile_field(const dfilter_t *df)
+{
+  const int *fields;
+  int        num_fields, i, j;
+
+  fields = dfilter_interesting_fields(df, &num_fields);
+  for (i = 0; i < num_fields; i++) {
+    header_field_info *hfinfo = proto_registrar_get_nth(fields[i]);
+
+    for (j = 0; volatile_fields[j] != NULL; j++) {
+      if (strcmp(hfinfo->abbrev, volatile_fields[j]) == 0)
+        return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static void
+append_token(GString *key, const gchar *token, gsize len)
+{
+  int i;
+
+  for (i = 0; operator_synonyms[i][0] != NULL; i++) {
+    if (strlen(operator_synonyms[i][1]) == len &&
+        strncmp(operator_synonyms[i][1], token, len) == 0) {
+      token = operator_synonyms[i][0];
+      len = strlen(token);
+      break;
+    }
+  }
+
+  if (key->len > 0)
+    g_string_append_c(key, ' ');
+  g_string_append_len(key, token, len);
+}
+
+gchar *
+filter_cache_key(const gchar *text, const dfilter_t *df)
+{
+  GString     *key;
+  const gchar *p, *start;
+
+  if (text == NULL || df == NULL || filter_uses_volatile_field(df))
+    return NULL;
+
+  /*
+   * Split the text into quoted strings, runs of operator characters,
+   * punctuation and words, much as the scanner does, and join them
+   * back with single spaces.
+   */
+  key = g_string_new("");
+  p = text;
+  while (*p != '\0') {
+    if (g_ascii_isspace(*p)) {
+      p++;
+      continue;
+    }
+
+    start = p;
+    if (*p == '"') {
+      for (p++; *p != '\0' && *p != '"'; p++) {
+        if (*p == '\\' && p[1] != '\0')
+          p++;
+      }
+      if (*p == '"')
+        p++;
+    } else if (*p == '$') {
+      /* A macro, which may be changed behind our back */
+      g_string_free(key, TRUE);
+      return NULL;
+    } else if (strchr(OPERATOR_CHARS, *p) != NULL) {
+      while (*p != '\0' && strchr(OPERATOR_CHARS, *p) != NULL)
+        p++;
+    } else if (strchr(PUNCT_CHARS, *p) != NULL) {
+      p++;
+    } else {
+      while (*p != '\0' && !g_ascii_isspace(*p) && *p != '"' && *p != '$' &&
+             strchr(OPERATOR_CHARS PUNCT_CHARS, *p) == NULL)
+        p++;
+    }
+    append_token(key, start, p - start);
+  }
+
+  return g_string_free(key, FALSE);
+}
+
+static GList *
+filter_cache_find(filter_cache *fc, const gchar *key)
+{
+  GList *l;
+
+  for (l = fc->results; l != NULL; l = l->next) {
+    if (strcmp(((filter_results *)l->data)->key, key) == 0)
+      return l;
+  }
+  return NULL;
+}
+
+/* Move a result to the front of the list, as the most recently used */
+static const filter_results *
+filter_cache_use(filter_cache *fc, GList *l)
+{
+  fc->results = g_list_remove_link(fc->results, l);
+  fc->results = g_list_concat(l, fc->results);
+  return (const filter_results *)l->data;
+}
+
+const filter_results *
+filter_cache_lookup(filter_cache *fc, const gchar *key)
+{
+  GList *l;
+
+  l = filter_cache_find(fc, key);
+  return l != NULL ? filter_cache_use(fc, l) : NULL;
+}
+
+const filter_results *
+filter_cache_lookup_narrowed(filter_cache *fc, const gchar *key)
+{
+  GList *l, *best = NULL;
+  gsize  best_len = 0;
+
+  /*
+   * "&&" has the lowest precedence of all the operators, so whatever
+   * follows "<filter> &&" can only narrow down what the filter passes.
+   */
+  for (l = fc->results; l != NULL; l = l->next) {
+    const gchar *old_key = ((filter_results *)l->data)->key;
+    gsize        len = strlen(old_key);
+
+    if (len > best_len && strncmp(key, old_key, len) == 0 &&
+        strncmp(key + len, " && ", 4) == 0) {
+      best = l;
+      best_len = len;
+    }
+  }
+  return best != NULL ? filter_cache_use(fc, best) : NULL;
+}
+
+void
+filter_cache_add(filter_cache *fc, const gchar *key,
+                 frame_data_sequence *frames, guint32 count)
+{
+  filter_results *fr;
+  GList          *l;
+  guint32         framenum;
+  gsize           words;
+
+  if (fc->max_filters == 0)
+    return;
+
+  l = filter_cache_find(fc, key);
+  if (l != NULL) {
+    filter_results_free(l->data, NULL);
+    fc->results = g_list_delete_link(fc->results, l);
+  }
+  while (g_list_length(fc->results) >= fc->max_filters) {
+    l = g_list_last(fc->results);
+    filter_results_free(l->data, NULL);
+    fc->results = g_list_delete_link(fc->results, l);
+  }
+
+  words = (count + 31) / 32;
+  fr = g_new(filter_results, 1);
+  fr->key = g_strdup(key);
+  fr->count = count;
+  fr->passed = g_new0(guint32, words);
+  fr->depended_upon = g_new0(guint32, words);
+  for (framenum = 1; framenum <= count; framenum++) {
+    frame_data *fdata = frame_data_sequence_find(frames, framenum);
+    guint32     bit = (guint32)1 << ((framenum - 1) % 32);
+
+    if (fdata->flags.passed_dfilter)
+      fr->passed[(framenum - 1) / 32] |= bit;
+    if (fdata->flags.dependent_of_displayed)
+      fr->depended_upon[(framenum - 1) / 32] |= bit;
+  }
+
+  fc->results = g_list_prepend(fc->results, fr);
+}
+
+guint32
+filter_results_count(const filter_results *fr)
+{
+  return fr->count;
+}
+
+gboolean
+filter_results_passed(const filter_results *fr, guint32 framenum)
+{
+  g_assert(framenum >= 1 && framenum <= fr->count);
+  return (fr->passed[(framenum - 1) / 32] >> ((framenum - 1) % 32)) & 1;
+}
+
+gboolean
+filter_results_depended_upon(const filter_results *fr, guint32 framenum)
+{
+  g_assert(framenum >= 1 && framenum <= fr->count);
+  return (fr->depended_upon[(framenum - 1) / 32] >> ((framenum - 1) % 32)) & 1;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
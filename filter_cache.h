@@ -0,0 +1,104 @@
+/* filter_cache.h
+ * Per-frame results of the last display filters applied to a capture file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __FILTER_CACHE_H__
+#define __FILTER_CACHE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <epan/frame_data_sequence.h>
+#include <epan/dfilter/dfilter.h>
+
+/** @file
+ *  Remembers, for the last few display filters, which frames passed
+ *  them and which frames the frames that passed depend upon, so that
+ *  going back to one of those filters doesn't need the frames to be
+ *  read and dissected again, and so that narrowing one down with
+ *  "&& ..." only needs the frames that passed it to be looked at.
+ *
+ *  Filters are told apart by their text, normalized so that spacing
+ *  and the choice between e.g. "and" and "&&" don't matter.
+ */
+
+typedef struct _filter_cache filter_cache;
+typedef struct _filter_results filter_results;
+
+/** Create a cache keeping the results of up to max_filters filters. */
+extern filter_cache *filter_cache_new(guint max_filters);
+
+extern void filter_cache_free(filter_cache *fc);
+
+/** Forget all results, e.g. because the frames are dissected anew. */
+extern void filter_cache_clear(filter_cache *fc);
+
+/** Normalize the text of a compiled filter, to be used as its key.
+ *
+ * @return the key, to be freed with g_free(), or NULL if the results
+ * of the filter can't be cached, as they depend on something other
+ * than the frames and their dissection (marked, ignored and time
+ * reference frames, comments, coloring rules, macros).
+ */
+extern gchar *filter_cache_key(const gchar *text, const dfilter_t *df);
+
+/** The results of a filter, or NULL if they aren't known. */
+extern const filter_results *filter_cache_lookup(filter_cache *fc, const gchar *key);
+
+/** The results of the longest filter whose key is narrowed down by
+ * key, i.e. key is "<that filter> && ...", or NULL if there is none. */
+extern const filter_results *filter_cache_lookup_narrowed(filter_cache *fc, const gchar *key);
+
+/** Remember the results of a filter just applied to the first count
+ * frames, as left in their passed_dfilter and dependent_of_displayed
+ * flags, forgetting the least recently used filter if need be. */
+extern void filter_cache_add(filter_cache *fc, const gchar *key,
+                             frame_data_sequence *frames, guint32 count);
+
+/** The number of frames the results cover. */
+extern guint32 filter_results_count(const filter_results *fr);
+
+/** Whether a frame, numbered from 1, passed the filter. */
+extern gboolean filter_results_passed(const filter_results *fr, guint32 framenum);
+
+/** Whether a frame, numbered from 1, is depended upon by a frame that
+ * passed the filter. */
+extern gboolean filter_results_depended_upon(const filter_results *fr, guint32 framenum);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FILTER_CACHE_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
@@ -26,12 +26,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <glib.h>
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
 
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
 #ifdef HAVE_GETOPT_H
 #include <getopt.h>
 #endif
@@ -47,6 +52,8 @@
 #endif
 
 #include <wsutil/file_util.h>
+#include <wsutil/tempfile.h>
+#include <wsutil/clopts_common.h>
 #include <wsutil/crash_info.h>
 #include <wsutil/ws_version_info.h>
 
@@ -59,6 +66,8 @@ print_usage(FILE *output)
     fprintf(output, "\n");
     fprintf(output, "Options:\n");
     fprintf(output, "  -n        don't write to output file if the input file is ordered.\n");
+    fprintf(output, "  -w <frames> sort within a window of this many frames, with\n");
+    fprintf(output, "            the frames in memory, rather than the whole file.\n");
     fprintf(output, "  -h        display this help and exit.\n");
 }
 
@@ -145,6 +154,403 @@ frames_compare(gconstpointer a, gconstpointer b)
     return nstime_cmp(time1, time2);
 }
 
+/*
+ * Bounded-memory reordering, for files too big to have every frame's
+ * record in memory, whose frames are only ever a little out of order.
+ *
+ * Frames are read into a window of at most a given number of them, kept
+ * as a heap, and the earliest one is written out whenever the window is
+ * full.  A frame that arrives after frames later than it have already
+ * been written can't go in the run being written, so it's kept for the
+ * next one; if that happens, each sorted run goes in a file of its own,
+ * and the runs are merged into the output file once all the frames are
+ * read.  Either way the input and output files are read and written
+ * sequentially.
+ */
+
+/* A frame held in the window, with its data */
+typedef struct WindowFrame_t {
+    struct wtap_pkthdr phdr;
+    guint8            *data;
+    guint              num;
+    guint              run;     /* which sorted run it goes in */
+    nstime_t           time;
+} WindowFrame_t;
+
+/* The sorted runs written so far */
+typedef struct SortedRuns_t {
+    const char                  *outfile;
+    int                          file_type_subtype;
+    int                          encap;
+    wtapng_section_t            *shb_hdr;
+    wtapng_iface_descriptions_t *idb_inf;
+    GPtrArray                   *filenames;
+    wtap_dumper                 *pdh;
+    guint                        run;
+    nstime_t                     last_time;     /* of the frame last written */
+} SortedRuns_t;
+
+/* A sorted run being merged, and the frame last read from it */
+typedef struct MergeRun_t {
+    wtap     *wth;
+    guint     run;
+    nstime_t  time;
+} MergeRun_t;
+
+/* Earliest first; frames with the same time stay in the order they had */
+static int
+window_frames_compare(gconstpointer a, gconstpointer b)
+{
+    const WindowFrame_t *frame1 = (const WindowFrame_t *) a;
+    const WindowFrame_t *frame2 = (const WindowFrame_t *) b;
+    int cmp;
+
+    if (frame1->run != frame2->run)
+        return frame1->run < frame2->run ? -1 : 1;
+    cmp = nstime_cmp(&frame1->time, &frame2->time);
+    if (cmp != 0)
+        return cmp;
+    return frame1->num < frame2->num ? -1 : frame1->num > frame2->num;
+}
+
+static int
+merge_runs_compare(gconstpointer a, gconstpointer b)
+{
+    const MergeRun_t *run1 = (const MergeRun_t *) a;
+    const MergeRun_t *run2 = (const MergeRun_t *) b;
+    int cmp;
+
+    cmp = nstime_cmp(&run1->time, &run2->time);
+    if (cmp != 0)
+        return cmp;
+    return run1->run < run2->run ? -1 : run1->run > run2->run;
+}
+
+/* A binary min-heap, in a GPtrArray */
+static void
+heap_push(GPtrArray *heap, gpointer item, GCompareFunc compare)
+{
+    guint i, parent;
+
+    g_ptr_array_add(heap, item);
+    for (i = heap->len - 1; i > 0; i = parent) {
+        parent = (i - 1) / 2;
+        if (compare(heap->pdata[parent], item) <= 0)
+            break;
+        heap->pdata[i] = heap->pdata[parent];
+    }
+    heap->pdata[i] = item;
+}
+
+static gpointer
+heap_pop(GPtrArray *heap, GCompareFunc compare)
+{
+    gpointer top = heap->pdata[0];
+    gpointer last = g_ptr_array_index(heap, heap->len - 1);
+    guint i, child;
+
+    g_ptr_array_set_size(heap, heap->len - 1);
+    if (heap->len == 0)
+        return top;
+
+    /* Sift the last item down from the top */
+    for (i = 0; (child = 2 * i + 1) < heap->len; i = child) {
+        if (child + 1 < heap->len &&
+            compare(heap->pdata[child + 1], heap->pdata[child]) < 0)
+            child++;
+        if (compare(last, heap->pdata[child]) <= 0)
+            break;
+        heap->pdata[i] = heap->pdata[child];
+    }
+    heap->pdata[i] = last;
+    return top;
+}
+
+static void
+run_dump_failure(const char *what, const char *filename, int err, gchar *err_info)
+{
+    fprintf(stderr, "reordercap: Error %s %s: %s\n", what, filename,
+            wtap_strerror(err));
+    if (err_info != NULL) {
+        fprintf(stderr, "(%s)\n", err_info);
+        g_free(err_info);
+    }
+    exit(1);
+}
+
+static void
+runs_close_current(SortedRuns_t *runs)
+{
+    int err;
+
+    if (runs->pdh == NULL)
+        return;
+    if (!wtap_dump_close(runs->pdh, &err))
+        run_dump_failure("closing",
+                         (const char *)g_ptr_array_index(runs->filenames, runs->filenames->len - 1),
+                         err, NULL);
+    runs->pdh = NULL;
+}
+
+/* Start writing another sorted run, in a temporary file next to the
+ * output file, so that a single one can just be renamed */
+static void
+runs_open_next(SortedRuns_t *runs)
+{
+    char *filename;
+    int   fd;
+    int   err;
+#ifndef _WIN32
+    mode_t mask;
+#endif
+
+    if (strcmp(runs->outfile, "-") == 0) {
+        char *tmpname;
+
+        fd = create_tempfile(&tmpname, "reordercap");
+        filename = g_strdup(tmpname);
+    } else {
+        filename = g_strdup_printf("%s.XXXXXX", runs->outfile);
+        fd = g_mkstemp(filename);
+    }
+    if (fd == -1) {
+        fprintf(stderr, "reordercap: Can't create a temporary file for %s: %s\n",
+                runs->outfile, g_strerror(errno));
+        exit(1);
+    }
+#ifndef _WIN32
+    /* g_mkstemp() makes it readable only by us; if it's renamed to the
+       output file, that should have the mode any other output file
+       would have. */
+    if (strcmp(runs->outfile, "-") != 0) {
+        mask = umask(0);
+        umask(mask);
+        if (fchmod(fd, 0666 & ~mask) == -1) {
+            fprintf(stderr, "reordercap: Can't set the permissions of %s: %s\n",
+                    filename, g_strerror(errno));
+            exit(1);
+        }
+    }
+#endif
+    g_ptr_array_add(runs->filenames, filename);
+
+    runs->pdh = wtap_dump_fdopen_ng(fd, runs->file_type_subtype, runs->encap,
+                                    65535, FALSE, runs->shb_hdr, runs->idb_inf, &err);
+    if (runs->pdh == NULL)
+        run_dump_failure("opening", filename, err, NULL);
+}
+
+/* Write the earliest frame in the window to the run it goes in */
+static void
+runs_write_frame(SortedRuns_t *runs, WindowFrame_t *frame)
+{
+    int    err;
+    gchar *err_info;
+
+    if (runs->pdh == NULL || frame->run != runs->run) {
+        runs_close_current(runs);
+        runs_open_next(runs);
+        runs->run = frame->run;
+    }
+
+    if (!wtap_dump(runs->pdh, &frame->phdr, frame->data, &err, &err_info))
+        run_dump_failure("writing frame to",
+                         (const char *)g_ptr_array_index(runs->filenames, runs->filenames->len - 1),
+                         err, err_info);
+    runs->last_time = frame->time;
+
+    g_free(frame->phdr.opt_comment);
+    g_free(frame->data);
+    g_free(frame);
+}
+
+/* Merge the sorted runs into the output file */
+static void
+runs_merge(SortedRuns_t *runs)
+{
+    GPtrArray   *heap = g_ptr_array_new();
+    wtap_dumper *pdh;
+    MergeRun_t  *mrun;
+    const struct wtap_pkthdr *phdr;
+    gint64       data_offset;
+    int          err;
+    gchar       *err_info;
+    guint        i;
+
+    pdh = wtap_dump_open_ng(runs->outfile, runs->file_type_subtype, runs->encap,
+                            65535, FALSE, runs->shb_hdr, runs->idb_inf, &err);
+    if (pdh == NULL) {
+        fprintf(stderr, "reordercap: Failed to open output file: (%s) - error %s\n",
+                runs->outfile, wtap_strerror(err));
+        exit(1);
+    }
+
+    for (i = 0; i < runs->filenames->len; i++) {
+        const char *filename = (const char *)g_ptr_array_index(runs->filenames, i);
+
+        mrun = g_new(MergeRun_t, 1);
+        mrun->run = i;
+        mrun->wth = wtap_open_offline(filename, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+        if (mrun->wth == NULL)
+            run_dump_failure("opening", filename, err, err_info);
+        if (!wtap_read(mrun->wth, &err, &err_info, &data_offset)) {
+            /* Runs are never empty */
+            run_dump_failure("reading", filename, err, err_info);
+        }
+        phdr = wtap_phdr(mrun->wth);
+        if (phdr->presence_flags & WTAP_HAS_TS)
+            mrun->time = phdr->ts;
+        else
+            nstime_set_unset(&mrun->time);
+        heap_push(heap, mrun, merge_runs_compare);
+    }
+
+    while (heap->len > 0) {
+        mrun = (MergeRun_t *)heap_pop(heap, merge_runs_compare);
+
+        if (!wtap_dump(pdh, wtap_phdr(mrun->wth), wtap_buf_ptr(mrun->wth), &err, &err_info))
+            run_dump_failure("writing frame to", runs->outfile, err, err_info);
+
+        if (wtap_read(mrun->wth, &err, &err_info, &data_offset)) {
+            phdr = wtap_phdr(mrun->wth);
+            if (phdr->presence_flags & WTAP_HAS_TS)
+                mrun->time = phdr->ts;
+            else
+                nstime_set_unset(&mrun->time);
+            heap_push(heap, mrun, merge_runs_compare);
+        } else {
+            if (err != 0)
+                run_dump_failure("reading",
+                                 (const char *)g_ptr_array_index(runs->filenames, mrun->run),
+                                 err, err_info);
+            wtap_close(mrun->wth);
+            g_free(mrun);
+        }
+    }
+    g_ptr_array_free(heap, TRUE);
+
+    if (!wtap_dump_close(pdh, &err)) {
+        fprintf(stderr, "reordercap: Error closing %s: %s\n", runs->outfile,
+                wtap_strerror(err));
+        exit(1);
+    }
+}
+
+static void
+runs_remove(SortedRuns_t *runs)
+{
+    guint i;
+
+    for (i = 0; i < runs->filenames->len; i++) {
+        char *filename = (char *)g_ptr_array_index(runs->filenames, i);
+
+        ws_unlink(filename);
+        g_free(filename);
+    }
+    g_ptr_array_free(runs->filenames, TRUE);
+}
+
+static void
+reorder_in_window(wtap *wth, const char *infile, const char *outfile,
+                  guint window, gboolean write_output_regardless,
+                  wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf)
+{
+    GPtrArray     *heap = g_ptr_array_new();
+    SortedRuns_t   runs;
+    WindowFrame_t *frame;
+    const struct wtap_pkthdr *phdr;
+    nstime_t       prev_time;
+    guint          num = 0;
+    guint          wrong_order_count = 0;
+    gint64         data_offset;
+    int            err;
+    gchar         *err_info;
+
+    runs.outfile           = outfile;
+    runs.file_type_subtype = wtap_file_type_subtype(wth);
+    runs.encap             = wtap_file_encap(wth);
+    runs.shb_hdr           = shb_hdr;
+    runs.idb_inf           = idb_inf;
+    runs.filenames         = g_ptr_array_new();
+    runs.pdh               = NULL;
+    runs.run               = 0;
+    nstime_set_unset(&runs.last_time);
+    nstime_set_unset(&prev_time);
+
+    while (wtap_read(wth, &err, &err_info, &data_offset)) {
+        phdr = wtap_phdr(wth);
+
+        frame = g_new(WindowFrame_t, 1);
+        frame->phdr = *phdr;
+        memset(&frame->phdr.ft_specific_data, 0, sizeof frame->phdr.ft_specific_data);
+        frame->phdr.opt_comment = g_strdup(phdr->opt_comment);
+        frame->data = (guint8 *)g_memdup(wtap_buf_ptr(wth), phdr->caplen);
+        frame->num = ++num;
+        if (phdr->presence_flags & WTAP_HAS_TS) {
+            frame->time = phdr->ts;
+        } else {
+            nstime_set_unset(&frame->time);
+        }
+
+        if (num > 1 && nstime_cmp(&frame->time, &prev_time) < 0) {
+            wrong_order_count++;
+        }
+        prev_time = frame->time;
+
+        /* Too late for the run being written? */
+        if (runs.pdh != NULL && nstime_cmp(&frame->time, &runs.last_time) < 0)
+            frame->run = runs.run + 1;
+        else
+            frame->run = runs.run;
+
+        heap_push(heap, frame, window_frames_compare);
+        if (heap->len > window)
+            runs_write_frame(&runs, (WindowFrame_t *)heap_pop(heap, window_frames_compare));
+    }
+    if (err != 0) {
+      /* Print a message noting that the read failed somewhere along the line. */
+      fprintf(stderr,
+              "reordercap: An error occurred while reading \"%s\": %s.\n",
+              infile, wtap_strerror(err));
+      if (err_info != NULL) {
+          fprintf(stderr, "(%s)\n", err_info);
+          g_free(err_info);
+      }
+    }
+
+    while (heap->len > 0)
+        runs_write_frame(&runs, (WindowFrame_t *)heap_pop(heap, window_frames_compare));
+    g_ptr_array_free(heap, TRUE);
+    runs_close_current(&runs);
+
+    printf("%u frames, %u out of order\n", num, wrong_order_count);
+
+    if (!write_output_regardless && (wrong_order_count == 0)) {
+        printf("Not writing output file because input file is already in order!\n");
+    } else if (runs.filenames->len == 1 && strcmp(outfile, "-") != 0) {
+        /* Everything was close enough to its place to be sorted in the
+           window; what was written is the output file. */
+        char *filename = (char *)g_ptr_array_index(runs.filenames, 0);
+
+#ifdef _WIN32
+        ws_unlink(outfile);
+#endif
+        if (ws_rename(filename, outfile) != 0) {
+            fprintf(stderr, "reordercap: Can't rename %s to %s: %s\n",
+                    filename, outfile, g_strerror(errno));
+            exit(1);
+        }
+        g_free(filename);
+        g_ptr_array_set_size(runs.filenames, 0);
+    } else {
+        if (runs.filenames->len > 1)
+            printf("Merging %u sorted runs\n", runs.filenames->len);
+        runs_merge(&runs);
+    }
+
+    runs_remove(&runs);
+}
+
 static void
 get_reordercap_compiled_info(GString *str)
 {
@@ -189,6 +595,7 @@ main(int argc, char *argv[])
     const struct wtap_pkthdr *phdr;
     guint wrong_order_count = 0;
     gboolean write_output_regardless = TRUE;
+    guint window = 0;
     guint i;
     wtapng_section_t            *shb_hdr;
     wtapng_iface_descriptions_t *idb_inf;
@@ -221,11 +628,14 @@ main(int argc, char *argv[])
       get_ws_vcs_version_info(), comp_info_str->str, runtime_info_str->str);
 
     /* Process the options first */
-    while ((opt = getopt_long(argc, argv, "hnv", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "hnvw:", long_options, NULL)) != -1) {
         switch (opt) {
             case 'n':
                 write_output_regardless = FALSE;
                 break;
+            case 'w':
+                window = get_positive_int(optarg, "window size");
+                break;
             case 'h':
                 printf("Reordercap (Wireshark) %s\n"
                        "Reorder timestamps of input file frames into output file.\n"
@@ -273,6 +683,15 @@ main(int argc, char *argv[])
     shb_hdr = wtap_file_get_shb_info(wth);
     idb_inf = wtap_file_get_idb_info(wth);
 
+    if (window > 0) {
+        reorder_in_window(wth, infile, outfile, window, write_output_regardless,
+                          shb_hdr, idb_inf);
+        g_free(idb_inf);
+        g_free(shb_hdr);
+        wtap_close(wth);
+        return 0;
+    }
+
     /* Open outfile (same filetype/encap as input file) */
     pdh = wtap_dump_open_ng(outfile, wtap_file_type_subtype(wth), wtap_file_encap(wth),
                             65535, FALSE, shb_hdr, idb_inf, &err);
@@ -123,6 +123,53 @@ ff_step_nsec_pcapng_direct() {
 	test_step_ok
 }
 
+# Uncompressed files are read out of a memory mapping of them, in
+# windows of 1 MB; pipes and compressed files can't be mapped and are
+# read(). Make a capture big enough that packets straddle a window.
+ff_make_big_pcap() {
+	head -c 24 "${CAPTURE_DIR}rsasnakeoil2.pcap" > ./ff-big.pcap
+	for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 \
+	    21 22 23 24 25 26 27 28 29 30 31 32 33 34 35 36 37 38 39 40 \
+	    41 42 43 44 45 46 47 48 ; do
+		tail -c +25 "${CAPTURE_DIR}rsasnakeoil2.pcap" >> ./ff-big.pcap
+	done
+}
+
+# Packet bytes, read out of the mapping / via stdin
+ff_step_mapped_pcap_stdin() {
+	ff_make_big_pcap
+	$TSHARK -x -r ./ff-big.pcap > ./ff-ts-mapped-direct.txt 2> /dev/null
+	$TSHARK -x -r - < ./ff-big.pcap > ./ff-ts-mapped-stdin.txt 2> /dev/null
+	diff -u ./ff-ts-mapped-direct.txt ./ff-ts-mapped-stdin.txt > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "Packet bytes of a mapped pcap vs pcap via stdin differ"
+		cat $DIFF_OUT
+		return
+	fi
+	test_step_ok
+}
+
+# Packet bytes read at random, out of the mapping / from a gzipped copy
+ff_step_mapped_pcap_random() {
+	if ! which gzip > /dev/null 2>&1 ; then
+		test_step_skipped
+		return
+	fi
+	ff_make_big_pcap
+	gzip -c ./ff-big.pcap > ./ff-big.pcap.gz
+	$TSHARK -2 -x -r ./ff-big.pcap > ./ff-ts-mapped-direct.txt 2> /dev/null
+	$TSHARK -2 -x -r ./ff-big.pcap.gz > ./ff-ts-mapped-gz.txt 2> /dev/null
+	diff -u ./ff-ts-mapped-direct.txt ./ff-ts-mapped-gz.txt > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "Packet bytes of a mapped pcap vs gzipped pcap read at random differ"
+		cat $DIFF_OUT
+		return
+	fi
+	test_step_ok
+}
+
 tshark_ff_suite() {
 	# Microsecond pcap direct read is used as the baseline.
 	test_step_add "Microsecond pcap via stdin" ff_step_usec_pcap_stdin
@@ -132,10 +179,13 @@ tshark_ff_suite() {
 	test_step_add "Microsecond pcap-ng direct read" ff_step_usec_pcapng_direct
 #	test_step_add "Nanosecond pcap-ng via stdin" ff_step_nsec_pcapng_stdin
 	test_step_add "Nanosecond pcap-ng direct read" ff_step_nsec_pcapng_direct
+	test_step_add "Memory-mapped pcap vs via stdin" ff_step_mapped_pcap_stdin
+	test_step_add "Memory-mapped pcap vs gzipped pcap at random" ff_step_mapped_pcap_random
 }
 
 ff_cleanup_step() {
 	rm -f ./ff-ts-*.txt
+	rm -f ./ff-big.pcap ./ff-big.pcap.gz
 	rm -f $DIFF_OUT
 }
 
@@ -142,6 +142,131 @@ io_step_rawshark_pcap_stdin() {
 	test_step_ok
 }
 
+# -T fields output, taken straight from the fields dissected, against
+# that taken from the protocol tree, which is what is done when a
+# protocol, here "ip", is one of the fields.  icmp.ident, dns.qry.class
+# and dns.resp.class are each the name of more than one field.
+io_step_fields_output() {
+	FIELDS="-e frame.number -e icmp.ident -e dns.qry.class -e dns.resp.class -e dns.flags.authenticated -e ip.src"
+	for OCCURRENCE in a f l ; do
+		$DUT -r "${CAPTURE_DIR}dns+icmp.pcapng.gz" -T fields -E occurrence=$OCCURRENCE \
+			$FIELDS > ./testout.txt 2>&1
+		RETURNVALUE=$?
+		if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+			cat ./testout.txt
+			test_step_failed "exit status of $DUT: $RETURNVALUE"
+			return
+		fi
+		$DUT -r "${CAPTURE_DIR}dns+icmp.pcapng.gz" -T fields -E occurrence=$OCCURRENCE \
+			-e ip $FIELDS 2>&1 | cut -f 2- > ./testout2.txt
+		diff -u --strip-trailing-cr ./testout2.txt ./testout.txt > $DIFF_OUT 2>&1
+		RETURNVALUE=$?
+		if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+			cat $DIFF_OUT
+			test_step_failed "Fields output with -E occurrence=$OCCURRENCE differs from that from the protocol tree"
+			return
+		fi
+	done
+	test_step_ok
+}
+
+# -T json and -T ek output is one valid JSON value per line
+io_step_json_output() {
+	JSON_PYTHON=`which python3 python 2>/dev/null | head -1`
+	if [ -z "$JSON_PYTHON" ] ; then
+		test_step_skipped
+		return
+	fi
+	for JSON_ARGS in "-T json" "-T ek" "-T json -e ip -e dns.qry.name -e ip.addr" ; do
+		$DUT -r "${CAPTURE_DIR}dns+icmp.pcapng.gz" $JSON_ARGS > ./testout.txt 2>./testout2.txt
+		RETURNVALUE=$?
+		if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+			cat ./testout2.txt
+			test_step_failed "exit status of $DUT $JSON_ARGS: $RETURNVALUE"
+			return
+		fi
+		$JSON_PYTHON -c '
+import json, sys
+lines = 0
+for line in sys.stdin:
+    json.loads(line)
+    lines += 1
+if lines == 0:
+    sys.exit("no output")
+' < ./testout.txt > ./testout2.txt 2>&1
+		RETURNVALUE=$?
+		if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+			cat ./testout2.txt
+			test_step_failed "Output of $DUT $JSON_ARGS isn't valid JSON"
+			return
+		fi
+	done
+	test_step_ok
+}
+
+# Read a little-endian u32 at the given offset of the given file
+io_read_u32() {
+	od -A n -t u4 -j $2 -N 4 "$1" | tr -d ' '
+}
+
+# -T columnar output, with and without second pass workers.  The four
+# packets of dhcp.pcap make one chunk; with -E occurrence=f, each of the
+# two columns has a validity bitmap of one byte and a value buffer of
+# four 4-byte values.
+io_step_columnar_output() {
+	if [ $ENDIANNESS != "little" ] ; then
+		test_step_skipped
+		return
+	fi
+	COLUMNAR_ARGS="-T columnar -E occurrence=f -e frame.number -e ip.src"
+	$DUT -r "${CAPTURE_DIR}dhcp.pcap" $COLUMNAR_ARGS > ./testout.bin 2>./testout.txt
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		cat ./testout.txt
+		test_step_failed "exit status of $DUT: $RETURNVALUE"
+		return
+	fi
+
+	if [ "`head -c 8 ./testout.bin`" != "WSCOLUMN" ] ||
+	   [ "`io_read_u32 ./testout.bin 8`" != 1 ] ||
+	   [ "`io_read_u32 ./testout.bin 12`" != 2 ] ; then
+		test_step_failed "Bad columnar header"
+		return
+	fi
+
+	# The header is 16 bytes, then 32 and 24 for the columns; the chunk
+	# is tagged 1 with 4 rows, and its buffers are 1 and 16 bytes long,
+	# padded to 8
+	if [ "`io_read_u32 ./testout.bin 72`" != 1 ] ||
+	   [ "`io_read_u32 ./testout.bin 80`" != 4 ] ||
+	   [ "`io_read_u32 ./testout.bin 88`" != 1 ] ||
+	   [ "`io_read_u32 ./testout.bin 104`" != 16 ] ||
+	   [ "`io_read_u32 ./testout.bin 128`" != 1 ] ||
+	   [ "`io_read_u32 ./testout.bin 144`" != 16 ] ||
+	   [ "`io_read_u32 ./testout.bin 168`" != 4294967295 ] ||
+	   [ "`wc -c < ./testout.bin | tr -d ' '`" != 176 ] ; then
+		od -A d -t x1 ./testout.bin
+		test_step_failed "Bad columnar chunk"
+		return
+	fi
+
+	if [ "$WS_SYSTEM" != "Windows" ] ; then
+		$DUT -r "${CAPTURE_DIR}dhcp.pcap" -2 --second-pass-workers 2 $COLUMNAR_ARGS > ./testout2.bin 2>./testout.txt
+		RETURNVALUE=$?
+		if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+			cat ./testout.txt
+			test_step_failed "exit status of $DUT with second pass workers: $RETURNVALUE"
+			return
+		fi
+		if ! cmp -s ./testout.bin ./testout2.bin ; then
+			test_step_failed "Columnar output with second pass workers differs"
+			return
+		fi
+	fi
+	test_step_ok
+}
+
+
 
 wireshark_io_suite() {
 	# Q: quit after cap, k: start capture immediately
@@ -159,6 +284,9 @@ tshark_io_suite() {
 	DUT=$TSHARK
 	test_step_add "Input file" io_step_input_file
 	test_step_add "Output piping" io_step_output_piping
+	test_step_add "Fields output" io_step_fields_output
+	test_step_add "JSON output" io_step_json_output
+	test_step_add "Columnar output" io_step_columnar_output
 	#test_step_add "Piping" io_step_input_piping
 }
 
@@ -178,6 +306,8 @@ io_cleanup_step() {
 	rm -f ./testout2.txt
 	rm -f ./testout.pcap
 	rm -f ./testout2.pcap
+	rm -f ./testout.bin
+	rm -f ./testout2.bin
 	rm -f $IO_RAWSHARK_DHCP_PCAP_TESTOUT
 }
 
@@ -71,12 +71,30 @@ set_dut() {
 	fi
 }
 
+unittests_step_dfilter_test() {
+	set_dut dfilter_test
+	ARGS=
+	unittests_step_test
+}
+
 unittests_step_exntest() {
 	set_dut exntest
 	ARGS=
 	unittests_step_test
 }
 
+unittests_step_label_fmt_test() {
+	set_dut label_fmt_test
+	ARGS=
+	unittests_step_test
+}
+
+unittests_step_mmh3_test() {
+	set_dut ../wsutil/mmh3_test
+	ARGS=
+	unittests_step_test
+}
+
 unittests_step_oids_test() {
 	set_dut oids_test
 	ARGS=
@@ -108,7 +126,10 @@ unittests_cleanup_step() {
 unittests_suite() {
 	test_step_set_pre unittests_cleanup_step
 	test_step_set_post unittests_cleanup_step
+	test_step_add "dfilter_test" unittests_step_dfilter_test
 	test_step_add "exntest" unittests_step_exntest
+	test_step_add "label_fmt_test" unittests_step_label_fmt_test
+	test_step_add "mmh3_test" unittests_step_mmh3_test
 	test_step_add "oids_test" unittests_step_oids_test
 	test_step_add "reassemble_test" unittests_step_reassemble_test
 	test_step_add "tvbtest" unittests_step_tvbtest
@@ -116,3 +116,11 @@ class testBytesEther(dftest.DFTest):
     def test_contains_4(self):
         dfilter = "ipx.src.node contains aa:e3"
         self.assertDFilterCount(dfilter, 0)
+
+    def test_contains_any_1(self):
+        dfilter = "ipx.src.node contains aa:e3 || ipx.src.node contains 11:22 || ipx.src.node contains a3:e3"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_contains_any_2(self):
+        dfilter = "ipx.src.node contains aa:e3 || ipx.src.node contains 11:22 || ipx.src.node contains e3:a3"
+        self.assertDFilterCount(dfilter, 0)
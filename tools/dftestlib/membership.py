@@ -0,0 +1,71 @@
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 2001 Gerald Combs
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+from dftestlib import dftest
+
+class testMembership(dftest.DFTest):
+    trace_file = "nfs.pcap"
+
+    def test_in_1(self):
+        dfilter = "ip.src in {172.25.100.14}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_2(self):
+        dfilter = "ip.src in {10.0.0.1 172.25.100.14}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_3(self):
+        dfilter = "ip.src in {10.0.0.1, 255.255.255.255}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_in_cidr_1(self):
+        dfilter = "ip.src in {10.0.0.0/8 172.25.100.0/24}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_cidr_2(self):
+        dfilter = "ip.src in {10.0.0.0/8 172.26.0.0/16}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_in_range_1(self):
+        dfilter = "ip.src in {172.25.100.10..172.25.100.20}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_range_2(self):
+        dfilter = "ip.src in {172.25.100.15..172.25.100.20}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_in_integer_1(self):
+        dfilter = "ip.version in {4 6}"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_in_integer_2(self):
+        dfilter = "ip.version in {0..3, 5..15}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_not_in_1(self):
+        dfilter = "!(ip.src in {172.25.100.14})"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_in_empty_range(self):
+        dfilter = "ip.version in {6..4}"
+        self.assertDFilterFail(dfilter)
+
+    def test_in_unsupported_type(self):
+        dfilter = "frame.time_delta in {1}"
+        self.assertDFilterFail(dfilter)
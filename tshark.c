@@ -46,6 +46,7 @@
 
 #ifndef _WIN32
 #include <signal.h>
+#include <sys/wait.h>
 #endif
 
 #ifdef HAVE_SYS_STAT_H
@@ -77,6 +78,7 @@
 #include <wsutil/file_util.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/report_err.h>
+#include <wsutil/tempfile.h>
 #include <wsutil/ws_version_info.h>
 
 #include "globals.h"
@@ -148,6 +150,13 @@ static frame_data prev_cap_frame;
 static const char* prev_display_dissector_name = NULL;
 
 static gboolean perform_two_pass_analysis;
+static gboolean minimal_dissection;
+static guint second_pass_workers;
+
+/* Long options without a one-letter equivalent */
+#define LONGOPT_MINIMAL_DISSECTION  MIN_NON_CAPTURE_LONGOPT
+#define LONGOPT_SECOND_PASS_WORKERS (MIN_NON_CAPTURE_LONGOPT+1)
+#define LONGOPT_SEEK_INDEX          (MIN_NON_CAPTURE_LONGOPT+2)
 
 /*
  * The way the packet decode is to be written.
@@ -155,11 +164,14 @@ static gboolean perform_two_pass_analysis;
 typedef enum {
   WRITE_TEXT,   /* summary or detail text */
   WRITE_XML,    /* PDML or PSML */
-  WRITE_FIELDS  /* User defined list of fields */
+  WRITE_FIELDS, /* User defined list of fields */
+  WRITE_JSON,   /* One JSON object per packet */
+  WRITE_COLUMNAR /* User defined list of fields, in binary columns */
   /* Add CSV and the like here */
 } output_action_e;
 
 static output_action_e output_action;
+static gboolean json_bulk_index;    /* -T ek rather than -T json */
 static gboolean do_dissection;     /* TRUE if we have to dissect each packet */
 static gboolean print_packet_info; /* TRUE if we're to print packet information */
 static gint print_summary = -1;    /* TRUE if we're to print packet summary information */
@@ -214,6 +226,8 @@ static gboolean process_packet(capture_file *cf, epan_dissect_t *edt, gint64 off
 static void show_capture_file_io_error(const char *, int, gboolean);
 static void show_print_file_io_error(int err);
 static gboolean write_preamble(capture_file *cf);
+static epan_dissect_t *new_print_edt(capture_file *cf, gboolean create_proto_tree,
+    guint tap_flags);
 static gboolean print_packet(capture_file *cf, epan_dissect_t *edt);
 static gboolean write_finale(void);
 static const char *cf_open_error_message(int err, gchar *err_info,
@@ -334,10 +348,15 @@ print_usage(FILE *output)
   /*fprintf(output, "\n");*/
   fprintf(output, "Input file:\n");
   fprintf(output, "  -r <infile>              set the filename to read from (- to read from stdin)\n");
+  fprintf(output, "  --seek-index             with -2, use or save a seek index for a compressed\n");
+  fprintf(output, "                           infile\n");
 
   fprintf(output, "\n");
   fprintf(output, "Processing:\n");
   fprintf(output, "  -2                       perform a two-pass analysis\n");
+  fprintf(output, "  --minimal-dissection     only dissect the protocols filters, taps and\n");
+  fprintf(output, "                           printed fields need\n");
+  fprintf(output, "  --second-pass-workers <n> with -2, print packets from n worker processes\n");
   fprintf(output, "  -R <read filter>         packet Read filter in Wireshark display filter syntax\n");
   fprintf(output, "  -Y <display filter>      packet displaY filter in Wireshark display filter\n");
   fprintf(output, "                           syntax\n");
@@ -362,11 +381,13 @@ print_usage(FILE *output)
   fprintf(output, "  -P                       print packet summary even when writing to a file\n");
   fprintf(output, "  -S <separator>           the line separator to print between packets\n");
   fprintf(output, "  -x                       add output of hex and ASCII dump (Packet Bytes)\n");
-  fprintf(output, "  -T pdml|ps|psml|text|fields\n");
+  fprintf(output, "  -T pdml|ps|psml|text|fields|json|ek|columnar\n");
   fprintf(output, "                           format of text output (def: text)\n");
   fprintf(output, "  -e <field>               field to print if -Tfields selected (e.g. tcp.port,\n");
   fprintf(output, "                           _ws.col.Info)\n");
   fprintf(output, "                           this option can be repeated to print multiple fields\n");
+  fprintf(output, "                           with -Tjson or -Tek, write only these fields\n");
+  fprintf(output, "                           -Tcolumnar writes these fields too\n");
   fprintf(output, "  -E<fieldsoption>=<value> set options for output when -Tfields selected:\n");
   fprintf(output, "     header=y|n            switch headers on and off\n");
   fprintf(output, "     separator=/t|/s|<char> select tab, space, printable character as separator\n");
@@ -951,6 +972,9 @@ main(int argc, char *argv[])
   static const struct option long_options[] = {
     {(char *)"help", no_argument, NULL, 'h'},
     {(char *)"version", no_argument, NULL, 'v'},
+    {(char *)"minimal-dissection", no_argument, NULL, LONGOPT_MINIMAL_DISSECTION},
+    {(char *)"second-pass-workers", required_argument, NULL, LONGOPT_SECOND_PASS_WORKERS},
+    {(char *)"seek-index", no_argument, NULL, LONGOPT_SEEK_INDEX},
     LONGOPT_CAPTURE_COMMON
     {0, 0, 0, 0 }
   };
@@ -1358,6 +1382,19 @@ main(int argc, char *argv[])
     case '2':        /* Perform two pass analysis */
       perform_two_pass_analysis = TRUE;
       break;
+    case LONGOPT_MINIMAL_DISSECTION: /* Only dissect what filters and output need */
+      minimal_dissection = TRUE;
+      break;
+    case LONGOPT_SECOND_PASS_WORKERS: /* Worker processes for the second pass */
+#ifdef _WIN32
+      cmdarg_err("--second-pass-workers isn't supported on this platform; ignoring it.");
+#else
+      second_pass_workers = get_positive_int(optarg, "number of second pass workers");
+#endif
+      break;
+    case LONGOPT_SEEK_INDEX: /* Use or save seek indexes for compressed files */
+      wtap_set_use_seek_indexes(TRUE);
+      break;
     case 'a':        /* autostop criteria */
     case 'b':        /* Ringbuffer option */
     case 'c':        /* Capture x packets */
@@ -1611,10 +1648,25 @@ main(int argc, char *argv[])
         output_action = WRITE_FIELDS;
         print_details = TRUE;   /* Need full tree info */
         print_summary = FALSE;  /* Don't allow summary */
+      } else if (strcmp(optarg, "columnar") == 0) {
+        output_action = WRITE_COLUMNAR;
+        print_details = TRUE;   /* Need full tree info */
+        print_summary = FALSE;  /* Don't allow summary */
+      } else if (strcmp(optarg, "json") == 0 || strcmp(optarg, "ek") == 0) {
+        output_action = WRITE_JSON;
+        json_bulk_index = strcmp(optarg, "ek") == 0;
+        print_details = TRUE;   /* Need full tree info */
+        print_summary = FALSE;  /* Don't allow summary */
       } else {
         cmdarg_err("Invalid -T parameter \"%s\"; it must be one of:", optarg);                   /* x */
-        cmdarg_err_cont("\t\"fields\" The values of fields specified with the -e option, in a form\n"
+        cmdarg_err_cont("\t\"columnar\" The values of fields specified with the -e option, in\n"
+                        "\t         binary columns laid out as Apache Arrow lays them out.\n"
+                        "\t\"fields\" The values of fields specified with the -e option, in a form\n"
                         "\t         specified by the -E option.\n"
+                        "\t\"json\"   One JSON object, on a line of its own, for the details\n"
+                        "\t         of each packet, or of the fields given with the -e option.\n"
+                        "\t\"ek\"     As \"json\", for the Elasticsearch bulk API: each packet\n"
+                        "\t         is preceded by an index action.\n"
                         "\t\"pdml\"   Packet Details Markup Language, an XML-based format for the\n"
                         "\t         details of a decoded packet. This information is equivalent to\n"
                         "\t         the packet details printed with the -V flag.\n"
@@ -1704,13 +1756,17 @@ main(int argc, char *argv[])
   }
 
   /* If we specified output fields, but not the output field type... */
-  if (WRITE_FIELDS != output_action && 0 != output_fields_num_fields(output_fields)) {
+  if (WRITE_FIELDS != output_action && WRITE_JSON != output_action &&
+      WRITE_COLUMNAR != output_action &&
+      0 != output_fields_num_fields(output_fields)) {
         cmdarg_err("Output fields were specified with \"-e\", "
-            "but \"-Tfields\" was not specified.");
+            "but \"-Tfields\", \"-Tcolumnar\", \"-Tjson\" or \"-Tek\" was not specified.");
         return 1;
-  } else if (WRITE_FIELDS == output_action && 0 == output_fields_num_fields(output_fields)) {
-        cmdarg_err("\"-Tfields\" was specified, but no fields were "
-                    "specified with \"-e\".");
+  } else if ((WRITE_FIELDS == output_action || WRITE_COLUMNAR == output_action) &&
+             0 == output_fields_num_fields(output_fields)) {
+        cmdarg_err("\"-T%s\" was specified, but no fields were "
+                    "specified with \"-e\".",
+                    WRITE_FIELDS == output_action ? "fields" : "columnar");
 
         return 1;
   }
@@ -1974,6 +2030,11 @@ main(int argc, char *argv[])
      line that their preferences have changed. */
   prefs_apply_all();
 
+  /* Minimal dissection has to be on before the taps, columns and
+     filters are set up, as they say which protocols are needed. */
+  if (minimal_dissection)
+    set_minimal_dissection(TRUE);
+
   /* At this point MATE will have registered its field array so we can
      have a tap filter with one of MATE's late-registered fields as part
      of the filter.  We can now process all the "-z" arguments. */
@@ -1986,6 +2047,7 @@ main(int argc, char *argv[])
     cmdarg_err("Some fields aren't valid");
     return 1;
   }
+  output_fields_require(output_fields);
 
 #ifdef HAVE_LIBPCAP
   /* We currently don't support taps, or printing dissected packets,
@@ -2719,7 +2781,7 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    edt = new_print_edt(cf, create_proto_tree, tap_flags);
 
     while (to_read-- && cf->wth) {
       wtap_cleareof(cf->wth);
@@ -2983,7 +3045,7 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
 
 static gboolean
 process_packet_second_pass(capture_file *cf, epan_dissect_t *edt, frame_data *fdata,
-               struct wtap_pkthdr *phdr, Buffer *buf,
+               struct wtap_pkthdr *phdr, const guint8 *pd,
                guint tap_flags)
 {
   column_info    *cinfo;
@@ -3010,6 +3072,11 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt, frame_data *fd
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    /* -T columnar picks the fields up from the ones primed */
+    if (minimal_dissection || proto_tree_uses_field_vector(edt->tree) ||
+        (print_packet_info && output_action == WRITE_COLUMNAR))
+      output_fields_prime_edt(output_fields, edt);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
@@ -3028,7 +3095,7 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt, frame_data *fd
       ref = &ref_frame;
     }
 
-    epan_dissect_run_with_taps(edt, cf->cd_t, phdr, frame_tvbuff_new_buffer(fdata, buf), fdata, cinfo);
+    epan_dissect_run_with_taps(edt, cf->cd_t, phdr, frame_tvbuff_new(fdata, pd), fdata, cinfo);
 
     /* Run the read/display filter if we have one. */
     if (cf->dfcode)
@@ -3081,6 +3148,458 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt, frame_data *fd
   return passed || fdata->flags.dependent_of_displayed;
 }
 
+#ifndef _WIN32
+/*
+ * Running the second pass of a two-pass analysis in several worker
+ * processes.
+ *
+ * Once the first pass is done, the only thing the dissection of a frame
+ * on the second pass depends on that isn't kept in its frame_data or in
+ * the dissectors' per-frame data is the frame that was displayed before
+ * it and the number of bytes displayed up to it, i.e. the results of
+ * the display filter for the frames before it.  So the frames are split
+ * into as many contiguous ranges as there are workers, and:
+ *
+ *  1) if there's a display filter, each worker dissects its range and
+ *     reports which of its frames passed the filter;
+ *
+ *  2) each worker then dissects and prints the frames of its range that
+ *     passed, starting from the displayed frame and byte count that
+ *     follow from those results, into a temporary file, and the files
+ *     are copied to the standard output in frame order.
+ *
+ * Workers are processes forked from us rather than threads, as the
+ * dissectors and the address resolution code keep state in globals.
+ * Taps, writing a capture file, "-l" and PostScript output (which keeps
+ * track of pages) still need the frames to be handled one at a time, in
+ * order, by us.
+ */
+typedef struct {
+  guint32  first;       /* first frame of the range */
+  guint32  last;        /* last frame of the range */
+  pid_t    pid;
+  int      result_fd;   /* read side of the pipe the worker reports on */
+  int      out_fd;      /* temporary file the worker prints to, or -1 */
+} second_pass_worker_t;
+
+static gboolean
+write_all(int fd, const void *data, size_t len)
+{
+  const guint8 *p = (const guint8 *)data;
+  ssize_t       n;
+
+  while (len != 0) {
+    n = ws_write(fd, p, (unsigned int)len);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    p += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+static gboolean
+read_all(int fd, void *data, size_t len)
+{
+  guint8  *p = (guint8 *)data;
+  ssize_t  n;
+
+  while (len != 0) {
+    n = ws_read(fd, p, (unsigned int)len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return FALSE;
+    p += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+static gboolean
+can_run_second_pass_in_workers(capture_file *cf, wtap_dumper *pdh)
+{
+  const int         *fields;
+  int                num_fields, i;
+  header_field_info *hfinfo;
+
+  if (second_pass_workers < 2 || !print_packet_info || pdh != NULL ||
+      line_buffered || tap_listeners_require_dissection())
+    return FALSE;
+  if (output_action == WRITE_TEXT && print_format == PR_FMT_PS)
+    return FALSE;
+  /* Columnar output is written a chunk of rows at a time, and the rows
+     a worker had left over when it finished would be lost. */
+  if (output_action == WRITE_COLUMNAR)
+    return FALSE;
+  if (strcmp(cf->filename, "-") == 0)
+    return FALSE;
+
+  /* A filter on the time since the previously displayed frame depends
+     on the results for the frames before, which we don't know yet. */
+  if (cf->dfcode) {
+    hfinfo = proto_registrar_get_byname("frame.time_delta_displayed");
+    fields = dfilter_interesting_fields(cf->dfcode, &num_fields);
+    for (i = 0; hfinfo != NULL && i < num_fields; i++) {
+      if (fields[i] == hfinfo->id)
+        return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/*
+ * Report what a worker did: the number of frames it got through, the
+ * error that stopped it, if any, and, on the first step, one byte per
+ * frame saying whether it passed the display filter.
+ */
+static void
+report_second_pass_worker(int fd, guint32 done, int err, gchar *err_info,
+                          const guint8 *passed)
+{
+  guint32 err_info_len = err_info ? (guint32)strlen(err_info) : 0;
+
+  if (!write_all(fd, &done, sizeof done) ||
+      !write_all(fd, &err, sizeof err) ||
+      !write_all(fd, &err_info_len, sizeof err_info_len) ||
+      !write_all(fd, err_info, err_info_len) ||
+      (passed != NULL && !write_all(fd, passed, done)))
+    _exit(2);
+}
+
+static gboolean
+read_second_pass_worker_report(second_pass_worker_t *worker, guint32 *done,
+                               int *err, gchar **err_info, guint8 *passed)
+{
+  guint32 err_info_len;
+
+  if (!read_all(worker->result_fd, done, sizeof *done) ||
+      !read_all(worker->result_fd, err, sizeof *err) ||
+      !read_all(worker->result_fd, &err_info_len, sizeof err_info_len))
+    return FALSE;
+  *err_info = NULL;
+  if (err_info_len != 0) {
+    *err_info = (gchar *)g_malloc(err_info_len + 1);
+    if (!read_all(worker->result_fd, *err_info, err_info_len)) {
+      g_free(*err_info);
+      *err_info = NULL;
+      return FALSE;
+    }
+    (*err_info)[err_info_len] = '\0';
+  }
+  if (passed != NULL && !read_all(worker->result_fd, passed, *done))
+    return FALSE;
+  return TRUE;
+}
+
+/* The body of a worker; never returns. */
+static void
+run_second_pass_worker(capture_file *cf, epan_dissect_t *edt,
+                       second_pass_worker_t *worker, const guint8 *passed,
+                       guint tap_flags)
+{
+  struct wtap_pkthdr  phdr;
+  Buffer              buf;
+  guint8             *pd;
+  frame_data         *fdata;
+  guint32             framenum;
+  guint8             *results = NULL;
+  int                 err = 0;
+  gchar              *err_info = NULL;
+
+  /* Random access needs a file position of our own. */
+  wtap_fdclose(cf->wth);
+  if (!wtap_fdreopen(cf->wth, cf->filename, &err)) {
+    report_second_pass_worker(worker->result_fd, 0, err, NULL, NULL);
+    _exit(0);
+  }
+
+  if (worker->out_fd != -1) {
+    if (dup2(worker->out_fd, 1) == -1)
+      _exit(2);
+  }
+
+  if (passed == NULL && cf->dfcode)
+    results = (guint8 *)g_malloc(worker->last - worker->first + 1);
+
+  wtap_phdr_init(&phdr);
+  ws_buffer_init(&buf, 1500);
+  for (framenum = worker->first; err == 0 && framenum <= worker->last; framenum++) {
+    fdata = frame_data_sequence_find(cf->frames, framenum);
+    if (passed != NULL && !passed[framenum - 1]) {
+      prev_cap = fdata;
+      continue;
+    }
+    if (!wtap_seek_read_data(cf->wth, fdata->file_off, &phdr, &buf, &pd, &err,
+                             &err_info))
+      break;
+    if (results != NULL) {
+      /* Only find out whether the frame passes the filter. */
+      epan_dissect_prime_dfilter(edt, cf->dfcode);
+      frame_data_set_before_dissect(fdata, &cf->elapsed_time, &ref, NULL);
+      epan_dissect_run(edt, cf->cd_t, &phdr, frame_tvbuff_new(fdata, pd),
+                       fdata, NULL);
+      results[framenum - worker->first] = dfilter_apply_edt(cf->dfcode, edt);
+      epan_dissect_reset(edt);
+    } else {
+      process_packet_second_pass(cf, edt, fdata, &phdr, pd, tap_flags);
+    }
+  }
+  ws_buffer_free(&buf);
+  wtap_phdr_cleanup(&phdr);
+
+  if (worker->out_fd != -1) {
+    fflush(stdout);
+    if (ferror(stdout))
+      _exit(2);
+  }
+  report_second_pass_worker(worker->result_fd, framenum - worker->first,
+                            err, err_info, results);
+  _exit(0);
+}
+
+/* Split the first count frames into ranges of about the same size. */
+static guint
+split_second_pass(second_pass_worker_t *workers, guint num_workers, guint32 count)
+{
+  guint32 per_worker = (count + num_workers - 1) / num_workers;
+  guint   i;
+
+  for (i = 0; i < num_workers && i * per_worker < count; i++) {
+    workers[i].first = i * per_worker + 1;
+    workers[i].last = MIN((i + 1) * per_worker, count);
+  }
+  return i;
+}
+
+static void
+stop_second_pass_workers(second_pass_worker_t *workers, guint num_workers)
+{
+  guint i;
+  int   status;
+
+  for (i = 0; i < num_workers; i++) {
+    kill(workers[i].pid, SIGTERM);
+    ws_close(workers[i].result_fd);
+    if (workers[i].out_fd != -1)
+      ws_close(workers[i].out_fd);
+    while (waitpid(workers[i].pid, &status, 0) == -1 && errno == EINTR)
+      ;
+  }
+}
+
+/*
+ * Start a worker for each range; if passed is NULL, the workers only
+ * work out which frames pass the display filter, otherwise they print
+ * the frames that passed.
+ */
+static gboolean
+start_second_pass_workers(capture_file *cf, epan_dissect_t *edt,
+                          second_pass_worker_t *workers, guint num_workers,
+                          const guint8 *passed, guint tap_flags)
+{
+  guint       i;
+  guint32     framenum;
+  guint32     start_cum_bytes = cum_bytes;
+  frame_data *last_dis = NULL;
+  int         pipe_fds[2];
+  char       *tmpname;
+  int         saved_errno;
+
+  /* Anything buffered would be written by every worker. */
+  fflush(stdout);
+
+  for (i = 0; i < num_workers; i++) {
+    second_pass_worker_t *worker = &workers[i];
+
+    worker->out_fd = -1;
+    if (passed != NULL) {
+      worker->out_fd = create_tempfile(&tmpname, "tshark_pass2");
+      if (worker->out_fd == -1) {
+        saved_errno = errno;
+        goto fail;
+      }
+      ws_unlink(tmpname);
+    }
+    if (pipe(pipe_fds) < 0) {
+      saved_errno = errno;
+      if (worker->out_fd != -1)
+        ws_close(worker->out_fd);
+      goto fail;
+    }
+
+    /* Set up where the range starts from. */
+    prev_dis = last_dis;
+    prev_cap = worker->first > 1 ? frame_data_sequence_find(cf->frames, worker->first - 1) : NULL;
+
+    worker->pid = fork();
+    if (worker->pid == 0) {
+      ws_close(pipe_fds[0]);
+      worker->result_fd = pipe_fds[1];
+      run_second_pass_worker(cf, edt, worker, passed, tap_flags);
+    }
+    ws_close(pipe_fds[1]);
+    if (worker->pid < 0) {
+      saved_errno = errno;
+      ws_close(pipe_fds[0]);
+      if (worker->out_fd != -1)
+        ws_close(worker->out_fd);
+      goto fail;
+    }
+    worker->result_fd = pipe_fds[0];
+
+    /* The next range starts after the frames displayed in this one. */
+    if (passed != NULL) {
+      for (framenum = worker->first; framenum <= worker->last; framenum++) {
+        if (passed[framenum - 1]) {
+          last_dis = frame_data_sequence_find(cf->frames, framenum);
+          frame_data_set_after_dissect(last_dis, &cum_bytes);
+        }
+      }
+    }
+  }
+  return TRUE;
+
+fail:
+  cmdarg_err("Couldn't start the second pass workers: %s; doing the second pass in one process.",
+             g_strerror(saved_errno));
+  stop_second_pass_workers(workers, i);
+  cum_bytes = start_cum_bytes;
+  prev_dis = NULL;
+  prev_cap = NULL;
+  return FALSE;
+}
+
+/* Copy what a worker printed to the standard output. */
+static gboolean
+copy_second_pass_output(int fd)
+{
+  char    buf[65536];
+  ssize_t n;
+
+  if (ws_lseek64(fd, 0, SEEK_SET) == -1)
+    return FALSE;
+  while ((n = ws_read(fd, buf, sizeof buf)) > 0) {
+    if (fwrite(buf, 1, n, stdout) != (size_t)n)
+      return FALSE;
+  }
+  return n == 0;
+}
+
+/*
+ * Wait for the workers, in order, and collect what they did, up to the
+ * first one that couldn't get through its range, which stops the others.
+ * Returns the number of frames up to that point, with *err and *err_info
+ * set to what stopped it.
+ */
+static guint32
+finish_second_pass_workers(second_pass_worker_t *workers, guint num_workers,
+                           guint8 *passed, int *err, gchar **err_info)
+{
+  guint    i;
+  guint32  done;
+  int      status;
+
+  *err = 0;
+  *err_info = NULL;
+  for (i = 0; i < num_workers; i++) {
+    second_pass_worker_t *worker = &workers[i];
+
+    if (!read_second_pass_worker_report(worker, &done, err, err_info,
+                                        passed != NULL ? &passed[worker->first - 1] : NULL)) {
+      cmdarg_err("A second pass worker failed.");
+      stop_second_pass_workers(workers + i, num_workers - i);
+      exit(2);
+    }
+    if (worker->out_fd != -1 && !copy_second_pass_output(worker->out_fd)) {
+      show_print_file_io_error(errno);
+      exit(2);
+    }
+    ws_close(worker->result_fd);
+    if (worker->out_fd != -1)
+      ws_close(worker->out_fd);
+    while (waitpid(worker->pid, &status, 0) == -1 && errno == EINTR)
+      ;
+    if (*err != 0) {
+      stop_second_pass_workers(workers + i + 1, num_workers - i - 1);
+      return worker->first - 1 + done;
+    }
+  }
+  return num_workers != 0 ? workers[num_workers - 1].last : 0;
+}
+
+/*
+ * Do the second pass with the workers.  Returns FALSE if that couldn't
+ * be done, in which case nothing has been printed and the frames are
+ * still to be handled; otherwise *err and *err_info are set if reading
+ * a frame failed.
+ */
+static gboolean
+process_second_pass_in_workers(capture_file *cf, epan_dissect_t *edt,
+                               guint tap_flags, int *err, gchar **err_info)
+{
+  second_pass_worker_t *workers;
+  guint                 num_workers;
+  guint32               count;
+  guint8               *passed;
+  dfilter_t            *dfcode;
+  int                   print_err;
+  gchar                *print_err_info;
+  gboolean              ok = TRUE;
+
+  num_workers = MIN(second_pass_workers, cf->count);
+  if (num_workers < 2)
+    return FALSE;
+
+  workers = g_new(second_pass_worker_t, num_workers);
+  passed = (guint8 *)g_malloc(cf->count);
+  memset(passed, TRUE, cf->count);
+  count = cf->count;
+  *err = 0;
+  *err_info = NULL;
+
+  if (cf->dfcode) {
+    num_workers = split_second_pass(workers, num_workers, count);
+    if (!start_second_pass_workers(cf, edt, workers, num_workers, NULL, tap_flags)) {
+      ok = FALSE;
+      goto out;
+    }
+    count = finish_second_pass_workers(workers, num_workers, passed, err, err_info);
+  }
+
+  if (count != 0) {
+    /* The frames that passed are known, so the workers printing them
+       needn't run the filter again. */
+    dfcode = cf->dfcode;
+    cf->dfcode = NULL;
+    num_workers = split_second_pass(workers, MIN(second_pass_workers, count), count);
+    if (start_second_pass_workers(cf, edt, workers, num_workers, passed, tap_flags)) {
+      finish_second_pass_workers(workers, num_workers, NULL, &print_err, &print_err_info);
+      if (*err == 0) {
+        *err = print_err;
+        *err_info = print_err_info;
+      } else {
+        g_free(print_err_info);
+      }
+    } else {
+      g_free(*err_info);
+      *err_info = NULL;
+      *err = 0;
+      ok = FALSE;
+    }
+    cf->dfcode = dfcode;
+  }
+
+out:
+  g_free(passed);
+  g_free(workers);
+  return ok;
+}
+#endif /* _WIN32 */
+
 static int
 load_cap_file(capture_file *cf, char *save_file, int out_file_type,
     gboolean out_file_name_res, int max_packet_count, gint64 max_byte_count)
@@ -3100,6 +3619,7 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
   char         *appname = NULL;
   struct wtap_pkthdr phdr;
   Buffer       buf;
+  guint8       *pd;
   epan_dissect_t *edt = NULL;
 
   wtap_phdr_init(&phdr);
@@ -3255,20 +3775,27 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
          printing packet details, which is true if we're printing stuff
          ("print_packet_info" is true) and we're in verbose mode
          ("packet_details" is true). */
-      edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+      edt = new_print_edt(cf, create_proto_tree, tap_flags);
     }
 
-    for (framenum = 1; err == 0 && framenum <= cf->count; framenum++) {
+#ifndef _WIN32
+    if (edt && can_run_second_pass_in_workers(cf, pdh) &&
+        process_second_pass_in_workers(cf, edt, tap_flags, &err, &err_info))
+      framenum = cf->count + 1;
+    else
+#endif
+      framenum = 1;
+    for (; err == 0 && framenum <= cf->count; framenum++) {
       fdata = frame_data_sequence_find(cf->frames, framenum);
-      if (wtap_seek_read(cf->wth, fdata->file_off, &phdr, &buf, &err,
-                         &err_info)) {
-        if (process_packet_second_pass(cf, edt, fdata, &phdr, &buf,
+      if (wtap_seek_read_data(cf->wth, fdata->file_off, &phdr, &buf, &pd,
+                              &err, &err_info)) {
+        if (process_packet_second_pass(cf, edt, fdata, &phdr, pd,
                                        tap_flags)) {
           /* Either there's no read filtering or this packet passed the
              filter, so, if we're writing to a capture file, write
              this packet out. */
           if (pdh != NULL) {
-            if (!wtap_dump(pdh, &phdr, ws_buffer_start_ptr(&buf), &err, &err_info)) {
+            if (!wtap_dump(pdh, &phdr, pd, &err, &err_info)) {
               /* Error writing to a capture file */
               switch (err) {
 
@@ -3371,7 +3898,7 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
          printing packet details, which is true if we're printing stuff
          ("print_packet_info" is true) and we're in verbose mode
          ("packet_details" is true). */
-      edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+      edt = new_print_edt(cf, create_proto_tree, tap_flags);
     }
 
     while (wtap_read(cf->wth, &err, &err_info, &data_offset)) {
@@ -3597,6 +4124,11 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset, struct wtap
 
     col_custom_prime_edt(edt, &cf->cinfo);
 
+    /* -T columnar picks the fields up from the ones primed */
+    if (minimal_dissection || proto_tree_uses_field_vector(edt->tree) ||
+        (print_packet_info && output_action == WRITE_COLUMNAR))
+      output_fields_prime_edt(output_fields, edt);
+
     /* We only need the columns if either
          1) some tap needs the columns
        or
@@ -3695,6 +4227,17 @@ write_preamble(capture_file *cf)
     write_fields_preamble(output_fields, stdout);
     return !ferror(stdout);
 
+  case WRITE_JSON:
+    write_json_preamble(json_bulk_index, stdout);
+    return !ferror(stdout);
+
+  case WRITE_COLUMNAR:
+#ifdef _WIN32
+    _setmode(fileno(stdout), O_BINARY);
+#endif
+    write_columnar_preamble(output_fields, stdout);
+    return !ferror(stdout);
+
   default:
     g_assert_not_reached();
     return FALSE;
@@ -3974,6 +4517,29 @@ print_columns(capture_file *cf)
   return print_line(print_stream, 0, line_bufp);
 }
 
+/*
+ * For -T fields and -T columnar, the protocol tree is only made visible
+ * to have the fields to write; unless a tap wants the tree, or some of
+ * the fields are written using their labels, just record the fields
+ * asked for, and skip building the tree.
+ */
+static epan_dissect_t *
+new_print_edt(capture_file *cf, gboolean create_proto_tree, guint tap_flags)
+{
+  epan_dissect_t *edt;
+
+  if (print_packet_info &&
+      (output_action == WRITE_FIELDS || output_action == WRITE_COLUMNAR) &&
+      !(tap_flags & TL_REQUIRES_PROTO_TREE) &&
+      output_fields_can_use_field_vector(output_fields)) {
+    edt = epan_dissect_new(cf->epan, TRUE, FALSE);
+    epan_dissect_use_field_vector(edt);
+    return edt;
+  }
+
+  return epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+}
+
 static gboolean
 print_packet(capture_file *cf, epan_dissect_t *edt)
 {
@@ -3996,6 +4562,8 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
         write_psml_columns(edt, stdout);
         return !ferror(stdout);
       case WRITE_FIELDS: /*No non-verbose "fields" format */
+      case WRITE_JSON:
+      case WRITE_COLUMNAR:
         g_assert_not_reached();
         break;
       }
@@ -4034,6 +4602,12 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
       write_fields_proto_tree(output_fields, edt, &cf->cinfo, stdout);
       printf("\n");
       return !ferror(stdout);
+    case WRITE_JSON:
+      write_json_proto_tree(output_fields, edt, stdout);
+      return !ferror(stdout);
+    case WRITE_COLUMNAR:
+      write_columnar_proto_tree(output_fields, edt, &cf->cinfo, stdout);
+      return !ferror(stdout);
     }
   }
   if (print_hex) {
@@ -4068,6 +4642,14 @@ write_finale(void)
     write_fields_finale(output_fields, stdout);
     return !ferror(stdout);
 
+  case WRITE_JSON:
+    write_json_finale(stdout);
+    return !ferror(stdout);
+
+  case WRITE_COLUMNAR:
+    write_columnar_finale(output_fields, stdout);
+    return !ferror(stdout);
+
   default:
     g_assert_not_reached();
     return FALSE;
@@ -4085,6 +4667,9 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   if (wth == NULL)
     goto fail;
 
+  /* We read it straight through, so reading ahead can only help */
+  wtap_set_read_ahead(wth);
+
   /* The open succeeded.  Fill in the information for this file. */
 
   /* Create new epan session for dissection. */
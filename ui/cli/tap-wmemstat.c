@@ -0,0 +1,190 @@
+/* tap-wmemstat.c
+ * Memory allocated by each protocol, as counted by wmem
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* This module provides the "-z wmem" memory accounting statistic for tshark */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <epan/packet.h>
+#include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
+#include <epan/wmem/wmem.h>
+
+void register_tap_listener_wmemstat(void);
+
+typedef struct _wmemstat_entry_t {
+	const char *scope;
+	guint       scope_order;
+	int         tag;
+	wmem_accounting_counts_t counts;
+} wmemstat_entry_t;
+
+typedef struct _wmemstat_t {
+	GArray     *entries;
+	const char *last_scope;
+	guint       num_scopes;
+} wmemstat_t;
+
+static void
+wmemstat_add_entry(const char *name, int tag,
+		   const wmem_accounting_counts_t *counts, void *user_data)
+{
+	wmemstat_t       *ws = (wmemstat_t *)user_data;
+	wmemstat_entry_t  entry;
+
+	/* Scopes come one after the other */
+	if (ws->last_scope != name) {
+		ws->last_scope = name;
+		ws->num_scopes++;
+	}
+
+	entry.scope = name;
+	entry.scope_order = ws->num_scopes;
+	entry.tag = tag;
+	entry.counts = *counts;
+	g_array_append_val(ws->entries, entry);
+}
+
+/* By scope, then by most bytes allocated */
+static gint
+wmemstat_compare(gconstpointer a, gconstpointer b)
+{
+	const wmemstat_entry_t *ea = (const wmemstat_entry_t *)a;
+	const wmemstat_entry_t *eb = (const wmemstat_entry_t *)b;
+
+	if (ea->scope_order != eb->scope_order)
+		return ea->scope_order < eb->scope_order ? -1 : 1;
+	if (ea->counts.total_bytes != eb->counts.total_bytes)
+		return ea->counts.total_bytes > eb->counts.total_bytes ? -1 : 1;
+	return ea->tag - eb->tag;
+}
+
+static const char *
+wmemstat_tag_name(int tag)
+{
+	protocol_t *protocol;
+
+	if (tag == WMEM_ACCOUNTING_NO_TAG)
+		return "(no protocol)";
+	protocol = find_protocol_by_id(tag);
+	return protocol ? proto_get_protocol_short_name(protocol) : "(unknown)";
+}
+
+static void
+wmemstat_draw(void *prs)
+{
+	wmemstat_t       *ws = (wmemstat_t *)prs;
+	wmemstat_entry_t *entry;
+	const char       *scope = NULL;
+	guint             i;
+
+	g_array_set_size(ws->entries, 0);
+	ws->last_scope = NULL;
+	ws->num_scopes = 0;
+	wmem_accounting_foreach(wmemstat_add_entry, ws);
+	g_array_sort(ws->entries, wmemstat_compare);
+
+	printf("\n");
+	printf("===================================================================================\n");
+	printf("Memory allocated by each protocol\n");
+	printf("Live counts are of what was allocated since the scope was last freed, and\n");
+	printf("include what was given back early; totals include everything allocated.\n");
+	for (i = 0; i < ws->entries->len; i++) {
+		entry = &g_array_index(ws->entries, wmemstat_entry_t, i);
+		if (entry->scope != scope) {
+			scope = entry->scope;
+			printf("\nScope: %s\n", scope);
+			printf("%-24s %14s %16s %14s %16s\n", "Protocol",
+			       "Live objects", "Live bytes", "Total objects", "Total bytes");
+		}
+		printf("%-24s %14" G_GINT64_MODIFIER "u %16" G_GINT64_MODIFIER "u"
+		       " %14" G_GINT64_MODIFIER "u %16" G_GINT64_MODIFIER "u\n",
+		       wmemstat_tag_name(entry->tag),
+		       entry->counts.objects, entry->counts.bytes,
+		       entry->counts.total_objects, entry->counts.total_bytes);
+	}
+	printf("===================================================================================\n");
+}
+
+static void
+wmemstat_init(const char *opt_arg, void *userdata _U_)
+{
+	wmemstat_t *ws;
+	GString    *error_string;
+
+	if (strcmp(opt_arg, "wmem") != 0) {
+		fprintf(stderr, "tshark: invalid \"-z wmem\" argument\n");
+		exit(1);
+	}
+
+	/* Only what is allocated from now on is counted */
+	wmem_accounting_enable();
+
+	ws = g_new0(wmemstat_t, 1);
+	ws->entries = g_array_new(FALSE, FALSE, sizeof(wmemstat_entry_t));
+
+	/* Nothing is tapped, this is only for drawing at the end */
+	error_string = register_tap_listener("frame", ws, NULL, 0, NULL, NULL, wmemstat_draw);
+	if (error_string) {
+		/* error, we failed to attach to the tap. complain and clean up */
+		fprintf(stderr, "tshark: Couldn't register wmem tap: %s\n",
+		    error_string->str);
+		g_string_free(error_string, TRUE);
+		g_array_free(ws->entries, TRUE);
+		g_free(ws);
+
+		exit(1);
+	}
+}
+
+static stat_tap_ui wmemstat_ui = {
+	REGISTER_STAT_GROUP_GENERIC,
+	NULL,
+	"wmem",
+	wmemstat_init,
+	-1,
+	0,
+	NULL
+};
+
+void
+register_tap_listener_wmemstat(void)
+{
+	register_stat_tap_ui(&wmemstat_ui, NULL);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -669,13 +669,14 @@ copy_selected_plist_cb(GtkWidget *w _U_, gpointer data _U_, COPY_SELECTED_E acti
     GString *gtk_text_str = g_string_new("");
     char labelstring[ITEM_LABEL_LENGTH];
     char *stringpointer = labelstring;
+    const gchar *label;
 
     switch(action)
     {
     case COPY_SELECTED_DESCRIPTION:
-        if (cfile.finfo_selected->rep &&
-            strlen (cfile.finfo_selected->rep->representation) > 0) {
-            g_string_append(gtk_text_str, cfile.finfo_selected->rep->representation);
+        label = proto_item_get_label(cfile.finfo_selected, labelstring);
+        if (label && strlen (label) > 0) {
+            g_string_append(gtk_text_str, label);
         }
         break;
     case COPY_SELECTED_FIELDNAME:
@@ -432,11 +432,13 @@ ph_capture_get_protocol_abbrev(GtkTreeSelection *selection, capture_file *cf)
 static gchar* ph_capture_get_description(capture_file *cf)
 {
 	gchar *buffer = NULL;
+	gchar label_str[ITEM_LABEL_LENGTH];
+	const gchar *label;
 
-	if(cf->finfo_selected->rep &&
-	   strlen(cf->finfo_selected->rep->representation) > 0)
+	label = proto_item_get_label(cf->finfo_selected, label_str);
+	if(label && strlen(label) > 0)
 	{
-		buffer = g_strdup(cf->finfo_selected->rep->representation);
+		buffer = g_strdup(label);
 	}
 	else
 	{
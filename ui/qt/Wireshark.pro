@@ -232,6 +232,7 @@ FORMS += \
     main_window.ui \
     main_window_preferences_frame.ui \
     manage_interfaces_dialog.ui \
+    memory_usage_dialog.ui \
     module_preferences_scroll_area.ui \
     packet_comment_dialog.ui \
     packet_format_group_box.ui \
@@ -290,6 +291,7 @@ HEADERS += $$HEADERS_WS_C \
     lbm_uimflow_dialog.h \
     main_window_preferences_frame.h \
     manage_interfaces_dialog.h \
+    memory_usage_dialog.h \
     module_preferences_scroll_area.h \
     packet_comment_dialog.h \
     packet_format_group_box.h \
@@ -644,6 +646,7 @@ SOURCES += \
     main_window_preferences_frame.cpp \
     main_window_slots.cpp \
     manage_interfaces_dialog.cpp \
+    memory_usage_dialog.cpp \
     module_preferences_scroll_area.cpp \
     packet_comment_dialog.cpp \
     packet_format_group_box.cpp \
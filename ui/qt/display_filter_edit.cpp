@@ -33,6 +33,9 @@
 
 #include "ui/utf8_entities.h"
 
+// How long to wait after the last keystroke before checking the filter
+const int syntax_check_delay_ = 300; // ms
+
 // platform
 //   osx
 //   win
@@ -213,6 +216,14 @@ DisplayFilterEdit::DisplayFilterEdit(QWidget *parent, bool plain) :
             .arg(bksz.width())
             .arg(cbsz.width() + apsz.width() + frameWidth + 1)
             );
+
+    // Compiling a filter may resolve host names, which can only be done
+    // on this thread, so rather than compiling on every keystroke we
+    // wait until the user stops typing for a moment.
+    syntax_timer_ = new QTimer(this);
+    syntax_timer_->setSingleShot(true);
+    syntax_timer_->setInterval(syntax_check_delay_);
+    connect(syntax_timer_, SIGNAL(timeout()), this, SLOT(checkFilterSyntax()));
 }
 
 void DisplayFilterEdit::paintEvent(QPaintEvent *evt) {
@@ -267,7 +278,20 @@ void DisplayFilterEdit::checkFilter(const QString& text)
     clear_button_->setVisible(!text.isEmpty());
 
     popFilterSyntaxStatus();
-    checkDisplayFilter(text);
+    setSyntaxState(Empty);
+    bookmark_button_->setEnabled(false);
+
+    if (text.isEmpty()) {
+        syntax_timer_->stop();
+        checkFilterSyntax();
+    } else {
+        syntax_timer_->start();
+    }
+}
+
+void DisplayFilterEdit::checkFilterSyntax()
+{
+    checkDisplayFilter(text());
 
     switch (syntaxState()) {
     case Deprecated:
@@ -312,6 +336,11 @@ void DisplayFilterEdit::clearFilter()
 
 void DisplayFilterEdit::applyDisplayFilter()
 {
+    // The delayed check may not have caught up with the text yet.
+    if (syntax_timer_->isActive()) {
+        syntax_timer_->stop();
+        checkFilterSyntax();
+    }
     if (syntaxState() != Valid && syntaxState() != Empty) {
         return;
     }
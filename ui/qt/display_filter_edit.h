@@ -23,6 +23,7 @@
 #define DISPLAYFILTEREDIT_H
 
 #include <QEvent>
+#include <QTimer>
 #include <QToolButton>
 #include "syntax_line_edit.h"
 
@@ -44,6 +45,7 @@ public slots:
 
 private slots:
     void checkFilter(const QString &text);
+    void checkFilterSyntax();
     void bookmarkClicked();
     void clearFilter();
     void changeEvent(QEvent* event);
@@ -54,6 +56,7 @@ private:
     QToolButton *bookmark_button_;
     QToolButton *clear_button_;
     QToolButton *apply_button_;
+    QTimer *syntax_timer_;
 
 signals:
     void pushFilterSyntaxStatus(QString&);
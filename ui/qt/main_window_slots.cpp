@@ -85,6 +85,7 @@
 #include "lbm_uimflow_dialog.h"
 #include "lbm_lbtrm_transport_dialog.h"
 #include "lbm_lbtru_transport_dialog.h"
+#include "memory_usage_dialog.h"
 #include "packet_comment_dialog.h"
 #include "preferences_dialog.h"
 #include "print_dialog.h"
@@ -1642,15 +1643,16 @@ void MainWindow::on_actionFilePrint_triggered()
 void MainWindow::actionEditCopyTriggered(MainWindow::CopySelected selection_type)
 {
     char label_str[ITEM_LABEL_LENGTH];
+    const gchar *label;
     QString clip;
 
     if (!capture_file_.capFile()) return;
 
     switch(selection_type) {
     case CopySelectedDescription:
-        if (capture_file_.capFile()->finfo_selected->rep &&
-                strlen (capture_file_.capFile()->finfo_selected->rep->representation) > 0) {
-            clip.append(capture_file_.capFile()->finfo_selected->rep->representation);
+        label = proto_item_get_label(capture_file_.capFile()->finfo_selected, label_str);
+        if (label && strlen(label) > 0) {
+            clip.append(label);
         }
         break;
     case CopySelectedFieldName:
@@ -2751,6 +2753,12 @@ void MainWindow::on_actionStatisticsProtocolHierarchy_triggered()
     phd->show();
 }
 
+void MainWindow::on_actionStatisticsMemoryUsage_triggered()
+{
+    MemoryUsageDialog *mud = new MemoryUsageDialog(*this, capture_file_);
+    mud->show();
+}
+
 #ifdef HAVE_LIBPCAP
 void MainWindow::on_actionCaptureOptions_triggered()
 {
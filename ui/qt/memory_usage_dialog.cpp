@@ -0,0 +1,177 @@
+/* memory_usage_dialog.cpp
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+ */
+
+#include "memory_usage_dialog.h"
+#include "ui_memory_usage_dialog.h"
+
+#include <epan/proto.h>
+#include <epan/wmem/wmem.h>
+
+#include <QHash>
+#include <QPushButton>
+#include <QTreeWidgetItem>
+
+/*
+ * @file Memory Usage dialog
+ *
+ * Shows the memory each protocol allocated from each wmem scope, as
+ * counted by wmem accounting, which is turned on when the dialog is
+ * first opened.
+ */
+
+const int protocol_col_ = 0;
+const int live_objects_col_ = 1;
+const int live_bytes_col_ = 2;
+const int total_objects_col_ = 3;
+const int total_bytes_col_ = 4;
+
+class MemoryUsageTreeWidgetItem : public QTreeWidgetItem
+{
+public:
+    MemoryUsageTreeWidgetItem(QTreeWidgetItem *parent, const QString &name) :
+        QTreeWidgetItem(parent)
+    {
+        setText(protocol_col_, name);
+        for (int col = live_objects_col_; col <= total_bytes_col_; col++) {
+            counts_[col] = 0;
+            setTextAlignment(col, Qt::AlignRight);
+        }
+    }
+
+    void addCounts(const wmem_accounting_counts_t *counts) {
+        counts_[live_objects_col_] += counts->objects;
+        counts_[live_bytes_col_] += counts->bytes;
+        counts_[total_objects_col_] += counts->total_objects;
+        counts_[total_bytes_col_] += counts->total_bytes;
+        for (int col = live_objects_col_; col <= total_bytes_col_; col++) {
+            setText(col, QString::number(counts_[col]));
+        }
+    }
+
+    bool operator< (const QTreeWidgetItem &other) const
+    {
+        const MemoryUsageTreeWidgetItem &other_muti = dynamic_cast<const MemoryUsageTreeWidgetItem&>(other);
+        int col = treeWidget()->sortColumn();
+
+        if (col >= live_objects_col_ && col <= total_bytes_col_) {
+            return counts_[col] < other_muti.counts_[col];
+        }
+
+        // Fall back to string comparison
+        return QTreeWidgetItem::operator <(other);
+    }
+
+private:
+    quint64 counts_[total_bytes_col_ + 1];
+};
+
+typedef QHash<QString, MemoryUsageTreeWidgetItem *> ScopeItemHash;
+
+struct memory_usage_tree_t {
+    QTreeWidget *tree;
+    ScopeItemHash scopes;
+};
+
+static void
+add_accounting_entry(const char *name, int tag, const wmem_accounting_counts_t *counts, void *data)
+{
+    memory_usage_tree_t *mut = static_cast<memory_usage_tree_t *>(data);
+    MemoryUsageTreeWidgetItem *scope_item = mut->scopes.value(name);
+    QString proto_name = QObject::tr("(no protocol)");
+
+    if (!scope_item) {
+        scope_item = new MemoryUsageTreeWidgetItem(mut->tree->invisibleRootItem(), name);
+        mut->scopes.insert(name, scope_item);
+    }
+
+    if (tag != WMEM_ACCOUNTING_NO_TAG) {
+        protocol_t *protocol = find_protocol_by_id(tag);
+        proto_name = protocol ? proto_get_protocol_short_name(protocol) : QObject::tr("(unknown)");
+    }
+
+    MemoryUsageTreeWidgetItem *proto_item = new MemoryUsageTreeWidgetItem(scope_item, proto_name);
+    proto_item->addCounts(counts);
+    scope_item->addCounts(counts);
+}
+
+MemoryUsageDialog::MemoryUsageDialog(QWidget &parent, CaptureFile &cf) :
+    WiresharkDialog(parent, cf),
+    ui(new Ui::MemoryUsageDialog)
+{
+    ui->setupUi(this);
+    setWindowSubtitle(tr("Memory Usage"));
+
+    // XXX Use recent settings instead
+    resize(parent.width() * 3 / 5, parent.height() * 3 / 5);
+
+    if (wmem_accounting_enabled()) {
+        ui->hintLabel->setText(tr("<small><i>Live counts are of what was allocated since the scope "
+                                  "was last freed, including memory given back early. "
+                                  "Reallocations count their new size.</i></small>"));
+    } else {
+        // Accounting costs a little on every allocation, so it stays off
+        // until somebody wants to see it.
+        wmem_accounting_enable();
+        ui->hintLabel->setText(tr("<small><i>Memory is counted from now on. "
+                                  "Reload the capture file to count everything it allocates.</i></small>"));
+    }
+
+    refresh_button_ = ui->buttonBox->addButton(tr("Refresh"), QDialogButtonBox::ActionRole);
+    connect(refresh_button_, SIGNAL(clicked()), this, SLOT(refresh()));
+
+    ui->memoryTreeWidget->setSortingEnabled(true);
+    ui->memoryTreeWidget->sortByColumn(total_bytes_col_, Qt::DescendingOrder);
+
+    refresh();
+}
+
+MemoryUsageDialog::~MemoryUsageDialog()
+{
+    delete ui;
+}
+
+void MemoryUsageDialog::refresh()
+{
+    memory_usage_tree_t mut;
+
+    mut.tree = ui->memoryTreeWidget;
+    ui->memoryTreeWidget->clear();
+    wmem_accounting_foreach(add_accounting_entry, &mut);
+
+    ui->memoryTreeWidget->expandAll();
+    for (int i = 0; i < ui->memoryTreeWidget->columnCount(); i++) {
+        ui->memoryTreeWidget->resizeColumnToContents(i);
+    }
+}
+
+/*
+ * Editor modelines
+ *
+ * Local Variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
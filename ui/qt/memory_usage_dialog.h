@@ -0,0 +1,62 @@
+/* memory_usage_dialog.h
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MEMORY_USAGE_DIALOG_H
+#define MEMORY_USAGE_DIALOG_H
+
+#include "wireshark_dialog.h"
+
+class QPushButton;
+
+namespace Ui {
+class MemoryUsageDialog;
+}
+
+class MemoryUsageDialog : public WiresharkDialog
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryUsageDialog(QWidget &parent, CaptureFile &cf);
+    ~MemoryUsageDialog();
+
+private slots:
+    void refresh();
+
+private:
+    Ui::MemoryUsageDialog *ui;
+    QPushButton *refresh_button_;
+};
+
+#endif // MEMORY_USAGE_DIALOG_H
+
+/*
+ * Editor modelines
+ *
+ * Local Variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
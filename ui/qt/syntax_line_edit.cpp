@@ -94,7 +94,7 @@ void SyntaxLineEdit::checkDisplayFilter(QString filter)
     deprecated_token_.clear();
     dfilter_t *dfp = NULL;
     gchar *err_msg;
-    if (dfilter_compile(filter.toUtf8().constData(), &dfp, &err_msg)) {
+    if (dfilter_compile_cached(filter.toUtf8().constData(), &dfp, &err_msg)) {
         GPtrArray *depr = NULL;
         if (dfp) {
             depr = dfilter_deprecated_tokens(dfp);
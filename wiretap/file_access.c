@@ -680,6 +680,18 @@ get_file_extension(const char *pathname)
 	return extensionp;
 }
 
+/*
+ * Whether wtap_open_offline() should use, and save, seek index files
+ * for compressed files opened for random access.
+ */
+static gboolean use_seek_indexes = FALSE;
+
+void
+wtap_set_use_seek_indexes(gboolean use)
+{
+	use_seek_indexes = use;
+}
+
 /*
  * Check if file extension is used in this heuristic
  */
@@ -854,6 +866,15 @@ wtap_open_offline(const char *filename, unsigned int type, int *err, char **err_
 
 		file_set_random_access(wth->fh, FALSE, wth->fast_seek);
 		file_set_random_access(wth->random_fh, TRUE, wth->fast_seek);
+
+		/*
+		 * If we've been through this file before, we might
+		 * already know where to seek to; if not, save what
+		 * we find this time.  Only if asked to, as that
+		 * writes a file next to the capture file.
+		 */
+		if (use_seek_indexes)
+			file_set_seek_index(wth->fh, filename);
 	}
 
 	/* 'type' is 1 greater than the array index */
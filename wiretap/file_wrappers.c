@@ -51,6 +51,10 @@
 #include <fcntl.h>
 #endif /* HAVE_FCNTL_H */
 #include <string.h>
+#ifdef HAVE_MMAP
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif /* HAVE_MMAP */
 #include "wtap-int.h"
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
@@ -145,6 +149,13 @@ struct wtap_reader {
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+    /* memory mapping */
+    unsigned char *map;        /* mapping of the file, or NULL if not mapped */
+    gint64 map_size;           /* size of the mapping */
+    /* reading ahead in another thread */
+    struct read_ahead *ra;     /* NULL if not reading ahead */
+    /* saving the fast seek points */
+    char *seek_index;          /* where to, or NULL if not saving them */
 };
 
 static int     /* gz_load */
@@ -170,6 +181,96 @@ raw_read(FILE_T state, unsigned char *buf, unsigned int count, guint *have)
     return 0;
 }
 
+#ifdef HAVE_MMAP
+/*
+ * Uncompressed regular files are memory-mapped if possible, and their
+ * data is then delivered straight out of the mapping, MAP_WINDOW bytes
+ * at a time, rather than being read() into the output buffer; that
+ * also lets file_read_mapped() hand out pointers into the mapping
+ * without copying anything.
+ *
+ * The mapping covers the file as it was when it was found not to be
+ * compressed; anything appended to it after that, as happens when
+ * reading a file that's still being written to by a capture, is read()
+ * as usual.  When the file is reopened, the old mapping is dropped and
+ * the newly opened file mapped in its place.
+ *
+ * The mapping is private and writable, so that callers that modify the
+ * packet data they're handed, as editcap does, get copies of the pages
+ * in question rather than a crash, but that means that it's counted
+ * against the commit limit on systems that don't overcommit; if we
+ * can't map the file, we just read it.
+ */
+#define MAP_WINDOW (1024*1024)
+
+static void
+map_file(FILE_T state, int fd)
+{
+    ws_statb64 st;
+    void *map;
+
+    if (ws_fstat64(fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+        st.st_size <= state->start)
+        return;
+
+    /* Don't eat up a 32-bit address space */
+    if ((guint64)st.st_size > G_MAXSIZE / 4)
+        return;
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+               fd, 0);
+    if (map == MAP_FAILED)
+        return;
+    state->map = (unsigned char *)map;
+    state->map_size = st.st_size;
+}
+
+/*
+ * Make the output buffer the part of the mapping at the current
+ * position; returns FALSE if the current position isn't in the mapping.
+ */
+static gboolean
+map_window(FILE_T state)
+{
+    gint64 off = state->start + state->pos;
+    gint64 left = state->map_size - off;
+
+    if (left <= 0)
+        return FALSE;
+    state->next = state->map + off;
+    state->have = left > MAP_WINDOW ? MAP_WINDOW : (guint)left;
+    state->raw_pos = off + state->have;
+    return TRUE;
+}
+
+/*
+ * Replace the mapping with one of the file open on fd, which has just
+ * been reopened.  If the output buffer is a window of the old mapping,
+ * it's made the same window of the new one or, if that doesn't cover
+ * it, emptied, so that the rest is read() from where we are.
+ */
+static void
+remap_file(FILE_T state, int fd)
+{
+    gint64 off = state->next - state->map;
+    gboolean in_map = off >= 0 && off <= state->map_size;
+
+    munmap(state->map, (size_t)state->map_size);
+    state->map = NULL;
+    state->map_size = 0;
+    map_file(state, fd);
+    if (!in_map)
+        return;
+    if (state->map != NULL && off + state->have <= state->map_size) {
+        state->next = state->map + off;
+    } else {
+        state->next = state->out;
+        state->have = 0;
+        state->raw_pos = state->start + state->pos;
+    }
+}
+#endif /* HAVE_MMAP */
+
 static int /* gz_avail */
 fill_in_buffer(FILE_T state)
 {
@@ -702,12 +803,24 @@ gz_head(FILE_T state)
         state->avail_in = 0;
     }
     state->compression = UNCOMPRESSED;
+#ifdef HAVE_MMAP
+    if (!state->is_compressed && state->map == NULL) {
+        /* What we've read so far is in the mapping as well */
+        map_file(state, state->fd);
+        if (state->map != NULL)
+            map_window(state);
+    }
+#endif
     return 0;
 }
 
+static int read_ahead_fill_out_buffer(FILE_T state);
+
 static int /* gz_make */
 fill_out_buffer(FILE_T state)
 {
+    if (state->ra != NULL)
+        return read_ahead_fill_out_buffer(state);
     if (state->compression == UNKNOWN) {           /* look for gzip header */
         if (gz_head(state) == -1)
             return -1;
@@ -715,6 +828,23 @@ fill_out_buffer(FILE_T state)
             return 0;
     }
     if (state->compression == UNCOMPRESSED) {           /* straight copy */
+#ifdef HAVE_MMAP
+        if (state->map != NULL) {
+            if (map_window(state))
+                return 0;
+
+            /*
+             * We're past the end of the mapping, and the descriptor
+             * isn't necessarily where we are; put it there.
+             */
+            state->raw_pos = state->start + state->pos;
+            if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+                state->err = errno;
+                state->err_info = NULL;
+                return -1;
+            }
+        }
+#endif
         if (raw_read(state, state->out, state->size /* << 1 */, &(state->have)) == -1)
             return -1;
         state->next = state->out;
@@ -777,6 +907,449 @@ gz_reset(FILE_T state)
     state->avail_in = 0;          /* no input data yet */
 }
 
+/*
+ * Reading ahead.
+ *
+ * If file_set_read_ahead() is called on a file, another thread reads
+ * and, if need be, decompresses it ahead of us, into a ring of
+ * READ_AHEAD_CHUNKS chunks, so that that can go on while whatever we
+ * hand the data to, such as a dissector, is busy with it.
+ *
+ * The thread has a reader of its own, on a duplicate of the file
+ * descriptor, and does its reading with it exactly as we would have;
+ * once a file is reading ahead, its own output buffer is only ever
+ * filled from the chunks, and its descriptor, input buffer and inflate
+ * stream are left alone.  When we want data from somewhere other than
+ * where the thread is reading, we stop it, move its reader there with
+ * file_seek(), and start it again.
+ *
+ * Fast seek points found by the thread are put in an array of its own,
+ * and handed over with the chunk they were found in, to be added to
+ * the file's array when we get to that chunk; the file's array is
+ * shared with the random-access reader, so the thread mustn't touch it.
+ * The thread's array starts with a point of its own, with just the
+ * offset of the last point in the file's array, so that it doesn't add
+ * points that are already there.
+ */
+#define READ_AHEAD_CHUNKS       4
+#define READ_AHEAD_CHUNK_SIZE   (256*1024)
+
+struct read_ahead_chunk {
+    unsigned char *data;
+    guint len;                 /* amount of data */
+    gint64 pos;                /* offset of data in uncompressed data */
+    gint64 raw_pos;            /* the reader's raw_pos after reading it */
+    int err;                   /* error after the data, or 0 */
+    const char *err_info;
+    gboolean eof;              /* TRUE if the data ends at the end of the file */
+    GPtrArray *fast_seek;      /* fast seek points found reading it, or NULL */
+};
+
+struct read_ahead {
+    FILE_T reader;             /* the thread's reader */
+    GThread *thread;
+    GMutex *mutex;             /* protects everything below */
+    GCond *cond;               /* signalled when any of it changes */
+    struct read_ahead_chunk chunks[READ_AHEAD_CHUNKS];
+    guint head;                /* first chunk read */
+    guint filled;              /* number of chunks read, starting at head */
+    gboolean in_use;           /* TRUE if the head chunk is our output buffer */
+    gboolean busy;             /* TRUE if the thread is reading a chunk */
+    gboolean stopped;          /* TRUE if the thread is to read no more for now */
+    gboolean quit;             /* TRUE if the thread is to exit */
+    GPtrArray *fast_seek;      /* the file's fast seek points, or NULL */
+    GPtrArray *reader_fast_seek;            /* the thread's, or NULL */
+    struct fast_seek_point last_fast_seek;  /* see above */
+};
+
+#ifndef S_ISREG
+#define S_ISREG(mode)   (((mode) & S_IFMT) == S_IFREG)
+#endif
+
+/*
+ * Read the next chunk, as file_read() would, except that we keep what
+ * we got before an error.
+ */
+static void
+read_ahead_chunk(struct read_ahead *ra, struct read_ahead_chunk *chunk)
+{
+    FILE_T reader = ra->reader;
+    guint n;
+
+    /* process a skip request */
+    if (reader->seek_pending) {
+        reader->seek_pending = FALSE;
+        (void)gz_skip(reader, reader->skip);
+    }
+
+    chunk->pos = reader->pos;
+    chunk->len = 0;
+    chunk->err = 0;
+    chunk->err_info = NULL;
+    chunk->eof = FALSE;
+    while (chunk->len < READ_AHEAD_CHUNK_SIZE) {
+        if (reader->have) {
+            n = MIN(reader->have, READ_AHEAD_CHUNK_SIZE - chunk->len);
+            memcpy(chunk->data + chunk->len, reader->next, n);
+            reader->next += n;
+            reader->have -= n;
+            reader->pos += n;
+            chunk->len += n;
+        } else if (reader->err) {
+            chunk->err = reader->err;
+            chunk->err_info = reader->err_info;
+            chunk->eof = reader->eof;
+            break;
+        } else if (reader->eof && reader->avail_in == 0) {
+            chunk->eof = TRUE;
+            break;
+        } else {
+            /* on an error, the err check above catches it */
+            (void)fill_out_buffer(reader);
+        }
+    }
+    chunk->raw_pos = reader->raw_pos;
+
+    /* Hand over the fast seek points we found, keeping the last one's offset */
+    if (reader->fast_seek != NULL && reader->fast_seek->len > 1) {
+        struct fast_seek_point *last;
+
+        chunk->fast_seek = g_ptr_array_sized_new(reader->fast_seek->len - 1);
+        for (n = 1; n < reader->fast_seek->len; n++)
+            g_ptr_array_add(chunk->fast_seek, reader->fast_seek->pdata[n]);
+        last = (struct fast_seek_point *)reader->fast_seek->pdata[reader->fast_seek->len - 1];
+        ra->last_fast_seek.out = last->out;
+        g_ptr_array_set_size(reader->fast_seek, 1);
+    }
+}
+
+static gpointer
+read_ahead_thread(gpointer data)
+{
+    struct read_ahead *ra = (struct read_ahead *)data;
+    struct read_ahead_chunk *chunk;
+
+    g_mutex_lock(ra->mutex);
+    for (;;) {
+        while (!ra->quit && (ra->stopped || ra->filled == READ_AHEAD_CHUNKS))
+            g_cond_wait(ra->cond, ra->mutex);
+        if (ra->quit)
+            break;
+
+        chunk = &ra->chunks[(ra->head + ra->filled) % READ_AHEAD_CHUNKS];
+        ra->busy = TRUE;
+        g_mutex_unlock(ra->mutex);
+
+        read_ahead_chunk(ra, chunk);
+
+        g_mutex_lock(ra->mutex);
+        ra->busy = FALSE;
+        ra->filled++;
+        /* There's nothing more to read until we're moved */
+        if (chunk->err || chunk->eof)
+            ra->stopped = TRUE;
+        g_cond_broadcast(ra->cond);
+    }
+    g_mutex_unlock(ra->mutex);
+    return NULL;
+}
+
+/*
+ * Add the fast seek points found reading a chunk to the file's; called
+ * with the mutex held.
+ */
+static void
+read_ahead_add_fast_seek(struct read_ahead *ra, struct read_ahead_chunk *chunk, gboolean keep)
+{
+    struct fast_seek_point *item, *last;
+    guint i;
+
+    if (chunk->fast_seek == NULL)
+        return;
+    for (i = 0; i < chunk->fast_seek->len; i++) {
+        item = (struct fast_seek_point *)chunk->fast_seek->pdata[i];
+        last = NULL;
+        if (keep && ra->fast_seek->len != 0)
+            last = (struct fast_seek_point *)ra->fast_seek->pdata[ra->fast_seek->len - 1];
+        /* The random-access reader may have got there first */
+        if (keep && (last == NULL || last->out < item->out))
+            g_ptr_array_add(ra->fast_seek, item);
+        else
+            g_free(item);
+    }
+    g_ptr_array_free(chunk->fast_seek, TRUE);
+    chunk->fast_seek = NULL;
+}
+
+/* We're done with the head chunk; called with the mutex held. */
+static void
+read_ahead_release(struct read_ahead *ra)
+{
+    read_ahead_add_fast_seek(ra, &ra->chunks[ra->head], TRUE);
+    ra->head = (ra->head + 1) % READ_AHEAD_CHUNKS;
+    ra->filled--;
+    ra->in_use = FALSE;
+    g_cond_broadcast(ra->cond);
+}
+
+/*
+ * Stop the thread, and throw away what it's read, other than the chunk
+ * we're using; called with the mutex held.
+ */
+static void
+read_ahead_stop(struct read_ahead *ra)
+{
+    guint keep = ra->in_use ? 1 : 0;
+    guint i;
+
+    ra->stopped = TRUE;
+    while (ra->busy)
+        g_cond_wait(ra->cond, ra->mutex);
+    for (i = keep; i < ra->filled; i++)
+        read_ahead_add_fast_seek(ra, &ra->chunks[(ra->head + i) % READ_AHEAD_CHUNKS], FALSE);
+    ra->filled = keep;
+}
+
+/*
+ * Move the thread's reader to where we are, and start the thread again;
+ * called with the mutex held and the thread stopped.
+ */
+static int
+read_ahead_restart(FILE_T state)
+{
+    struct read_ahead *ra = state->ra;
+    FILE_T reader = ra->reader;
+    int err;
+
+    /* It can use the file's fast seek points to get there */
+    reader->fast_seek = ra->fast_seek;
+    if (file_seek(reader, state->pos, SEEK_SET, &err) == -1) {
+        reader->fast_seek = ra->reader_fast_seek;
+        state->err = err;
+        state->err_info = NULL;
+        return -1;
+    }
+    /* We've no error, so it's to try again */
+    file_clearerr(reader);
+
+    reader->fast_seek = ra->reader_fast_seek;
+    if (ra->fast_seek != NULL) {
+        ra->last_fast_seek.out = -1;
+        if (ra->fast_seek->len != 0)
+            ra->last_fast_seek.out =
+                ((struct fast_seek_point *)ra->fast_seek->pdata[ra->fast_seek->len - 1])->out;
+    }
+
+    ra->stopped = FALSE;
+    g_cond_broadcast(ra->cond);
+    return 0;
+}
+
+/*
+ * Make the chunk with the data at the current position our output
+ * buffer, waiting for it to be read if need be; this is what
+ * fill_out_buffer() does when reading ahead.
+ */
+static int
+read_ahead_fill_out_buffer(FILE_T state)
+{
+    struct read_ahead *ra = state->ra;
+    struct read_ahead_chunk *chunk;
+    guint off;
+    int ret = 0;
+
+    g_mutex_lock(ra->mutex);
+    if (ra->in_use)
+        read_ahead_release(ra);
+    for (;;) {
+        if (ra->filled == 0) {
+            if (!ra->stopped || ra->busy) {
+                g_cond_wait(ra->cond, ra->mutex);
+            } else if (read_ahead_restart(state) == -1) {
+                ret = -1;
+                break;
+            }
+            continue;
+        }
+
+        chunk = &ra->chunks[ra->head];
+        if (chunk->pos > state->pos) {
+            /* We've gone back; so must the thread */
+            read_ahead_stop(ra);
+            continue;
+        }
+        if (chunk->pos + chunk->len <= state->pos && !chunk->err && !chunk->eof) {
+            /* We've skipped over this one */
+            read_ahead_release(ra);
+            continue;
+        }
+
+        /* That's ours; anything after what it's got is past the end */
+        if (state->pos > chunk->pos + chunk->len)
+            state->pos = chunk->pos + chunk->len;
+        read_ahead_add_fast_seek(ra, chunk, TRUE);
+        off = (guint)(state->pos - chunk->pos);
+        state->next = chunk->data + off;
+        state->have = chunk->len - off;
+        state->raw_pos = chunk->raw_pos;
+        if (chunk->err) {
+            state->err = chunk->err;
+            state->err_info = chunk->err_info;
+        }
+        if (chunk->eof)
+            state->eof = TRUE;
+        ra->in_use = TRUE;
+        break;
+    }
+    g_mutex_unlock(ra->mutex);
+    return ret;
+}
+
+/*
+ * file_seek() when reading ahead, with offset relative to the current
+ * position; within the chunk we're using, we just move, otherwise
+ * read_ahead_fill_out_buffer() sorts things out when we next read.
+ */
+static gint64
+read_ahead_seek(FILE_T file, gint64 offset, int *err)
+{
+    struct read_ahead *ra = file->ra;
+    struct read_ahead_chunk *chunk;
+    gint64 pos = file->pos + offset;
+
+    if (pos < 0) {
+        *err = EINVAL;
+        return -1;
+    }
+    if (ra->in_use) {
+        /* Unless we've already moved off it, next is at file->pos */
+        chunk = &ra->chunks[ra->head];
+        if (file->next == chunk->data + (file->pos - chunk->pos) &&
+            pos >= chunk->pos && pos <= chunk->pos + chunk->len) {
+            file->next = chunk->data + (guint)(pos - chunk->pos);
+            file->have = chunk->len - (guint)(pos - chunk->pos);
+            file->pos = pos;
+            return file->pos;
+        }
+    }
+    if (offset < 0) {
+        /* as when rewinding */
+        file->eof = FALSE;
+        file->err = 0;
+        file->err_info = NULL;
+    }
+    file->have = 0;
+    file->pos = pos;
+    return file->pos;
+}
+
+void
+file_set_read_ahead(FILE_T file)
+{
+    ws_statb64 st;
+    struct read_ahead *ra;
+    FILE_T reader;
+    int fd;
+    int i;
+
+    if (file->ra != NULL)
+        return;
+
+#ifdef HAVE_MMAP
+    /* Reading straight out of the mapping is better */
+    if (file->map != NULL)
+        return;
+#endif
+
+    /*
+     * The thread starts over from the beginning of the file, so we
+     * can't do this with a pipe.
+     */
+    if (ws_fstat64(file->fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return;
+
+#if !GLIB_CHECK_VERSION(2,31,0)
+    if (!g_thread_supported())
+        return;
+#endif
+
+    fd = ws_dup(file->fd);
+    if (fd == -1)
+        return;
+    if (ws_lseek64(fd, file->start, SEEK_SET) == -1 ||
+        (reader = file_fdopen(fd)) == NULL) {
+        ws_close(fd);
+        return;
+    }
+#ifdef HAVE_LIBZ
+    reader->dont_check_crc = file->dont_check_crc;
+#endif
+
+    ra = g_new0(struct read_ahead, 1);
+    ra->reader = reader;
+    for (i = 0; i < READ_AHEAD_CHUNKS; i++)
+        ra->chunks[i].data = (unsigned char *)g_malloc(READ_AHEAD_CHUNK_SIZE);
+    ra->fast_seek = file->fast_seek;
+    if (ra->fast_seek != NULL) {
+        ra->reader_fast_seek = g_ptr_array_new();
+        g_ptr_array_add(ra->reader_fast_seek, &ra->last_fast_seek);
+    }
+    /* It's moved to where we are when we first need something */
+    ra->stopped = TRUE;
+
+    /* What we've got in our input buffer is the thread's business now */
+    file->avail_in = 0;
+    file->eof = FALSE;
+
+#if GLIB_CHECK_VERSION(2,31,0)
+    ra->mutex = g_new(GMutex, 1);
+    g_mutex_init(ra->mutex);
+    ra->cond = g_new(GCond, 1);
+    g_cond_init(ra->cond);
+    ra->thread = g_thread_new("File read ahead", read_ahead_thread, ra);
+#else
+    ra->mutex = g_mutex_new();
+    ra->cond = g_cond_new();
+    ra->thread = g_thread_create(read_ahead_thread, ra, TRUE, NULL);
+#endif
+    file->ra = ra;
+}
+
+static void
+read_ahead_free(struct read_ahead *ra)
+{
+    guint i;
+
+    g_mutex_lock(ra->mutex);
+    ra->quit = TRUE;
+    g_cond_broadcast(ra->cond);
+    g_mutex_unlock(ra->mutex);
+    g_thread_join(ra->thread);
+
+    for (i = 0; i < READ_AHEAD_CHUNKS; i++) {
+        read_ahead_add_fast_seek(ra, &ra->chunks[i], FALSE);
+        g_free(ra->chunks[i].data);
+    }
+    if (ra->reader_fast_seek != NULL) {
+        /* The first one is ra->last_fast_seek */
+        for (i = 1; i < ra->reader_fast_seek->len; i++)
+            g_free(ra->reader_fast_seek->pdata[i]);
+        g_ptr_array_free(ra->reader_fast_seek, TRUE);
+    }
+    file_close(ra->reader);
+
+#if GLIB_CHECK_VERSION(2,31,0)
+    g_mutex_clear(ra->mutex);
+    g_free(ra->mutex);
+    g_cond_clear(ra->cond);
+    g_free(ra->cond);
+#else
+    g_mutex_free(ra->mutex);
+    g_cond_free(ra->cond);
+#endif
+    g_free(ra);
+}
+
 FILE_T
 file_fdopen(int fd)
 {
@@ -796,6 +1369,10 @@ file_fdopen(int fd)
 
     state->fast_seek_cur = NULL;
     state->fast_seek = NULL;
+    state->map = NULL;
+    state->map_size = 0;
+    state->ra = NULL;
+    state->seek_index = NULL;
 
     /* open the file with the appropriate mode (or just use fd) */
     state->fd = fd;
@@ -918,6 +1495,241 @@ file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
     stream->fast_seek = seek;
 }
 
+#ifdef HAVE_LIBZ
+/*
+ * Finding the fast seek points for a compressed file means reading,
+ * and decompressing, all of it, and until the sequential pass has got
+ * that far, seeking to somewhere near the end means decompressing
+ * everything in between.  So, once we've been through a file, we save
+ * the points we found to a "seek index" file next to it, with the
+ * size and modification time of the file they're for; the next time
+ * it's opened, if the file hasn't changed, they're all there from
+ * the start.
+ *
+ * The seek index is a header followed by a record for each point,
+ * all big-endian, with the point's 32K window compressed after the
+ * record.  If we can't write it, as when the file is somewhere we
+ * can't write to, we just don't; if there's anything wrong with one
+ * we read, we ignore it and write a new one.
+ */
+#define SEEK_INDEX_SUFFIX   ".seekidx"
+#define SEEK_INDEX_MAGIC    0x57534958  /* "WSIX" */
+#define SEEK_INDEX_VERSION  1
+
+struct seek_index_hdr {
+    guint32 magic;
+    guint32 version;
+    guint64 size;          /* size of the file the points are for */
+    guint64 mtime;         /* and its modification time */
+    guint32 count;         /* number of points */
+    guint32 pad;
+};
+
+struct seek_index_rec {
+    guint64 out;
+    guint64 in;
+    guint32 compression;
+    guint32 bits;
+    guint32 adler;
+    guint32 total_out;
+    guint32 window_len;    /* compressed size of the window, or 0 if none */
+    guint32 pad;
+};
+
+static gboolean
+seek_index_read(FILE_T file, const char *path, const ws_statb64 *st)
+{
+    FILE *fp;
+    struct seek_index_hdr hdr;
+    struct seek_index_rec rec;
+    struct fast_seek_point *point;
+    unsigned char *buf;
+    uLong buf_size = compressBound(ZLIB_WINSIZE);
+    uLongf len;
+    guint32 i, count;
+    gint64 last_out = -1;
+    gboolean ok = FALSE;
+
+    if ((fp = ws_fopen(path, "rb")) == NULL)
+        return FALSE;
+    if (fread(&hdr, sizeof hdr, 1, fp) != 1 ||
+        GUINT32_FROM_BE(hdr.magic) != SEEK_INDEX_MAGIC ||
+        GUINT32_FROM_BE(hdr.version) != SEEK_INDEX_VERSION ||
+        GUINT64_FROM_BE(hdr.size) != (guint64)st->st_size ||
+        GUINT64_FROM_BE(hdr.mtime) != (guint64)st->st_mtime) {
+        fclose(fp);
+        return FALSE;
+    }
+    count = GUINT32_FROM_BE(hdr.count);
+
+    buf = (unsigned char *)g_malloc(buf_size);
+    for (i = 0; i < count; i++) {
+        if (fread(&rec, sizeof rec, 1, fp) != 1)
+            break;
+        point = g_new(struct fast_seek_point, 1);
+        g_ptr_array_add(file->fast_seek, point);
+        point->out = (gint64)GUINT64_FROM_BE(rec.out);
+        point->in = (gint64)GUINT64_FROM_BE(rec.in);
+        point->compression = (compression_t)GUINT32_FROM_BE(rec.compression);
+        if (point->out <= last_out || point->in < 0 || point->in > st->st_size)
+            break;
+        last_out = point->out;
+
+        if (point->compression == ZLIB) {
+            guint32 bits = GUINT32_FROM_BE(rec.bits);
+
+#ifdef HAVE_INFLATEPRIME
+            if (bits > 7)
+                break;
+            point->data.zlib.bits = bits;
+#else
+            if (bits != 0)
+                break;
+#endif
+            point->data.zlib.adler = GUINT32_FROM_BE(rec.adler);
+            point->data.zlib.total_out = GUINT32_FROM_BE(rec.total_out);
+            len = GUINT32_FROM_BE(rec.window_len);
+            if (len > buf_size || fread(buf, 1, len, fp) != len)
+                break;
+            len = ZLIB_WINSIZE;
+            if (uncompress(point->data.zlib.window, &len, buf,
+                           GUINT32_FROM_BE(rec.window_len)) != Z_OK ||
+                len != ZLIB_WINSIZE)
+                break;
+        } else if (point->compression != UNCOMPRESSED &&
+                   point->compression != GZIP_AFTER_HEADER)
+            break;
+    }
+    if (i == count && count != 0 && getc(fp) == EOF)
+        ok = TRUE;
+    g_free(buf);
+    fclose(fp);
+
+    if (!ok) {
+        for (i = 0; i < file->fast_seek->len; i++)
+            g_free(file->fast_seek->pdata[i]);
+        g_ptr_array_set_size(file->fast_seek, 0);
+    }
+    return ok;
+}
+
+static void
+seek_index_write(FILE_T file)
+{
+    ws_statb64 st;
+    int fd;
+    FILE *fp;
+    char *tmp_path;
+    struct seek_index_hdr hdr;
+    struct seek_index_rec rec;
+    struct fast_seek_point *point;
+    unsigned char *buf;
+    uLong buf_size = compressBound(ZLIB_WINSIZE);
+    uLongf len;
+    guint i;
+    gboolean ok = TRUE;
+
+    /* Only worth it if there are points in the middle of the compressed data */
+    for (i = 0; i < file->fast_seek->len; i++) {
+        point = (struct fast_seek_point *)file->fast_seek->pdata[i];
+        if (point->compression == ZLIB)
+            break;
+    }
+    if (i == file->fast_seek->len)
+        return;
+
+    if (ws_fstat64(file->fd, &st) == -1)
+        return;
+
+    /*
+     * Write it to a new, uniquely-named, file, created with O_EXCL, and
+     * rename that into place, so that nobody can have us write through
+     * a link they planted, and nobody reads a half-written index.
+     */
+    tmp_path = g_strconcat(file->seek_index, ".XXXXXX", NULL);
+    if ((fd = g_mkstemp(tmp_path)) == -1) {
+        g_free(tmp_path);
+        return;
+    }
+    if ((fp = ws_fdopen(fd, "wb")) == NULL) {
+        ws_close(fd);
+        ws_unlink(tmp_path);
+        g_free(tmp_path);
+        return;
+    }
+
+    hdr.magic = GUINT32_TO_BE(SEEK_INDEX_MAGIC);
+    hdr.version = GUINT32_TO_BE(SEEK_INDEX_VERSION);
+    hdr.size = GUINT64_TO_BE((guint64)st.st_size);
+    hdr.mtime = GUINT64_TO_BE((guint64)st.st_mtime);
+    hdr.count = GUINT32_TO_BE(file->fast_seek->len);
+    hdr.pad = 0;
+    if (fwrite(&hdr, sizeof hdr, 1, fp) != 1)
+        ok = FALSE;
+
+    buf = (unsigned char *)g_malloc(buf_size);
+    for (i = 0; ok && i < file->fast_seek->len; i++) {
+        point = (struct fast_seek_point *)file->fast_seek->pdata[i];
+        memset(&rec, 0, sizeof rec);
+        rec.out = GUINT64_TO_BE((guint64)point->out);
+        rec.in = GUINT64_TO_BE((guint64)point->in);
+        rec.compression = GUINT32_TO_BE((guint32)point->compression);
+        len = 0;
+        if (point->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+            rec.bits = GUINT32_TO_BE((guint32)point->data.zlib.bits);
+#endif
+            rec.adler = GUINT32_TO_BE(point->data.zlib.adler);
+            rec.total_out = GUINT32_TO_BE(point->data.zlib.total_out);
+            len = buf_size;
+            if (compress2(buf, &len, point->data.zlib.window, ZLIB_WINSIZE,
+                          Z_BEST_SPEED) != Z_OK) {
+                ok = FALSE;
+                break;
+            }
+            rec.window_len = GUINT32_TO_BE((guint32)len);
+        }
+        if (fwrite(&rec, sizeof rec, 1, fp) != 1 ||
+            (len != 0 && fwrite(buf, 1, len, fp) != len))
+            ok = FALSE;
+    }
+    g_free(buf);
+
+    if (fclose(fp) == EOF)
+        ok = FALSE;
+    if (!ok || ws_rename(tmp_path, file->seek_index) == -1)
+        ws_unlink(tmp_path);
+    g_free(tmp_path);
+}
+#endif /* HAVE_LIBZ */
+
+void
+file_set_seek_index(FILE_T file, const char *path _U_)
+{
+#ifdef HAVE_LIBZ
+    ws_statb64 st;
+    char *index_path;
+
+    /*
+     * This is for the sequential side, which finds the points, and
+     * only before it's found any.
+     */
+    if (file->fast_seek == NULL || file->fast_seek->len != 0)
+        return;
+    if (ws_fstat64(file->fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return;
+
+    index_path = g_strconcat(path, SEEK_INDEX_SUFFIX, NULL);
+    if (seek_index_read(file, index_path, &st)) {
+        /* Nothing more to find */
+        g_free(index_path);
+        return;
+    }
+    g_free(file->seek_index);
+    file->seek_index = index_path;
+#endif
+}
+
 gint64
 file_seek(FILE_T file, gint64 offset, int whence, int *err)
 {
@@ -949,6 +1761,31 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
         offset += file->skip;
     file->seek_pending = FALSE;
 
+    if (file->ra != NULL)
+        return read_ahead_seek(file, offset, err);
+
+#ifdef HAVE_MMAP
+    if (file->map != NULL && file->compression == UNCOMPRESSED) {
+        /*
+         * Everything in the mapping can be got at directly, and
+         * fill_out_buffer() puts the descriptor where it needs to
+         * be for anything after it; just go there.
+         */
+        if (file->pos + offset < 0) {
+            *err = EINVAL;
+            return -1;
+        }
+        file->pos += offset;
+        file->have = 0;
+        file->eof = FALSE;
+        file->err = 0;
+        file->err_info = NULL;
+        file->avail_in = 0;
+        map_window(file);
+        return file->pos;
+    }
+#endif
+
     /*
      * Are we seeking backwards and, if so, do we have data in the buffer?
      */
@@ -1262,6 +2099,51 @@ file_read(void *buf, unsigned int len, FILE_T file)
     return (int)got;
 }
 
+/*
+ * If the next len bytes are in the file's memory mapping, skip over
+ * them, as file_read() would, and return a pointer to them in the
+ * mapping, which stays valid until the file is closed or reopened;
+ * otherwise return NULL without doing anything, and the caller should
+ * file_read() them instead.
+ */
+#ifdef HAVE_MMAP
+unsigned char *
+file_read_mapped(unsigned int len, FILE_T file)
+{
+    unsigned char *data;
+
+    if (file->map == NULL || file->compression != UNCOMPRESSED || file->err)
+        return NULL;
+
+    /* process a skip request */
+    if (file->seek_pending) {
+        file->seek_pending = FALSE;
+        if (gz_skip(file, file->skip) == -1)
+            return NULL;
+    }
+
+    if (file->start + file->pos + len > file->map_size)
+        return NULL;
+    if (file->have < len) {
+        /* The data runs past the end of the window; move it here */
+        if (!map_window(file) || file->have < len)
+            return NULL;
+    }
+
+    data = file->next;
+    file->next += len;
+    file->have -= len;
+    file->pos += len;
+    return data;
+}
+#else
+unsigned char *
+file_read_mapped(unsigned int len _U_, FILE_T file _U_)
+{
+    return NULL;
+}
+#endif
+
 /*
  * XXX - this *peeks* at next byte, not a character.
  */
@@ -1435,6 +2317,12 @@ file_clearerr(FILE_T stream)
 void
 file_fdclose(FILE_T file)
 {
+    if (file->ra != NULL) {
+        g_mutex_lock(file->ra->mutex);
+        read_ahead_stop(file->ra);
+        g_mutex_unlock(file->ra->mutex);
+        file_fdclose(file->ra->reader);
+    }
     ws_close(file->fd);
     file->fd = -1;
 }
@@ -1444,8 +2332,26 @@ file_fdreopen(FILE_T file, const char *path)
 {
     int fd;
 
+    if (file->ra != NULL && !file_fdreopen(file->ra->reader, path))
+        return FALSE;
     if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
         return FALSE;
+#ifdef HAVE_MMAP
+    /*
+     * The file may have been replaced, e.g. by saving it, and the
+     * mapping is of the one we had open.
+     */
+    if (file->map != NULL)
+        remap_file(file, fd);
+#endif
+    /*
+     * Put the new descriptor where the old one was, as relative seeks
+     * assume the descriptor is at raw_pos.
+     */
+    if (ws_lseek64(fd, file->raw_pos, SEEK_SET) == -1) {
+        ws_close(fd);
+        return FALSE;
+    }
     file->fd = fd;
     return TRUE;
 }
@@ -1455,6 +2361,17 @@ file_close(FILE_T file)
 {
     int fd = file->fd;
 
+    if (file->ra != NULL)
+        read_ahead_free(file->ra);
+
+#ifdef HAVE_LIBZ
+    /* If we've read all of it, we've found all the points there are */
+    if (file->seek_index != NULL && file->eof && file->err == 0 &&
+        file->fd != -1)
+        seek_index_write(file);
+    g_free(file->seek_index);
+#endif
+
     /* free memory and close file */
     if (file->size) {
 #ifdef HAVE_LIBZ
@@ -1464,6 +2381,10 @@ file_close(FILE_T file)
         g_free(file->in);
     }
     g_free(file->fast_seek_cur);
+#ifdef HAVE_MMAP
+    if (file->map != NULL)
+        munmap(file->map, (size_t)file->map_size);
+#endif
     file->err = 0;
     file->err_info = NULL;
     g_free(file);
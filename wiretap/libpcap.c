@@ -64,7 +64,8 @@ static gboolean libpcap_read(wtap *wth, int *err, gchar **err_info,
 static gboolean libpcap_seek_read(wtap *wth, gint64 seek_off,
     struct wtap_pkthdr *phdr, Buffer *buf, int *err, gchar **err_info);
 static gboolean libpcap_read_packet(wtap *wth, FILE_T fh,
-    struct wtap_pkthdr *phdr, Buffer *buf, int *err, gchar **err_info);
+    struct wtap_pkthdr *phdr, Buffer *buf, guint8 **data, int *err,
+    gchar **err_info);
 static gboolean libpcap_dump(wtap_dumper *wdh, const struct wtap_pkthdr *phdr,
     const guint8 *pd, int *err, gchar **err_info);
 static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, gchar **err_info,
@@ -617,7 +618,7 @@ static gboolean libpcap_read(wtap *wth, int *err, gchar **err_info,
 	*data_offset = file_tell(wth->fh);
 
 	return libpcap_read_packet(wth, wth->fh, &wth->phdr,
-	    wth->frame_buffer, err, err_info);
+	    wth->frame_buffer, &wth->frame_data, err, err_info);
 }
 
 static gboolean
@@ -627,8 +628,8 @@ libpcap_seek_read(wtap *wth, gint64 seek_off, struct wtap_pkthdr *phdr,
 	if (file_seek(wth->random_fh, seek_off, SEEK_SET, err) == -1)
 		return FALSE;
 
-	if (!libpcap_read_packet(wth, wth->random_fh, phdr, buf, err,
-	    err_info)) {
+	if (!libpcap_read_packet(wth, wth->random_fh, phdr, buf,
+	    &wth->random_data, err, err_info)) {
 		if (*err == 0)
 			*err = WTAP_ERR_SHORT_READ;
 		return FALSE;
@@ -638,7 +639,7 @@ libpcap_seek_read(wtap *wth, gint64 seek_off, struct wtap_pkthdr *phdr,
 
 static gboolean
 libpcap_read_packet(wtap *wth, FILE_T fh, struct wtap_pkthdr *phdr,
-    Buffer *buf, int *err, gchar **err_info)
+    Buffer *buf, guint8 **data, int *err, gchar **err_info)
 {
 	struct pcaprec_ss990915_hdr hdr;
 	guint packet_size;
@@ -717,14 +718,25 @@ libpcap_read_packet(wtap *wth, FILE_T fh, struct wtap_pkthdr *phdr,
 	phdr->len = orig_size;
 
 	/*
-	 * Read the packet data.
+	 * Read the packet data, leaving it in place if the file is
+	 * memory-mapped and we don't have to modify it.
 	 */
-	if (!wtap_read_packet_bytes(fh, buf, packet_size, err, err_info))
-		return FALSE;	/* failed */
-
 	libpcap = (libpcap_t *)wth->priv;
+	if (pcap_read_post_process_modifies(wth->file_encap,
+	    libpcap->byte_swapped)) {
+		*data = NULL;
+		if (!wtap_read_packet_bytes(fh, buf, packet_size, err,
+		    err_info))
+			return FALSE;	/* failed */
+	} else {
+		if (!wtap_read_packet_bytes_mapped(fh, buf, packet_size,
+		    data, err, err_info))
+			return FALSE;	/* failed */
+	}
+
 	pcap_read_post_process(wth->file_type_subtype, wth->file_encap,
-	    phdr, ws_buffer_start_ptr(buf), libpcap->byte_swapped, -1);
+	    phdr, (*data != NULL) ? *data : ws_buffer_start_ptr(buf),
+	    libpcap->byte_swapped, -1);
 	return TRUE;
 }
 
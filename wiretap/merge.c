@@ -40,6 +40,42 @@
 #include <string.h>
 #include "merge.h"
 
+/*
+ * More files than this, and the rest are closed again once we've read
+ * their first packet, until the merge gets to them.
+ */
+#define MERGE_MAX_OPEN_FILES 64
+
+/*
+ * State of a merge by time stamp, kept after the array of input files:
+ * a binary min-heap of the files with packets left to read, ordered by
+ * the time stamp of the next packet in each, and the file whose packet
+ * would be next if not the one at the top of the heap.  As long as the
+ * file at the top keeps coming before that one, as it does when the
+ * files don't overlap in time, we just keep reading from it.
+ */
+typedef struct merge_state_s {
+  int heap_len;           /* -1 until the merge has started */
+  int runner_up;          /* file index, or -1 if not known */
+  int heap[1];            /* file indices; in_file_count of them */
+} merge_state_t;
+
+#define MERGE_STATE_SIZE(count) \
+  (sizeof(merge_state_t) + ((count) > 0 ? (count) - 1 : 0) * sizeof(int))
+
+static merge_state_t *
+merge_state(int in_file_count, merge_in_file_t in_files[])
+{
+  return (merge_state_t *)(void *)&in_files[in_file_count];
+}
+
+gboolean
+merge_reopen_in_file(merge_in_file_t *in_file, int *err, gchar **err_info)
+{
+  in_file->wth = wtap_open_offline(in_file->filename, WTAP_TYPE_AUTO, err, err_info, FALSE);
+  return in_file->wth != NULL;
+}
+
 /*
  * Scan through the arguments and open the input files
  */
@@ -49,35 +85,60 @@ merge_open_in_files(int in_file_count, char *const *in_file_names,
                     int *err_fileno)
 {
   gint i;
-  gint j;
   size_t files_size = in_file_count * sizeof(merge_in_file_t);
   merge_in_file_t *files;
+  merge_state_t *state;
   gint64 size;
 
-  files = (merge_in_file_t *)g_malloc(files_size);
+  files = (merge_in_file_t *)g_malloc(files_size + MERGE_STATE_SIZE(in_file_count));
   *in_files = files;
+  state = merge_state(in_file_count, files);
+  state->heap_len  = -1;
+  state->runner_up = -1;
 
   for (i = 0; i < in_file_count; i++) {
-    files[i].filename    = in_file_names[i];
-    files[i].wth         = wtap_open_offline(in_file_names[i], WTAP_TYPE_AUTO, err, err_info, FALSE);
-    files[i].data_offset = 0;
-    files[i].state       = PACKET_NOT_PRESENT;
-    files[i].packet_num  = 0;
-    if (!files[i].wth) {
+    files[i].filename     = in_file_names[i];
+    files[i].data_offset  = 0;
+    files[i].state        = PACKET_NOT_PRESENT;
+    files[i].packet_num   = 0;
+    files[i].interface_id = 0;
+    if (!merge_reopen_in_file(&files[i], err, err_info)) {
       /* Close the files we've already opened. */
-      for (j = 0; j < i; j++)
-        wtap_close(files[j].wth);
+      merge_close_in_files(i, files);
       *err_fileno = i;
       return FALSE;
     }
     size = wtap_file_size(files[i].wth, err);
     if (size == -1) {
-      for (j = 0; j + 1 > j && j <= i; j++)
-        wtap_close(files[j].wth);
+      merge_close_in_files(i + 1, files);
       *err_fileno = i;
       return FALSE;
     }
-    files[i].size = size;
+    files[i].size              = size;
+    files[i].file_type_subtype = wtap_file_type_subtype(files[i].wth);
+    files[i].encap             = wtap_file_encap(files[i].wth);
+    files[i].snapshot_length   = wtap_snapshot_length(files[i].wth);
+
+    /* Find out when it starts */
+    if (wtap_read(files[i].wth, err, err_info, &files[i].data_offset)) {
+      files[i].state    = PACKET_PRESENT;
+      files[i].first_ts = wtap_phdr(files[i].wth)->ts;
+    } else if (*err != 0) {
+      merge_close_in_files(i + 1, files);
+      *err_fileno = i;
+      return FALSE;
+    } else {
+      files[i].state = AT_EOF;
+      nstime_set_zero(&files[i].first_ts);
+    }
+
+    if (i >= MERGE_MAX_OPEN_FILES) {
+      /* We'll read that packet again when we get to it */
+      wtap_close(files[i].wth);
+      files[i].wth = NULL;
+      if (files[i].state == PACKET_PRESENT)
+        files[i].state = PACKET_NOT_PRESENT;
+    }
   }
   return TRUE;
 }
@@ -90,7 +151,10 @@ merge_close_in_files(int count, merge_in_file_t in_files[])
 {
   int i;
   for (i = 0; i < count; i++) {
-    wtap_close(in_files[i].wth);
+    if (in_files[i].wth != NULL) {
+      wtap_close(in_files[i].wth);
+      in_files[i].wth = NULL;
+    }
   }
 }
 
@@ -108,10 +172,10 @@ merge_select_frame_type(int count, merge_in_file_t files[])
   int i;
   int selected_frame_type;
 
-  selected_frame_type = wtap_file_encap(files[0].wth);
+  selected_frame_type = files[0].encap;
 
   for (i = 1; i < count; i++) {
-    int this_frame_type = wtap_file_encap(files[i].wth);
+    int this_frame_type = files[i].encap;
     if (selected_frame_type != this_frame_type) {
       selected_frame_type = WTAP_ENCAP_PER_PACKET;
       break;
@@ -132,7 +196,7 @@ merge_max_snapshot_length(int count, merge_in_file_t in_files[])
   int snapshot_length;
 
   for (i = 0; i < count; i++) {
-    snapshot_length = wtap_snapshot_length(in_files[i].wth);
+    snapshot_length = in_files[i].snapshot_length;
     if (snapshot_length == 0) {
       /* Snapshot length of input file not known. */
       snapshot_length = WTAP_MAX_PACKET_SIZE;
@@ -144,24 +208,103 @@ merge_max_snapshot_length(int count, merge_in_file_t in_files[])
 }
 
 /*
- * returns TRUE if first argument is earlier than second
+ * Read the next packet from an input file, opening it first if we
+ * haven't yet, and closing it if there are no more.
  */
 static gboolean
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+merge_read_in_file(merge_in_file_t *in_file, int *err, gchar **err_info)
 {
-  if (l->secs > r->secs) {  /* left is later */
+  if (in_file->wth == NULL && !merge_reopen_in_file(in_file, err, err_info)) {
+    in_file->state = GOT_ERROR;
     return FALSE;
-  } else if (l->secs < r->secs) { /* left is earlier */
-    return TRUE;
-  } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
+  }
+  if (!wtap_read(in_file->wth, err, err_info, &in_file->data_offset)) {
+    if (*err != 0) {
+      in_file->state = GOT_ERROR;
+      return FALSE;
+    }
+    in_file->state = AT_EOF;
+    wtap_close(in_file->wth);
+    in_file->wth = NULL;
     return FALSE;
   }
-  /* either one < two or one == two
-   * either way, return one
-   */
+  in_file->state = PACKET_PRESENT;
   return TRUE;
 }
 
+/*
+ * The time stamp of the next packet from an input file; we know when a
+ * file we haven't read from yet starts from when we opened it.
+ */
+static const nstime_t *
+merge_next_ts(merge_in_file_t *in_file)
+{
+  if (in_file->state == PACKET_PRESENT)
+    return &wtap_phdr(in_file->wth)->ts;
+  return &in_file->first_ts;
+}
+
+/*
+ * returns TRUE if the next packet from the first file comes before the
+ * next one from the second; if they're at the same time, the one from
+ * the file that came first on the command line goes first
+ */
+static gboolean
+merge_is_earlier(merge_in_file_t in_files[], int l, int r)
+{
+  int cmp = nstime_cmp(merge_next_ts(&in_files[l]), merge_next_ts(&in_files[r]));
+
+  return cmp < 0 || (cmp == 0 && l < r);
+}
+
+static void
+merge_heap_sift_up(merge_in_file_t in_files[], merge_state_t *state, int pos)
+{
+  int file = state->heap[pos];
+  int parent;
+
+  while (pos > 0) {
+    parent = (pos - 1) / 2;
+    if (!merge_is_earlier(in_files, file, state->heap[parent]))
+      break;
+    state->heap[pos] = state->heap[parent];
+    pos = parent;
+  }
+  state->heap[pos] = file;
+}
+
+/*
+ * The child of a heap entry that comes first, or -1 if it has none
+ */
+static int
+merge_heap_min_child(merge_in_file_t in_files[], merge_state_t *state, int pos)
+{
+  int child = 2 * pos + 1;
+
+  if (child >= state->heap_len)
+    return -1;
+  if (child + 1 < state->heap_len &&
+      merge_is_earlier(in_files, state->heap[child + 1], state->heap[child]))
+    child++;
+  return child;
+}
+
+static void
+merge_heap_sift_down(merge_in_file_t in_files[], merge_state_t *state, int pos)
+{
+  int file = state->heap[pos];
+  int child;
+
+  while ((child = merge_heap_min_child(in_files, state, pos)) != -1) {
+    if (merge_is_earlier(in_files, file, state->heap[child]))
+      break;
+    state->heap[pos] = state->heap[child];
+    pos = child;
+  }
+  state->heap[pos] = file;
+  state->runner_up = -1;
+}
+
 /*
  * Read the next packet, in chronological order, from the set of files
  * to be merged.
@@ -179,59 +322,71 @@ merge_in_file_t *
 merge_read_packet(int in_file_count, merge_in_file_t in_files[],
                   int *err, gchar **err_info)
 {
+  merge_state_t *state = merge_state(in_file_count, in_files);
+  merge_in_file_t *in_file;
   int i;
-  int ei = -1;
-  nstime_t tv = { sizeof(time_t) > sizeof(int) ? LONG_MAX : INT_MAX, INT_MAX };
-  struct wtap_pkthdr *phdr;
+  int child;
+
+  if (state->heap_len == -1) {
+    /* First time through; put every file with packets on the heap. */
+    state->heap_len = 0;
+    for (i = 0; i < in_file_count; i++) {
+      if (in_files[i].state != AT_EOF) {
+        state->heap[state->heap_len] = i;
+        merge_heap_sift_up(in_files, state, state->heap_len++);
+      }
+    }
+  }
 
   /*
-   * Make sure we have a packet available from each file, if there are any
-   * packets left in the file in question, and search for the packet
-   * with the earliest time stamp.
+   * Make sure we have a packet from the file at the top of the heap,
+   * which is the one we returned a packet from last time, if it still
+   * has packets, or one we haven't read from yet.
    */
-  for (i = 0; i < in_file_count; i++) {
-    if (in_files[i].state == PACKET_NOT_PRESENT) {
-      /*
-       * No packet available, and we haven't seen an error or EOF yet,
-       * so try to read the next packet.
-       */
-      if (!wtap_read(in_files[i].wth, err, err_info, &in_files[i].data_offset)) {
-        if (*err != 0) {
-          in_files[i].state = GOT_ERROR;
-          return &in_files[i];
-        }
-        in_files[i].state = AT_EOF;
-      } else
-        in_files[i].state = PACKET_PRESENT;
+  for (;;) {
+    if (state->heap_len == 0) {
+      /* All the streams are at EOF.  Return an EOF indication. */
+      *err = 0;
+      return NULL;
     }
+    in_file = &in_files[state->heap[0]];
+    if (in_file->state == PACKET_PRESENT)
+      break;
 
-    if (in_files[i].state == PACKET_PRESENT) {
-      phdr = wtap_phdr(in_files[i].wth);
-      if (is_earlier(&phdr->ts, &tv)) {
-        tv = phdr->ts;
-        ei = i;
-      }
+    if (!merge_read_in_file(in_file, err, err_info)) {
+      if (*err != 0)
+        return in_file;
+
+      /* No more packets in this file; drop it. */
+      state->heap[0] = state->heap[--state->heap_len];
+      if (state->heap_len > 0)
+        merge_heap_sift_down(in_files, state, 0);
+      continue;
     }
-  }
 
-  if (ei == -1) {
-    /* All the streams are at EOF.  Return an EOF indication. */
-    *err = 0;
-    return NULL;
+    /* Does its next packet still come before everything else? */
+    if (state->heap_len > 1) {
+      if (state->runner_up == -1) {
+        child = merge_heap_min_child(in_files, state, 0);
+        state->runner_up = state->heap[child];
+      }
+      if (!merge_is_earlier(in_files, state->heap[0], state->runner_up))
+        merge_heap_sift_down(in_files, state, 0);
+    }
   }
 
   /* We'll need to read another packet from this file. */
-  in_files[ei].state = PACKET_NOT_PRESENT;
+  in_file->state = PACKET_NOT_PRESENT;
 
   /* Count this packet. */
-  in_files[ei].packet_num++;
+  in_file->packet_num++;
 
   /*
    * Return a pointer to the merge_in_file_t of the file from which the
    * packet was read.
    */
   *err = 0;
-  return &in_files[ei];
+  return in_file;
 }
 
 /*
@@ -254,20 +409,21 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
   int i;
 
   /*
-   * Find the first file not at EOF, and read the next packet from it.
+   * Find the first file not at EOF, and read the next packet from it,
+   * unless we read it when we opened the file.
    */
   for (i = 0; i < in_file_count; i++) {
     if (in_files[i].state == AT_EOF)
       continue; /* This file is already at EOF */
-    if (wtap_read(in_files[i].wth, err, err_info, &in_files[i].data_offset))
+    if (in_files[i].state == PACKET_PRESENT)
+      break; /* We have a packet */
+    if (merge_read_in_file(&in_files[i], err, err_info))
       break; /* We have a packet */
     if (*err != 0) {
       /* Read error - quit immediately. */
-      in_files[i].state = GOT_ERROR;
       return &in_files[i];
     }
-    /* EOF - flag this file as being at EOF, and try the next one. */
-    in_files[i].state = AT_EOF;
+    /* EOF - the file is flagged as being at EOF; try the next one. */
   }
   if (i == in_file_count) {
     /* All the streams are at EOF.  Return an EOF indication. */
@@ -275,6 +431,9 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
     return NULL;
   }
 
+  /* We'll need to read another packet from this file. */
+  in_files[i].state = PACKET_NOT_PRESENT;
+
   /*
    * Return a pointer to the merge_in_file_t of the file from which the
    * packet was read.
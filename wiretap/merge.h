@@ -38,19 +38,32 @@ typedef enum {
 
 /**
  * Structures to manage our input files.
+ *
+ * So as not to run out of file descriptors when merging a great many
+ * files, they aren't all kept open: wth is NULL while a file isn't open,
+ * either because we haven't got to it yet or because we've read all of
+ * it.  What we need to know about it in the meantime is kept here.
  */
 typedef struct merge_in_file_s {
   const char     *filename;
-  wtap           *wth;
+  wtap           *wth;            /* NULL if not open at the moment */
   gint64          data_offset;
   in_file_state_e state;
   guint32         packet_num;	  /* current packet number */
   gint64          size;		      /* file size */
   guint32         interface_id;   /* identifier of the interface.
 								   * Used for fake interfaces when writing WTAP_ENCAP_PER_PACKET */
+  int             file_type_subtype;
+  int             encap;          /* file encapsulation type */
+  int             snapshot_length;
+  nstime_t        first_ts;       /* time stamp of the first packet */
 } merge_in_file_t;
 
 /** Open a number of input files to merge.
+ *
+ * The first packet of each file is read, to find out when it starts;
+ * if there are a lot of files, all but the first few are closed again
+ * until the merge gets to them.
  *
  * @param in_file_count number of entries in in_file_names and in_files
  * @param in_file_names filenames of the input files
@@ -65,6 +78,18 @@ merge_open_in_files(int in_file_count, char *const *in_file_names,
                     merge_in_file_t **in_files, int *err, gchar **err_info,
                     int *err_fileno);
 
+/** Open an input file that isn't open at the moment, for instance to get
+ * its header information; the merge carries on from the beginning of the
+ * file if it hasn't got to it yet.
+ *
+ * @param in_file the input file, whose wth is NULL
+ * @param err wiretap error, if failed
+ * @param err_info wiretap error string, if failed
+ * @return TRUE if the file could be opened, FALSE otherwise
+ */
+WS_DLL_PUBLIC gboolean
+merge_reopen_in_file(merge_in_file_t *in_file, int *err, gchar **err_info);
+
 /** Close the input files again.
  *
  * @param in_file_count number of entries in in_files
@@ -1866,6 +1866,26 @@ pcap_read_post_process(int file_type, int wtap_encap,
 	}
 }
 
+/*
+ * Returns TRUE if pcap_read_post_process() would modify the packet
+ * data, so that it can't be handed out straight from a memory mapping
+ * of the file.
+ */
+gboolean
+pcap_read_post_process_modifies(int wtap_encap, gboolean bytes_swapped)
+{
+	switch (wtap_encap) {
+
+	case WTAP_ENCAP_USB_LINUX:
+	case WTAP_ENCAP_USB_LINUX_MMAPPED:
+	case WTAP_ENCAP_NFLOG:
+		return bytes_swapped;
+
+	default:
+		return FALSE;
+	}
+}
+
 int
 pcap_get_phdr_size(int encap, const union wtap_pseudo_header *pseudo_header)
 {
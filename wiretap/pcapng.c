@@ -351,6 +351,7 @@ typedef struct wtapng_block_s {
      */
     struct wtap_pkthdr *packet_header;
     Buffer *frame_buffer;
+    guint8 *frame_data;     /* packet data, if not in frame_buffer */
 } wtapng_block_t;
 
 /* Interface data in private struct */
@@ -1080,6 +1081,29 @@ pcapng_read_if_descr_block(wtap *wth, FILE_T fh, pcapng_block_header_t *bh,
 }
 
 
+/*
+ * Read the data of a packet, leaving it in place if the file is
+ * memory-mapped and pcap_read_post_process() won't modify it.
+ */
+static gboolean
+pcapng_read_packet_data(FILE_T fh, pcapng_t *pn, int wtap_encap, wtapng_block_t *wblock, guint length, int *err, gchar **err_info)
+{
+    if (pcap_read_post_process_modifies(wtap_encap, pn->byte_swapped)) {
+        wblock->frame_data = NULL;
+        return wtap_read_packet_bytes(fh, wblock->frame_buffer, length, err, err_info);
+    }
+    return wtap_read_packet_bytes_mapped(fh, wblock->frame_buffer, length, &wblock->frame_data, err, err_info);
+}
+
+static guint8 *
+pcapng_packet_data(wtapng_block_t *wblock)
+{
+    if (wblock->frame_data != NULL)
+        return wblock->frame_data;
+    return ws_buffer_start_ptr(wblock->frame_buffer);
+}
+
+
 static gboolean
 pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wtapng_block_t *wblock, int *err, gchar **err_info, gboolean enhanced)
 {
@@ -1293,8 +1317,8 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
     wblock->packet_header->ts.nsecs = (int)(((ts % iface_info.time_units_per_second) * 1000000000) / iface_info.time_units_per_second);
 
     /* "(Enhanced) Packet Block" read capture data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                packet.cap_len - pseudo_header_len, err, err_info))
+    if (!pcapng_read_packet_data(fh, pn, iface_info.wtap_encap, wblock,
+                                 packet.cap_len - pseudo_header_len, err, err_info))
         return FALSE;
     block_read += packet.cap_len - pseudo_header_len;
 
@@ -1430,7 +1454,7 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
     }
 
     pcap_read_post_process(WTAP_FILE_TYPE_SUBTYPE_PCAPNG, iface_info.wtap_encap,
-                           wblock->packet_header, ws_buffer_start_ptr(wblock->frame_buffer),
+                           wblock->packet_header, pcapng_packet_data(wblock),
                            pn->byte_swapped, fcslen);
     return TRUE;
 }
@@ -1582,8 +1606,8 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
     memset((void *)&wblock->packet_header->pseudo_header, 0, sizeof(union wtap_pseudo_header));
 
     /* "Simple Packet Block" read capture data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                simple_packet.cap_len, err, err_info))
+    if (!pcapng_read_packet_data(fh, pn, iface_info.wtap_encap, wblock,
+                                 simple_packet.cap_len, err, err_info))
         return FALSE;
 
     /* jump over potential padding bytes at end of the packet data */
@@ -1593,7 +1617,7 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
     }
 
     pcap_read_post_process(WTAP_FILE_TYPE_SUBTYPE_PCAPNG, iface_info.wtap_encap,
-                           wblock->packet_header, ws_buffer_start_ptr(wblock->frame_buffer),
+                           wblock->packet_header, pcapng_packet_data(wblock),
                            pn->byte_swapped, pn->if_fcslen);
     return TRUE;
 }
@@ -2146,6 +2170,7 @@ pcapng_read_block(wtap *wth, FILE_T fh, pcapng_t *pn, wtapng_block_t *wblock, in
     guint32 block_total_length;
 
     memset(&(wblock->data), 0, sizeof(wblock->data));
+    wblock->frame_data = NULL;
 
     /* Try to read the (next) block header */
     if (!wtap_read_bytes_or_eof(fh, &bh, sizeof bh, err, err_info)) {
@@ -2507,6 +2532,7 @@ pcapng_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
     }
 
 got_packet:
+    wth->frame_data = wblock.frame_data;
 
     /*pcapng_debug2("Read length: %u Packet length: %u", bytes_read, wth->phdr.caplen);*/
     pcapng_debug1("pcapng_read: data_offset is finally %" G_GINT64_MODIFIER "d", *data_offset);
@@ -2551,6 +2577,7 @@ pcapng_seek_read(wtap *wth, gint64 seek_off,
         pcapng_debug1("pcapng_seek_read: block type %u not PB/EPB/SPB", wblock.type);
         return FALSE;
     }
+    wth->random_data = wblock.frame_data;
 
     return TRUE;
 }
@@ -53,6 +53,8 @@ struct wtap {
     int                         file_type_subtype;
     guint                       snapshot_length;
     struct Buffer               *frame_buffer;
+    guint8                      *frame_data;    /**< data of the packet read by subtype_read, if it's not in frame_buffer */
+    guint8                      *random_data;   /**< data of the packet read by subtype_seek_read, if it's not in its buffer */
     struct wtap_pkthdr          phdr;
     struct wtapng_section_s     shb_hdr;
     guint                       number_of_interfaces;   /**< The number of interfaces a capture was made on, number of IDB:s in a pcapng file or equivalent(?)*/
@@ -304,6 +306,22 @@ gboolean
 wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
     gchar **err_info);
 
+/*
+ * Read packet data as wtap_read_packet_bytes() does, except that, if
+ * the file is memory-mapped, the data isn't copied anywhere and *data
+ * is set to point to it in the mapping; otherwise the data is read into
+ * the Buffer and *data is set to NULL.
+ *
+ * Readers that use this set wth->frame_data (when reading sequentially)
+ * or wth->random_data (when reading at random) from *data; they mustn't
+ * modify the data in the mapping, and should read into the Buffer with
+ * wtap_read_packet_bytes() any data that they have to modify.
+ */
+WS_DLL_PUBLIC
+gboolean
+wtap_read_packet_bytes_mapped(FILE_T fh, Buffer *buf, guint length,
+    guint8 **data, int *err, gchar **err_info);
+
 #endif /* __WTAP_INT_H__ */
 
 /*
@@ -1024,6 +1024,13 @@ wtap_cleareof(wtap *wth) {
 	file_clearerr(wth->fh);
 }
 
+void
+wtap_set_read_ahead(wtap *wth)
+{
+	if (wth->fh != NULL)
+		file_set_read_ahead(wth->fh);
+}
+
 void wtap_set_cb_new_ipv4(wtap *wth, wtap_new_ipv4_callback_t add_new_ipv4) {
 	if (wth)
 		wth->add_new_ipv4 = add_new_ipv4;
@@ -1049,6 +1056,7 @@ wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 	 */
 	wth->phdr.pkt_encap = wth->file_encap;
 	wth->phdr.pkt_tsprec = wth->file_tsprec;
+	wth->frame_data = NULL;
 
 	*err = 0;
 	*err_info = NULL;
@@ -1162,6 +1170,16 @@ wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
 	    err_info);
 }
 
+gboolean
+wtap_read_packet_bytes_mapped(FILE_T fh, Buffer *buf, guint length,
+    guint8 **data, int *err, gchar **err_info)
+{
+	*data = file_read_mapped(length, fh);
+	if (*data != NULL)
+		return TRUE;
+	return wtap_read_packet_bytes(fh, buf, length, err, err_info);
+}
+
 /*
  * Return an approximation of the amount of data we've read sequentially
  * from the file so far.  (gint64, in case that's 64 bits.)
@@ -1181,6 +1199,8 @@ wtap_phdr(wtap *wth)
 guint8 *
 wtap_buf_ptr(wtap *wth)
 {
+	if (wth->frame_data != NULL)
+		return wth->frame_data;
 	return ws_buffer_start_ptr(wth->frame_buffer);
 }
 
@@ -1201,8 +1221,33 @@ gboolean
 wtap_seek_read(wtap *wth, gint64 seek_off,
 	struct wtap_pkthdr *phdr, Buffer *buf, int *err, gchar **err_info)
 {
+	guint8 *data;
+
+	if (!wtap_seek_read_data(wth, seek_off, phdr, buf, &data, err,
+	    err_info))
+		return FALSE;
+
+	/*
+	 * The caller wants the data in the buffer; if it's somewhere
+	 * else, copy it there.
+	 */
+	if (data != ws_buffer_start_ptr(buf)) {
+		ws_buffer_assure_space(buf, phdr->caplen);
+		memcpy(ws_buffer_start_ptr(buf), data, phdr->caplen);
+	}
+	return TRUE;
+}
+
+gboolean
+wtap_seek_read_data(wtap *wth, gint64 seek_off,
+	struct wtap_pkthdr *phdr, Buffer *buf, guint8 **data, int *err,
+	gchar **err_info)
+{
+	wth->random_data = NULL;
 	if (!wth->subtype_seek_read(wth, seek_off, phdr, buf, err, err_info))
 		return FALSE;
+	*data = (wth->random_data != NULL) ? wth->random_data :
+	    ws_buffer_start_ptr(buf);
 
 	/*
 	 * It makes no sense for the captured data length to be bigger
@@ -1428,6 +1428,17 @@ WS_DLL_PUBLIC
 struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err,
     gchar **err_info, gboolean do_random);
 
+/**
+ * Have "wtap_open_offline()", when opening a compressed file for random
+ * access, load the points it can seek to from a "<file>.seekidx" file
+ * next to it and, if there's no usable one, write one once the file has
+ * been read through.  Off by default.
+ *
+ * @param use TRUE to use seek index files, FALSE not to
+ */
+WS_DLL_PUBLIC
+void wtap_set_use_seek_indexes(gboolean use);
+
 /**
  * If we were compiled with zlib and we're at EOF, unset EOF so that
  * wtap_read/gzread has a chance to succeed. This is necessary if
@@ -1436,6 +1447,14 @@ struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err
 WS_DLL_PUBLIC
 void wtap_cleareof(wtap *wth);
 
+/**
+ * Have a separate thread read, and decompress, the file ahead of
+ * wtap_read(), for a caller that reads it straight through.  Does
+ * nothing if the file is a pipe or is read out of a memory mapping.
+ */
+WS_DLL_PUBLIC
+void wtap_set_read_ahead(wtap *wth);
+
 /**
  * Set callback functions to add new hostnames. Currently pcapng-only.
  * MUST match add_ipv4_name and add_ipv6_name in addr_resolv.c.
@@ -1459,9 +1478,22 @@ WS_DLL_PUBLIC
 gboolean wtap_seek_read (wtap *wth, gint64 seek_off,
         struct wtap_pkthdr *phdr, Buffer *buf, int *err, gchar **err_info);
 
+/** Like wtap_seek_read(), except that the packet data isn't necessarily
+ * put into buf: *data is set to point to it, either in buf or, for
+ * files that are read straight out of a memory mapping of the file,
+ * in the mapping, in which case it stays valid until the file is closed
+ * or wtap_fdreopen() is called, and mustn't be modified. */
+WS_DLL_PUBLIC
+gboolean wtap_seek_read_data (wtap *wth, gint64 seek_off,
+        struct wtap_pkthdr *phdr, Buffer *buf, guint8 **data, int *err,
+        gchar **err_info);
+
 /*** get various information snippets about the current packet ***/
 WS_DLL_PUBLIC
 struct wtap_pkthdr *wtap_phdr(wtap *wth);
+/** The data of the packet last read by wtap_read(); for files that are
+ * read straight out of a memory mapping of the file, it's in the mapping,
+ * where it stays until the file is closed. */
 WS_DLL_PUBLIC
 guint8 *wtap_buf_ptr(wtap *wth);
 
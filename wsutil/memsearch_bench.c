@@ -0,0 +1,249 @@
+/* memsearch_bench.c
+ * Checks the SSE2 and AVX2 versions of the buffer searching and
+ * scanning routines against the plain C ones, and times them
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Usage: memsearch_bench [bytes to scan per test, in MB]
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "ws_cpuid.h"
+#include "ws_mempbrk.h"
+#include "ws_memsearch.h"
+
+#define MAX_LEN		65536
+#define CHECK_LEN	300
+
+typedef struct {
+	const char *name;
+	const guint8 *(*memchr2)(const guint8 *, size_t, guint8, guint8);
+	const guint8 *(*memmem)(const guint8 *, size_t, const guint8 *, size_t);
+	size_t (*ascii_span)(const guint8 *, size_t);
+} kernels_t;
+
+static kernels_t kernels[3];
+static int num_kernels;
+
+static const guint8 needle[] = "\r\n\r\n";
+
+static int failed;
+
+static void
+check(gboolean ok, const char *kernel, const char *what, size_t len, size_t pos)
+{
+	if (!ok) {
+		fprintf(stderr, "%s: %s wrong, length %lu, position %lu\n",
+			kernel, what, (unsigned long) len, (unsigned long) pos);
+		failed = 1;
+	}
+}
+
+/*
+ * Put what's being looked for at each position in turn, in buffers
+ * of each length and alignment, and make sure every version finds it
+ * there, and nowhere before.
+ */
+static void
+check_kernels(guint8 *buf)
+{
+	size_t len, pos, align;
+	int k;
+
+	for (align = 0; align < 32; align++) {
+		guint8 *p = buf + align;
+
+		for (len = 0; len <= CHECK_LEN; len++) {
+			for (pos = 0; pos <= len; pos++) {
+				memset(p, 'a', len);
+				if (pos < len)
+					p[pos] = (pos & 1) ? '\n' : '\r';
+				/* a near miss just before it */
+				if (pos >= 3)
+					memcpy(p + pos - 3, "\r\n\r", 3);
+				for (k = 0; k < num_kernels; k++) {
+					const guint8 *expected = _ws_memchr2(p, len, '\r', '\n');
+
+					check(kernels[k].memchr2(p, len, '\r', '\n') == expected,
+					      kernels[k].name, "memchr2", len, pos);
+				}
+
+				memset(p, 'a', len);
+				if (pos + sizeof needle - 1 <= len)
+					memcpy(p + pos, needle, sizeof needle - 1);
+				if (pos >= 1)
+					memcpy(p + pos - 1, "\r\n\r", MIN(3, len - pos + 1));
+				for (k = 0; k < num_kernels; k++) {
+					const guint8 *expected = _ws_memmem(p, len, needle, sizeof needle - 1);
+
+					check(kernels[k].memmem(p, len, needle, sizeof needle - 1) == expected,
+					      kernels[k].name, "memmem", len, pos);
+				}
+
+				memset(p, 'a', len);
+				if (pos < len)
+					p[pos] = 0x80 | (guint8) pos;
+				for (k = 0; k < num_kernels; k++) {
+					check(kernels[k].ascii_span(p, len) == pos,
+					      kernels[k].name, "ascii_span", len, pos);
+				}
+			}
+		}
+	}
+}
+
+static void
+report(const char *kernel, const char *what, size_t len, size_t total, GTimer *timer)
+{
+	printf("%-8s %-12s %6lu bytes: %8.1f MB/s\n", kernel, what, (unsigned long) len,
+	       total / g_timer_elapsed(timer, NULL) / (1024 * 1024));
+}
+
+/*
+ * Time each version over text with what's being looked for at the end,
+ * as for the headers of a text protocol, at packet and reassembled PDU
+ * sizes.
+ */
+static void
+time_kernels(guint8 *buf, size_t total)
+{
+	static const size_t lens[] = { 64, 1500, MAX_LEN };
+	GTimer *timer = g_timer_new();
+	volatile size_t sink = 0;
+	size_t i, n, runs;
+	int k;
+
+	for (i = 0; i < G_N_ELEMENTS(lens); i++) {
+		for (n = 0; n < lens[i]; n++)
+			buf[n] = "GET / HTTP/1.1 Host: www.example.com "[n % 37];
+		memcpy(buf + lens[i] - (sizeof needle - 1), needle, sizeof needle - 1);
+		runs = total / lens[i];
+
+		for (k = 0; k < num_kernels; k++) {
+			g_timer_start(timer);
+			for (n = 0; n < runs; n++)
+				sink += kernels[k].memchr2(buf, lens[i] - 4, '\r', '\n') == NULL;
+			report(kernels[k].name, "memchr2", lens[i], runs * lens[i], timer);
+
+			g_timer_start(timer);
+			for (n = 0; n < runs; n++)
+				sink += kernels[k].memmem(buf, lens[i], needle, sizeof needle - 1) != NULL;
+			report(kernels[k].name, "memmem", lens[i], runs * lens[i], timer);
+
+			g_timer_start(timer);
+			for (n = 0; n < runs; n++)
+				sink += kernels[k].ascii_span(buf, lens[i]);
+			report(kernels[k].name, "ascii_span", lens[i], runs * lens[i], timer);
+		}
+
+		g_timer_start(timer);
+		for (n = 0; n < runs; n++)
+			sink += ws_memmem(buf, lens[i], needle, sizeof needle - 1) != NULL;
+		report("ws", "memmem", lens[i], runs * lens[i], timer);
+
+		g_timer_start(timer);
+		for (n = 0; n < runs; n++)
+			sink += ws_mempbrk(buf, lens[i] - 4, (const guint8 *) "\r\n\"") == NULL;
+		report("mempbrk", "\\r\\n\"", lens[i], runs * lens[i], timer);
+
+		/* Header lines, so that the needle's first bytes are common */
+		for (n = 0; n < lens[i]; n++)
+			buf[n] = "\r\nX-Header: value"[n % 18];
+		memcpy(buf + lens[i] - (sizeof needle - 1), needle, sizeof needle - 1);
+		for (k = 0; k < num_kernels; k++) {
+			g_timer_start(timer);
+			for (n = 0; n < runs; n++)
+				sink += kernels[k].memmem(buf, lens[i], needle, sizeof needle - 1) != NULL;
+			report(kernels[k].name, "memmem lines", lens[i], runs * lens[i], timer);
+		}
+		g_timer_start(timer);
+		for (n = 0; n < runs; n++)
+			sink += ws_memmem(buf, lens[i], needle, sizeof needle - 1) != NULL;
+		report("ws", "memmem lines", lens[i], runs * lens[i], timer);
+	}
+
+	g_timer_destroy(timer);
+}
+
+int
+main(int argc, char **argv)
+{
+	guint8 *buf;
+	size_t  total = 256;
+
+	if (argc > 1)
+		total = strtoul(argv[1], NULL, 10);
+	total *= 1024 * 1024;
+
+	kernels[num_kernels].name = "plain";
+	kernels[num_kernels].memchr2 = _ws_memchr2;
+	kernels[num_kernels].memmem = _ws_memmem;
+	kernels[num_kernels].ascii_span = _ws_ascii_span;
+	num_kernels++;
+#ifdef WS_HAVE_SSE2
+	kernels[num_kernels].name = "sse2";
+	kernels[num_kernels].memchr2 = _ws_memchr2_sse2;
+	kernels[num_kernels].memmem = _ws_memmem_sse2;
+	kernels[num_kernels].ascii_span = _ws_ascii_span_sse2;
+	num_kernels++;
+#endif
+#ifdef HAVE_AVX2
+	if (ws_cpuid_avx2()) {
+		kernels[num_kernels].name = "avx2";
+		kernels[num_kernels].memchr2 = _ws_memchr2_avx2;
+		kernels[num_kernels].memmem = _ws_memmem_avx2;
+		kernels[num_kernels].ascii_span = _ws_ascii_span_avx2;
+		num_kernels++;
+	}
+#endif
+
+	buf = (guint8 *) g_malloc(MAX_LEN + 32);
+
+	check_kernels(buf);
+	if (failed)
+		return 1;
+	printf("All %d versions agree\n", num_kernels);
+
+	time_kernels(buf, total);
+
+	g_free(buf);
+	return 0;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,119 @@
+/* mmh3.c
+ * MurmurHash3, the 128-bit version for 64-bit platforms
+ * Based on the public domain MurmurHash3_x64_128() by Austin Appleby
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/pint.h>
+#include <wsutil/mmh3.h>
+
+#define ROTL64(x, r)	(((x) << (r)) | ((x) >> (64 - (r))))
+
+#define C1	G_GUINT64_CONSTANT(0x87c37b91114253d5)
+#define C2	G_GUINT64_CONSTANT(0x4cf5ad432745937f)
+
+static inline guint64
+fmix64(guint64 k)
+{
+	k ^= k >> 33;
+	k *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+	k ^= k >> 33;
+	k *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+	k ^= k >> 33;
+
+	return k;
+}
+
+void
+mmh3_hash128(const guint8 *buf, size_t len, guint32 seed, guint8 digest[MMH3_DIGEST_LEN])
+{
+	const guint8 *tail;
+	guint64       h1 = seed;
+	guint64       h2 = seed;
+	guint64       k1, k2;
+	size_t        nblocks = len / 16;
+	size_t        i;
+
+	/* The blocks are read little-endian, whatever we're running on */
+	for (i = 0; i < nblocks; i++) {
+		k1 = pletoh64(buf + i * 16);
+		k2 = pletoh64(buf + i * 16 + 8);
+
+		k1 *= C1; k1 = ROTL64(k1, 31); k1 *= C2; h1 ^= k1;
+
+		h1 = ROTL64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+		k2 *= C2; k2 = ROTL64(k2, 33); k2 *= C1; h2 ^= k2;
+
+		h2 = ROTL64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+	}
+
+	tail = buf + nblocks * 16;
+	k1 = 0;
+	k2 = 0;
+
+	/* Whatever's left over, as zero-padded blocks */
+	for (i = len & 15; i > 8; i--)
+		k2 ^= ((guint64)tail[i - 1]) << ((i - 9) * 8);
+	for (i = MIN(len & 15, 8); i > 0; i--)
+		k1 ^= ((guint64)tail[i - 1]) << ((i - 1) * 8);
+	if ((len & 15) > 8) {
+		k2 *= C2; k2 = ROTL64(k2, 33); k2 *= C1; h2 ^= k2;
+	}
+	if ((len & 15) > 0) {
+		k1 *= C1; k1 = ROTL64(k1, 31); k1 *= C2; h1 ^= k1;
+	}
+
+	h1 ^= (guint64)len;
+	h2 ^= (guint64)len;
+
+	h1 += h2;
+	h2 += h1;
+
+	h1 = fmix64(h1);
+	h2 = fmix64(h2);
+
+	h1 += h2;
+	h2 += h1;
+
+	for (i = 0; i < 8; i++) {
+		digest[i]     = (guint8)(h1 >> (i * 8));
+		digest[i + 8] = (guint8)(h2 >> (i * 8));
+	}
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
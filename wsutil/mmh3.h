@@ -0,0 +1,47 @@
+/* mmh3.h
+ * MurmurHash3, the 128-bit version for 64-bit platforms
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MMH3_H
+#define MMH3_H
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * A fast, well-distributed hash, for telling blocks of data apart;
+ * it is not a cryptographic hash, so don't use it where someone might
+ * be trying to make two blocks look alike.  The digest is the same on
+ * all platforms.
+ */
+#define MMH3_DIGEST_LEN 16
+
+WS_DLL_PUBLIC void mmh3_hash128(const guint8 *buf, size_t len, guint32 seed,
+                                guint8 digest[MMH3_DIGEST_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* MMH3_H */
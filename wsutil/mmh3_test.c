@@ -0,0 +1,183 @@
+/* mmh3_test.c
+ * Checks mmh3_hash128() against the digests that the reference
+ * MurmurHash3_x64_128 gives
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "mmh3.h"
+
+#define SEED	0x9747b28c
+
+typedef struct {
+	size_t		len;
+	const char	*digest;
+} mmh3_vector_t;
+
+/*
+ * The digests of the bytes 0, 1, 2, ..., len - 1, as the reference
+ * implementation writes them out on a little-endian machine: h1, then
+ * h2, each least significant byte first.  Lengths 0 to 33 take in no
+ * blocks, one and two, with every length of tail.
+ */
+static const mmh3_vector_t vectors_seed_0[] = {
+	{  0, "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00" },
+	{  1, "\xb5\x5c\xff\x6e\xe5\xab\x10\x46\x83\x35\xf8\x78\xaa\x2d\x62\x51" },
+	{  2, "\x4c\x26\xab\x8d\xc5\xf5\xb3\x7c\x44\xe0\xc2\x6e\x32\x01\x3c\xf0" },
+	{  3, "\xbe\xe6\x53\xef\x2f\xa1\x72\xb8\xb6\x96\xb3\x52\xc2\x55\x62\xfb" },
+	{  4, "\x10\xaf\xdf\x0d\xae\x94\xc5\xe1\xe2\xfd\xc2\x13\xbd\x05\xd6\xd3" },
+	{  5, "\x36\x40\xf9\xa6\xd4\x8c\xee\x41\xf6\x23\x0c\x63\x5e\x15\xd0\xf8" },
+	{  6, "\x3c\x04\xf5\xa4\xbb\x3a\x98\x66\xa0\x2c\x51\x16\x0b\x24\xe0\x57" },
+	{  7, "\x68\x0d\x4b\xca\x87\x69\x4c\xbd\x87\xc7\x25\xbd\xd4\xdd\x3a\x61" },
+	{  8, "\xc8\x2f\x8e\xd6\xbd\xe1\xa7\x47\xc7\xdc\x31\xec\x02\xee\xe6\x60" },
+	{  9, "\x32\x2d\x81\x6e\x0f\xcb\xb4\xfb\xb9\xff\x00\x02\x1d\x75\xde\x78" },
+	{ 10, "\x63\xe4\x58\x9e\xe8\x25\xca\xcf\x76\x20\xad\x72\xc4\x13\x43\x25" },
+	{ 11, "\x88\x4f\x56\xc7\x47\x4f\x7b\xc5\xb0\x1b\x71\x20\x8d\xea\x65\x69" },
+	{ 12, "\xca\xa5\x12\x92\xe6\xa7\x5d\xb3\x46\x53\xf7\xec\x46\xf1\x75\x80" },
+	{ 13, "\xc2\x41\x5f\xc5\xf2\xd9\x52\x4b\xfc\xd8\xa6\xaf\x9e\x86\xff\x84" },
+	{ 14, "\x64\x6d\x90\x35\xee\x33\xa9\x5f\xdf\xc9\x0f\x38\x73\x25\x78\x0d" },
+	{ 15, "\xe9\x25\x49\xfd\x98\x15\x23\x47\xe9\x7d\xc6\x88\xee\x6d\x84\xcd" },
+	{ 16, "\x30\x3f\x90\x91\xb5\x24\x49\x44\x45\xe8\x2f\x76\x56\x64\x90\xab" },
+	{ 17, "\x0e\xc2\xe7\x9f\x0f\xf4\x76\x5c\x24\xa8\xda\x9e\x6b\x02\x5f\xc1" },
+	{ 18, "\x7b\xc4\xe9\xba\xd1\xe4\x48\x16\x5f\xeb\xb9\x0b\x18\x84\x26\xce" },
+	{ 19, "\x63\x01\xa3\x64\x55\xa4\x65\xa6\xdc\x1f\xae\xbf\x60\x79\x4f\x95" },
+	{ 20, "\x4b\x95\x36\x57\x70\x53\xd2\xa3\x7a\x9c\x7b\x6c\x25\x06\x1f\x5a" },
+	{ 21, "\x03\x12\xd4\x28\xa0\x3d\xd1\xcd\xcb\xe7\xa2\x2d\xfc\x0e\xc5\x6b" },
+	{ 22, "\x71\x2a\xc1\x27\xbf\xf3\xf8\x45\x62\x56\x1e\x60\x73\xa3\x30\x17" },
+	{ 23, "\xdb\x81\x35\x15\x6f\x37\xa1\xb9\x41\x49\x2a\xb4\x93\x1c\x45\x26" },
+	{ 24, "\xde\xdf\xb2\x75\x62\x84\x4e\x73\x52\x9e\xfb\xbb\xab\x7e\x70\x94" },
+	{ 25, "\xcb\x82\xe9\x2e\xb5\x7c\xbe\x3b\xfc\x9f\xef\xbe\x33\x54\xd3\xa2" },
+	{ 26, "\x72\x6f\x22\x02\xfe\xdc\x15\xa5\x78\x7d\xc4\xfc\xdc\x68\x0c\x2e" },
+	{ 27, "\xed\x2e\x59\x4d\x88\x02\x16\x11\x19\xb5\x1d\xdc\x48\x19\x74\x28" },
+	{ 28, "\x3c\x81\x05\xee\x62\xff\x14\xdc\x8b\xcb\x67\x45\xbb\x50\x20\x66" },
+	{ 29, "\x1a\xcf\x18\x15\xb1\x94\xe4\xaa\x76\xe1\xcf\x8c\xf7\x12\x9e\x64" },
+	{ 30, "\xe3\x01\xa2\x38\x0d\x08\x69\xf0\x19\x6b\xd2\xe3\x7f\x68\xf3\x22" },
+	{ 31, "\x94\xd0\x2c\xa3\xe1\xd3\x3d\x05\x90\x54\x00\xb4\xef\x9a\xe5\x9e" },
+	{ 32, "\x0f\x50\x2f\xb6\x22\x90\x6d\xc6\x51\x11\xc3\x34\x6e\x0a\x05\x1c" },
+	{ 33, "\x12\x46\xba\xfa\x1b\x28\x41\x7d\x0b\xa3\xd6\xa7\x73\x80\xac\x55" },
+};
+
+/* The same, with SEED */
+static const mmh3_vector_t vectors_seed[] = {
+	{  0, "\xb3\xbb\xaa\x1d\x8a\x20\x2b\x39\x7a\x95\x02\xe3\x8f\x60\xb0\x93" },
+	{  1, "\xc0\x30\xd7\x7d\x9a\xf6\xc9\x02\xc8\x94\x6f\x4e\x34\x03\x71\xf6" },
+	{  2, "\x58\xcf\x5c\x28\x23\x94\x6c\xbf\xce\x60\x3d\xd4\xcc\xaf\x0c\x2b" },
+	{  3, "\x18\x24\xed\x5a\x25\xa1\x96\x50\x6f\x99\x9f\x2d\xc5\x52\x2c\xc8" },
+	{  4, "\xe1\x8e\x0b\x57\xf2\x67\x45\xee\x10\xa4\xd7\x18\x56\x80\xa8\x13" },
+	{  5, "\xe9\x9c\x8a\x18\x40\x4c\x72\x41\xe4\xfd\xe3\xea\xa2\x7f\xee\x05" },
+	{  6, "\xec\xe5\x77\x14\xb5\xdc\xc3\xd7\x49\xeb\xd5\x56\x9a\xd1\xf1\xc9" },
+	{  7, "\x6a\x8c\x15\x91\xb9\x05\x19\x8d\xc4\xa8\x67\xc4\xa1\xa3\x8d\x10" },
+	{  8, "\x2b\x17\x33\xe4\xd1\xeb\xec\x6d\xfb\x0d\x2b\xa3\x6e\x5e\x83\x29" },
+	{  9, "\xdc\x7c\xdb\x74\x86\x0c\xb2\xab\x1c\x6b\x9a\xc0\xeb\x38\xa5\xa2" },
+	{ 10, "\xf4\x9a\xf5\xf4\x20\xa8\x46\x07\x20\xc6\x54\xb9\x34\x6e\xa0\x40" },
+	{ 11, "\x3b\xc2\x9f\xfc\x5f\x78\xf7\x38\xe0\xdb\x76\x44\x36\xa8\x14\xfe" },
+	{ 12, "\x61\xec\xd6\x70\x11\x2b\xf2\xc1\x9b\x66\xeb\x52\xdb\xd3\x4b\xa0" },
+	{ 13, "\x8b\x27\x6d\xfc\xf6\xd5\xa9\x4a\x0c\xfd\x7a\xdb\x18\x73\xbf\xc7" },
+	{ 14, "\x4b\xda\xe9\xe7\x48\xcc\xe7\xc8\x3e\x7d\x4b\x1f\x3f\x3c\x9f\x9a" },
+	{ 15, "\x40\x53\x37\x1d\x58\x1e\x46\xce\xcf\x00\x41\x9e\x27\xd4\x01\xf9" },
+	{ 16, "\xc9\x26\x23\xac\x4c\xe1\xf6\xcd\xd1\xd2\x7b\x18\xde\xca\x54\xe0" },
+	{ 17, "\x48\xca\xd1\x23\x96\x3e\xf0\x4b\xec\xfe\x86\xc1\x35\x6d\xb4\xcd" },
+	{ 18, "\x61\x90\x73\xa8\xbb\x2c\x3a\xb1\xc1\xca\x8b\x37\x6f\x5b\xf8\xa6" },
+	{ 19, "\x32\xcb\x4d\xd9\x9e\x3d\x82\x20\xc1\xae\xaa\x46\x0f\xe3\x26\x25" },
+	{ 20, "\x8e\x20\x54\xc9\x86\x20\xda\x18\xaa\x9e\xc3\xdd\x78\x3b\xdb\xfd" },
+	{ 21, "\x28\x3d\x6c\xb2\x5a\xfa\xd8\xc6\xf6\x99\xbd\x74\x98\x12\x8b\xb4" },
+	{ 22, "\x4a\xb7\x4b\xf1\xe7\x12\xed\xd0\x7e\xf5\xc4\xa5\x08\x50\xc8\x5a" },
+	{ 23, "\x46\xc8\xd7\x37\x5a\x8c\xaa\x8d\xb0\x88\xfa\x8e\x6d\xf7\x68\xb0" },
+	{ 24, "\xe2\x7e\xda\xa2\xc2\xfc\xe9\x5d\xf5\xe6\x3f\xa3\x90\x52\x1d\x34" },
+	{ 25, "\x30\x8a\xd9\x73\x78\x06\xee\xc9\x95\xe9\x2f\x40\x31\x3b\xb2\xff" },
+	{ 26, "\x74\x47\x91\x36\xff\x7b\x93\x55\x2e\x27\x73\xa1\xa6\xcd\x62\x7a" },
+	{ 27, "\x00\xef\x65\x13\xa7\xad\x05\xc0\x25\xe4\xf5\x43\xbb\x3b\x61\x60" },
+	{ 28, "\x23\x8b\x66\x9e\xd3\xff\x67\xc1\xd6\xd8\x18\x39\xf8\xea\xb7\xaf" },
+	{ 29, "\x8f\xb1\xfe\x6f\xf7\x06\x02\x67\x01\x43\x30\xa6\x94\x30\x83\x90" },
+	{ 30, "\x1c\x91\x42\x6a\xb9\x8a\x3e\xe0\x0e\xb2\x0c\xff\x32\xc0\x16\xce" },
+	{ 31, "\x67\x87\x60\xb0\x94\x20\x40\x11\x07\x0d\x75\x94\xdb\x13\x76\x16" },
+	{ 32, "\x96\x5c\xb9\xb0\xeb\x57\xeb\xec\xe0\x47\xff\xae\x62\x32\x70\xaa" },
+	{ 33, "\xa2\x80\xf4\x02\x61\xc5\x19\xdd\x8f\x8a\x00\x9f\xef\xa1\xdb\x57" },
+};
+
+static void
+check_vectors(const mmh3_vector_t *vectors, size_t num_vectors, guint32 seed)
+{
+	guint8	data[64];
+	guint8	digest[MMH3_DIGEST_LEN];
+	guint8	*copy;
+	size_t	i, j;
+
+	for (i = 0; i < sizeof data; i++)
+		data[i] = (guint8)i;
+
+	for (i = 0; i < num_vectors; i++) {
+		mmh3_hash128(data, vectors[i].len, seed, digest);
+		if (memcmp(digest, vectors[i].digest, MMH3_DIGEST_LEN) != 0) {
+			g_test_message("length %u, seed 0x%08x", (unsigned)vectors[i].len, seed);
+			g_assert_not_reached();
+		}
+
+		/* Where the data is doesn't matter */
+		for (j = 1; j < 8; j++) {
+			copy = (guint8 *)g_malloc(vectors[i].len + j);
+			memcpy(copy + j, data, vectors[i].len);
+			mmh3_hash128(copy + j, vectors[i].len, seed, digest);
+			g_assert(memcmp(digest, vectors[i].digest, MMH3_DIGEST_LEN) == 0);
+			g_free(copy);
+		}
+	}
+}
+
+static void
+mmh3_test_seed_0(void)
+{
+	check_vectors(vectors_seed_0, G_N_ELEMENTS(vectors_seed_0), 0);
+}
+
+static void
+mmh3_test_seed(void)
+{
+	check_vectors(vectors_seed, G_N_ELEMENTS(vectors_seed), SEED);
+}
+
+int
+main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/mmh3/seed_0", mmh3_test_seed_0);
+	g_test_add_func("/mmh3/seed", mmh3_test_seed);
+
+	return g_test_run();
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
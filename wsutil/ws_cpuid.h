@@ -28,15 +28,24 @@
  */
 
 #if defined(_MSC_VER)     /* MSVC */
+#include <intrin.h>
+#include <immintrin.h>
+
 static gboolean
 ws_cpuid(guint32 *CPUInfo, guint32 selector)
 {
 	CPUInfo[0] = CPUInfo[1] = CPUInfo[2] = CPUInfo[3] = 0;
-	__cpuid((int *) CPUInfo, selector);
+	__cpuidex((int *) CPUInfo, selector, 0);
 	/* XXX, how to check if it's supported on MSVC? just in case clear all flags above */
 	return TRUE;
 }
 
+static guint64
+ws_xgetbv(guint32 xcr)
+{
+	return _xgetbv(xcr);
+}
+
 #elif defined(__GNUC__)  /* GCC/clang */
 
 #if defined(__x86_64__)
@@ -48,9 +57,21 @@ ws_cpuid(guint32 *CPUInfo, int selector)
 							"=b" (CPUInfo[1]),
 							"=c" (CPUInfo[2]),
 							"=d" (CPUInfo[3])
-						: "a"(selector));
+						: "a"(selector), "c"(0));
 	return TRUE;
 }
+
+static inline guint64
+ws_xgetbv(guint32 xcr)
+{
+	guint32 lo, hi;
+
+	/* xgetbv, spelled out for assemblers that don't know it */
+	__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0"
+						: "=a" (lo), "=d" (hi)
+						: "c"(xcr));
+	return ((guint64) hi << 32) | lo;
+}
 #elif defined(__i386__)
 static gboolean
 ws_cpuid(guint32 *CPUInfo _U_, int selector _U_)
@@ -98,7 +119,7 @@ ws_cpuid(guint32 *CPUInfo _U_, int selector _U_)
 }
 #endif
 
-static int
+static inline int
 ws_cpuid_sse42(void)
 {
 	guint32 CPUInfo[4];
@@ -109,3 +130,29 @@ ws_cpuid_sse42(void)
 	/* in ECX bit 20 toggled on */
 	return (CPUInfo[2] & (1 << 20));
 }
+
+static inline int
+ws_cpuid_avx2(void)
+{
+#if defined(_MSC_VER) || (defined(__GNUC__) && defined(__x86_64__))
+	guint32 CPUInfo[4];
+
+	if (!ws_cpuid(CPUInfo, 0) || CPUInfo[0] < 7)
+		return 0;
+
+	/* in ECX bits 27 (OSXSAVE) and 28 (AVX) toggled on */
+	if (!ws_cpuid(CPUInfo, 1) || (CPUInfo[2] & 0x18000000) != 0x18000000)
+		return 0;
+
+	/* the OS saves the XMM and YMM registers */
+	if ((ws_xgetbv(0) & 0x6) != 0x6)
+		return 0;
+
+	/* in EBX of leaf 7 bit 5 toggled on */
+	if (!ws_cpuid(CPUInfo, 7))
+		return 0;
+	return (CPUInfo[1] & (1 << 5));
+#else
+	return 0;
+#endif
+}
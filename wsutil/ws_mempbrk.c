@@ -34,12 +34,15 @@
 #endif
 #endif
 
+#include <string.h>
+
 #include <glib.h>
 #include "ws_symbol_export.h"
 #ifdef HAVE_SSE4_2
 #include "ws_cpuid.h"
 #endif
 #include "ws_mempbrk.h"
+#include "ws_memsearch.h"
 
 const guint8 *
 _ws_mempbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles)
@@ -69,6 +72,12 @@ ws_mempbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles)
 	if (*needles == 0)
 		return NULL;
 
+	/* One or two needles, such as CR and LF, are just compared for */
+	if (needles[1] == 0)
+		return (const guint8 *)memchr(haystack, needles[0], haystacklen);
+	if (needles[2] == 0)
+		return ws_memchr2(haystack, haystacklen, needles[0], needles[1]);
+
 #ifdef HAVE_SSE4_2
 	if G_UNLIKELY(have_sse42 < 0)
 		have_sse42 = ws_cpuid_sse42();
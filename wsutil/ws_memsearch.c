@@ -0,0 +1,280 @@
+/* ws_memsearch.c
+ * Searching and scanning buffers, with SSE2 and AVX2 versions chosen
+ * at run time
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+#ifdef HAVE_AVX2
+#include "ws_cpuid.h"
+#endif
+#include "bits_ctz.h"
+#include "ws_memsearch.h"
+
+#ifdef WS_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * The plain C versions; the others hand them whatever is left over
+ * at the end of the buffer.
+ */
+const guint8 *
+_ws_memchr2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2)
+{
+	const guint8 *haystack_end = haystack + haystacklen;
+
+	while (haystack < haystack_end) {
+		if (*haystack == c1 || *haystack == c2)
+			return haystack;
+		haystack++;
+	}
+
+	return NULL;
+}
+
+const guint8 *
+_ws_memmem(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen)
+{
+	const guint8 *begin;
+	const guint8 *last_possible;
+
+	if (needlelen == 0 || needlelen > haystacklen)
+		return NULL;
+
+	/* Let memchr() find the candidates for the first byte; it is
+	 * usually much faster than a byte-at-a-time loop. */
+	last_possible = haystack + haystacklen - needlelen;
+	for (begin = haystack; begin <= last_possible; ++begin) {
+		begin = (const guint8 *)memchr(begin, needle[0],
+				last_possible - begin + 1);
+		if (begin == NULL)
+			break;
+		if (!memcmp(&begin[1], needle + 1, needlelen - 1))
+			return begin;
+	}
+
+	return NULL;
+}
+
+size_t
+_ws_ascii_span(const guint8 *buf, size_t len)
+{
+	size_t  i = 0;
+	guint32 word;
+
+	/* Four bytes at a time, then find out which one isn't ASCII */
+	for (; i + 4 <= len; i += 4) {
+		memcpy(&word, buf + i, 4);
+		if (word & 0x80808080)
+			break;
+	}
+	for (; i < len; i++) {
+		if (buf[i] & 0x80)
+			break;
+	}
+
+	return i;
+}
+
+#ifdef WS_HAVE_SSE2
+
+#define cast_128__m128i(p) ((const __m128i *) (const void *) (p))
+
+const guint8 *
+_ws_memchr2_sse2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2)
+{
+	const __m128i v1 = _mm_set1_epi8((char) c1);
+	const __m128i v2 = _mm_set1_epi8((char) c2);
+	__m128i       block;
+	int           mask;
+
+	for (; haystacklen >= 16; haystack += 16, haystacklen -= 16) {
+		block = _mm_loadu_si128(cast_128__m128i(haystack));
+		mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, v1),
+						      _mm_cmpeq_epi8(block, v2)));
+		if (mask)
+			return haystack + ws_ctz(mask);
+	}
+
+	return _ws_memchr2(haystack, haystacklen, c1, c2);
+}
+
+/*
+ * Compare the first and last bytes of the needle against 16 places
+ * at a time, and only compare the rest at the places where both match.
+ */
+const guint8 *
+_ws_memmem_sse2(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen)
+{
+	__m128i first, last;
+	size_t  i;
+	int     mask;
+
+	if (needlelen < 2 || needlelen > haystacklen)
+		return _ws_memmem(haystack, haystacklen, needle, needlelen);
+
+	first = _mm_set1_epi8((char) needle[0]);
+	last  = _mm_set1_epi8((char) needle[needlelen - 1]);
+
+	for (i = 0; i + 16 + needlelen - 1 <= haystacklen; i += 16) {
+		mask = _mm_movemask_epi8(_mm_and_si128(
+			_mm_cmpeq_epi8(first, _mm_loadu_si128(cast_128__m128i(haystack + i))),
+			_mm_cmpeq_epi8(last, _mm_loadu_si128(cast_128__m128i(haystack + i + needlelen - 1)))));
+		while (mask) {
+			const guint8 *candidate = haystack + i + ws_ctz(mask);
+
+			if (!memcmp(candidate + 1, needle + 1, needlelen - 2))
+				return candidate;
+			mask &= mask - 1;
+		}
+	}
+
+	return _ws_memmem(haystack + i, haystacklen - i, needle, needlelen);
+}
+
+size_t
+_ws_ascii_span_sse2(const guint8 *buf, size_t len)
+{
+	size_t i;
+	int    mask;
+
+	/* The high-order bits are just what movemask picks out */
+	for (i = 0; i + 16 <= len; i += 16) {
+		mask = _mm_movemask_epi8(_mm_loadu_si128(cast_128__m128i(buf + i)));
+		if (mask)
+			return i + ws_ctz(mask);
+	}
+
+	return i + _ws_ascii_span(buf + i, len - i);
+}
+
+#endif /* WS_HAVE_SSE2 */
+
+#ifdef HAVE_AVX2
+static int have_avx2 = -1;
+
+#define ws_have_avx2() \
+	(G_UNLIKELY(have_avx2 < 0) ? (have_avx2 = ws_cpuid_avx2() != 0) : have_avx2)
+#endif
+
+WS_DLL_PUBLIC const guint8 *
+ws_memchr2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2)
+{
+	if (c1 == c2)
+		return (const guint8 *)memchr(haystack, c1, haystacklen);
+
+#ifdef HAVE_AVX2
+	if (haystacklen >= 32 && ws_have_avx2())
+		return _ws_memchr2_avx2(haystack, haystacklen, c1, c2);
+#endif
+#ifdef WS_HAVE_SSE2
+	if (haystacklen >= 16)
+		return _ws_memchr2_sse2(haystack, haystacklen, c1, c2);
+#endif
+
+	return _ws_memchr2(haystack, haystacklen, c1, c2);
+}
+
+/* First bytes of the needle found without the rest before switching over */
+#define MEMMEM_FALSE_HITS	4
+
+WS_DLL_PUBLIC const guint8 *
+ws_memmem(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen)
+{
+	const guint8 *begin;
+	const guint8 *last_possible;
+	int           false_hits = 0;
+
+	if (needlelen == 0 || needlelen > haystacklen)
+		return NULL;
+
+	if (needlelen == 1)
+		return (const guint8 *)memchr(haystack, needle[0], haystacklen);
+
+	/*
+	 * memchr() is hard to beat while the first byte of the needle is
+	 * rare; once it has turned up a few times without the rest of the
+	 * needle, as "\r" does when looking for "\r\n\r\n", compare the
+	 * first and last bytes of the needle at 16 or 32 places at a time.
+	 */
+	last_possible = haystack + haystacklen - needlelen;
+	for (begin = haystack; begin <= last_possible; ++begin) {
+		begin = (const guint8 *)memchr(begin, needle[0],
+				last_possible - begin + 1);
+		if (begin == NULL)
+			return NULL;
+		if (!memcmp(&begin[1], needle + 1, needlelen - 1))
+			return begin;
+		if (++false_hits == MEMMEM_FALSE_HITS) {
+			begin++;
+			break;
+		}
+	}
+	if (begin > last_possible)
+		return NULL;
+
+	haystacklen -= begin - haystack;
+	haystack = begin;
+
+#ifdef HAVE_AVX2
+	if (haystacklen >= 32 + needlelen - 1 && ws_have_avx2())
+		return _ws_memmem_avx2(haystack, haystacklen, needle, needlelen);
+#endif
+#ifdef WS_HAVE_SSE2
+	if (haystacklen >= 16 + needlelen - 1)
+		return _ws_memmem_sse2(haystack, haystacklen, needle, needlelen);
+#endif
+
+	return _ws_memmem(haystack, haystacklen, needle, needlelen);
+}
+
+WS_DLL_PUBLIC size_t
+ws_ascii_span(const guint8 *buf, size_t len)
+{
+#ifdef HAVE_AVX2
+	if (len >= 32 && ws_have_avx2())
+		return _ws_ascii_span_avx2(buf, len);
+#endif
+#ifdef WS_HAVE_SSE2
+	if (len >= 16)
+		return _ws_ascii_span_sse2(buf, len);
+#endif
+
+	return _ws_ascii_span(buf, len);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
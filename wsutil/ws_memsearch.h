@@ -0,0 +1,72 @@
+/* ws_memsearch.h
+ * Searching and scanning buffers, with SSE2 and AVX2 versions chosen
+ * at run time
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WS_MEMSEARCH_H__
+#define __WS_MEMSEARCH_H__
+
+#include "ws_symbol_export.h"
+
+/*
+ * SSE2 is part of x86-64, and of x86 when the compiler is told it may
+ * use it throughout, so the SSE2 versions need no check at run time.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WS_HAVE_SSE2 1
+#endif
+
+/** Find the first occurrence of either of two bytes, e.g. CR and LF, in
+ * a buffer.
+ *
+ * @return a pointer to it, or NULL if there is none.
+ */
+WS_DLL_PUBLIC const guint8 *ws_memchr2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2);
+
+/** Find the first occurrence of a string of bytes in a buffer.
+ *
+ * @return a pointer to it, or NULL if there is none or the string is
+ * empty.
+ */
+WS_DLL_PUBLIC const guint8 *ws_memmem(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen);
+
+/** The number of bytes at the start of a buffer that are ASCII, i.e.
+ * that have the high-order bit clear.
+ */
+WS_DLL_PUBLIC size_t ws_ascii_span(const guint8 *buf, size_t len);
+
+const guint8 *_ws_memchr2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2);
+const guint8 *_ws_memmem(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen);
+size_t _ws_ascii_span(const guint8 *buf, size_t len);
+
+#ifdef WS_HAVE_SSE2
+const guint8 *_ws_memchr2_sse2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2);
+const guint8 *_ws_memmem_sse2(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen);
+size_t _ws_ascii_span_sse2(const guint8 *buf, size_t len);
+#endif
+
+#ifdef HAVE_AVX2
+const guint8 *_ws_memchr2_avx2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2);
+const guint8 *_ws_memmem_avx2(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen);
+size_t _ws_ascii_span_avx2(const guint8 *buf, size_t len);
+#endif
+
+#endif /* __WS_MEMSEARCH_H__ */
@@ -0,0 +1,130 @@
+/* ws_memsearch_avx2.c
+ * AVX2 versions of the buffer searching and scanning routines; these
+ * are only called if the CPU has AVX2, so this is the only file built
+ * with the compiler flag that enables it
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_AVX2
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <immintrin.h>
+
+#include "bits_ctz.h"
+#include "ws_memsearch.h"
+
+#define cast_256__m256i(p) ((const __m256i *) (const void *) (p))
+
+/*
+ * What's left over at the end of the buffer goes to the SSE2 versions,
+ * which are always there on a CPU with AVX2, but maybe not compiled in.
+ */
+#ifdef WS_HAVE_SSE2
+#define memchr2_tail	_ws_memchr2_sse2
+#define memmem_tail	_ws_memmem_sse2
+#define ascii_span_tail	_ws_ascii_span_sse2
+#else
+#define memchr2_tail	_ws_memchr2
+#define memmem_tail	_ws_memmem
+#define ascii_span_tail	_ws_ascii_span
+#endif
+
+const guint8 *
+_ws_memchr2_avx2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2)
+{
+	const __m256i v1 = _mm256_set1_epi8((char) c1);
+	const __m256i v2 = _mm256_set1_epi8((char) c2);
+	__m256i       block;
+	guint32       mask;
+
+	for (; haystacklen >= 32; haystack += 32, haystacklen -= 32) {
+		block = _mm256_loadu_si256(cast_256__m256i(haystack));
+		mask = (guint32) _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, v1),
+								      _mm256_cmpeq_epi8(block, v2)));
+		if (mask)
+			return haystack + ws_ctz(mask);
+	}
+
+	return memchr2_tail(haystack, haystacklen, c1, c2);
+}
+
+const guint8 *
+_ws_memmem_avx2(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen)
+{
+	__m256i first, last;
+	size_t  i;
+	guint32 mask;
+
+	if (needlelen < 2 || needlelen > haystacklen)
+		return _ws_memmem(haystack, haystacklen, needle, needlelen);
+
+	first = _mm256_set1_epi8((char) needle[0]);
+	last  = _mm256_set1_epi8((char) needle[needlelen - 1]);
+
+	for (i = 0; i + 32 + needlelen - 1 <= haystacklen; i += 32) {
+		mask = (guint32) _mm256_movemask_epi8(_mm256_and_si256(
+			_mm256_cmpeq_epi8(first, _mm256_loadu_si256(cast_256__m256i(haystack + i))),
+			_mm256_cmpeq_epi8(last, _mm256_loadu_si256(cast_256__m256i(haystack + i + needlelen - 1)))));
+		while (mask) {
+			const guint8 *candidate = haystack + i + ws_ctz(mask);
+
+			if (!memcmp(candidate + 1, needle + 1, needlelen - 2))
+				return candidate;
+			mask &= mask - 1;
+		}
+	}
+
+	return memmem_tail(haystack + i, haystacklen - i, needle, needlelen);
+}
+
+size_t
+_ws_ascii_span_avx2(const guint8 *buf, size_t len)
+{
+	size_t  i;
+	guint32 mask;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		mask = (guint32) _mm256_movemask_epi8(_mm256_loadu_si256(cast_256__m256i(buf + i)));
+		if (mask)
+			return i + ws_ctz(mask);
+	}
+
+	return i + ascii_span_tail(buf + i, len - i);
+}
+
+#endif /* HAVE_AVX2 */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */